@@ -142,7 +142,7 @@ cdef class SpopVec(PopVec):
         """
         Append 'p' into this object.
 
-        This is done via a serialized copy, meaning that 
+        This is done via a copy, meaning that
         this object and p will not share any pointers
         """
         self.__append_details__(copypops(p))
@@ -203,7 +203,7 @@ cdef class MlocusPopVec(PopVec):
         """
         Append 'p' into this object.
 
-        This is done via a serialized copy, meaning that 
+        This is done via a copy, meaning that
         this object and p will not share any pointers
         """
         self.__append_details__(copypops(p))
@@ -348,7 +348,7 @@ cdef class MetaPopVec(PopVec):
         """
         Append 'p' into this object.
 
-        This is done via a serialized copy, meaning that 
+        This is done via a copy, meaning that
         this object and p will not share any pointers
         """
         self.__append_details__(copypops(p))
@@ -381,3 +381,205 @@ cdef class GSLrng:
         self.thisptr = new GSLrng_t(seed)
     def __dealloc__(self):
         del self.thisptr
+
+cdef class EvolveOptions:
+    """
+    Run-time options for the "evolve" functions.
+
+    These options do not affect the model being simulated.
+    Rather, they affect how the simulation is executed.
+
+    :param nthreads: The maximum number of replicates to simulate at once.
+        The default, 0, means to use the number of cores reported by the machine.
+    :param offspring_chunks: For single-deme simulations, generate each generation's
+        offspring in this many chunks, in parallel.  The default, 0 (or 1), means
+        offspring are generated serially.
+    :param offspring_threads: The number of threads used to fill offspring chunks.
+        The default, 0, means to use the number of cores reported by the machine.
+    :param fold_fixations: For quantitative trait simulations, remove fixed selected
+        mutations from gametes and add their homozygous effects to a constant
+        offset used when calculating trait values.  Default is False.
+    :param record_ancestry: For single-deme and multi-locus simulations, record the
+        ancestry of the population instead of simulating neutral mutations forward in time.  Neutral mutations are placed on the recorded
+        genealogy.  Default is False.
+    :param simplification_interval: With record_ancestry, how often (in generations)
+        the recorded ancestry is reduced to that of the current generation.  Default is 100.
+    :param compaction_interval: Remove extinct mutations and gametes from a population's
+        containers every this many generations.  The default, 0, means never.
+    :param compaction_threshold: Also remove them whenever the fraction of live elements
+        in either container falls below this value.  The default, 0, means never.
+    :param gamete_merge_interval: Every this many generations, merge gametes carrying
+        the same mutations into one, so that the number of distinct gametes does not
+        grow with the number of recombination paths leading to the same haplotype.  The
+        default, 0, means never.
+    :param reservation_growth: Memory for mutations and gametes is reserved ahead of need,
+        following the sizes observed during the simulation: capacity is kept within this
+        factor and its cube of what has been needed, and is released (by compaction) after
+        the population contracts.  The default is 1.5.  0 means reserve once, for the
+        largest population size.
+    :param reservation_cap: If not 0, reservations ahead of need are limited so that a
+        replicate's mutations, gametes and diploids take at most this many bytes.  The
+        default is 0.
+    :param memory_budget: If not 0, a replicate is only started while the estimated memory
+        of the running replicates, including its own, is at most this many bytes, so that
+        large containers of populations are evolved in waves.  Replicates that are not
+        running are compacted.  A replicate whose estimate exceeds the budget runs on its
+        own.  The default, 0, means no budget.
+    :param numa_placement: Pin the threads running replicates to the NUMA nodes of the
+        machine, round-robin, and re-allocate each replicate's containers on the node of
+        the thread evolving it.  Does nothing where the topology cannot be read (see
+        :func:`fwdpy.fwdpy.numa_topology`).  Default is False.
+    :param huge_pages: Advise the kernel to back large containers with transparent huge
+        pages.  Default is False.
+    :param sampler_queue: If not 0, temporal samplers are applied to snapshots of each
+        replicate by a background thread, so that evolution continues while they run.
+        At most this many snapshots per replicate are waiting or being sampled.  The
+        default, 0, applies samplers in the thread evolving the replicate.
+
+    .. note:: Results depend on the seed, and on whether offspring_chunks is greater
+        than 1.  They may depend on gamete_merge_interval, as merged gametes use fewer
+        random numbers when recombining with themselves.  They do not depend on
+        nthreads, offspring_threads, the number of chunks, the compaction and
+        reservation settings, memory_budget, numa_placement, huge_pages or
+        sampler_queue.  A chunked simulation will not reproduce a serial simulation
+        using the same seed.
+
+    .. note:: fold_fixations keeps gametes from accumulating fixed selected
+        mutations, so that the cost of each generation does not grow during long
+        simulations.  Trait values are unaffected, but the fixed mutations are only
+        found in the population's fixations, and not in samples taken from it.
+        It is supported by :class:`fwdpy.qtrait.SpopAdditiveTrait`,
+        :class:`fwdpy.qtrait.SpopMultTrait`, :class:`fwdpy.qtrait.SpopGBRTrait`
+        and :class:`fwdpy.qtrait_mloc.MlocusAdditiveTrait`.  Use the same value
+        each time a population is evolved.
+
+    .. note:: With record_ancestry, the neutral mutations of a population are stored
+        separately from its gametes.  They are returned by :func:`fwdpy.fwdpy.get_samples`,
+        :func:`fwdpy.fwdpy.ms_sample` and the samples taken by :class:`fwdpy.fwdpy.PopSampler`,
+        but are not seen by other functions, such as :func:`fwdpy.fwdpy.view_mutations`.
+        Neutral mutations that become fixed are not moved to the population's fixations.
+        A population whose ancestry is recorded may only be evolved further with
+        record_ancestry set.  The recorded ancestry is kept by :func:`fwdpy.fwdpy.copypop`,
+        :func:`fwdpy.fwdpyio.serialize` and :class:`fwdpy.fwdpyio.gzSerializer`.
+        In multi-locus simulations, loci must occupy disjoint, increasing position
+        ranges, and the locus boundaries must be given to :func:`fwdpy.fwdpy.get_samples`,
+        :class:`fwdpy.fwdpy.PopSampler` and :class:`fwdpy.fwdpy.SummaryStatsSampler`,
+        so that neutral sites are assigned to loci.  Results differ from simulations
+        that do not record ancestry.
+
+    .. note:: Simulations recycle the memory of extinct mutations and gametes, so a
+        population's containers keep the size they had at the time of greatest
+        diversity, for example before a bottleneck.  Compaction shrinks them to the
+        live elements, and sorts the mutations by position.  The order of mutations
+        returned by functions such as :func:`fwdpy.fwdpy.view_mutations` may therefore
+        change.  Checking compaction_threshold requires a pass over both containers
+        each generation.  So does reservation_growth, while the population is smaller
+        than the largest size it has had during the simulation.  See
+        :func:`fwdpy.fwdpy.reservation_high_water`.
+
+    Example:
+
+    >>> import fwdpy
+    >>> #Simulate at most 8 replicates at a time:
+    >>> opts = fwdpy.EvolveOptions(nthreads=8)
+    >>> #Simulate one large replicate, using 4 offspring chunks:
+    >>> opts = fwdpy.EvolveOptions(nthreads=1,offspring_chunks=4)
+    """
+    def __cinit__(self, unsigned nthreads = 0, unsigned offspring_chunks = 0, unsigned offspring_threads = 0,
+                  bint fold_fixations = False, bint record_ancestry = False,
+                  unsigned simplification_interval = 100, unsigned compaction_interval = 0,
+                  double compaction_threshold = 0., unsigned gamete_merge_interval = 0,
+                  double reservation_growth = 1.5,
+                  size_t reservation_cap = 0, size_t memory_budget = 0,
+                  bint numa_placement = False, bint huge_pages = False,
+                  unsigned sampler_queue = 0):
+        self.opts.nthreads = nthreads
+        self.opts.offspring_chunks = offspring_chunks
+        self.opts.offspring_threads = offspring_threads
+        self.opts.fold_fixations = fold_fixations
+        self.opts.record_ancestry = record_ancestry
+        self.opts.simplification_interval = simplification_interval
+        self.opts.compaction_interval = compaction_interval
+        self.opts.compaction_threshold = compaction_threshold
+        self.opts.gamete_merge_interval = gamete_merge_interval
+        self.opts.reservation_growth = reservation_growth
+        self.opts.reservation_cap = reservation_cap
+        self.opts.memory_budget = memory_budget
+        self.opts.numa_placement = numa_placement
+        self.opts.huge_pages = huge_pages
+        self.opts.sampler_queue = sampler_queue
+    property nthreads:
+        def __get__(self):
+            return self.opts.nthreads
+        def __set__(self, unsigned value):
+            self.opts.nthreads = value
+    property offspring_chunks:
+        def __get__(self):
+            return self.opts.offspring_chunks
+        def __set__(self, unsigned value):
+            self.opts.offspring_chunks = value
+    property offspring_threads:
+        def __get__(self):
+            return self.opts.offspring_threads
+        def __set__(self, unsigned value):
+            self.opts.offspring_threads = value
+    property fold_fixations:
+        def __get__(self):
+            return self.opts.fold_fixations
+        def __set__(self, bint value):
+            self.opts.fold_fixations = value
+    property record_ancestry:
+        def __get__(self):
+            return self.opts.record_ancestry
+        def __set__(self, bint value):
+            self.opts.record_ancestry = value
+    property simplification_interval:
+        def __get__(self):
+            return self.opts.simplification_interval
+        def __set__(self, unsigned value):
+            self.opts.simplification_interval = value
+    property compaction_interval:
+        def __get__(self):
+            return self.opts.compaction_interval
+        def __set__(self, unsigned value):
+            self.opts.compaction_interval = value
+    property compaction_threshold:
+        def __get__(self):
+            return self.opts.compaction_threshold
+        def __set__(self, double value):
+            self.opts.compaction_threshold = value
+    property gamete_merge_interval:
+        def __get__(self):
+            return self.opts.gamete_merge_interval
+        def __set__(self, unsigned value):
+            self.opts.gamete_merge_interval = value
+    property reservation_growth:
+        def __get__(self):
+            return self.opts.reservation_growth
+        def __set__(self, double value):
+            self.opts.reservation_growth = value
+    property reservation_cap:
+        def __get__(self):
+            return self.opts.reservation_cap
+        def __set__(self, size_t value):
+            self.opts.reservation_cap = value
+    property memory_budget:
+        def __get__(self):
+            return self.opts.memory_budget
+        def __set__(self, size_t value):
+            self.opts.memory_budget = value
+    property numa_placement:
+        def __get__(self):
+            return self.opts.numa_placement
+        def __set__(self, bint value):
+            self.opts.numa_placement = value
+    property huge_pages:
+        def __get__(self):
+            return self.opts.huge_pages
+        def __set__(self, bint value):
+            self.opts.huge_pages = value
+    property sampler_queue:
+        def __get__(self):
+            return self.opts.sampler_queue
+        def __set__(self, unsigned value):
+            self.opts.sampler_queue = value
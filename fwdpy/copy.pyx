@@ -1,37 +1,67 @@
-import fwdpyio as fpio
-
-def copypop(PopType pop):
+def copypop(PopType pop, bint compact = False):
     """
     Copy a population
 
     :param pop: the population to copy.
+    :param compact: If True, extinct mutations and gametes are not kept by the copy.
+        The mutations of the copy are then sorted by position.
 
     :rtype: A :class:`fwdpy.fwdpy.PopType` of the same (derived) type as pop
 
-    .. note:: The function is implemented in terms of the serialization routines in the fwdpy.fwdpyio module.  The return value can be evolved and not affect the input value.
+    .. note:: The copy is made in C++, without serializing pop.  The return value can be evolved and not affect the input value.
     """
-    s = fpio.serialize(pop)
     if isinstance(pop,Spop):
-        return fpio.deserialize_singlepops(list(s))
+        s = Spop()
+        s.pop = copy_population[singlepop_t](deref((<Spop>pop).pop.get()),compact)
+        return s
     elif isinstance(pop,MetaPop):
-        return fpio.deserialize_metapops(list(s))
+        m = MetaPop()
+        m.mpop = copy_population[metapop_t](deref((<MetaPop>pop).mpop.get()),compact)
+        return m
+    elif isinstance(pop,MlocusPop):
+        ml = MlocusPop()
+        ml.pop = copy_population[multilocus_t](deref((<MlocusPop>pop).pop.get()),compact)
+        return ml
     else:
         raise RuntimeError("fwdpy.copypop: PopType "+str(type(pop))+" is not supported")
 
-def copypops(PopVec pops):
+def copypops(PopVec pops, bint compact = False, unsigned nthreads = 0):
     """
     Copy a population
 
     :param pops: the list of population to copy.
+    :param compact: If True, extinct mutations and gametes are not kept by the copies.
+        The mutations of each copy are then sorted by position.
+    :param nthreads: Max. number of populations copied at once.  0 means use the
+        number of CPUs.
 
     :rtype: A :class:`fwdpy.fwdpy.PopVec` of the same (derived) type as pop
 
-    .. note:: The function is implemented in terms of the serialization routines in the fwdpy.fwdpyio module.  The return value can be evolved and not affect the input value.
+    .. note:: The copies are made in C++, in parallel, without serializing pops.  The return value can be evolved and not affect the input value.
     """
-    s = [fpio.serialize(pop) for pop in pops]
+    cdef vector[shared_ptr[singlepop_t]] spops
+    cdef vector[shared_ptr[metapop_t]] mpops
+    cdef vector[shared_ptr[multilocus_t]] mlpops
+    cdef SpopVec s
+    cdef MetaPopVec m
+    cdef MlocusPopVec ml
     if isinstance(pops,SpopVec):
-        return fpio.deserialize_singlepops(s)
+        with nogil:
+            spops = copy_populations[singlepop_t]((<SpopVec>pops).pops,compact,nthreads)
+        s = SpopVec(0,0)
+        s.reset(spops)
+        return s
     elif isinstance(pops,MetaPopVec):
-        return fpio.deserialize_metapops(s)
+        with nogil:
+            mpops = copy_populations[metapop_t]((<MetaPopVec>pops).mpops,compact,nthreads)
+        m = MetaPopVec(0,[])
+        m.reset(mpops)
+        return m
+    elif isinstance(pops,MlocusPopVec):
+        with nogil:
+            mlpops = copy_populations[multilocus_t]((<MlocusPopVec>pops).pops,compact,nthreads)
+        ml = MlocusPopVec(0,0,0)
+        ml.reset(mlpops)
+        return ml
     else:
         raise RuntimeError("fwdpy.copypopvec: popvec type "+str(type(pops))+" is not supported")
@@ -1,3 +1,5 @@
+from fitness cimport SpopFitness,MlocusFitness,singlepop_fitness_values,multilocus_fitness_values,gamete_effect_sums
+
 def check_popdata_singlepop(Spop p):
     cdef bint csum = check_sum[gcont_t](p.pop.get().gametes,2*(<unsigned>p.pop.get().diploids.size()))
     cdef bint pds = popdata_sane[dipvector_t,gcont_t,mcont_t](p.pop.get().diploids,p.pop.get().gametes,p.pop.get().mutations,p.pop.get().mcounts)
@@ -15,17 +17,37 @@ def check_popdata_metapop(MetaPop p):
         i+=1
     return {'check_sum':csum,'popdata_sane':lpds}
 
+def check_popdata_mlocus(MlocusPop p):
+    #fwdpp's popdata_sane expects one gamete per diploid, so the
+    #equivalent checks are done here for all loci at once.
+    cdef multilocus_t * pop = p.pop.get()
+    cdef unsigned nloci = pop.diploids[0].size() if pop.diploids.size() else 0
+    cdef bint csum = check_sum[gcont_t](pop.gametes,2*nloci*(<unsigned>pop.diploids.size()))
+    cdef vector[unsigned] gcounts = vector[unsigned](pop.gametes.size(),0)
+    cdef size_t i,j
+    for i in range(pop.diploids.size()):
+        for j in range(pop.diploids[i].size()):
+            gcounts[pop.diploids[i][j].first]+=1
+            gcounts[pop.diploids[i][j].second]+=1
+    cdef bint pds = recount_mutations[multilocus_t](deref(pop)) == pop.mcounts
+    for i in range(pop.gametes.size()):
+        pds = pds and gcounts[i] == pop.gametes[i].n
+    return {'check_sum':csum,'popdata_sane':pds}
+
 def check_popdata_popvec(SpopVec p):
     return [check_popdata_singlepop(i) for i in p]
 
 def check_popdata_mpopvec(MetaPopVec p):
     return [check_popdata_metapop(i) for i in p]
 
+def check_popdata_mlocusvec(MlocusPopVec p):
+    return [check_popdata_mlocus(i) for i in p]
+
 def check_popdata(object p):
     """
     Apply fwdpp's debugging functions to population containers.
     
-    :param p: A object of type :class:`fwdpy.fwdpy.poptype` or :class:`fwdpy.fwdpy.poptype`
+    :param p: A object of type :class:`fwdpy.fwdpy.PopType` or :class:`fwdpy.fwdpy.PopVec`
 
     :rtype: Dictionary with return values (True or False). Any false values reflect a critical data inconsistency, and mean an exception should be raised.
     """
@@ -33,9 +55,208 @@ def check_popdata(object p):
         return check_popdata_popvec(p)
     elif isinstance(p,MetaPopVec):
         return check_popdata_mpopvec(p)
+    elif isinstance(p,MlocusPopVec):
+        return check_popdata_mlocusvec(p)
     elif isinstance(p,Spop):
         return check_popdata_singlepop(p)
     elif isinstance(p,MetaPop):
         return check_popdata_metapop(p)
+    elif isinstance(p,MlocusPop):
+        return check_popdata_mlocus(p)
     else:
         raise RuntimeError("object type not understood")
+
+def fitness_values(object p, object fitness, bint dispatch = True):
+    """
+    The fitness, or genetic value, of each diploid in a population.
+
+    :param p: A :class:`fwdpy.fwdpy.Spop` or :class:`fwdpy.fwdpy.MlocusPop`
+    :param fitness: A :class:`fwdpy.fitness.SpopFitness` or :class:`fwdpy.fitness.MlocusFitness`, matching p.
+    :param dispatch: (True) Evaluate built-in models as the "evolve" functions do.  If False, use the
+        model's std::function, as for custom fitness functions.
+
+    :rtype: A list with one value per diploid.
+
+    .. note:: This is intended for testing that both ways of evaluating a model agree.
+    """
+    if isinstance(p,Spop) and isinstance(fitness,SpopFitness):
+        return singlepop_fitness_values(deref((<Spop>p).pop.get()),deref((<SpopFitness>fitness).wfxn.get()),dispatch)
+    elif isinstance(p,MlocusPop) and isinstance(fitness,MlocusFitness):
+        return multilocus_fitness_values(deref((<MlocusPop>p).pop.get()),(<MlocusFitness>fitness).wfxn,dispatch)
+    else:
+        raise RuntimeError("object types not understood")
+
+def effect_sums_by_simd_level(Spop p):
+    """
+    Values computed over the selected mutations of each gamete by the kernels
+    used by built-in models, which use SIMD instructions, for each instruction set
+    supported by this CPU.
+
+    :param p: A :class:`fwdpy.fwdpy.Spop`
+
+    :rtype: A list with one element per instruction set, starting with the code path
+        that does not use SIMD.  Each element is a list holding, for each gamete, the
+        sum of s, and then the het. and hom. values of the additive and of the
+        multiplicative site-dependent models with scaling 2.
+
+    .. note:: This is intended for testing that all code paths agree.
+    """
+    return gamete_effect_sums(deref(p.pop.get()))
+
+def mutation_bookkeeping(Spop p):
+    """
+    The data kept by a population about its mutations, for testing.
+
+    :param p: A :class:`fwdpy.fwdpy.Spop`
+
+    :rtype: A dictionary.  mcounts holds the number of copies of each mutation,
+        as stored by the population, and recount the same numbers found by
+        scanning all diploids.  positions holds the position of each mutation,
+        lookup the positions in the lookup table used to avoid mutating the same
+        position twice, and fixations the positions of the recorded fixations.
+    """
+    cdef singlepop_t * pop = p.pop.get()
+    return {'mcounts':pop.mcounts,
+            'recount':recount_mutations[singlepop_t](deref(pop)),
+            'positions':[pop.mutations[i].pos for i in range(pop.mutations.size())],
+            'lookup':sorted_lookup_positions(pop.mut_lookup),
+            'fixations':[pop.fixations[i].pos for i in range(pop.fixations.size())]}
+
+def multilocus_gametes(MlocusPop p):
+    """
+    The gametes carried by each diploid of a multi-locus population, for testing.
+
+    :param p: A :class:`fwdpy.fwdpy.MlocusPop`
+
+    :rtype: A list with one element per diploid.  Each element is a pair of tuples,
+        holding the index of the diploid's first and second gamete at each locus.
+    """
+    cdef multilocus_t * pop = p.pop.get()
+    cdef size_t i,j
+    rv=[]
+    for i in range(pop.diploids.size()):
+        rv.append((tuple([pop.diploids[i][j].first for j in range(pop.diploids[i].size())]),
+                   tuple([pop.diploids[i][j].second for j in range(pop.diploids[i].size())])))
+    return rv
+
+def gamete_key_storage_singlepop(Spop p):
+    return gamete_key_storage[singlepop_t](deref(p.pop.get()))
+
+def gamete_key_storage_mlocus(MlocusPop p):
+    return gamete_key_storage[multilocus_t](deref(p.pop.get()))
+
+def gamete_key_storage_stats(object p):
+    """
+    Statistics on the memory used by gametes to store the keys of their mutations.
+
+    :param p: A :class:`fwdpy.fwdpy.Spop`, :class:`fwdpy.fwdpy.MlocusPop`, or a
+        :class:`fwdpy.fwdpy.SpopVec` or :class:`fwdpy.fwdpy.MlocusPopVec`
+
+    :rtype: A dictionary, or a list of them for a container of populations.  bytes_live
+        is the storage owned by extant gametes.  bytes_reserved also includes extinct
+        gametes and buffers kept for re-use.  recycle_hits counts the gametes made with a
+        buffer kept for re-use, in_place the gametes made in the storage of a recycled
+        gamete, and allocations the gametes for which storage was allocated.
+
+    .. note:: Only gametes made by multi-locus simulations, and by single-deme
+        simulations when offspring_chunks of :class:`fwdpy.fwdpy.EvolveOptions` is
+        greater than 1 or with record_ancestry, are counted.
+    """
+    if isinstance(p,SpopVec):
+        return [gamete_key_storage_singlepop(i) for i in p]
+    elif isinstance(p,MlocusPopVec):
+        return [gamete_key_storage_mlocus(i) for i in p]
+    elif isinstance(p,Spop):
+        return gamete_key_storage_singlepop(p)
+    elif isinstance(p,MlocusPop):
+        return gamete_key_storage_mlocus(p)
+    else:
+        raise RuntimeError("object type not understood")
+
+def reservation_high_water(object p):
+    """
+    High-water marks of the containers of a population, recorded by the "evolve"
+    functions.  See reservation_growth in :class:`fwdpy.fwdpy.EvolveOptions`.
+
+    :param p: A :class:`fwdpy.fwdpy.Spop`, :class:`fwdpy.fwdpy.MlocusPop`, or a
+        :class:`fwdpy.fwdpy.SpopVec` or :class:`fwdpy.fwdpy.MlocusPopVec`
+
+    :rtype: A dictionary, or a list of them for a container of populations.  mutations,
+        gametes and diploids are the largest sizes reached, and bytes the largest amount
+        of memory reserved by the three containers, not counting the mutation keys held
+        by gametes.  grown and shrunk count the times memory was reserved ahead of need
+        or released, and capped the times a reservation was limited by reservation_cap.
+
+    .. note:: The marks accumulate over all calls to "evolve" functions, and are not
+        copied by serialization.
+    """
+    if isinstance(p,SpopVec) or isinstance(p,MlocusPopVec):
+        return [reservation_high_water(i) for i in p]
+    elif isinstance(p,Spop):
+        return (<Spop>p).pop.get().reservation
+    elif isinstance(p,MlocusPop):
+        return (<MlocusPop>p).pop.get().reservation
+    else:
+        raise RuntimeError("object type not understood")
+
+def numa_topology():
+    """
+    The NUMA nodes used by the numa_placement option of :class:`fwdpy.fwdpy.EvolveOptions`.
+
+    :rtype: A list with, for each node, the list of CPUs of that node that fwdpy may run
+        on.  Empty if the topology cannot be read, in which case numa_placement does
+        nothing.
+    """
+    return numa_nodes()
+
+def diploid_layout():
+    """
+    The layout of diploids in this build of fwdpy.
+
+    :rtype: A dict.  'compact' is True for a build with --compact-diploid, in which
+        the genetic value, environmental value, fitness and label of each diploid are
+        stored apart from the diploids.  'diploid_bytes' is the size of one diploid.
+    """
+    return {'compact':compact_diploid_layout,'diploid_bytes':sizeof(diploid_t)}
+
+def alias_sampler_counts(GSLrng rng, list weights, unsigned ndraws):
+    """
+    Draw from the table used to pick parents, built from weights.
+
+    :param rng: A :class:`fwdpy.fwdpy.GSLrng`
+    :param weights: A list of non-negative weights, not all zero.
+    :param ndraws: The number of draws.
+
+    :rtype: A list with the number of times each index was drawn.
+
+    .. note:: This is intended for testing the table.
+    """
+    cdef vector[double] w = weights
+    cdef alias_sampler a
+    a.rebuild(w.data(),w.size())
+    cdef vector[unsigned] counts = vector[unsigned](w.size(),0)
+    cdef unsigned i
+    for i in range(ndraws):
+        counts[a(rng.thisptr.get())]+=1
+    return counts
+
+def alias_sampler_reserved_bytes(list sizes):
+    """
+    Rebuild one table used to pick parents for each number of weights
+    in sizes, in turn.
+
+    :rtype: A list with the bytes owned by the table after each rebuild.
+
+    .. note:: This is intended for testing that rebuilding the table re-uses its storage.
+    """
+    cdef alias_sampler a
+    cdef vector[double] w
+    cdef size_t n,i
+    rv=[]
+    for n in sizes:
+        w.resize(n)
+        for i in range(n):
+            w[i]=float(1+(i+len(rv))%7)
+        a.rebuild(w.data(),n)
+        rv.append(a.reserved_bytes())
+    return rv
@@ -38,12 +38,13 @@ def evolve_regions(GSLrng rng,
                    list recregions,
                    double f = 0,
                    double scaling = 2.0,
-                   const char * fitness = "multiplicative",):
+                   const char * fitness = "multiplicative",
+                   EvolveOptions options = None):
     """
     Evolve a region with variable mutation, fitness effects, and recombination rates.
 
     :param rng: a :class:`GSLrng`
-    :param npops: The number of populations to simulate.  This is equal to the number of threads that will be used!
+    :param npops: The number of populations to simulate.  See :class:`fwdpy.fwdpy.EvolveOptions` for how many are run at once.
     :param N: The diploid population size to simulate
     :param nlist: An array view of a NumPy array.  This represents the population sizes over time.  The length of this view is the length of the simulation in generations. The view must be of an array of 32 bit, unsigned integers (see example).
     :param mu_neutral: The mutation rate to variants not affecting fitness ("neutral" mutations).  The unit is per gamete, per generation.
@@ -55,6 +56,7 @@ def evolve_regions(GSLrng rng,
     :param f: The selfing probabilty
     :param scaling: For a single mutation, fitness is calculated as 1, 1+sh, and 1+scaling*s for genotypes AA, Aa, and aa, respectively.
     :param fitness: The fitness model.  Must be either "multiplicative" or "additive".
+    :param options: (None) A :class:`fwdpy.fwdpy.EvolveOptions`.
 
     :raises: RuntimeError if parameters do not pass checks
 
@@ -95,7 +97,7 @@ def evolve_regions(GSLrng rng,
     evolve_regions_sampler(rng,pops,donothing,nlist,
                            mu_neutral,mu_selected,recrate,
                            nregions,sregions,recregions,len(nlist),
-                           f,scaling,fitness)
+                           f,scaling,fitness,options)
     return pops
 
 @cython.boundscheck(False)
@@ -110,7 +112,8 @@ def evolve_regions_more(GSLrng rng,
                         list recregions,
                         double f = 0,
                         double scaling = 2.0,
-                        const char * fitness = "multiplicative"):
+                        const char * fitness = "multiplicative",
+                        EvolveOptions options = None):
     """
     Continue to evolve a region with variable mutation, fitness effects, and recombination rates.
 
@@ -126,6 +129,7 @@ def evolve_regions_more(GSLrng rng,
     :param f: The selfing probabilty
     :param scaling: For a single mutation, fitness is calculated as 1, 1+sh, and 1+scaling*s for genotypes AA, Aa, and aa, respectively.
     :param fitness: The fitness model.  Must be either "multiplicative" or "additive".
+    :param options: (None) A :class:`fwdpy.fwdpy.EvolveOptions`.
 
     :raises: RuntimeError if parameters do not pass checks
 
@@ -149,12 +153,12 @@ def evolve_regions_more(GSLrng rng,
     evolve_regions_sampler(rng,pops,donothing,nlist,
                            mu_neutral,mu_selected,recrate,
                            nregions,sregions,recregions,int(len(nlist)),
-                           f,scaling,fitness)
+                           f,scaling,fitness,options)
 
 @cython.boundscheck(False)
 def evolve_regions_sampler(GSLrng rng,
                            SpopVec pops,
-                           TemporalSampler slist,
+                           slist,
                            unsigned[:] nlist,
                            double mu_neutral,
                            double mu_selected,
@@ -165,13 +169,14 @@ def evolve_regions_sampler(GSLrng rng,
                            int sample,
                            double f = 0,
                            double scaling = 2.0,
-                           const char * fitness = "multiplicative"):
+                           const char * fitness = "multiplicative",
+                           EvolveOptions options = None):
     """
     Evolve a single population under standard population genetic fitness models and apply a "sampler" at regular intervals.
     
     :param rng: a :class:`GSLrng`
     :param pops: A :class:`SpopVec`
-    :param slist: A :class:`TemporalSampler`.
+    :param slist: A :class:`TemporalSampler`, or a list of them, applied together via a :class:`CompositeSampler`.
     :param nlist: An array view of a NumPy array.  This represents the population sizes over time.  The length of this view is the length of the simulation in generations. The view must be of an array of 32 bit, unsigned integers (see example).
     :param mu_neutral: The mutation rate to variants not affecting fitness ("neutral" mutations).  The unit is per gamete, per generation.
     :param mu_selected: The mutation rate to variants affecting fitness ("selected" mutations).  The unit is per gamete, per generation.
@@ -183,6 +188,7 @@ def evolve_regions_sampler(GSLrng rng,
     :param f: The selfing probabilty
     :param scaling: For a single mutation, fitness is calculated as 1, 1+sh, and 1+scaling*s for genotypes AA, Aa, and aa, respectively.
     :param fitness: The fitness model.  Must be either "multiplicative" or "additive".
+    :param options: (None) A :class:`fwdpy.fwdpy.EvolveOptions`.
     """
 
     if fitness == b'multiplicative':
@@ -190,13 +196,13 @@ def evolve_regions_sampler(GSLrng rng,
         evolve_regions_sampler_fitness(rng,pops,slist,ffm,nlist,
                                        mu_neutral,mu_selected,recrate,
                                        nregions,sregions,recregions,
-                                       sample,f)
+                                       sample,f,options)
     elif fitness == b'additive':
         ffa = SpopAdditive(scaling)
         evolve_regions_sampler_fitness(rng,pops,slist,ffa,nlist,
                                        mu_neutral,mu_selected,recrate,
                                        nregions,sregions,recregions,
-                                       sample,f)
+                                       sample,f,options)
 
     else:
         raise RuntimeError("fitness must be either multiplicative or additive")
@@ -204,7 +210,7 @@ def evolve_regions_sampler(GSLrng rng,
 @cython.boundscheck(False)
 def evolve_regions_sampler_fitness(GSLrng rng,
                                    SpopVec pops,
-                                   TemporalSampler slist,
+                                   slist,
                                    SpopFitness fitness_function,
                                    unsigned[:] nlist,
                                    double mu_neutral,
@@ -214,13 +220,14 @@ def evolve_regions_sampler_fitness(GSLrng rng,
                                    list sregions,
                                    list recregions,
                                    int sample,
-                                   double f = 0):
+                                   double f = 0,
+                                   EvolveOptions options = None):
     """
     Evolve a single population under arbitrary fitness models and apply a "sampler" at regular intervals.
     
     :param rng: a :class:`GSLrng`
     :param pops: A :class:`SpopVec`
-    :param slist: A :class:`TemporalSampler`.
+    :param slist: A :class:`TemporalSampler`, or a list of them, applied together via a :class:`CompositeSampler`.
     :param fitness_function: A :class:`fwdpy.fitness.SpopFitness`
     :param nlist: An array view of a NumPy array.  This represents the population sizes over time.  The length of this view is the length of the simulation in generations. The view must be of an array of 32 bit, unsigned integers (see example).
     :param mu_neutral: The mutation rate to variants not affecting fitness ("neutral" mutations).  The unit is per gamete, per generation.
@@ -231,6 +238,7 @@ def evolve_regions_sampler_fitness(GSLrng rng,
     :param recregions: A list specifying how the genetic map varies along the region
     :param sample: Apply the temporal sampler every 'sample' generations during the simulation. 0 means it will never get applied, which may or may not be what you want.
     :param f: The selfing probabilty
+    :param options: (None) A :class:`fwdpy.fwdpy.EvolveOptions`.
     """
     check_input_params(mu_neutral,mu_selected,recrate,nregions,sregions,recregions)
     if sample < 0:
@@ -240,6 +248,9 @@ def evolve_regions_sampler_fitness(GSLrng rng,
         f=0
     rmgr = region_manager_wrapper()
     internal.make_region_manager(rmgr,nregions,sregions,recregions)
+    if options is None:
+        options = EvolveOptions()
     cdef size_t listlen = len(nlist)
+    cdef TemporalSampler sampler = slist if isinstance(slist,TemporalSampler) else CompositeSampler(slist)
     evolve_regions_sampler_cpp(rng.thisptr,pops.pops,
-                               slist.vec,&nlist[0],listlen,mu_neutral,mu_selected,recrate,f,sample,rmgr.thisptr,deref(fitness_function.wfxn.get()))
+                               sampler.vec,&nlist[0],listlen,mu_neutral,mu_selected,recrate,f,sample,rmgr.thisptr,deref(fitness_function.wfxn.get()),options.opts)
@@ -39,6 +39,9 @@ cdef extern from "fwdpy_fitness.hpp" namespace "fwdpy" nogil:
 		          haplotype_fitness_fxn_finalizer f)
         void update(const singlepop_t *)
 
+    cdef cppclass singlepop_gbr_trait(singlepop_fitness):
+        singlepop_gbr_trait()
+
     cdef cppclass multilocus_fitness:
         multilocus_fitness()
         void update(const multilocus_t *)
@@ -54,6 +57,26 @@ cdef extern from "fwdpy_fitness.hpp" namespace "fwdpy" nogil:
     ctypedef double(*mlocus_fitness_fxn)(const vector[diploid_t] &, const gcont_t &, const mcont_t &)
     multilocus_fitness make_mloc_custom_fitness(mlocus_fitness_fxn f)
     
+cdef extern from "site_fitness_cache.hpp" namespace "fwdpy" nogil:
+    cdef enum site_dependent_model_t:
+        additive_site_model
+        multiplicative_site_model
+    singlepop_fitness * make_cached_site_fitness(site_dependent_model_t model,
+                                                 double scaling,
+                                                 fitness_function_finalizer wfinal,
+                                                 double starting_fitness)
+
+cdef extern from "fitness_dispatch.hpp" namespace "fwdpy" nogil:
+    vector[double] singlepop_fitness_values(const singlepop_t & pop,
+                                            const singlepop_fitness & fitness,
+                                            bint dispatch) except +
+    vector[double] multilocus_fitness_values(const multilocus_t & pop,
+                                             const multilocus_fitness & fitness,
+                                             bint dispatch) except +
+
+cdef extern from "mutation_effect_table.hpp" namespace "fwdpy" nogil:
+    vector[vector[double]] gamete_effect_sums(const singlepop_t & pop)
+
 #Helper functions for making custom fitness functions
 cdef inline double return_w(double w) nogil:
     return max[double](0.0,w)
@@ -94,8 +117,14 @@ cdef inline void hom_mult_update_1(double & w, const popgenmut & m) nogil:
 cdef inline genotype_fitness_updater choose_mult_hom_updater(int scaling) nogil:
     #Defaults to using a scaling of 2
     if scaling==1:
-        return <genotype_fitness_updater>hom_additive_update_1
-    return <genotype_fitness_updater>hom_additive_update_2
+        return <genotype_fitness_updater>hom_mult_update_1
+    return <genotype_fitness_updater>hom_mult_update_2
+
+cdef inline double choose_hom_scaling(int scaling) nogil:
+    #Same mapping as choose_additive_hom_updater/choose_mult_hom_updater
+    if scaling==1:
+        return 1.0
+    return 2.0
 
 cdef inline double sum_haplotype_effects(const gamete_t & g, const mcont_t & m) nogil:
     cdef size_t i=0,n=g.smutations.size()
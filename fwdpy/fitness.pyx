@@ -2,31 +2,45 @@ cdef class SpopAdditive(SpopFitness):
     """
     Additive fitness model for a single deme.
     """
-    def __cinit__(self,int scaling = 2):
+    def __cinit__(self,int scaling = 2,bint cache = True):
         """
         Constructor
 
         :param scaling: For a single mutation, fitness is calculated as 1, 1+sh, and 1+scaling*s for genotypes AA, Aa, and aa, respectively
+        :param cache: (True) Cache per-gamete values.  The results are the same either way.
         """
-        self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_additive_update,
-                                                                        choose_additive_hom_updater(scaling),
-                                                                        return_w_plus1,
-                                                                        0.0))
+        if not cache:
+            self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_additive_update,
+                                                                            choose_additive_hom_updater(scaling),
+                                                                            return_w_plus1,
+                                                                            0.0))
+            return
+        self.wfxn = unique_ptr[singlepop_fitness](make_cached_site_fitness(additive_site_model,
+                                                                          choose_hom_scaling(scaling),
+                                                                          return_w_plus1,
+                                                                          0.0))
         
 cdef class SpopMult(SpopFitness):
     """
     Multiplicative fitness model for a single deme.
     """
-    def __cinit__(self,int scaling = 1):
+    def __cinit__(self,int scaling = 1,bint cache = True):
         """
         Constructor
 
         :param scaling: For a single mutation, fitness is calculated as 1, 1+sh, and 1+scaling*s for genotypes AA, Aa, and aa, respectively
+        :param cache: (True) Cache per-gamete values.  The results are the same either way.
         """
-        self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_mult_update,
-                                                                        choose_mult_hom_updater(scaling),
-                                                                        return_w,
-                                                                        1.0))
+        if not cache:
+            self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_mult_update,
+                                                                            choose_mult_hom_updater(scaling),
+                                                                            return_w,
+                                                                            1.0))
+            return
+        self.wfxn = unique_ptr[singlepop_fitness](make_cached_site_fitness(multiplicative_site_model,
+                                                                          choose_hom_scaling(scaling),
+                                                                          return_w,
+                                                                          1.0))
         
 cdef class MlocusAdditive(MlocusFitness):
     """
@@ -4,6 +4,7 @@ from libcpp.string cimport string
 from libcpp.memory cimport shared_ptr,unique_ptr
 
 from libcpp.map cimport map
+from libc.stdint cimport uint64_t
 
 from fwdpy.internal.internal cimport *
 from fwdpy.fwdpp cimport popgenmut,gamete_base
@@ -11,12 +12,22 @@ from fwdpy.cpp cimport hash,mutex
 from libcpp.unordered_set cimport unordered_set
 from libcpp.unordered_map cimport unordered_map
 from cython_gsl cimport gsl_rng
-from fwdpy.structs cimport qtrait_stats_cython,allele_age_data_t,VAcum,popsample_details
+from fwdpy.structs cimport qtrait_stats_cython,allele_age_data_t,VAcum,popsample_details,summary_stats
 from fwdpy.fitness cimport singlepop_fitness
 
 ##Create hooks to C++ types
 ctypedef vector[unsigned] ucont_t
 
+cdef extern from "reserve.hpp" namespace "fwdpy" nogil:
+    cdef struct reservation_stats:
+        size_t mutations
+        size_t gametes
+        size_t diploids
+        size_t bytes
+        unsigned grown
+        unsigned shrunk
+        unsigned capped
+
 #Wrap the classes:
 cdef extern from "types.hpp" namespace "fwdpy" nogil:
     # "Standard" popgen types
@@ -25,12 +36,32 @@ cdef extern from "types.hpp" namespace "fwdpy" nogil:
     ctypedef vector[popgenmut] mcont_t
     ctypedef unordered_set[double,equal_eps] lookup_t
     
+    #32 bits in a build with --compact-diploid
+    ctypedef size_t gamete_index_t
+    const bint compact_diploid_layout
+
     cdef cppclass diploid_t:
-        size_t first,second,label;
-        double g,e,w
+        gamete_index_t first,second
 
     ctypedef vector[diploid_t] dipvector_t
 
+    #g, e, w and label of each diploid, read via trait_g() and friends.
+    #Depending on the build, these are stored by the diploids or apart
+    #from them.  See diploid_t in types.hpp.
+    cdef cppclass diploid_traits_t:
+        pass
+    cdef cppclass mloc_traits_t:
+        pass
+
+    double trait_g(const diploid_traits_t &, size_t)
+    double trait_e(const diploid_traits_t &, size_t)
+    double trait_w(const diploid_traits_t &, size_t)
+    size_t trait_label(const diploid_traits_t &, size_t)
+    double trait_g(const mloc_traits_t &, size_t)
+    double trait_e(const mloc_traits_t &, size_t)
+    double trait_w(const mloc_traits_t &, size_t)
+    size_t trait_label(const mloc_traits_t &, size_t)
+
     cdef cppclass singlepop_t:
         singlepop_t(unsigned)
         unsigned N
@@ -42,13 +73,15 @@ cdef extern from "types.hpp" namespace "fwdpy" nogil:
         mcont_t fixations
         ucont_t fixation_times
         lookup_t mut_lookup
+        reservation_stats reservation
+        const diploid_traits_t & traits() const
         unsigned gen()
         unsigned popsize()
         int sane()
         string serialize() const
         void deserialize(const string &)
         int tofile(const char *,bint)
-        void fromfile(const char *,size_t)
+        void fromfile(const char *,size_t) except +
         void clear()
 
     cdef cppclass metapop_t:
@@ -63,13 +96,14 @@ cdef extern from "types.hpp" namespace "fwdpy" nogil:
         mcont_t fixations
         ucont_t fixation_times
         lookup_t mut_lookup
+        const diploid_traits_t & traits(size_t) const
         ucont_t popsizes()
         int sane()
         int size()
         string serialize() const
         void deserialize(const string &)
         int tofile(const char *,bint)
-        void fromfile(const char *,size_t)
+        void fromfile(const char *,size_t) except +
         void clear()
 
     cdef cppclass multilocus_t:
@@ -85,13 +119,15 @@ cdef extern from "types.hpp" namespace "fwdpy" nogil:
         mcont_t fixations
         ucont_t fixation_times
         lookup_t mut_lookup
+        reservation_stats reservation
+        const mloc_traits_t & traits() const
         int gen()
         int sane()
         int popsize()
         string serialize() const
         void deserialize(const string &)
         int tofile(const char *,bint)
-        void fromfile(const char *,size_t)
+        void fromfile(const char *,size_t) except +
         void clear()
 
     # Types based around KTfwd::generalmut_vec
@@ -114,7 +150,7 @@ cdef extern from "types.hpp" namespace "fwdpy" nogil:
         string serialize() const
         void deserialize(const string &)
         int tofile(const char *,bint)
-        void fromfile(const char *,size_t)
+        void fromfile(const char *,size_t) except +
         void clear()
 
     cdef cppclass GSLrng_t:
@@ -190,6 +226,28 @@ cdef class MlocusPopVec(PopVec):
 cdef class GSLrng:
     cdef GSLrng_t * thisptr
 
+cdef extern from "evolve_options.hpp" namespace "fwdpy" nogil:
+    cdef cppclass evolve_options:
+        evolve_options()
+        unsigned nthreads
+        unsigned offspring_chunks
+        unsigned offspring_threads
+        bint fold_fixations
+        bint record_ancestry
+        unsigned simplification_interval
+        unsigned compaction_interval
+        double compaction_threshold
+        unsigned gamete_merge_interval
+        double reservation_growth
+        size_t reservation_cap
+        size_t memory_budget
+        bint numa_placement
+        bint huge_pages
+        unsigned sampler_queue
+
+cdef class EvolveOptions:
+    cdef evolve_options opts
+
 #Functions relating to built-in temporal sampling features
 
 cdef extern from "sampler_base.hpp" namespace "fwdpy" nogil:
@@ -247,6 +305,14 @@ cdef extern from "sampler_base.hpp" namespace "fwdpy" nogil:
 
     void apply_sampler_single_cpp[T](const T *pop,const vector[unique_ptr[sampler_base]] & samplers)
 
+    #Applies several samplers to a population, sharing one
+    #traversal of it between those that support it.
+    #Children are not owned.
+    cdef cppclass composite_sampler(sampler_base):
+        composite_sampler()
+        void add(sampler_base *) except +
+        size_t size() const
+
 cdef extern from "sampler_no_sampling.hpp" namespace "fwdpy" nogil:
     cdef cppclass no_sampling(sampler_base):
         no_sampling()
@@ -272,16 +338,18 @@ cdef extern from "sampler_sample_n.hpp" namespace "fwdpy" nogil:
         popSampleData rv
         popSampleData final() const
 
+cdef extern from "sampler_summary_stats.hpp" namespace "fwdpy" nogil:
+    cdef cppclass sample_summary_stats(sampler_base):
+        sample_summary_stats(unsigned, const gsl_rng * r,
+                const vector[pair[double,double]] & boundaries) except +
+        vector[summary_stats] final() const
+
 #The following typedefs help us with the
 #frequency tracker API.
 ctypedef pair[uint,double] genfreqPair
 ctypedef unordered_map[uint,map[pair[double,double],vector[genfreqPair]]] freqTraj 
 
 cdef extern from "sampler_selected_mut_tracker.hpp" namespace "fwdpy" nogil:
-    cdef cppclass selected_mut_tracker(sampler_base):
-        selected_mut_tracker()
-        freqTraj final() const
-
     ctypedef bool(*origin_filter_fxn)(unsigned)
     ctypedef bool(*pos_esize_filter_fxn)(const pair[double,double] &)
     ctypedef bool(*freq_filter_fxn)(const vector[pair[uint,double]] &)
@@ -298,6 +366,13 @@ cdef extern from "sampler_selected_mut_tracker.hpp" namespace "fwdpy" nogil:
         void register_callback(bool(*)(const pair[double,double]&,const T&))
         void register_callback(bool(*)(const vector[pair[uint,double]]&,const T&))
 
+    #The trajFilter, if not NULL, must outlive the tracker
+    cdef cppclass selected_mut_tracker(sampler_base):
+        selected_mut_tracker(const trajFilter * tf, double min_freq, unsigned existed_past)
+        freqTraj final() const
+        size_t ntrajectories() const
+        size_t nrecords() const
+
     void traj2sql(
         const vector[unique_ptr[sampler_base]] &samplers,
         const shared_ptr[mutex] & dblock,
@@ -323,6 +398,9 @@ cdef class QtraitStatsSampler(TemporalSampler):
 cdef class PopSampler(TemporalSampler):
     pass
 
+cdef class SummaryStatsSampler(TemporalSampler):
+    pass
+
 cdef class VASampler(TemporalSampler):
     pass
 
@@ -333,7 +411,10 @@ cdef class TrajExistedPast(TrajFilter):
     pass
 
 cdef class FreqSampler(TemporalSampler):
-    pass
+    cdef readonly TrajFilter traj_filter
+
+cdef class CompositeSampler(TemporalSampler):
+    cdef readonly list samplers
 
 
 
@@ -371,8 +452,8 @@ cdef struct diploid_mloc_data:
 
 cdef popgen_mut_data get_mutation( const popgenmut & m, size_t n) nogil
 cdef gamete_data get_gamete( const gamete_t & g, const mcont_t & mutations, const mcounts_cont_t & mcounts) nogil
-cdef diploid_data get_diploid( const diploid_t & dip, const gcont_t & gametes, const mcont_t & mutations, const mcounts_cont_t & mcounts) nogil
-cdef diploid_mloc_data get_diploid_mloc( const dipvector_t & dip, const gcont_t & gametes, const mcont_t & mutations, const mcounts_cont_t & mcounts) nogil
+cdef diploid_data get_diploid( const dipvector_t & diploids, const diploid_traits_t & traits, size_t i, const gcont_t & gametes, const mcont_t & mutations, const mcounts_cont_t & mcounts) nogil
+cdef diploid_mloc_data get_diploid_mloc( const vector[dipvector_t] & diploids, const mloc_traits_t & traits, size_t i, const gcont_t & gametes, const mcont_t & mutations, const mcounts_cont_t & mcounts) nogil
 
 ##Now, wrap the functions.
 ##To whatever extent possible, we avoid cdef externs in favor of Cython fxns based on cpp types.
@@ -410,7 +491,8 @@ cdef extern from "evolve_regions_sampler.hpp" namespace "fwdpy" nogil:
 				     const double f,
 				     const int sample,
 				     const region_manager * rm,
-				     const singlepop_fitness & fitness) except +
+				     const singlepop_fitness & fitness,
+				     const evolve_options & options) except +
 
 
 cdef extern from "sampling_wrappers.hpp" namespace "fwdpy" nogil:
@@ -421,6 +503,35 @@ cdef extern from "sampling_wrappers.hpp" namespace "fwdpy" nogil:
     vector[sep_sample_t] sample_sep_single_mloc[POPTYPE](gsl_rng * r,const POPTYPE & p, const unsigned nsam, const bool
             removeFixed, const vector[pair[double,double]] &)  except +
 
+cdef extern from "gamete_key_arena.hpp" namespace "fwdpy" nogil:
+    cdef struct key_storage_stats:
+        size_t bytes_live
+        size_t bytes_reserved
+        uint64_t recycle_hits
+        uint64_t in_place
+        uint64_t allocations
+    key_storage_stats gamete_key_storage[POPTYPE](const POPTYPE & pop)
+
+cdef extern from "alias_sampler.hpp" namespace "fwdpy" nogil:
+    cdef cppclass alias_sampler:
+        alias_sampler()
+        void rebuild(const double * weights, const size_t n) except +
+        size_t size() const
+        size_t reserved_bytes() const
+        size_t operator()(const gsl_rng * r) const
+
+cdef extern from "fwdpp_features.hpp" namespace "fwdpy" nogil:
+    vector[unsigned] recount_mutations[POPTYPE](const POPTYPE & pop)
+    vector[double] sorted_lookup_positions(const lookup_t & lookup)
+
+cdef extern from "copy_populations.hpp" namespace "fwdpy" nogil:
+    shared_ptr[POPTYPE] copy_population[POPTYPE](const POPTYPE & pop, const bint compact) except +
+    vector[shared_ptr[POPTYPE]] copy_populations[POPTYPE](const vector[shared_ptr[POPTYPE]] & pops,
+                                                          const bint compact, const unsigned nthreads) except +
+
+cdef extern from "numa_placement.hpp" namespace "fwdpy" nogil:
+    vector[vector[unsigned]] numa_nodes()
+
 cdef extern from "fwdpy_add_mutations.hpp" namespace "fwdpy" nogil:
     size_t add_mutation_cpp(singlepop_t * pop,
                             const vector[size_t] & indlist,
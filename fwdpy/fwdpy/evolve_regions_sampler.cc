@@ -7,14 +7,22 @@
 #include <fwdpp/sugar/sampling.hpp>
 #include <iterator>
 #include <memory>
-#include <thread>
 #include <type_traits>
 #include <vector>
 
+#include "ancestry_tables.hpp"
+#include "compaction.hpp"
+#include "counter_rng.hpp"
 #include "evolve_regions_sampler.hpp"
+#include "fitness_dispatch.hpp"
+#include "replicate_admission.hpp"
+#include "replicate_scheduler.hpp"
 #include "fwdpy_fitness.hpp"
+#include "mutation_effect_table.hpp"
 #include "reserve.hpp"
+#include "sample_diploid_chunked.hpp"
 #include "sampler_base.hpp"
+#include "sampler_pipeline.hpp"
 #include "types.hpp"
 #include "wf_rules.hpp"
 
@@ -22,23 +30,31 @@ using namespace std;
 
 namespace fwdpy
 {
+    template <typename fitness_t>
     void
     evolve_regions_sampler_cpp_details(
-        singlepop_t *pop, const unsigned long seed, const unsigned *Nvector,
+        singlepop_t *pop, const rng_stream_key &stream,
+        const unsigned *Nvector,
         const size_t Nvector_len, const double neutral, const double selected,
         const double recrate, const double f,
-        std::unique_ptr<singlepop_fitness> &fitness, const int interval,
+        std::unique_ptr<singlepop_fitness> &fitness, const fitness_t &ff,
+        const int interval,
         KTfwd::extensions::discrete_mut_model &&__m,
-        KTfwd::extensions::discrete_rec_model &&__recmap, sampler_base &s,
-        wf_rules rules)
+        KTfwd::extensions::discrete_rec_model &&__recmap,
+        const ancestry_neutral_model &neutral_model, sampler_base &s,
+        wf_rules rules, const evolve_options &options)
     {
         const size_t simlen = Nvector_len;
-        auto x = std::max_element(Nvector, Nvector + Nvector_len);
-        assert(x != Nvector + Nvector_len);
-        reserve_space(pop->gametes, pop->mutations, *x, neutral + selected);
-        const double mu_tot = neutral + selected;
-        gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
-        gsl_rng_set(rng, seed);
+        // When recording ancestry, neutral mutations are not simulated
+        // forward in time.  They are added to the tables by mutate().
+        const bool record = options.record_ancestry;
+        const double forward_neutral = record ? 0. : neutral;
+        const double mu_tot = forward_neutral + selected;
+        adaptive_reservation reservation(options);
+        reservation.start(pop, Nvector, Nvector_len, mu_tot);
+        const counter_rng replicate_rng(stream);
+        gsl_rng *rng = replicate_rng.get();
+        sampler_pipeline<singlepop_t> sample(s, options);
         KTfwd::extensions::discrete_mut_model m(std::move(__m));
         KTfwd::extensions::discrete_rec_model recmap(std::move(__recmap));
         // Recombination policy: more complex than the standard case...
@@ -46,35 +62,89 @@ namespace fwdpy
             recmap, pop->gametes, pop->mutations, rng, recrate);
 
         wf_rules local_rules(std::move(rules));
+        std::unique_ptr<chunked_offspring_generator> chunked(
+            (options.offspring_chunks > 1 || record
+             || chunked_generator_required)
+                ? new chunked_offspring_generator(
+                      *pop, options.offspring_chunks,
+                      options.offspring_threads)
+                : nullptr);
+        std::vector<offspring_chunk::recombination_policy> chunk_recpols;
+        std::vector<offspring_chunk::mutation_model> chunk_mmodels;
+        if (chunked)
+            {
+                chunk_recpols
+                    = bind_chunk_recombination(*chunked, recmap, pop, recrate);
+            }
+        if (record)
+            {
+                if (pop->ancestry.empty())
+                    pop->ancestry.reset(2 * pop->diploids.size(),
+                                        pop->generation);
+                chunked->record_ancestry(&pop->ancestry);
+            }
         /*
           Update fitness model data.
           Needed for stateful fitness models and
           situtations where we evolve, stop, then
           evolve again.
         */
-        // fitness->update(pop);
+        update_model_data(ff, *fitness, pop);
         for (size_t g = 0; g < simlen; ++g, ++pop->generation)
             {
                 const unsigned nextN = *(Nvector + g);
-                KTfwd::experimental::sample_diploid(
-                    rng, pop->gametes, pop->diploids, pop->mutations,
-                    pop->mcounts, pop->N, nextN, mu_tot,
-                    KTfwd::extensions::bind_dmm(m, pop->mutations,
-                                                pop->mut_lookup, rng, neutral,
-                                                selected, pop->generation),
-                    recpos, fitness->fitness_function, pop->neutral,
-                    pop->selected, f, local_rules);
+                if (chunked)
+                    {
+                        chunked->seed(stream, pop->generation);
+                        bind_chunk_mutation(*chunked, m, pop, forward_neutral,
+                                            selected, chunk_mmodels);
+                        (*chunked)(pop, nextN, mu_tot, chunk_mmodels,
+                                   chunk_recpols, ff, f, local_rules,
+                                   std::true_type());
+                    }
+#ifndef FWDPY_COMPACT_DIPLOID
+                else
+                    {
+                        KTfwd::experimental::sample_diploid(
+                            rng, pop->gametes, pop->diploids, pop->mutations,
+                            pop->mcounts, pop->N, nextN, mu_tot,
+                            track_new_mutations(
+                                KTfwd::extensions::bind_dmm(
+                                    m, pop->mutations, pop->mut_lookup, rng,
+                                    neutral, selected, pop->generation),
+                                ff),
+                            recpos, ff, pop->neutral, pop->selected, f,
+                            local_rules);
+                        diploids_written(pop);
+                    }
+#endif
                 pop->N = nextN;
-                if (interval && pop->generation + 1
-                    && (pop->generation + 1) % interval == 0.)
+                const bool sample_now = interval && pop->generation + 1
+                                        && (pop->generation + 1) % interval
+                                               == 0.;
+                // Samplers and the caller see simplified, fully
+                // mutated tables.
+                if (record
+                    && (sample_now || g + 1 == simlen
+                        || (g + 1) % options.simplification_interval == 0))
+                    {
+                        pop->ancestry.simplify();
+                        pop->ancestry.mutate(rng, neutral_model);
+                    }
+                if (sample_now)
                     {
-                        s(pop, pop->generation + 1);
+                        sample(pop, pop->generation + 1);
                     }
                 KTfwd::update_mutations(
                     pop->mutations, pop->fixations, pop->fixation_times,
                     pop->mut_lookup, pop->mcounts, pop->generation, 2 * nextN);
+                mcounts_written(pop);
+                const bool compacted
+                    = compact_if_due(pop, options, unsigned(g + 1));
+                if (reservation.update(pop, compacted))
+                    fitness->indexes_changed();
                 // Allow fitness model to update any data that it may need
-                // fitness->update(pop);
+                update_model_data(ff, *fitness, pop);
                 assert(KTfwd::check_sum(pop->gametes, 2 * nextN));
             }
         // if (interval && pop->generation && (pop->generation) % interval ==
@@ -84,12 +154,45 @@ namespace fwdpy
         //    }
         // Update population's size variable to be the current pop size
         pop->N = unsigned(pop->diploids.size());
-        // cleanup
-        gsl_rng_free(rng);
+        sample.finish();
         // Let the sampler clean up after itself
         s.cleanup();
     }
 
+    struct evolve_regions_sampler_visitor
+    /*!
+      Calls evolve_regions_sampler_cpp_details for one replicate,
+      with the fitness model's concrete type.  See fitness_dispatch.hpp.
+    */
+    {
+        singlepop_t *pop;
+        const rng_stream_key stream;
+        const unsigned *Nvector;
+        const size_t Nvector_len;
+        const double neutral, selected, recrate, f;
+        std::unique_ptr<singlepop_fitness> &fitness;
+        const int interval;
+        const internal::region_manager *rm;
+        sampler_base &s;
+        const wf_rules &rules;
+        const evolve_options &options;
+
+        template <typename fitness_t>
+        void
+        operator()(const fitness_t &ff) const
+        {
+            evolve_regions_sampler_cpp_details(
+                pop, stream, Nvector, Nvector_len, neutral, selected, recrate,
+                f, fitness, ff, interval,
+                KTfwd::extensions::discrete_mut_model(rm->nb, rm->ne, rm->nw,
+                                                      rm->sb, rm->se, rm->sw,
+                                                      rm->callbacks),
+                KTfwd::extensions::discrete_rec_model(rm->rb, rm->rw, rm->rw),
+                ancestry_neutral_model{ neutral, rm->nb, rm->ne, rm->nw }, s,
+                rules, options);
+        }
+    };
+
     void
     evolve_regions_sampler_cpp(
         GSLrng_t *rng, std::vector<std::shared_ptr<singlepop_t>> &pops,
@@ -97,7 +200,8 @@ namespace fwdpy
         const unsigned *Nvector, const size_t Nvector_length,
         const double mu_neutral, const double mu_selected,
         const double littler, const double f, const int sample,
-        const internal::region_manager *rm, const singlepop_fitness &fitness)
+        const internal::region_manager *rm, const singlepop_fitness &fitness,
+        const evolve_options &options)
     {
         // check inputs--this is point of failure.  Throw excceptions here b4
         // getting into any threaded nonsense.
@@ -110,48 +214,34 @@ namespace fwdpy
             throw std::runtime_error("selfing probabilty must be 0<=f<=1.");
         if (sample < 0)
             throw std::runtime_error("sampling interval must be non-negative");
-        wf_rules rules;
-        if (pops.size() > 1)
+        if (samplers.size() != pops.size())
             {
-                std::vector<std::unique_ptr<singlepop_fitness>> fitnesses;
-                for (std::size_t i = 0; i < pops.size(); ++i)
-                    {
-                        fitnesses.emplace_back(
-                            std::unique_ptr<singlepop_fitness>(
-                                fitness.clone()));
-                    }
-
-                std::vector<std::thread> threads;
-                for (std::size_t i = 0; i < pops.size(); ++i)
-                    {
-                        threads.emplace_back(std::thread(
-                            evolve_regions_sampler_cpp_details, pops[i].get(),
-                            gsl_rng_get(rng->get()), Nvector, Nvector_length,
-                            mu_neutral, mu_selected, littler, f,
-                            std::ref(fitnesses[i]), sample,
-                            KTfwd::extensions::discrete_mut_model(
-                                rm->nb, rm->ne, rm->nw, rm->sb, rm->se, rm->sw,
-                                rm->callbacks),
-                            KTfwd::extensions::discrete_rec_model(
-                                rm->rb, rm->rw, rm->rw),
-                            std::ref(*samplers[i]), rules));
-                    }
-                for (auto &t : threads)
-                    t.join();
+                throw std::runtime_error("length of samplers != length of "
+                                         "population container");
             }
-        else // don't spawn threads all willy-nilly!
+        check_compaction_options(options);
+        check_reservation_options(options);
+        check_ancestry_options(options, pops);
+        wf_rules rules;
+        std::vector<std::unique_ptr<singlepop_fitness>> fitnesses;
+        for (std::size_t i = 0; i < pops.size(); ++i)
             {
-				auto fitness_ptr = std::unique_ptr<singlepop_fitness>(fitness.clone());
-                evolve_regions_sampler_cpp_details(
-                    pops[0].get(), gsl_rng_get(rng->get()), Nvector,
-                    Nvector_length, mu_neutral, mu_selected, littler, f,
-                    std::ref(fitness_ptr), sample,
-                    KTfwd::extensions::discrete_mut_model(
-                        rm->nb, rm->ne, rm->nw, rm->sb, rm->se, rm->sw,
-                        rm->callbacks),
-                    KTfwd::extensions::discrete_rec_model(rm->rb, rm->rw,
-                                                          rm->rw),
-                    std::ref(*samplers[0]), rules);
+                fitnesses.emplace_back(
+                    std::unique_ptr<singlepop_fitness>(fitness.clone()));
             }
+        const auto streams = draw_replicate_streams(rng->get(), pops.size());
+        replicate_scheduler scheduler(
+            replicate_worker_count(options.nthreads, pops.size()));
+        const double mu_forward
+            = (options.record_ancestry ? 0. : mu_neutral) + mu_selected;
+        run_admitted(scheduler, pops, Nvector, Nvector_length, mu_forward,
+                     options, [&](const std::size_t i) {
+            visit_singlepop_fitness(
+                *fitnesses[i],
+                evolve_regions_sampler_visitor{
+                    pops[i].get(), streams[i], Nvector, Nvector_length,
+                    mu_neutral, mu_selected, littler, f, fitnesses[i], sample,
+                    rm, *samplers[i], rules, options });
+        });
     }
 }
@@ -582,6 +582,7 @@ namespace
     {
         try
             {
+                const auto trajectories = data.final();
                 if (onedb)
                     {
                         sqlite3 *db; // will be closed by class destructor
@@ -589,7 +590,7 @@ namespace
                         trajSQLonedb t(db, dblock_, tf, dbname, threshold,
                                        label, append);
                         t.prepare_statements();
-                        t(data.begin(), data.end());
+                        t(trajectories.begin(), trajectories.end());
                     }
                 else
                     {
@@ -598,7 +599,7 @@ namespace
                         auto name = db.str();
                         trajSQL t(NULL, tf, name, threshold, append);
                         t.prepare_statements();
-                        t(data.begin(), data.end());
+                        t(trajectories.begin(), trajectories.end());
                     }
             }
         catch (std::runtime_error &re)
@@ -676,10 +677,13 @@ namespace fwdpy
         unsigned dummy = 0;
         for (auto &&i : samplers)
             {
-                tasks.emplace_back(async(
-                    launch::async, traj2sql_details, dblock,
-                    *dynamic_cast<fwdpy::selected_mut_tracker *>(i.get()), tf,
-                    dbname, threshold, label + dummy, onedb, append));
+                // Passed by reference, so that the tracker is not copied
+                const auto &data
+                    = *dynamic_cast<fwdpy::selected_mut_tracker *>(i.get());
+                tasks.emplace_back(async(launch::async, traj2sql_details,
+                                         dblock, cref(data), tf, dbname,
+                                         threshold, label + dummy, onedb,
+                                         append));
                 dummy++;
             }
 
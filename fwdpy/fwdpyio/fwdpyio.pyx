@@ -171,6 +171,25 @@ def deserialize_singlepops(list strings):
     pops.reset(temp)
     return pops
 
+def read_singlepops(string filename, list offsets):
+    """
+    Read populations written by :class:`fwdpy.fwdpyio.fwdpyio.gzSerializer` back into a :class:`fwdpy.fwdpy.SpopVec`
+
+    :param filename: A file written by :class:`fwdpy.fwdpyio.fwdpyio.gzSerializer`
+    :param offsets: A list of offsets into filename, as returned by :func:`fwdpy.fwdpyio.fwdpyio.gzSerializer.get`
+
+    :returns: :class:`fwdpy.fwdpy.SpopVec` with one population per offset
+
+    :raises: RuntimeError if the file cannot be read
+
+    .. note:: Ancestry tables recorded via :class:`fwdpy.fwdpy.EvolveOptions` are read back, too.
+    """
+    cdef SpopVec rv = SpopVec(len(offsets),0)
+    cdef size_t i
+    for i in range(len(offsets)):
+        rv.pops[i].get().fromfile(filename.c_str(),offsets[i])
+    return rv
+
 def deserialize_metapops(list strings):
     """
     Convert binary representation of populations back to a :class:`fwdpy.fwdpy.MetaPopVec`
@@ -0,0 +1,136 @@
+#ifndef FWDPY_ALIAS_SAMPLER_HPP
+#define FWDPY_ALIAS_SAMPLER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <gsl/gsl_rng.h>
+
+namespace fwdpy
+{
+    class alias_sampler
+    /*!
+      Sample indexes in [0,n) proportionally to non-negative weights,
+      using Walker's alias method (Vose's construction).
+
+      This is a replacement for gsl_ran_discrete_preproc/gsl_ran_discrete
+      for tables that are rebuilt every generation.  All storage is
+      owned by the object and re-used, so that rebuild() does not
+      allocate unless n exceeds every previous n.
+
+      Sampling is const and may be done concurrently from several
+      threads, each with its own gsl_rng.
+    */
+    {
+      private:
+        std::vector<double> prob;
+        std::vector<std::uint32_t> alias;
+        //! Work lists for rebuild()
+        std::vector<std::uint32_t> small, large;
+
+      public:
+        alias_sampler() : prob{}, alias{}, small{}, large{} {}
+
+        void
+        rebuild(const double *weights, const std::size_t n)
+        /*!
+          Rebuild the table from weights[0] ... weights[n-1].
+
+          Throws std::runtime_error if n is zero or too large, if any
+          weight is negative or not finite, or if all weights are zero.
+        */
+        {
+            if (!n)
+                throw std::runtime_error("alias_sampler: no weights");
+            if (n > std::numeric_limits<std::uint32_t>::max())
+                throw std::runtime_error("alias_sampler: too many weights");
+            double sum = 0.;
+            for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (!(weights[i] >= 0.) || !std::isfinite(weights[i]))
+                        throw std::runtime_error(
+                            "alias_sampler: weights must be finite and "
+                            "non-negative");
+                    sum += weights[i];
+                }
+            if (!(sum > 0.))
+                throw std::runtime_error(
+                    "alias_sampler: weights sum to zero");
+            prob.resize(n);
+            alias.resize(n);
+            small.clear();
+            large.clear();
+            // Scale so that the mean weight is 1
+            const double scale = double(n) / sum;
+            for (std::size_t i = 0; i < n; ++i)
+                {
+                    prob[i] = weights[i] * scale;
+                    if (prob[i] < 1.)
+                        small.push_back(std::uint32_t(i));
+                    else
+                        large.push_back(std::uint32_t(i));
+                }
+            while (!small.empty() && !large.empty())
+                {
+                    const auto s = small.back();
+                    small.pop_back();
+                    const auto l = large.back();
+                    alias[s] = l;
+                    // The excess of l tops up column s.
+                    prob[l] = (prob[l] + prob[s]) - 1.;
+                    if (prob[l] < 1.)
+                        {
+                            large.pop_back();
+                            small.push_back(l);
+                        }
+                }
+            // Whatever remains is 1 up to rounding error
+            for (const auto i : large)
+                {
+                    prob[i] = 1.;
+                    alias[i] = i;
+                }
+            for (const auto i : small)
+                {
+                    prob[i] = 1.;
+                    alias[i] = i;
+                }
+        }
+
+        std::size_t
+        size() const
+        {
+            return prob.size();
+        }
+
+        std::size_t
+        reserved_bytes() const noexcept
+        //! Bytes of storage owned by the table, whether used or not
+        {
+            return prob.capacity() * sizeof(double)
+                   + (alias.capacity() + small.capacity() + large.capacity())
+                         * sizeof(std::uint32_t);
+        }
+
+        std::size_t
+        operator()(const gsl_rng *r) const
+        /*!
+          Return an index.  A single uniform deviate chooses both the
+          column and the coin flip within the column.
+
+          \note rebuild() must have been called at least once.
+        */
+        {
+            const double u = gsl_rng_uniform(r) * double(prob.size());
+            const std::size_t i
+                = std::min(std::size_t(u), prob.size() - 1);
+            return (u - double(i) < prob[i]) ? i : std::size_t(alias[i]);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,761 @@
+#ifndef FWDPY_ANCESTRY_TABLES_HPP
+#define FWDPY_ANCESTRY_TABLES_HPP
+
+/*!
+  \file ancestry_tables.hpp
+
+  Ancestry ("tree sequence") recording for single-deme and
+  multi-locus simulations.
+
+  Each gamete of each generation is a node.  When an offspring gamete
+  is made, one edge per recombination segment is recorded, connecting
+  the parental gamete it was copied from to the offspring gamete.
+  Loci occupy disjoint position ranges, so one set of tables records
+  all loci of a multi-locus population.  There, a node is one side of
+  a diploid, made of one gamete per locus.
+  Periodically, the tables are simplified to the genealogy of the
+  extant gametes, following Kelleher et al. (2018) PLoS Comput. Biol.
+  14: e1006581.  Neutral mutations are then placed on the branches of
+  the simplified genealogy, so that they never have to be carried
+  through the forward simulation.
+*/
+
+#include "dirty_chunks.hpp"
+#include "evolve_options.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gsl/gsl_randist.h>
+#include <gsl/gsl_rng.h>
+
+namespace fwdpy
+{
+    struct ancestry_edge
+    //! Genomic interval [left,right) of child was inherited from parent
+    {
+        double left, right;
+        std::int32_t parent, child;
+    };
+
+    struct ancestry_mutation
+    {
+        double pos;
+        //! The mutation arose on the branch above this node
+        std::int32_t node;
+        //! Generation of origin, as for KTfwd::popgenmut::g
+        unsigned origin;
+    };
+
+    struct ancestry_neutral_model
+    /*!
+      Neutral mutation rate per gamete per generation, and the neutral
+      regions [beg,end) with their weights, as passed to
+      KTfwd::extensions::discrete_mut_model.
+    */
+    {
+        double mu;
+        std::vector<double> beg, end, weight;
+    };
+
+    class ancestry_tables
+    /*!
+      Node, edge and mutation tables for one population.
+
+      Node i was born in generation node_times[i].  The gametes of the
+      current generation are nodes [first_sample,first_sample+nsamples),
+      in the order diploids[0].first, diploids[0].second,
+      diploids[1].first, ...
+
+      After simplify(), the current gametes are nodes [0,nsamples), and
+      the tables only contain the ancestry of those gametes, back to
+      the founders, which are the gametes passed to reset().
+    */
+    {
+      private:
+        struct segment
+        {
+            double left, right;
+            std::int32_t node;
+        };
+        struct segment_greater
+        {
+            bool
+            operator()(const segment &a, const segment &b) const
+            {
+                return a.left > b.left;
+            }
+        };
+        //! Scratch space for simplify()
+        std::vector<std::vector<segment>> ancestry;
+        std::vector<segment> heap, overlaps;
+        std::vector<ancestry_edge> parent_edges;
+
+        static constexpr std::uint32_t format_tag = 0x41445746; // "FWDA"
+
+        void
+        push(const segment &s)
+        {
+            heap.push_back(s);
+            std::push_heap(heap.begin(), heap.end(), segment_greater());
+        }
+
+        segment
+        pop()
+        {
+            std::pop_heap(heap.begin(), heap.end(), segment_greater());
+            const auto rv = heap.back();
+            heap.pop_back();
+            return rv;
+        }
+
+        void
+        add_parent_edge(const double left, const double right,
+                        const std::int32_t parent, const std::int32_t child)
+        {
+            parent_edges.push_back(ancestry_edge{ left, right, parent, child });
+        }
+
+        void
+        flush_parent_edges(std::vector<ancestry_edge> &output)
+        //! Output the edges of one parent, merging adjacent intervals
+        {
+            std::sort(parent_edges.begin(), parent_edges.end(),
+                      [](const ancestry_edge &a, const ancestry_edge &b) {
+                          return a.child < b.child
+                                 || (a.child == b.child && a.left < b.left);
+                      });
+            for (const auto &e : parent_edges)
+                {
+                    if (!output.empty() && output.back().parent == e.parent
+                        && output.back().child == e.child
+                        && output.back().right == e.left)
+                        {
+                            output.back().right = e.right;
+                        }
+                    else
+                        output.push_back(e);
+                }
+            parent_edges.clear();
+        }
+
+        void
+        merge_ancestry(const std::int32_t u, const bool root,
+                       std::vector<unsigned> &output_times,
+                       std::vector<ancestry_edge> &output_edges)
+        /*!
+          Pass the segments in the heap up to input node u.  Where two
+          or more overlap, u is a coalescence and becomes an output
+          node.  If root is true, u becomes an output node wherever it
+          has ancestral material, so that the branches above the oldest
+          coalescences are kept.
+        */
+        {
+            std::int32_t v = -1;
+            while (!heap.empty())
+                {
+                    const double l = heap.front().left;
+                    double r = upper();
+                    overlaps.clear();
+                    while (!heap.empty() && heap.front().left == l)
+                        {
+                            overlaps.push_back(pop());
+                            r = std::min(r, overlaps.back().right);
+                        }
+                    if (!heap.empty())
+                        r = std::min(r, heap.front().left);
+                    if (overlaps.size() == 1 && !root)
+                        {
+                            auto x = overlaps[0];
+                            if (!heap.empty() && heap.front().left < x.right)
+                                {
+                                    ancestry[u].push_back(segment{
+                                        x.left, heap.front().left, x.node });
+                                    x.left = heap.front().left;
+                                    push(x);
+                                }
+                            else
+                                ancestry[u].push_back(x);
+                        }
+                    else
+                        {
+                            if (v == -1)
+                                {
+                                    v = std::int32_t(output_times.size());
+                                    output_times.push_back(node_times[u]);
+                                }
+                            ancestry[u].push_back(segment{ l, r, v });
+                            for (auto &x : overlaps)
+                                {
+                                    add_parent_edge(l, r, v, x.node);
+                                    if (x.right > r)
+                                        {
+                                            x.left = r;
+                                            push(x);
+                                        }
+                                }
+                        }
+                }
+            flush_parent_edges(output_edges);
+        }
+
+        template <typename T>
+        static void
+        write_vector(std::ostream &o, const std::vector<T> &v)
+        {
+            const std::uint64_t n = v.size();
+            o.write(reinterpret_cast<const char *>(&n), sizeof(n));
+            if (n)
+                o.write(reinterpret_cast<const char *>(v.data()),
+                        std::streamsize(n * sizeof(T)));
+        }
+
+        template <typename T>
+        static void
+        read_vector(std::istream &i, std::vector<T> &v)
+        {
+            std::uint64_t n;
+            i.read(reinterpret_cast<char *>(&n), sizeof(n));
+            v.resize(n);
+            if (n)
+                i.read(reinterpret_cast<char *>(v.data()),
+                       std::streamsize(n * sizeof(T)));
+        }
+
+        template <typename visitor>
+        void
+        for_each_carried(const std::vector<std::int32_t> &sample_nodes,
+                         const visitor &f) const
+        /*!
+          Call f(m, columns) for each mutation m carried by at least
+          one of sample_nodes, where columns are the indexes into
+          sample_nodes of the carriers, in no particular order.
+        */
+        {
+            const std::size_t nnodes = node_times.size();
+            const auto nsam = sample_nodes.size();
+            // Columns of each node, as linked lists
+            std::vector<std::int64_t> first_column(nnodes, -1),
+                next_column(nsam, -1);
+            for (std::size_t c = nsam; c-- > 0;)
+                {
+                    next_column[c] = first_column[sample_nodes[c]];
+                    first_column[sample_nodes[c]] = std::int64_t(c);
+                }
+            // Edges grouped by parent
+            std::vector<std::size_t> offsets(nnodes + 1, 0), children;
+            for (const auto &e : edges)
+                ++offsets[e.parent + 1];
+            for (std::size_t i = 0; i < nnodes; ++i)
+                offsets[i + 1] += offsets[i];
+            children.resize(edges.size());
+            {
+                auto next = offsets;
+                for (std::size_t i = 0; i < edges.size(); ++i)
+                    children[next[edges[i].parent]++] = i;
+            }
+            std::vector<std::int32_t> stack;
+            std::vector<std::size_t> columns;
+            for (const auto &m : mutations)
+                {
+                    columns.clear();
+                    stack.assign(1, m.node);
+                    while (!stack.empty())
+                        {
+                            const auto u = stack.back();
+                            stack.pop_back();
+                            for (auto c = first_column[u]; c != -1;
+                                 c = next_column[c])
+                                columns.push_back(std::size_t(c));
+                            for (auto k = offsets[u]; k < offsets[u + 1]; ++k)
+                                {
+                                    const auto &e = edges[children[k]];
+                                    if (e.left <= m.pos && m.pos < e.right)
+                                        stack.push_back(e.child);
+                                }
+                        }
+                    if (!columns.empty())
+                        f(m, columns);
+                }
+        }
+
+      public:
+        //! Birth generation of each node
+        std::vector<unsigned> node_times;
+        std::vector<ancestry_edge> edges;
+        std::vector<ancestry_mutation> mutations;
+        std::size_t first_sample, nsamples;
+        //! Birth generation of the current gametes
+        unsigned generation;
+        //! Branches have had mutations placed up to this generation
+        unsigned mutated_through;
+        //! Edges [0,nsimplified_edges) are the output of the last simplify()
+        std::size_t nsimplified_edges;
+        /*!
+          Changed by every member function that modifies the tables.
+          The offspring generators append edges right after
+          add_generation().  See dirty_chunks.hpp.
+        */
+        std::uint64_t revision;
+
+        ancestry_tables()
+            : ancestry{}, heap{}, overlaps{}, parent_edges{}, node_times{},
+              edges{}, mutations{}, first_sample(0), nsamples(0),
+              generation(0), mutated_through(0), nsimplified_edges(0),
+              revision(next_revision())
+        {
+        }
+
+        ancestry_tables(const ancestry_tables &rhs)
+            : ancestry{}, heap{}, overlaps{}, parent_edges{},
+              node_times(rhs.node_times), edges(rhs.edges),
+              mutations(rhs.mutations), first_sample(rhs.first_sample),
+              nsamples(rhs.nsamples), generation(rhs.generation),
+              mutated_through(rhs.mutated_through),
+              nsimplified_edges(rhs.nsimplified_edges),
+              revision(rhs.revision)
+        //! Scratch space is not copied.
+        {
+        }
+
+        ancestry_tables(ancestry_tables &&) = default;
+
+        ancestry_tables &
+        operator=(ancestry_tables rhs)
+        {
+            node_times.swap(rhs.node_times);
+            edges.swap(rhs.edges);
+            mutations.swap(rhs.mutations);
+            first_sample = rhs.first_sample;
+            nsamples = rhs.nsamples;
+            generation = rhs.generation;
+            mutated_through = rhs.mutated_through;
+            nsimplified_edges = rhs.nsimplified_edges;
+            revision = rhs.revision;
+            return *this;
+        }
+
+        //! Left end of the genome
+        static constexpr double
+        lower()
+        {
+            return std::numeric_limits<double>::lowest();
+        }
+
+        //! Right end of the genome
+        static constexpr double
+        upper()
+        {
+            return std::numeric_limits<double>::max();
+        }
+
+        bool
+        empty() const
+        {
+            return node_times.empty();
+        }
+
+        bool
+        up_to_date() const
+        /*!
+          \return true if the tables are simplified, and mutations have
+          been placed on all branches.
+        */
+        {
+            return first_sample == 0 && nsimplified_edges == edges.size()
+                   && mutated_through == generation;
+        }
+
+        void
+        reset(const std::size_t twoN, const unsigned gen)
+        //! Start recording from twoN unrelated gametes born in generation gen
+        {
+            node_times.assign(twoN, gen);
+            edges.clear();
+            mutations.clear();
+            first_sample = 0;
+            nsamples = twoN;
+            generation = mutated_through = gen;
+            nsimplified_edges = 0;
+            revision = next_revision();
+        }
+
+        std::size_t
+        add_generation(const std::size_t twoN)
+        /*!
+          Add the nodes of the next generation, which become the current
+          gametes.  Edges to them must then be appended to edges.
+
+          \return The first new node.
+        */
+        {
+            if (node_times.size() + twoN
+                > std::size_t(std::numeric_limits<std::int32_t>::max()))
+                {
+                    throw std::runtime_error(
+                        "ancestry tables: too many nodes.  Simplify more "
+                        "often.");
+                }
+            const std::size_t first = node_times.size();
+            node_times.insert(node_times.end(), twoN, generation + 1);
+            first_sample = first;
+            nsamples = twoN;
+            ++generation;
+            revision = next_revision();
+            return first;
+        }
+
+        void
+        simplify()
+        /*!
+          Reduce the tables to the ancestry of the current gametes.
+          Mutations not ancestral to any of them are removed.  Unary
+          nodes are removed, except for the founders, which keep an edge
+          to each root of the genealogy below them.
+
+          Edges are processed from the youngest parent to the oldest.
+          Edges added since the last call are sorted, and go before the
+          output of the last call, whose parents are all older.
+        */
+        {
+            if (first_sample == 0 && nsimplified_edges == edges.size())
+                return;
+            revision = next_revision();
+            const auto old_end = edges.begin() + nsimplified_edges;
+            std::sort(old_end, edges.end(),
+                      [this](const ancestry_edge &a, const ancestry_edge &b) {
+                          const auto ta = node_times[a.parent],
+                                     tb = node_times[b.parent];
+                          if (ta != tb)
+                              return ta > tb;
+                          if (a.parent != b.parent)
+                              return a.parent < b.parent;
+                          if (a.child != b.child)
+                              return a.child < b.child;
+                          return a.left < b.left;
+                      });
+            std::rotate(edges.begin(), old_end, edges.end());
+
+            ancestry.resize(node_times.size());
+            std::vector<unsigned> output_times;
+            std::vector<ancestry_edge> output_edges;
+            output_times.reserve(nsamples);
+            for (std::size_t i = 0; i < nsamples; ++i)
+                {
+                    const auto u = first_sample + i;
+                    ancestry[u].push_back(
+                        segment{ lower(), upper(), std::int32_t(i) });
+                    output_times.push_back(node_times[u]);
+                }
+            // The founders, born when recording started, are the oldest
+            // nodes.  They are kept, so that mutate() can place mutations
+            // on the branches from them to the oldest coalescences, and
+            // on lineages that have not coalesced.
+            const unsigned founded
+                = *std::min_element(node_times.begin(), node_times.end());
+            std::size_t e = 0;
+            while (e < edges.size())
+                {
+                    const auto u = edges[e].parent;
+                    for (; e < edges.size() && edges[e].parent == u; ++e)
+                        {
+                            const auto &edge = edges[e];
+                            for (const auto &x : ancestry[edge.child])
+                                {
+                                    if (x.right > edge.left
+                                        && edge.right > x.left)
+                                        {
+                                            push(segment{
+                                                std::max(x.left, edge.left),
+                                                std::min(x.right, edge.right),
+                                                x.node });
+                                        }
+                                }
+                        }
+                    merge_ancestry(u, node_times[u] == founded,
+                                   output_times, output_edges);
+                }
+
+            // Each mutation goes to the output node inheriting its site
+            std::size_t kept = 0;
+            for (const auto &m : mutations)
+                {
+                    const auto &a = ancestry[m.node];
+                    auto s = std::upper_bound(
+                        a.begin(), a.end(), m.pos,
+                        [](const double p, const segment &x) {
+                            return p < x.left;
+                        });
+                    if (s != a.begin() && m.pos < (--s)->right)
+                        {
+                            mutations[kept++]
+                                = ancestry_mutation{ m.pos, s->node, m.origin };
+                        }
+                }
+            mutations.resize(kept);
+
+            for (auto &a : ancestry)
+                a.clear();
+            node_times.swap(output_times);
+            edges.swap(output_edges);
+            first_sample = 0;
+            nsimplified_edges = edges.size();
+        }
+
+        void
+        mutate(const gsl_rng *r, const ancestry_neutral_model &model)
+        /*!
+          Place neutral mutations on the parts of branches born after
+          mutated_through.  Call after simplify(), so that only the
+          ancestry of the current gametes is mutated.
+
+          For an edge over [left,right) and a branch of t generations,
+          the number of mutations in neutral region i is Poisson with
+          mean t*mu*(weight[i]/sum of weights)*(fraction of region i
+          overlapping the edge).
+        */
+        {
+            revision = next_revision();
+            double wsum = 0.;
+            for (const auto w : model.weight)
+                wsum += w;
+            if (!(model.mu > 0.) || !(wsum > 0.))
+                {
+                    mutated_through = generation;
+                    return;
+                }
+            for (const auto &edge : edges)
+                {
+                    const unsigned lo
+                        = std::max(node_times[edge.parent], mutated_through);
+                    const unsigned tc = node_times[edge.child];
+                    if (tc <= lo)
+                        continue;
+                    const double branch = double(tc - lo);
+                    for (std::size_t i = 0; i < model.weight.size(); ++i)
+                        {
+                            const double b = model.beg[i], e = model.end[i];
+                            const double a = std::max(b, edge.left),
+                                         z = std::min(e, edge.right);
+                            double mean
+                                = branch * model.mu * model.weight[i] / wsum;
+                            if (b == e)
+                                {
+                                    if (b < edge.left || !(b < edge.right))
+                                        continue;
+                                }
+                            else if (a < z)
+                                mean *= (z - a) / (e - b);
+                            else
+                                continue;
+                            const unsigned n = gsl_ran_poisson(r, mean);
+                            for (unsigned j = 0; j < n; ++j)
+                                {
+                                    // The offspring gamete of generation
+                                    // t has origin t-1.
+                                    mutations.push_back(ancestry_mutation{
+                                        (b == e) ? b : gsl_ran_flat(r, a, z),
+                                        edge.child,
+                                        lo
+                                            + unsigned(gsl_rng_uniform_int(
+                                                  r, tc - lo)) });
+                                }
+                        }
+                }
+            mutated_through = generation;
+        }
+
+        void
+        simplify_and_mutate(const gsl_rng *r,
+                            const ancestry_neutral_model &model)
+        //! Make the tables up_to_date(), if they are not
+        {
+            if (up_to_date())
+                return;
+            simplify();
+            mutate(r, model);
+        }
+
+        void
+        neutral_genotypes(const std::vector<std::int32_t> &sample_nodes,
+                          std::map<double, std::string> &sites) const
+        /*!
+          Add the genotypes of sample_nodes at each mutation carried by
+          at least one of them.  sites maps positions to genotype
+          strings of length sample_nodes.size().  Entries of sites
+          created here are filled with '0' first.
+
+          \note The tables must be simplified.
+        */
+        {
+            const auto nsam = sample_nodes.size();
+            for_each_carried(
+                sample_nodes,
+                [&sites, nsam](const ancestry_mutation &m,
+                               const std::vector<std::size_t> &columns) {
+                    auto &s = sites[m.pos];
+                    if (s.empty())
+                        s.assign(nsam, '0');
+                    for (const auto c : columns)
+                        s[c] = '1';
+                });
+        }
+
+        void
+        derived_counts(const std::vector<std::int32_t> &sample_nodes,
+                       std::vector<unsigned> &counts,
+                       std::vector<double> *site_positions = nullptr) const
+        /*!
+          Fill counts with the number of sample_nodes carrying the
+          derived allele at each position carried by at least one of
+          them, in order of position.  Equivalent to counting the '1's
+          of each entry of neutral_genotypes(), without building the
+          genotypes.  If site_positions is not nullptr, it is filled
+          with the position of each count.
+
+          \note The tables must be simplified.
+        */
+        {
+            // Mutations at the same position count as one site, so
+            // their carriers are merged.  That only happens for point
+            // regions, so the other sites are counted directly.
+            std::vector<double> positions;
+            positions.reserve(mutations.size());
+            for (const auto &m : mutations)
+                positions.push_back(m.pos);
+            std::sort(positions.begin(), positions.end());
+            std::vector<double> shared;
+            for (std::size_t i = 1; i < positions.size(); ++i)
+                {
+                    if (positions[i] == positions[i - 1]
+                        && (shared.empty() || shared.back() != positions[i]))
+                        shared.push_back(positions[i]);
+                }
+            std::vector<std::pair<double, unsigned>> sites;
+            std::map<double, std::vector<bool>> shared_sites;
+            const auto nsam = sample_nodes.size();
+            for_each_carried(
+                sample_nodes,
+                [&](const ancestry_mutation &m,
+                    const std::vector<std::size_t> &columns) {
+                    if (!std::binary_search(shared.begin(), shared.end(),
+                                            m.pos))
+                        {
+                            sites.emplace_back(m.pos,
+                                               unsigned(columns.size()));
+                            return;
+                        }
+                    auto &carried = shared_sites[m.pos];
+                    carried.resize(nsam, false);
+                    for (const auto c : columns)
+                        carried[c] = true;
+                });
+            for (const auto &s : shared_sites)
+                sites.emplace_back(
+                    s.first,
+                    unsigned(std::count(s.second.begin(), s.second.end(),
+                                        true)));
+            std::sort(sites.begin(), sites.end());
+            counts.clear();
+            for (const auto &s : sites)
+                counts.push_back(s.second);
+            if (site_positions)
+                {
+                    site_positions->clear();
+                    for (const auto &s : sites)
+                        site_positions->push_back(s.first);
+                }
+        }
+
+        void
+        write(std::ostream &o) const
+        {
+            const std::uint32_t tag = format_tag;
+            const std::uint64_t fs = first_sample, ns = nsamples,
+                                nse = nsimplified_edges;
+            o.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+            o.write(reinterpret_cast<const char *>(&generation),
+                    sizeof(unsigned));
+            o.write(reinterpret_cast<const char *>(&mutated_through),
+                    sizeof(unsigned));
+            o.write(reinterpret_cast<const char *>(&fs), sizeof(fs));
+            o.write(reinterpret_cast<const char *>(&ns), sizeof(ns));
+            o.write(reinterpret_cast<const char *>(&nse), sizeof(nse));
+            write_vector(o, node_times);
+            write_vector(o, edges);
+            write_vector(o, mutations);
+        }
+
+        void
+        read(std::istream &i)
+        //! Throws std::runtime_error if i does not contain tables
+        {
+            std::uint32_t tag = 0;
+            std::uint64_t fs, ns, nse;
+            i.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+            if (!i || tag != format_tag)
+                throw std::runtime_error("invalid ancestry table data");
+            i.read(reinterpret_cast<char *>(&generation), sizeof(unsigned));
+            i.read(reinterpret_cast<char *>(&mutated_through),
+                   sizeof(unsigned));
+            i.read(reinterpret_cast<char *>(&fs), sizeof(fs));
+            i.read(reinterpret_cast<char *>(&ns), sizeof(ns));
+            i.read(reinterpret_cast<char *>(&nse), sizeof(nse));
+            read_vector(i, node_times);
+            read_vector(i, edges);
+            read_vector(i, mutations);
+            if (!i)
+                throw std::runtime_error("invalid ancestry table data");
+            first_sample = std::size_t(fs);
+            nsamples = std::size_t(ns);
+            nsimplified_edges = std::size_t(nse);
+            revision = next_revision();
+        }
+    };
+
+    template <typename poptype>
+    void
+    check_ancestry_options(const evolve_options &options,
+                           const std::vector<std::shared_ptr<poptype>> &pops)
+    /*!
+      Throws std::runtime_error if options.record_ancestry cannot be
+      used to evolve pops further.  Tables recorded earlier must be up
+      to date, and ancestry must be recorded if they exist.
+    */
+    {
+        if (options.record_ancestry && !options.simplification_interval)
+            {
+                throw std::runtime_error(
+                    "simplification_interval must be > 0");
+            }
+        for (const auto &pop : pops)
+            {
+                const auto &tables = pop->ancestry;
+                if (tables.empty())
+                    continue;
+                if (!options.record_ancestry)
+                    {
+                        throw std::runtime_error(
+                            "population has recorded ancestry, so "
+                            "record_ancestry must be set");
+                    }
+                if (!tables.up_to_date()
+                    || tables.generation != pop->generation
+                    || tables.nsamples != 2 * pop->diploids.size())
+                    {
+                        throw std::runtime_error("recorded ancestry does not "
+                                                 "match the population");
+                    }
+            }
+    }
+}
+
+#endif
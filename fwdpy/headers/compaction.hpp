@@ -0,0 +1,291 @@
+#ifndef FWDPY_COMPACTION_HPP
+#define FWDPY_COMPACTION_HPP
+
+/*!
+  \file compaction.hpp
+
+  Removal of extinct elements from a population's containers.
+
+  Object recycling leaves extinct mutations and gametes in place.
+  After a bottleneck, or after a period of high diversity, most slots
+  may be extinct, and the containers stay at their peak size.
+  compact_population() rebuilds them from the live elements only, and
+  updates the indexes stored in gametes and diploids.
+
+  Different recombination paths also rebuild the same haplotype in
+  different slots, so that, after a long neutral burn-in, many live
+  gametes are identical.  merge_identical_gametes() replaces each such
+  group by one gamete.
+
+  Compaction changes mutation and gamete indexes, and merging changes
+  gamete indexes, so anything holding such indexes across generations
+  must be refreshed afterwards.  See compact_if_due(), which the
+  "evolve" drivers call.
+*/
+
+#include "dirty_chunks.hpp"
+#include "evolve_options.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <fwdpp/forward_types.hpp>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace fwdpy
+{
+    namespace compaction_details
+    {
+        constexpr KTfwd::uint_t extinct
+            = std::numeric_limits<KTfwd::uint_t>::max();
+
+        inline void
+        remap_keys(std::vector<KTfwd::uint_t> &keys,
+                   const std::vector<KTfwd::uint_t> &remap)
+        {
+            for (auto &k : keys)
+                {
+                    assert(remap[k] != extinct);
+                    k = remap[k];
+                }
+        }
+
+        template <typename diploid_t>
+        inline void
+        remap_diploids(std::vector<diploid_t> &diploids,
+                       const std::vector<KTfwd::uint_t> &remap)
+        {
+            for (auto &dip : diploids)
+                {
+                    assert(remap[dip.first] != extinct);
+                    assert(remap[dip.second] != extinct);
+                    dip.first = remap[dip.first];
+                    dip.second = remap[dip.second];
+                }
+        }
+
+        template <typename diploid_t>
+        inline void
+        remap_diploids(std::vector<std::vector<diploid_t>> &diploids,
+                       const std::vector<KTfwd::uint_t> &remap)
+        //! Demes of a metapop_t, or loci of a multilocus_t
+        {
+            for (auto &d : diploids)
+                remap_diploids(d, remap);
+        }
+
+        template <typename gamete_t>
+        inline std::size_t
+        hash_gamete(const gamete_t &g)
+        {
+            std::hash<KTfwd::uint_t> h;
+            std::size_t rv = g.mutations.size();
+            // The usual hash_combine
+            for (const auto k : g.mutations)
+                rv ^= h(k) + 0x9e3779b9 + (rv << 6) + (rv >> 2);
+            rv ^= g.smutations.size() + 0x9e3779b9 + (rv << 6) + (rv >> 2);
+            for (const auto k : g.smutations)
+                rv ^= h(k) + 0x9e3779b9 + (rv << 6) + (rv >> 2);
+            return rv;
+        }
+    }
+
+    template <typename pop_t>
+    std::size_t
+    live_mutations(const pop_t *pop)
+    {
+        return std::size_t(std::count_if(
+            pop->mcounts.begin(), pop->mcounts.end(),
+            [](const KTfwd::uint_t n) { return n > 0; }));
+    }
+
+    template <typename pop_t>
+    std::size_t
+    live_gametes(const pop_t *pop)
+    {
+        return std::size_t(std::count_if(
+            pop->gametes.begin(), pop->gametes.end(),
+            [](const typename pop_t::gamete_t &g) { return g.n > 0; }));
+    }
+
+    template <typename pop_t>
+    void
+    compact_population(pop_t *pop)
+    /*!
+      Remove extinct mutations and gametes from pop.
+
+      Live mutations (non-zero count) are sorted by position, so that
+      mutation keys within each gamete remain sorted by position and
+      are now also in increasing order.  Live gametes (non-zero count)
+      keep their relative order.  The keys in gamete_t::mutations and
+      gamete_t::smutations and the gamete indexes of all diploids are
+      updated.  The capacity of each container is reduced to its size.
+
+      Works for singlepop_t, metapop_t and multilocus_t.  Must be
+      called between generations, when mcounts is up to date.
+      Fixations and the position lookup table hold no indexes, and are
+      not modified.
+    */
+    {
+        using namespace compaction_details;
+        assert(pop->mcounts.size() == pop->mutations.size());
+
+        std::vector<KTfwd::uint_t> order;
+        order.reserve(pop->mutations.size());
+        for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+            {
+                if (pop->mcounts[i])
+                    order.push_back(KTfwd::uint_t(i));
+            }
+        std::sort(order.begin(), order.end(),
+                  [pop](const KTfwd::uint_t a, const KTfwd::uint_t b) {
+                      return pop->mutations[a].pos < pop->mutations[b].pos;
+                  });
+        std::vector<KTfwd::uint_t> remap(pop->mutations.size(), extinct);
+        typename pop_t::mcont_t mutations;
+        std::vector<KTfwd::uint_t> mcounts;
+        mutations.reserve(order.size());
+        mcounts.reserve(order.size());
+        for (const auto k : order)
+            {
+                remap[k] = KTfwd::uint_t(mutations.size());
+                mutations.emplace_back(std::move(pop->mutations[k]));
+                mcounts.push_back(pop->mcounts[k]);
+            }
+        // Swap rather than assign, so that policies bound to the
+        // containers remain valid.
+        pop->mutations.swap(mutations);
+        pop->mcounts.swap(mcounts);
+
+        const auto ngametes = live_gametes(pop);
+        std::vector<KTfwd::uint_t> gamete_remap(pop->gametes.size(),
+                                                extinct);
+        typename pop_t::gcont_t gametes;
+        gametes.reserve(ngametes);
+        for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+            {
+                auto &g = pop->gametes[i];
+                if (!g.n)
+                    continue;
+                remap_keys(g.mutations, remap);
+                remap_keys(g.smutations, remap);
+                gamete_remap[i] = KTfwd::uint_t(gametes.size());
+                gametes.emplace_back(std::move(g));
+            }
+        pop->gametes.swap(gametes);
+        remap_diploids(pop->diploids, gamete_remap);
+        mcounts_written(pop);
+        diploids_written(pop);
+    }
+
+    template <typename pop_t>
+    std::size_t
+    merge_identical_gametes(pop_t *pop)
+    /*!
+      Merge live gametes carrying the same neutral and selected
+      mutation keys.  Each group is replaced by its first gamete, whose
+      count becomes the sum of the group's counts, and the gamete
+      indexes of all diploids are updated.  The other gametes of the
+      group become extinct, and their slots are recycled by the next
+      generation or removed by compact_population().  They keep their
+      key storage for re-use.
+
+      Works for singlepop_t, metapop_t and multilocus_t.
+
+      \return The number of gametes merged away.
+    */
+    {
+        using namespace compaction_details;
+        std::unordered_multimap<std::size_t, KTfwd::uint_t> seen;
+        seen.reserve(pop->gametes.size());
+        std::vector<KTfwd::uint_t> remap(pop->gametes.size());
+        std::size_t merged = 0;
+        for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+            {
+                remap[i] = KTfwd::uint_t(i);
+                auto &g = pop->gametes[i];
+                if (!g.n)
+                    continue;
+                const auto h = hash_gamete(g);
+                const auto range = seen.equal_range(h);
+                auto first = range.first;
+                for (; first != range.second; ++first)
+                    {
+                        const auto &f = pop->gametes[first->second];
+                        if (f.mutations == g.mutations
+                            && f.smutations == g.smutations)
+                            break;
+                    }
+                if (first == range.second)
+                    {
+                        seen.emplace(h, KTfwd::uint_t(i));
+                        continue;
+                    }
+                remap[i] = first->second;
+                pop->gametes[first->second].n += g.n;
+                g.n = 0;
+                g.mutations.clear();
+                g.smutations.clear();
+                ++merged;
+            }
+        if (merged)
+            {
+                remap_diploids(pop->diploids, remap);
+                diploids_written(pop);
+            }
+        return merged;
+    }
+
+    inline void
+    check_compaction_options(const evolve_options &options)
+    //! Throws std::runtime_error if the policy is invalid
+    {
+        if (!(options.compaction_threshold >= 0.
+              && options.compaction_threshold <= 1.))
+            {
+                throw std::runtime_error(
+                    "compaction_threshold must be 0<=x<=1.");
+            }
+    }
+
+    template <typename pop_t>
+    bool
+    compact_if_due(pop_t *pop, const evolve_options &options,
+                   const unsigned generations)
+    /*!
+      Apply the gamete merging and compaction policies of options
+      after the given number of generations of a simulation.  Merging
+      comes first, so that the gametes it makes extinct count towards
+      compaction_threshold.
+
+      \return true if pop was compacted, or gametes were merged, in
+      which case the caller must refresh any state holding mutation or
+      gamete indexes.
+    */
+    {
+        const bool merged = options.gamete_merge_interval
+                            && generations % options.gamete_merge_interval
+                                   == 0
+                            && merge_identical_gametes(pop);
+        bool due = options.compaction_interval
+                   && generations % options.compaction_interval == 0;
+        if (!due && options.compaction_threshold > 0.)
+            {
+                const double threshold = options.compaction_threshold;
+                due = (!pop->mutations.empty()
+                       && double(live_mutations(pop))
+                              < threshold * double(pop->mutations.size()))
+                      || (!pop->gametes.empty()
+                          && double(live_gametes(pop))
+                                 < threshold * double(pop->gametes.size()));
+            }
+        if (due)
+            compact_population(pop);
+        return due || merged;
+    }
+}
+
+#endif
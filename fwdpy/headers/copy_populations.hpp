@@ -0,0 +1,58 @@
+#ifndef FWDPY_COPY_POPULATIONS_HPP
+#define FWDPY_COPY_POPULATIONS_HPP
+
+/*!
+  \file copy_populations.hpp
+
+  Deep copies of populations, without a serialization round-trip.
+
+  The population types are copy-constructible, and share no storage
+  with their copies.  Copies of a container of populations are made
+  in parallel, by a replicate_scheduler.
+*/
+
+#include "compaction.hpp"
+#include "replicate_scheduler.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace fwdpy
+{
+    template <typename pop_t>
+    std::shared_ptr<pop_t>
+    copy_population(const pop_t &pop, const bool compact)
+    /*!
+      \param compact If true, extinct mutations and gametes are removed
+      from the copy, as by compact_population().
+
+      Works for singlepop_t, metapop_t and multilocus_t.
+    */
+    {
+        std::shared_ptr<pop_t> rv(new pop_t(pop));
+        if (compact)
+            compact_population(rv.get());
+        return rv;
+    }
+
+    template <typename pop_t>
+    std::vector<std::shared_ptr<pop_t>>
+    copy_populations(const std::vector<std::shared_ptr<pop_t>> &pops,
+                     const bool compact, const unsigned nthreads)
+    /*!
+      copy_population() applied to each element of pops, using at most
+      nthreads threads.  0 means use
+      std::thread::hardware_concurrency().
+    */
+    {
+        std::vector<std::shared_ptr<pop_t>> rv(pops.size());
+        replicate_scheduler scheduler(
+            replicate_worker_count(nthreads, pops.size()));
+        scheduler.run(pops.size(), [&](const std::size_t i) {
+            rv[i] = copy_population(*pops[i], compact);
+        });
+        return rv;
+    }
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef FWDPY_COUNTER_RNG_HPP
+#define FWDPY_COUNTER_RNG_HPP
+
+/*!
+  \file counter_rng.hpp
+
+  Counter-based random number streams.
+
+  The generator is Philox4x32-10 (Salmon et al. 2011, "Parallel random
+  numbers: as easy as 1, 2, 3").  Each output block is a pure function
+  of a key and a counter, so that a stream is identified by a
+  rng_stream_key rather than by the state of some other generator.
+  Draws made from a stream do not depend on the order in which other
+  streams were created or used, or on which thread uses them.
+
+  The streams are exposed as a gsl_rng type, so that they may be used
+  wherever fwdpp and the GSL expect a gsl_rng *.
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <gsl/gsl_rng.h>
+
+namespace fwdpy
+{
+    //! What a stream is used for.  Each purpose is an independent stream.
+    enum class rng_purpose : std::uint32_t
+    {
+        replicate,
+        parents,
+        recombination,
+        mutation,
+        phenotype
+    };
+
+    struct rng_stream_key
+    /*!
+      Identifies one stream.  seed is the master seed, drawn once from
+      the caller's GSLrng.  replicate is the index of the population in
+      its container.  generation and individual are 0 for streams used
+      for a whole replicate.
+    */
+    {
+        std::uint64_t seed;
+        std::uint32_t replicate, generation, individual;
+        rng_purpose purpose;
+    };
+
+    namespace philox
+    {
+        constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57,
+                                W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+        //! Max. number of counter values encrypted at once
+        constexpr std::size_t max_blocks = 16;
+
+        inline void
+        blocks(const std::uint32_t key[2], const std::uint64_t first,
+               const std::uint32_t c2, const std::uint32_t c3,
+               const std::size_t n, std::uint32_t *out) noexcept
+        /*!
+          Write the outputs for counters first ... first+n-1 to
+          out[0,4n).  The low 64 bits of the counter are the block
+          index, and the high 64 bits are c2 and c3.
+
+          The lanes are kept in separate arrays so that the rounds
+          vectorize over blocks.
+        */
+        {
+            std::uint32_t x0[max_blocks], x1[max_blocks], x2[max_blocks],
+                x3[max_blocks];
+            for (std::size_t b = 0; b < n; ++b)
+                {
+                    const std::uint64_t c = first + b;
+                    x0[b] = std::uint32_t(c);
+                    x1[b] = std::uint32_t(c >> 32);
+                    x2[b] = c2;
+                    x3[b] = c3;
+                }
+            std::uint32_t k0 = key[0], k1 = key[1];
+            for (unsigned round = 0; round < 10; ++round)
+                {
+                    for (std::size_t b = 0; b < n; ++b)
+                        {
+                            const std::uint64_t p0 = std::uint64_t(M0) * x0[b],
+                                                p1 = std::uint64_t(M1) * x2[b];
+                            const std::uint32_t y0
+                                = std::uint32_t(p1 >> 32) ^ x1[b] ^ k0,
+                                y2 = std::uint32_t(p0 >> 32) ^ x3[b] ^ k1;
+                            x1[b] = std::uint32_t(p1);
+                            x3[b] = std::uint32_t(p0);
+                            x0[b] = y0;
+                            x2[b] = y2;
+                        }
+                    k0 += W0;
+                    k1 += W1;
+                }
+            for (std::size_t b = 0; b < n; ++b)
+                {
+                    out[4 * b] = x0[b];
+                    out[4 * b + 1] = x1[b];
+                    out[4 * b + 2] = x2[b];
+                    out[4 * b + 3] = x3[b];
+                }
+        }
+
+        inline std::uint64_t
+        splitmix64(std::uint64_t x) noexcept
+        {
+            x += 0x9E3779B97F4A7C15ULL;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return x ^ (x >> 31);
+        }
+
+        struct state
+        {
+            std::uint32_t key[2];
+            std::uint32_t generation, individual;
+            //! Index of the next block to encrypt
+            std::uint64_t counter;
+            //! Number of blocks encrypted by the next refill
+            std::size_t nblocks;
+            std::size_t pos, size;
+            std::uint32_t buffer[4 * max_blocks];
+        };
+
+        inline void
+        set_key(state *s, const rng_stream_key &k) noexcept
+        /*!
+          The replicate and purpose are mixed into the key.  The
+          generation and individual are the high words of the counter.
+        */
+        {
+            const std::uint64_t key = splitmix64(
+                k.seed ^ splitmix64((std::uint64_t(k.replicate) << 32)
+                                    | std::uint32_t(k.purpose)));
+            s->key[0] = std::uint32_t(key);
+            s->key[1] = std::uint32_t(key >> 32);
+            s->generation = k.generation;
+            s->individual = k.individual;
+            s->counter = 0;
+            // Streams for one individual are short.  Start small, and
+            // encrypt more blocks at once as the stream gets used.
+            s->nblocks = 1;
+            s->pos = s->size = 0;
+        }
+
+        inline unsigned long
+        get(void *vstate) noexcept
+        {
+            auto s = static_cast<state *>(vstate);
+            if (s->pos == s->size)
+                {
+                    blocks(s->key, s->counter, s->individual, s->generation,
+                           s->nblocks, s->buffer);
+                    s->counter += s->nblocks;
+                    s->size = 4 * s->nblocks;
+                    s->pos = 0;
+                    s->nblocks = std::min(2 * s->nblocks, max_blocks);
+                }
+            return s->buffer[s->pos++];
+        }
+
+        inline double
+        get_double(void *vstate) noexcept
+        {
+            return double(get(vstate)) / 4294967296.0;
+        }
+
+        inline void
+        set(void *vstate, unsigned long seed) noexcept
+        {
+            set_key(static_cast<state *>(vstate),
+                    rng_stream_key{ seed, 0, 0, 0, rng_purpose::replicate });
+        }
+    }
+
+    inline const gsl_rng_type *
+    gsl_rng_counter()
+    /*!
+      The gsl_rng type.  gsl_rng_set(r, seed) selects the replicate
+      stream of replicate 0 for that seed.
+    */
+    {
+        static const gsl_rng_type t
+            = { "fwdpy_philox4x32_10", 0xffffffffUL, 0,
+                sizeof(philox::state), &philox::set, &philox::get,
+                &philox::get_double };
+        return &t;
+    }
+
+    inline void
+    set_rng_stream(const gsl_rng *r, const rng_stream_key &k) noexcept
+    //! Restart r at the beginning of stream k.  r must be a gsl_rng_counter().
+    {
+        assert(r->type == gsl_rng_counter());
+        philox::set_key(static_cast<philox::state *>(r->state), k);
+    }
+
+    class counter_rng
+    /*!
+      Owns a gsl_rng of type gsl_rng_counter().  Its stream may be
+      changed with set(), which does not allocate, so that one object
+      may be re-keyed for each individual.
+    */
+    {
+      private:
+        struct deleter
+        {
+            void
+            operator()(gsl_rng *r) const
+            {
+                gsl_rng_free(r);
+            }
+        };
+        std::unique_ptr<gsl_rng, deleter> r;
+
+      public:
+        explicit counter_rng(const rng_stream_key &k)
+            : r(gsl_rng_alloc(gsl_rng_counter()))
+        {
+            set(k);
+        }
+
+        counter_rng()
+            : counter_rng(rng_stream_key{ 0, 0, 0, 0, rng_purpose::replicate })
+        {
+        }
+
+        gsl_rng *
+        get() const
+        {
+            return r.get();
+        }
+
+        void
+        set(const rng_stream_key &k) const
+        {
+            set_rng_stream(r.get(), k);
+        }
+    };
+
+    inline std::vector<rng_stream_key>
+    draw_replicate_streams(const gsl_rng *r, const std::size_t n)
+    /*!
+      One stream per replicate.  A single master seed is drawn from
+      the parent RNG, and replicate i gets stream (seed, i), however
+      many workers run and whichever one picks it up.
+    */
+    {
+        const std::uint64_t seed = gsl_rng_get(r);
+        std::vector<rng_stream_key> rv;
+        rv.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            {
+                rv.push_back(rng_stream_key{ seed, std::uint32_t(i), 0, 0,
+                                             rng_purpose::replicate });
+            }
+        return rv;
+    }
+}
+
+#endif
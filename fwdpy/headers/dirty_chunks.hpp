@@ -0,0 +1,117 @@
+#ifndef FWDPY_DIRTY_CHUNKS_HPP
+#define FWDPY_DIRTY_CHUNKS_HPP
+
+/*!
+  \file dirty_chunks.hpp
+
+  Records of the writes to a population's containers, read by
+  population_snapshot.
+
+  A container is divided into chunks of chunk_size elements.  Each
+  chunk has a revision number, which code writing to the chunk must
+  change with touch().  A reader that copied a chunk at revision r
+  may keep its copy for as long as the chunk's revision is still r.
+
+  Revision numbers are drawn from one counter for the whole process,
+  so that the revisions of a container that was replaced, for example
+  by deserialization, differ from any revision seen before.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fwdpy
+{
+    inline std::uint64_t
+    next_revision()
+    {
+        static std::atomic<std::uint64_t> counter(0);
+        return ++counter;
+    }
+
+    class dirty_chunks
+    {
+      private:
+        //! Revision of each chunk written by touch(i)
+        std::vector<std::uint64_t> chunks;
+        //! Revision of the last touch_all()
+        std::uint64_t all;
+
+      public:
+        static constexpr std::size_t chunk_size = 1024;
+
+        dirty_chunks() : chunks{}, all(next_revision()) {}
+
+        void
+        touch(const std::size_t i)
+        //! Element i was written
+        {
+            const std::size_t c = i / chunk_size;
+            if (c >= chunks.size())
+                chunks.resize(c + 1, 0);
+            chunks[c] = next_revision();
+        }
+
+        void
+        touch(const std::size_t first, const std::size_t last)
+        //! Elements [first,last) were written
+        {
+            if (first >= last)
+                return;
+            const std::size_t c = (last - 1) / chunk_size;
+            if (c >= chunks.size())
+                chunks.resize(c + 1, 0);
+            const auto r = next_revision();
+            std::fill(chunks.begin() + std::ptrdiff_t(first / chunk_size),
+                      chunks.begin() + std::ptrdiff_t(c + 1), r);
+        }
+
+        void
+        touch_all()
+        //! Any element may have been written
+        {
+            chunks.clear();
+            all = next_revision();
+        }
+
+        std::uint64_t
+        revision(const std::size_t c) const noexcept
+        //! \return The revision of chunk c
+        {
+            return (c < chunks.size()) ? std::max(all, chunks[c]) : all;
+        }
+    };
+
+    template <typename pop_t>
+    inline auto
+    diploids_written(pop_t *pop) -> decltype(pop->diploid_writes.touch_all())
+    //! Any diploid of pop may have been written
+    {
+        pop->diploid_writes.touch_all();
+    }
+
+    inline void
+    diploids_written(const void *)
+    //! For population types whose writes are not recorded
+    {
+    }
+
+    template <typename pop_t>
+    inline auto
+    mcounts_written(pop_t *pop) -> decltype(pop->mcount_writes.touch_all())
+    //! Any mutation count of pop may have been written
+    {
+        pop->mcount_writes.touch_all();
+    }
+
+    inline void
+    mcounts_written(const void *)
+    //! For population types whose writes are not recorded
+    {
+    }
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef FWDPY_EVOLVE_OPTIONS_HPP
+#define FWDPY_EVOLVE_OPTIONS_HPP
+
+#include <cstddef>
+
+namespace fwdpy
+{
+    struct evolve_options
+    /*!
+      Run-time options shared by the "evolve" drivers.
+
+      These options do not change the model being simulated.  They
+      affect how the simulation is carried out.
+    */
+    {
+        //! Max. number of replicates run at once.  0 means use
+        //! std::thread::hardware_concurrency().
+        unsigned nthreads;
+        //! Single-deme simulations only: the offspring generation is
+        //! filled in this many chunks, in parallel.  0 or 1 means no
+        //! chunking.  Results depend on whether chunking is used, but
+        //! not on the number of chunks.
+        unsigned offspring_chunks;
+        //! Number of threads filling offspring chunks.  0 means use
+        //! std::thread::hardware_concurrency().  Results do not depend
+        //! on this value.
+        unsigned offspring_threads;
+        //! Quantitative trait simulations only: remove fixed selected
+        //! mutations from gametes, and add their homozygous effects
+        //! to a constant offset applied by the trait function.  Trait
+        //! values do not depend on this value.  Requires a fitness
+        //! model supporting it.
+        bool fold_fixations;
+        //! Not for multi-deme simulations: do not simulate neutral
+        //! mutations forward.  Instead, record the ancestry of each
+        //! gamete, and place neutral mutations on the recorded
+        //! genealogy.  See ancestry_tables.hpp.  Results depend on this
+        //! value.
+        bool record_ancestry;
+        //! With record_ancestry, simplify the ancestry every this many
+        //! generations.  Must be > 0.
+        unsigned simplification_interval;
+        //! Remove extinct mutations and gametes from a population's
+        //! containers every this many generations.  0 means never.
+        //! See compaction.hpp.  Results do not depend on this value.
+        unsigned compaction_interval;
+        //! Also remove them whenever the fraction of live elements in
+        //! either container falls below this value.  0 means never.
+        double compaction_threshold;
+        //! Merge identical gametes every this many generations.  0
+        //! means never.  See merge_identical_gametes() in
+        //! compaction.hpp.  Results may depend on this value, as
+        //! gametes recombining with a copy of themselves may use
+        //! fewer random numbers.
+        unsigned gamete_merge_interval;
+        //! Capacity of the mutation and gamete containers is kept
+        //! within growth and growth^3 times what the simulation has
+        //! needed, shrinking after contractions.  0 means reserve once,
+        //! for the largest population size.  Otherwise, must be > 1.
+        //! See adaptive_reservation in reserve.hpp.  Results do not
+        //! depend on this value.
+        double reservation_growth;
+        //! If not 0, reservations ahead of need are limited so that a
+        //! replicate's mutations, gametes and diploids take at most
+        //! this many bytes.
+        std::size_t reservation_cap;
+        //! If not 0, replicates are only started while the estimated
+        //! memory of the running replicates fits within this many
+        //! bytes, and are compacted when not running.  See
+        //! replicate_admission.hpp.  Results do not depend on this
+        //! value.
+        std::size_t memory_budget;
+        //! Pin replicate workers to NUMA nodes, and re-allocate each
+        //! replicate on the node evolving it.  Does nothing where the
+        //! topology is unknown.  See numa_placement.hpp.  Results do
+        //! not depend on this value.
+        bool numa_placement;
+        //! Advise large containers to use transparent huge pages.
+        //! Results do not depend on this value.
+        bool huge_pages;
+        //! If not 0, samplers are applied to snapshots of the
+        //! population by a background thread, and evolution continues
+        //! while they run.  At most this many snapshots are waiting or
+        //! being sampled.  See sampler_pipeline.hpp.  Results do not
+        //! depend on this value.
+        unsigned sampler_queue;
+        evolve_options()
+            : nthreads(0), offspring_chunks(0), offspring_threads(0),
+              fold_fixations(false), record_ancestry(false),
+              simplification_interval(100), compaction_interval(0),
+              compaction_threshold(0.), gamete_merge_interval(0),
+              reservation_growth(1.5), reservation_cap(0), memory_budget(0),
+              numa_placement(false), huge_pages(false), sampler_queue(0)
+        {
+        }
+    };
+}
+
+#endif
@@ -1,5 +1,6 @@
 #ifndef FWDPY_EVOLVE_REGIONS_SAMPLER_HPP
 #define FWDPY_EVOLVE_REGIONS_SAMPLER_HPP
+#include "evolve_options.hpp"
 #include "fwdpy_fitness.hpp"
 #include "internal_region_manager.hpp"
 #include "sampler_base.hpp"
@@ -14,6 +15,7 @@ namespace fwdpy
         const unsigned *Nvector, const size_t Nvector_length,
         const double mu_neutral, const double mu_selected,
         const double littler, const double f, const int sample,
-        const internal::region_manager *rm, const singlepop_fitness &fitness);
+        const internal::region_manager *rm, const singlepop_fitness &fitness,
+        const evolve_options &options);
 } // ns fwdpy
 #endif
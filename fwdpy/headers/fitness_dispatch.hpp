@@ -0,0 +1,172 @@
+#ifndef FWDPY_FITNESS_DISPATCH_HPP
+#define FWDPY_FITNESS_DISPATCH_HPP
+
+/*!
+  \file fitness_dispatch.hpp
+
+  Recover the concrete type of a fitness model.
+
+  The "evolve" drivers receive fitness models through the
+  singlepop_fitness and multilocus_fitness base classes.  The functions
+  below call a visitor with the built-in model as its concrete policy
+  type, so that the generation loop may be instantiated for it.  For
+  user-defined models, the visitor receives the std::function.
+
+  A visitor is a type with a template member
+  operator()(const fitness_t &).  (C++11 has no generic lambdas.)
+*/
+
+#include "fitness_kernels.hpp"
+#include "fwdpy_fitness.hpp"
+#include "site_fitness_cache.hpp"
+#include "types.hpp"
+#include <memory>
+#include <vector>
+
+namespace fwdpy
+{
+    template <typename visitor_t>
+    inline void
+    visit_singlepop_fitness(const singlepop_fitness &fitness, visitor_t &&v)
+    {
+        switch (fitness.builtin())
+            {
+            case singlepop_builtin_t::additive_site:
+                v(static_cast<const cached_site_fitness<additive_site_effects>
+                                  &>(fitness));
+                return;
+            case singlepop_builtin_t::multiplicative_site:
+                v(static_cast<const cached_site_fitness<
+                      multiplicative_site_effects> &>(fitness));
+                return;
+            case singlepop_builtin_t::gbr_trait:
+                v(static_cast<const singlepop_gbr_trait &>(fitness));
+                return;
+            default:
+                v(fitness.fitness_function);
+            }
+    }
+
+    template <typename visitor_t>
+    inline void
+    visit_multilocus_fitness(const multilocus_fitness &fitness,
+                             visitor_t &&v)
+    {
+        switch (fitness.builtin)
+            {
+            case mloc_builtin_t::additive_fitness:
+                v(mloc_additive_fitness_kernel{});
+                return;
+            case mloc_builtin_t::multiplicative_fitness:
+                v(mloc_multiplicative_fitness_kernel{});
+                return;
+            case mloc_builtin_t::additive_trait:
+                v(mloc_additive_trait_kernel{ fitness.scaling });
+                return;
+            case mloc_builtin_t::multiplicative_trait:
+                v(mloc_multiplicative_trait_kernel{ fitness.scaling });
+                return;
+            case mloc_builtin_t::gbr_trait:
+                v(mloc_gbr_trait_kernel{});
+                return;
+            case mloc_builtin_t::power_mean_trait:
+                v(mloc_power_mean_trait_kernel{ fitness.SLp, fitness.MLp,
+                                                fitness.SLd, fitness.MLd });
+                return;
+            default:
+                v(fitness.fitness_function);
+            }
+    }
+
+    template <typename fitness_t>
+    inline void
+    update_model_data(const fitness_t &, singlepop_fitness &,
+                      const singlepop_t *)
+    /*!
+      Called by the single-deme "evolve" drivers, with the concrete
+      model passed to the visitor, before the first generation and
+      after each generation.  Models holding per-population data call
+      singlepop_fitness::update().  Other models, including custom
+      fitness functions, hold none, and nothing is done.
+    */
+    {
+    }
+
+    template <typename site_effects>
+    inline void
+    update_model_data(const cached_site_fitness<site_effects> &,
+                      singlepop_fitness &fitness, const singlepop_t *pop)
+    //! Sync the mutation_effect_table and refill the per-gamete cache
+    {
+        fitness.update(pop);
+    }
+
+    inline void
+    update_model_data(const singlepop_gbr_trait &, singlepop_fitness &fitness,
+                      const singlepop_t *pop)
+    //! Sync the mutation_effect_table
+    {
+        fitness.update(pop);
+    }
+
+    template <typename poptype> struct diploid_values
+    /*!
+      Visitor for the functions above, recording the value of each
+      diploid of pop.  Models holding a mutation_effect_table are
+      synced with pop first, as by the "evolve" drivers.
+    */
+    {
+        const poptype &pop;
+        std::vector<double> &values;
+        template <typename fitness_t>
+        void
+        operator()(const fitness_t &ff) const
+        {
+            mutation_effects_changed(ff, pop);
+            values.clear();
+            for (const auto &dip : pop.diploids)
+                values.push_back(ff(dip, pop.gametes, pop.mutations));
+        }
+    };
+
+    inline std::vector<double>
+    singlepop_fitness_values(const singlepop_t &pop,
+                             const singlepop_fitness &fitness,
+                             const bool dispatch)
+    /*!
+      The value of each diploid of pop, obtained through
+      visit_singlepop_fitness if dispatch is true, or else through
+      fitness_function.  Used to check that the two agree.  A copy of
+      fitness is updated for pop first, as by the "evolve" drivers.
+    */
+    {
+        std::unique_ptr<singlepop_fitness> f(fitness.clone());
+        f->update(&pop);
+        std::vector<double> rv;
+        const diploid_values<singlepop_t> v{ pop, rv };
+        if (dispatch)
+            visit_singlepop_fitness(*f, v);
+        else
+            v(f->fitness_function);
+        return rv;
+    }
+
+    inline std::vector<double>
+    multilocus_fitness_values(const multilocus_t &pop,
+                              const multilocus_fitness &fitness,
+                              const bool dispatch)
+    //! As singlepop_fitness_values, for multi-locus models
+    {
+        std::unique_ptr<multilocus_fitness> f(fitness.clone());
+        f->update(&pop);
+        std::vector<double> rv;
+        const diploid_values<multilocus_t> v{ pop, rv };
+        if (dispatch)
+            visit_multilocus_fitness(*f, v);
+        else
+            v(f->fitness_function);
+        return rv;
+    }
+}
+
+#endif
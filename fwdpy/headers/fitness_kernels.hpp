@@ -0,0 +1,324 @@
+#ifndef FWDPY_FITNESS_KERNELS_HPP
+#define FWDPY_FITNESS_KERNELS_HPP
+
+/*!
+  \file fitness_kernels.hpp
+
+  Policy types for the built-in fitness models.
+
+  Each type is a small value type whose operator() has the signature
+  of a fitness function.  The "evolve" drivers pass them by their
+  concrete type all the way down to the rules, allowing the per-mutation
+  loops to be inlined.  See fitness_dispatch.hpp.
+*/
+
+#include "multilocus_genotypes.hpp"
+#include "mutation_effect_table.hpp"
+#include "types.hpp"
+#include <cmath>
+#include <fwdpp/fitness_models.hpp>
+#include <numeric>
+#include <vector>
+
+namespace fwdpy
+{
+    //! Built-in single-deme models.
+    enum class singlepop_builtin_t
+    {
+        custom,
+        additive_site,
+        multiplicative_site,
+        gbr_trait
+    };
+
+    //! Built-in multi-locus models.
+    enum class mloc_builtin_t
+    {
+        custom,
+        additive_fitness,
+        multiplicative_fitness,
+        additive_trait,
+        multiplicative_trait,
+        gbr_trait,
+        power_mean_trait
+    };
+
+    inline double
+    sum_haplotype_effect_sizes(const gamete_t &g,
+                               const mcont_t &mutations) noexcept
+    {
+        double rv = 0.;
+        for (const auto k : g.smutations)
+            rv += mutations[k].s;
+        return rv;
+    }
+
+    /*
+      Site effects for cached_site_fitness.  het() and hom() update a
+      value exactly as the corresponding genotype_fitness_updater
+      functions in fitness.pxd do, so that cached and uncached models
+      perform the same floating-point operations.
+    */
+
+    struct additive_site_effects
+    /*!
+      Fitness is additive over sites: het. sites add h*s, and hom. sites
+      add scaling*s.
+    */
+    {
+        double scaling;
+        static constexpr singlepop_builtin_t builtin
+            = singlepop_builtin_t::additive_site;
+        //! See mutation_effect_table::fold_sites()
+        static constexpr bool product = false;
+        inline void
+        het(double &w, const double s, const double h) const noexcept
+        {
+            w += s * h;
+        }
+        inline void
+        hom(double &w, const double s) const noexcept
+        {
+            w += scaling * s;
+        }
+    };
+
+    struct multiplicative_site_effects
+    /*!
+      Fitness is multiplicative over sites: het. sites contribute
+      1+h*s, and hom. sites 1+scaling*s.
+    */
+    {
+        double scaling;
+        static constexpr singlepop_builtin_t builtin
+            = singlepop_builtin_t::multiplicative_site;
+        //! See mutation_effect_table::fold_sites()
+        static constexpr bool product = true;
+        inline void
+        het(double &w, const double s, const double h) const noexcept
+        {
+            w *= (1. + s * h);
+        }
+        inline void
+        hom(double &w, const double s) const noexcept
+        {
+            w *= (1. + scaling * s);
+        }
+    };
+
+    // Multi-locus kernels.  These reproduce the lambdas formerly
+    // returned by the make_mloc_* functions in fwdpy_fitness.hpp.
+    // They take a const_multilocus_span, so that they accept either a
+    // multilocus_diploid_t or a row of a multilocus_genotypes.
+
+    struct mloc_additive_fitness_kernel
+    //! Additive within loci w/dominance, and then additive across loci
+    {
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            const KTfwd::additive_diploid ff;
+            for (const auto &locus : diploid)
+                {
+                    w += ff(gametes[locus.first], gametes[locus.second],
+                            mutations);
+                }
+            return w;
+        }
+    };
+
+    struct mloc_multiplicative_fitness_kernel
+    //! Multiplicative within loci w/dominance, and then additive across loci
+    {
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            const KTfwd::multiplicative_diploid ff;
+            for (const auto &locus : diploid)
+                {
+                    w += ff(gametes[locus.first], gametes[locus.second],
+                            mutations);
+                }
+            return w;
+        }
+    };
+
+    struct mloc_additive_trait_kernel
+    //! Additive within loci w/dominance, and then additive across loci
+    {
+        double scaling;
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            const KTfwd::site_dependent_fitness ff;
+            const double sc = scaling;
+            for (const auto &locus : diploid)
+                {
+                    w += ff(gametes[locus.first], gametes[locus.second],
+                            mutations,
+                            [sc](double &fitness,
+                                 const KTfwd::popgenmut &mut) noexcept {
+                                fitness += (sc * mut.s);
+                            },
+                            [](double &fitness,
+                               const KTfwd::popgenmut &mut) noexcept {
+                                fitness += (mut.h * mut.s);
+                            },
+                            0.);
+                }
+            return w;
+        }
+    };
+
+    struct mloc_folded_additive_trait_kernel
+    /*!
+      mloc_additive_trait_kernel, plus the summed hom. effects of
+      fixations that were removed from the gametes.  The sum is owned
+      by the caller, and updated between generations.
+    */
+    {
+        mloc_additive_trait_kernel kernel;
+        const double *fixed;
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            return kernel(diploid, gametes, mutations) + *fixed;
+        }
+    };
+
+    struct mloc_multiplicative_trait_kernel
+    //! Multiplicative within loci w/dominance, and then additive across loci
+    {
+        double scaling;
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            const KTfwd::site_dependent_fitness ff;
+            const double sc = scaling;
+            for (const auto &locus : diploid)
+                {
+                    w += ff(gametes[locus.first], gametes[locus.second],
+                            mutations,
+                            [sc](double &fitness,
+                                 const KTfwd::popgenmut &mut) noexcept {
+                                fitness *= (1. + sc * mut.s);
+                            },
+                            [](double &fitness,
+                               const KTfwd::popgenmut &mut) noexcept {
+                                fitness *= (1. + mut.h * mut.s);
+                            },
+                            1.);
+                }
+            return w - 1.0;
+        }
+    };
+
+    inline double
+    lane_sum_effect_sizes(const gamete_t &g,
+                          const mcont_t &mutations) noexcept
+    //! sum_haplotype_effect_sizes, summed as by the GBR models
+    {
+        return lane_sum_s(
+            [&mutations](const KTfwd::uint_t k) { return mutations[k].s; },
+            g.smutations.data(), g.smutations.size());
+    }
+
+    struct mloc_gbr_trait_kernel
+    /*!
+      "GBR" model within loci, additive across loci
+
+      Effect sizes are read from a mutation_effect_table, which the
+      multi-locus "evolve" drivers keep in sync via
+      mutation_effects_changed() and mutation_added().  Without a table
+      in sync, they are read from the mutations, and summed in the
+      same order.
+    */
+    {
+        mutable mutation_effect_table table;
+
+        mloc_gbr_trait_kernel() : table{} {}
+
+        inline double
+        haplotype_sum(const gamete_t &g, const mcont_t &mutations) const
+            noexcept
+        {
+            if (table.size() != mutations.size())
+                return lane_sum_effect_sizes(g, mutations);
+            return table.total_s(g.smutations.data(), g.smutations.size());
+        }
+
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            for (const auto &locus : diploid)
+                {
+                    w += std::sqrt(
+                        haplotype_sum(gametes[locus.first], mutations)
+                        * haplotype_sum(gametes[locus.second], mutations));
+                }
+            return w;
+        }
+    };
+
+    inline void
+    mutation_added(const mloc_gbr_trait_kernel &kernel,
+                   const mcont_t &mutations, const std::size_t key)
+    {
+        kernel.table.assign(key, mutations[key]);
+    }
+
+    inline void
+    mutation_effects_changed(const mloc_gbr_trait_kernel &kernel,
+                             const multilocus_t &pop)
+    {
+        kernel.table.sync(pop.mutations);
+    }
+
+    struct mloc_power_mean_trait_kernel
+    //! Power mean within loci, and then power mean across loci
+    {
+        double SLp, MLp;
+        std::vector<double> SLd, MLd;
+        inline double
+        operator()(const const_multilocus_span diploid,
+                   const gcont_t &gametes, const mcont_t &mutations) const
+            noexcept
+        {
+            double w = 0.0;
+            std::size_t j = 0;
+            for (const auto &locus : diploid)
+                {
+                    const auto h1 = sum_haplotype_effect_sizes(
+                        gametes[locus.first], mutations);
+                    const auto h2 = sum_haplotype_effect_sizes(
+                        gametes[locus.second], mutations);
+                    w += MLd[j]
+                         * (std::pow(std::pow((SLd[0] * std::pow(h1, SLp)
+                                               + SLd[1] * std::pow(h2, SLp)),
+                                              1. / SLp),
+                                     MLp));
+                    j++;
+                }
+            return std::pow(w, 1. / MLp);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef FWDPY_FOLDED_FIXATIONS_HPP
+#define FWDPY_FOLDED_FIXATIONS_HPP
+
+/*!
+  \file folded_fixations.hpp
+
+  Record of the fixations removed from gametes by
+  evolve_options::fold_fixations.
+
+  A population's fixations may also hold selected mutations that were
+  removed by other simulations, for example by evolve_regions.  Only
+  the ones listed here contribute to trait values when the population
+  is evolved further with folding.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace fwdpy
+{
+    class folded_fixations
+    {
+      private:
+        //! Sorted positions
+        std::vector<double> positions;
+
+        static constexpr std::uint32_t format_tag = 0x46445746; // "FWDF"
+
+      public:
+        folded_fixations() : positions{} {}
+
+        bool
+        empty() const noexcept
+        {
+            return positions.empty();
+        }
+
+        std::size_t
+        size() const noexcept
+        {
+            return positions.size();
+        }
+
+        void
+        clear() noexcept
+        {
+            positions.clear();
+        }
+
+        void
+        insert(const double pos)
+        {
+            auto i = std::lower_bound(positions.begin(), positions.end(),
+                                      pos);
+            if (i == positions.end() || *i != pos)
+                positions.insert(i, pos);
+        }
+
+        bool
+        contains(const double pos) const noexcept
+        {
+            return std::binary_search(positions.begin(), positions.end(),
+                                      pos);
+        }
+
+        static bool
+        next_in(std::istream &i)
+        /*!
+          \return Whether the next data in i were written by write().
+          Nothing is extracted.
+        */
+        {
+            const auto start = i.tellg();
+            std::uint32_t tag = 0;
+            i.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+            const bool rv = bool(i) && tag == format_tag;
+            i.clear();
+            i.seekg(start);
+            return rv;
+        }
+
+        void
+        write(std::ostream &o) const
+        {
+            const std::uint32_t tag = format_tag;
+            const std::uint64_t n = positions.size();
+            o.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+            o.write(reinterpret_cast<const char *>(&n), sizeof(n));
+            if (n)
+                o.write(reinterpret_cast<const char *>(positions.data()),
+                        std::streamsize(n * sizeof(double)));
+        }
+
+        void
+        read(std::istream &i)
+        //! Throws std::runtime_error if i does not contain the data
+        {
+            std::uint32_t tag = 0;
+            std::uint64_t n = 0;
+            i.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+            if (!i || tag != format_tag)
+                throw std::runtime_error("invalid folded fixation data");
+            i.read(reinterpret_cast<char *>(&n), sizeof(n));
+            positions.resize(n);
+            if (n)
+                i.read(reinterpret_cast<char *>(positions.data()),
+                       std::streamsize(n * sizeof(double)));
+            if (!i)
+                throw std::runtime_error("invalid folded fixation data");
+        }
+    };
+}
+
+#endif
@@ -5,8 +5,15 @@
   is missing a feature.  Those features may first appear here before getting
   moved over to fwdpp.
 */
+#ifndef FWDPY_FWDPP_FEATURES_HPP
+#define FWDPY_FWDPP_FEATURES_HPP
+
 #include <algorithm>
+#include <cassert>
+#include <cstddef>
 #include <fwdpp/util.hpp>
+#include <numeric>
+#include <vector>
 
 namespace fwdpy
 {
@@ -96,4 +103,360 @@ namespace fwdpy
                     lookup.erase(mutations[i].pos);
             }
     }
+
+    namespace detail
+    {
+        template <typename gcont_t, typename diploid_t>
+        void
+        recount_diploid(const gcont_t &gametes, const diploid_t &dip,
+                        std::vector<KTfwd::uint_t> &counts)
+        {
+            for (const auto g : { dip.first, dip.second })
+                {
+                    for (const auto k : gametes[g].mutations)
+                        ++counts[k];
+                    for (const auto k : gametes[g].smutations)
+                        ++counts[k];
+                }
+        }
+
+        template <typename gcont_t, typename diploid_t>
+        void
+        recount_diploid(const gcont_t &gametes,
+                        const std::vector<diploid_t> &loci,
+                        std::vector<KTfwd::uint_t> &counts)
+        //! Overload for the diploids of multi-locus populations
+        {
+            for (const auto &dip : loci)
+                recount_diploid(gametes, dip, counts);
+        }
+    }
+
+    template <typename pop_t>
+    std::vector<KTfwd::uint_t>
+    recount_mutations(const pop_t &pop)
+    /*!
+      The number of copies of each mutation carried by the diploids of
+      a single-deme or multi-locus population, found by a full scan.
+      Used to test the counts kept by mutation_bookkeeper and by the
+      multi-locus offspring generator.
+    */
+    {
+        std::vector<KTfwd::uint_t> rv(pop.mutations.size(), 0);
+        for (const auto &dip : pop.diploids)
+            detail::recount_diploid(pop.gametes, dip, rv);
+        return rv;
+    }
+
+    template <typename mutation_lookup_table>
+    std::vector<double>
+    sorted_lookup_positions(const mutation_lookup_table &lookup)
+    //! The positions held by a mutation lookup table, sorted
+    {
+        std::vector<double> rv(lookup.begin(), lookup.end());
+        std::sort(rv.begin(), rv.end());
+        return rv;
+    }
+
+    struct retain_selected_fixations
+    /*!
+      Tag type for mutation_bookkeeper: fixed selected mutations stay in
+      the gametes, which is the default for quantitative trait
+      simulations.
+    */
+    {
+    };
+
+    template <typename mutation_t> class mutation_bookkeeper
+    /*!
+      Incremental replacement for update_mutations_n.
+
+      update_mutations_n visits every mutation slot each generation,
+      erases the position of every extinct slot from the lookup table
+      each generation, and inserts fixations into the middle of sorted
+      vectors.  This class only visits:
+
+      1. Mutations added during this generation.  Their keys must be
+      appended to "added", for example by the mutation model.  See
+      track_new_mutations in mutation_effect_table.hpp.
+      2. Mutations fixed in this generation.  Their keys must be
+      appended to "fixed" while the offspring gametes are processed.
+      See process_offspring_gametes and fixation_logging_policy in
+      sample_diploid_chunked.hpp.
+      3. Mutations of the parental gametes that are not carried by
+      any offspring.  A mutation lost in this generation was only
+      carried by such gametes.
+
+      Thus, the cost per generation scales with the number of
+      mutations that may have changed, plus the number of gametes,
+      rather than with the size of the mutation container.  The
+      position of an extinct mutation is erased from the lookup table
+      once.
+
+      New fixations are appended to a buffer and merged into the
+      sorted fixations/fixation_times containers by flush().  The
+      "evolve" drivers call flush() before applying a sampler and at
+      the end of a simulation.
+
+      Usage:
+
+      1. reset() before the first generation.
+      2. update() after every generation, in place of
+      update_mutations_n.
+      3. flush() whenever fixations must be up to date.
+      4. indexes_changed() after the population is compacted.
+
+      When fixed selected mutations are removed from gametes (see
+      evolve_options::fold_fixations), update() and
+      fold_removed_fixations() take a "folder", which is called once
+      for each fixed selected mutation that is no longer carried by
+      the gametes.  Pass retain_selected_fixations() otherwise.
+    */
+    {
+      private:
+        //! Per slot: a non-neutral fixation has already been recorded
+        std::vector<char> recorded;
+        //! Gamete counts after the last update
+        std::vector<KTfwd::uint_t> gamete_counts;
+        //! Keys visited by update()
+        std::vector<std::size_t> dirty;
+        //! Fixations not yet merged into the population's containers
+        std::vector<mutation_t> new_fixations;
+        std::vector<KTfwd::uint_t> new_fixation_times;
+
+        template <typename pop_t, typename folder_t>
+        static inline bool
+        fold(pop_t *pop, const folder_t &folder, const mutation_t &m)
+        {
+            folder(m);
+            pop->folded.insert(m.pos);
+            return true;
+        }
+
+        template <typename pop_t>
+        static inline bool
+        fold(pop_t *, const retain_selected_fixations &,
+             const mutation_t &) noexcept
+        {
+            return false;
+        }
+
+      public:
+        //! Keys of mutations added or recycled since the last update
+        std::vector<std::size_t> added;
+        //! Keys of mutations fixed since the last update
+        std::vector<std::size_t> fixed;
+
+        mutation_bookkeeper()
+            : recorded{}, gamete_counts{}, dirty{}, new_fixations{},
+              new_fixation_times{}, added{}, fixed{}
+        {
+        }
+
+        template <typename pop_t>
+        void
+        reset(pop_t *pop)
+        /*!
+          Full scan of the population.  Must be called before the first
+          generation, as the population may have been modified since
+          the last simulation.
+        */
+        {
+            added.clear();
+            fixed.clear();
+            new_fixations.clear();
+            new_fixation_times.clear();
+            recorded.assign(pop->mutations.size(), 0);
+            gamete_counts.resize(pop->gametes.size());
+            for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+                gamete_counts[i] = pop->gametes[i].n;
+            const auto twoN = 2 * pop->N;
+            for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+                {
+                    const auto &m = pop->mutations[i];
+                    if (!pop->mcounts[i])
+                        {
+                            pop->mut_lookup.erase(m.pos);
+                            continue;
+                        }
+                    if (pop->mcounts[i] == twoN && !m.neutral)
+                        {
+                            auto loc = std::lower_bound(
+                                pop->fixations.begin(), pop->fixations.end(),
+                                m.pos,
+                                [](const mutation_t &f,
+                                   const double p) noexcept {
+                                    return f.pos < p;
+                                });
+                            recorded[i] = (loc != pop->fixations.end()
+                                           && loc->pos == m.pos);
+                        }
+                }
+        }
+
+        template <typename pop_t>
+        void
+        fold_removed_fixations(const pop_t *,
+                               const retain_selected_fixations &)
+        {
+        }
+
+        template <typename pop_t, typename folder_t>
+        void
+        fold_removed_fixations(const pop_t *pop, const folder_t &folder)
+        /*!
+          Pass each fixation previously removed from the gametes by
+          update() with a folder to folder, so that a population
+          evolved with folding may be evolved further.  Fixations
+          removed by other simulations, which are not listed in
+          pop->folded, are skipped.
+        */
+        {
+            for (const auto &m : pop->fixations)
+                {
+                    if (!m.neutral && pop->folded.contains(m.pos))
+                        folder(m);
+                }
+        }
+
+        template <typename pop_t>
+        void
+        update(pop_t *pop, const unsigned generation, const unsigned twoN)
+        /*!
+          Same effect as update_mutations_n, except that new fixations
+          are buffered until flush().
+        */
+        {
+            update(pop, generation, twoN, retain_selected_fixations());
+        }
+
+        template <typename pop_t, typename folder_t>
+        void
+        update(pop_t *pop, const unsigned generation, const unsigned twoN,
+               const folder_t &folder)
+        /*!
+          As above.  Unless folder is retain_selected_fixations, fixed
+          selected mutations are passed to folder, listed in
+          pop->folded, and then treated like fixed neutral mutations.
+          They are recorded as fixations once, even if previously
+          recorded by a simulation that retained them.
+        */
+        {
+            if (recorded.size() < pop->mutations.size())
+                recorded.resize(pop->mutations.size(), 0);
+            for (const auto k : added)
+                recorded[k] = 0;
+            dirty.assign(added.begin(), added.end());
+            dirty.insert(dirty.end(), fixed.begin(), fixed.end());
+            added.clear();
+            fixed.clear();
+            // Parental gametes are not recycled while the offspring are
+            // generated, so their keys still refer to the same mutations.
+            gamete_counts.resize(pop->gametes.size(), 0);
+            for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+                {
+                    const auto &g = pop->gametes[i];
+                    if (gamete_counts[i] && !g.n)
+                        {
+                            dirty.insert(dirty.end(), g.mutations.begin(),
+                                         g.mutations.end());
+                            dirty.insert(dirty.end(), g.smutations.begin(),
+                                         g.smutations.end());
+                        }
+                    gamete_counts[i] = g.n;
+                }
+            // update_mutations_n visits keys in increasing order.  See
+            // flush().
+            std::sort(dirty.begin(), dirty.end());
+            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+            for (const auto k : dirty)
+                {
+                    const auto &m = pop->mutations[k];
+                    auto &n = pop->mcounts[k];
+                    assert(n <= twoN);
+                    if (n == twoN && (m.neutral || !recorded[k]))
+                        {
+                            new_fixations.push_back(m);
+                            new_fixation_times.push_back(generation);
+                            if (!m.neutral)
+                                recorded[k] = 1;
+                        }
+                    if (n == twoN && (m.neutral || fold(pop, folder, m)))
+                        {
+                            n = 0; // Mark as recyclable
+                            pop->mcount_writes.touch(k);
+                        }
+                    if (!n)
+                        pop->mut_lookup.erase(m.pos);
+                }
+        }
+
+        template <typename pop_t>
+        void
+        indexes_changed(pop_t *pop)
+        /*!
+          Call after compact_population().  Buffered fixations are
+          merged, and the live keys are found again.
+        */
+        {
+            flush(pop);
+            reset(pop);
+        }
+
+        template <typename pop_t>
+        void
+        flush(pop_t *pop)
+        /*!
+          Merge buffered fixations into pop->fixations and
+          pop->fixation_times, keeping them sorted by position.
+
+          update_mutations_n inserts each fixation before existing
+          fixations at the same position, so fixations at equal
+          positions are in the reverse of the order in which they were
+          found.  The same order is kept here.
+
+          The merge runs backwards from the end of the containers, so
+          only existing fixations at or to the right of the leftmost
+          new one are moved.
+        */
+        {
+            if (new_fixations.empty())
+                return;
+            std::vector<std::size_t> order(new_fixations.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(),
+                      [this](const std::size_t a, const std::size_t b) {
+                          const auto pa = new_fixations[a].pos,
+                                     pb = new_fixations[b].pos;
+                          return pa < pb || (pa == pb && a > b);
+                      });
+            auto &fixations = pop->fixations;
+            auto &times = pop->fixation_times;
+            std::size_t i = fixations.size(), j = order.size(),
+                        w = fixations.size() + order.size();
+            fixations.resize(w, new_fixations.front());
+            times.resize(w);
+            while (j)
+                {
+                    --w;
+                    if (i && fixations[i - 1].pos
+                                 >= new_fixations[order[j - 1]].pos)
+                        {
+                            --i;
+                            fixations[w] = std::move(fixations[i]);
+                            times[w] = times[i];
+                        }
+                    else
+                        {
+                            --j;
+                            fixations[w] = new_fixations[order[j]];
+                            times[w] = new_fixation_times[order[j]];
+                        }
+                }
+            new_fixations.clear();
+            new_fixation_times.clear();
+        }
+    };
 }
+
+#endif
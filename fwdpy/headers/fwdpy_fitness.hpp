@@ -1,6 +1,8 @@
 #ifndef FWDPY_FITNESS_MODELS_HPP
 #define FWDPY_FITNESS_MODELS_HPP
 
+#include "fitness_kernels.hpp"
+#include "mutation_effect_table.hpp"
 #include "types.hpp"
 #include <algorithm>
 #include <cmath>
@@ -101,19 +103,65 @@ namespace fwdpy
         fitness_fxn_t fitness_function;
 
         /*!
-          Placeholder for future functionality
-        */
-        /*
-    virtual void update(const singlepop_t *)
-    {
-    }
+          Called by the "evolve" drivers before the first generation
+          and after each generation, allowing stateful fitness models
+          to update their data.  Only built-in models that keep such
+          data are updated.  See update_model_data() in
+          fitness_dispatch.hpp.
         */
+        virtual void
+        update(const singlepop_t *)
+        {
+        }
+
+        virtual ~singlepop_fitness() {}
+
+        //! Which built-in model, if any, this is.  See fitness_dispatch.hpp
+        virtual singlepop_builtin_t
+        builtin() const
+        {
+            return singlepop_builtin_t::custom;
+        }
+
         virtual singlepop_fitness *
         clone() const
         {
             return new singlepop_fitness(*this);
         }
 
+        /*!
+          Whether the model supports fold_fixation(), which is required
+          by evolve_options::fold_fixations.
+        */
+        virtual bool
+        folds_fixations() const
+        {
+            return false;
+        }
+
+        /*!
+          Called by the "evolve" drivers when a selected mutation
+          reaches fixation and is about to be removed from all
+          gametes.  Models returning true from folds_fixations() add
+          the mutation's homozygous effect to a constant offset, so
+          that trait values are unchanged by its removal.
+        */
+        virtual void
+        fold_fixation(const KTfwd::popgenmut &)
+        {
+        }
+
+        /*!
+          Called by the "evolve" drivers, before update(), when the
+          population's mutations and gametes were re-indexed by
+          compact_population().  Models storing data by mutation or
+          gamete index must discard it.
+        */
+        virtual void
+        indexes_changed()
+        {
+        }
+
         //! Allows us to allocate on stack in Cython
         singlepop_fitness() : fitness_function(fitness_fxn_t()) {}
         //! Constructor is a sink for a fitness_fxn_t.
@@ -147,6 +195,113 @@ namespace fwdpy
         }
     };
 
+    class singlepop_gbr_trait : public singlepop_fitness
+    /*!
+      The "gene-based recessive" model of Thornton et al. (2013).
+
+      Effect sizes are read from a mutation_effect_table, which is kept
+      in sync in the same way as for cached_site_fitness.  See
+      site_fitness_cache.hpp.  Haplotype sums are taken as by
+      mutation_effect_table::total_s(), with or without the table.
+
+      Folded fixations (see fold_fixation()) are carried by both
+      haplotypes, so their summed effect sizes are added to each
+      haplotype's sum.
+    */
+    {
+      private:
+        mutable mutation_effect_table table;
+        //! Summed effect sizes of folded fixations
+        double fixed_s;
+
+        void
+        bind()
+        {
+            this->fitness_function = [this](const diploid_t &dip,
+                                             const gcont_t &gametes,
+                                             const mcont_t &mutations) {
+                return (*this)(dip, gametes, mutations);
+            };
+        }
+
+      public:
+        singlepop_gbr_trait() : singlepop_fitness(), table{}, fixed_s(0.)
+        {
+            bind();
+        }
+
+        singlepop_gbr_trait(const singlepop_gbr_trait &)
+            : singlepop_fitness(), table{}, fixed_s(0.)
+        /*!
+          The table and folded fixations are not copied, as they refer
+          to a specific population.
+        */
+        {
+            bind();
+        }
+
+        //! fitness_function refers to this object, and cannot be copied
+        singlepop_gbr_trait &operator=(const singlepop_gbr_trait &) = delete;
+
+        inline double
+        operator()(const diploid_t &dip, const gcont_t &gametes,
+                   const mcont_t &mutations) const noexcept
+        {
+            const auto &g1 = gametes[dip.first], &g2 = gametes[dip.second];
+            if (table.size() != mutations.size())
+                return std::sqrt(
+                    (lane_sum_effect_sizes(g1, mutations) + fixed_s)
+                    * (lane_sum_effect_sizes(g2, mutations) + fixed_s));
+            const auto &k1 = g1.smutations, &k2 = g2.smutations;
+            return std::sqrt(
+                (table.total_s(k1.data(), k1.size()) + fixed_s)
+                * (table.total_s(k2.data(), k2.size()) + fixed_s));
+        }
+
+        void
+        assign_mutation(const mcont_t &mutations, const std::size_t key) const
+        {
+            table.assign(key, mutations[key]);
+        }
+
+        virtual void
+        update(const singlepop_t *pop)
+        {
+            table.sync(pop->mutations);
+        }
+
+        virtual singlepop_builtin_t
+        builtin() const
+        {
+            return singlepop_builtin_t::gbr_trait;
+        }
+
+        virtual bool
+        folds_fixations() const
+        {
+            return true;
+        }
+
+        virtual void
+        fold_fixation(const KTfwd::popgenmut &m)
+        {
+            fixed_s += m.s;
+        }
+
+        virtual singlepop_fitness *
+        clone() const
+        {
+            return new singlepop_gbr_trait(*this);
+        }
+    };
+
+    inline void
+    mutation_added(const singlepop_gbr_trait &fitness,
+                   const mcont_t &mutations, const std::size_t key)
+    {
+        fitness.assign_mutation(mutations, key);
+    }
+
     /*
     template<typename data_t>
     struct singlepop_fitness_data : public singlepop_fitness
@@ -221,6 +376,15 @@ namespace fwdpy
         //! The fitness function itself
         fitness_fxn_t fitness_function;
 
+        /*!
+          Which built-in model, if any, this is, and its parameters.
+          Stored by value, as Cython holds these objects by value.  See
+          fitness_dispatch.hpp.
+        */
+        mloc_builtin_t builtin;
+        double scaling, SLp, MLp;
+        std::vector<double> SLd, MLd;
+
         /*!
           Placeholder for future functionality
         */
@@ -237,11 +401,21 @@ namespace fwdpy
         }
 
         //! Allows us to allocate on stack in Cython
-        multilocus_fitness() : fitness_function(fitness_fxn_t()) {}
+        multilocus_fitness()
+            : fitness_function(fitness_fxn_t()),
+              builtin(mloc_builtin_t::custom), scaling(0.), SLp(0.), MLp(0.),
+              SLd{}, MLd{}
+        {
+        }
         //! Constructor is a sink for a fitness_fxn_t
-        multilocus_fitness(fitness_fxn_t ff) : fitness_function(std::move(ff))
+        multilocus_fitness(fitness_fxn_t ff)
+            : fitness_function(std::move(ff)),
+              builtin(mloc_builtin_t::custom), scaling(0.), SLp(0.), MLp(0.),
+              SLd{}, MLd{}
         {
         }
+
+        virtual ~multilocus_fitness() {}
     };
 
     //  template<typename data_t>
@@ -317,18 +491,10 @@ namespace fwdpy
       Additive within loci w/dominance, and then additive across loci
     */
     {
-        return multilocus_fitness(
-            [scaling](const std::vector<diploid_t> &diploid,
-                      const gcont_t &gametes, const mcont_t &mutations) {
-                double w = 0.0;
-                auto ff = KTfwd::additive_diploid();
-                for (const auto &locus : diploid)
-                    {
-                        w += ff(gametes[locus.first], gametes[locus.second],
-                                mutations);
-                    }
-                return w;
-            });
+        multilocus_fitness rv(mloc_additive_fitness_kernel{});
+        rv.builtin = mloc_builtin_t::additive_fitness;
+        rv.scaling = scaling;
+        return rv;
     }
 
     inline multilocus_fitness
@@ -337,47 +503,22 @@ namespace fwdpy
       Additive within loci w/dominance, and then additive across loci
     */
     {
-        return multilocus_fitness(
-            [scaling](const std::vector<diploid_t> &diploid,
-                      const gcont_t &gametes, const mcont_t &mutations) {
-                double w = 0.0;
-                auto ff = KTfwd::site_dependent_fitness();
-                for (const auto &locus : diploid)
-                    {
-                        w += ff(gametes[locus.first], gametes[locus.second],
-                                mutations,
-                                [&](double &fitness,
-                                    const KTfwd::popgenmut &mut) noexcept {
-                                    fitness += (scaling * mut.s);
-                                },
-                                [](double &fitness,
-                                   const KTfwd::popgenmut &mut) noexcept {
-                                    fitness += (mut.h * mut.s);
-                                },
-                                0.);
-                    }
-                return w;
-            });
+        multilocus_fitness rv(mloc_additive_trait_kernel{ scaling });
+        rv.builtin = mloc_builtin_t::additive_trait;
+        rv.scaling = scaling;
+        return rv;
     }
 
     inline multilocus_fitness
     make_mloc_multiplicative_fitness(double scaling = 2.0)
     /*!
-      Additive within loci w/dominance, and then additive across loci
+      Multiplicative within loci w/dominance, and then additive across loci
     */
     {
-        return multilocus_fitness(
-            [scaling](const std::vector<diploid_t> &diploid,
-                      const gcont_t &gametes, const mcont_t &mutations) {
-                double w = 0.0;
-                auto ff = KTfwd::multiplicative_diploid();
-                for (const auto &locus : diploid)
-                    {
-                        w += ff(gametes[locus.first], gametes[locus.second],
-                                mutations);
-                    }
-                return w;
-            });
+        multilocus_fitness rv(mloc_multiplicative_fitness_kernel{});
+        rv.builtin = mloc_builtin_t::multiplicative_fitness;
+        rv.scaling = scaling;
+        return rv;
     }
 
     inline multilocus_fitness
@@ -386,27 +527,10 @@ namespace fwdpy
       Multiplicative within loci w/dominance, and then additive across loci
     */
     {
-        return multilocus_fitness([scaling](
-            const std::vector<diploid_t> &diploid, const gcont_t &gametes,
-            const mcont_t &mutations) {
-            double w = 0.0;
-            auto ff = KTfwd::site_dependent_fitness();
-            for (const auto &locus : diploid)
-                {
-                    w += ff(
-                        gametes[locus.first], gametes[locus.second], mutations,
-                        [&](double &fitness,
-                            const KTfwd::popgenmut &mut) noexcept {
-                            fitness *= (1. + scaling * mut.s);
-                        },
-                        [&mutations](double &fitness,
-                                     const KTfwd::popgenmut &mut) noexcept {
-                            fitness *= (1. + mut.h * mut.s);
-                        },
-                        1.);
-                }
-            return w - 1.0;
-        });
+        multilocus_fitness rv(mloc_multiplicative_trait_kernel{ scaling });
+        rv.builtin = mloc_builtin_t::multiplicative_trait;
+        rv.scaling = scaling;
+        return rv;
     }
 
     inline multilocus_fitness
@@ -415,67 +539,28 @@ namespace fwdpy
       "GBR" model within loci, additive across loci
     */
     {
-        return multilocus_fitness([](const std::vector<diploid_t> &diploid,
-                                     const gcont_t &gametes,
-                                     const mcont_t &mutations) {
-            double w = 0.0;
-            for (const auto &locus : diploid)
-                {
-                    auto h1 = std::accumulate(
-                        gametes[locus.first].smutations.cbegin(),
-                        gametes[locus.first].smutations.cend(), 0.0,
-                        [&mutations](const double &d,
-                                     const std::size_t &i) noexcept {
-                            return d + mutations[i].s;
-                        });
-                    auto h2 = std::accumulate(
-                        gametes[locus.second].smutations.cbegin(),
-                        gametes[locus.second].smutations.cend(), 0.0,
-                        [&mutations](const double &d,
-                                     const std::size_t &i) noexcept {
-                            return d + mutations[i].s;
-                        });
-                    w += std::sqrt(h1 * h2);
-                }
-            return w;
-        });
+        multilocus_fitness rv(mloc_gbr_trait_kernel{});
+        rv.builtin = mloc_builtin_t::gbr_trait;
+        return rv;
     }
 
     inline multilocus_fitness
     make_mloc_power_mean_trait(const double SLp, const double MLp,
                                const std::vector<double> &SLd,
                                const std::vector<double> &MLd)
+    /*!
+      Power mean within loci, then power mean across loci.
+      The weights are copied.
+    */
     {
-        return multilocus_fitness([&](const std::vector<diploid_t> &diploid,
-                                      const gcont_t &gametes,
-                                      const mcont_t &mutations) {
-            double w = 0.0;
-            std::size_t j = 0;
-            for (const auto &locus : diploid)
-                {
-                    auto h1 = std::accumulate(
-                        gametes[locus.first].smutations.cbegin(),
-                        gametes[locus.first].smutations.cend(), 0.0,
-                        [&mutations](const double &d,
-                                     const std::size_t &i) noexcept {
-                            return d + mutations[i].s;
-                        });
-                    auto h2 = std::accumulate(
-                        gametes[locus.second].smutations.cbegin(),
-                        gametes[locus.second].smutations.cend(), 0.0,
-                        [&mutations](const double &d,
-                                     const std::size_t &i) noexcept {
-                            return d + mutations[i].s;
-                        });
-                    w += MLd[j]
-                         * (std::pow(std::pow((SLd[0] * std::pow(h1, SLp)
-                                               + SLd[1] * std::pow(h2, SLp)),
-                                              1. / SLp),
-                                     MLp));
-                    j++;
-                }
-            return std::pow(w, 1. / MLp);
-        });
+        multilocus_fitness rv(
+            mloc_power_mean_trait_kernel{ SLp, MLp, SLd, MLd });
+        rv.builtin = mloc_builtin_t::power_mean_trait;
+        rv.SLp = SLp;
+        rv.MLp = MLp;
+        rv.SLd = SLd;
+        rv.MLd = MLd;
+        return rv;
     }
 
     inline multilocus_fitness
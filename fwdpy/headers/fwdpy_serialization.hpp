@@ -4,11 +4,61 @@
 #ifndef FWDPY_SERIALIZATION_HPP
 #define FWDPY_SERIALIZATION_HPP
 #include "serialization_common.hpp"
+#include <cstdint>
 #include <fwdpp/sugar/serialization.hpp>
+#include <stdexcept>
+#include <string>
 namespace fwdpy
 {
     namespace serialize_objects
     {
+        /*!
+          Marks optional data written after a population in a gzipped
+          file.  The next population in the file, if any, would have to
+          be at generation 0x54445746 to be mistaken for it.
+        */
+        constexpr std::uint32_t gz_trailer_tag = 0x54445746; // "FWDT"
+
+        inline int
+        gzwrite_trailer(gzFile f, const std::string &trailer)
+        /*!
+          Write trailer, which holds optional data such as ancestry
+          tables, after a population.  Nothing is written if trailer is
+          empty.  Returns the number of uncompressed bytes written.
+        */
+        {
+            if (trailer.empty())
+                return 0;
+            const std::uint32_t tag = gz_trailer_tag;
+            const std::uint64_t n = trailer.size();
+            auto rv = gzwrite(f, reinterpret_cast<const char *>(&tag),
+                              sizeof(tag));
+            rv += gzwrite(f, reinterpret_cast<const char *>(&n), sizeof(n));
+            rv += gzwrite(f, trailer.data(), unsigned(n));
+            return rv;
+        }
+
+        inline std::string
+        gzread_trailer(gzFile f)
+        /*!
+          Read the data written by gzwrite_trailer, or return an empty
+          string if f does not continue with such data.
+        */
+        {
+            std::uint32_t tag = 0;
+            std::uint64_t n = 0;
+            if (gzread(f, reinterpret_cast<char *>(&tag), sizeof(tag))
+                    != int(sizeof(tag))
+                || tag != gz_trailer_tag)
+                return std::string();
+            if (gzread(f, reinterpret_cast<char *>(&n), sizeof(n))
+                != int(sizeof(n)))
+                throw std::runtime_error("invalid population file");
+            std::string rv(std::size_t(n), '\0');
+            if (n && gzread(f, &rv[0], unsigned(n)) != int(n))
+                throw std::runtime_error("invalid population file");
+            return rv;
+        }
 
         template <typename poptype> struct deserialize_details
         {
@@ -34,7 +84,9 @@ namespace fwdpy
         inline int
         gzserialize_details(const poptype &pop, const mwriter_t &mwriter,
                             const dipwriter_t &dipwriter, const char *filename,
-                            bool append)
+                            bool append,
+                            const std::string &trailer = std::string())
+        //! See gzwrite_trailer for trailer
         {
             gzFile f;
             if (append)
@@ -50,12 +102,19 @@ namespace fwdpy
                           sizeof(decltype(pop.generation)));
             KTfwd::gzserialize s;
             rv += s(f, pop, mwriter, dipwriter);
+            rv += gzwrite_trailer(f, trailer);
             gzclose(f);
             return rv;
         }
 
         template <typename poptype> struct gzdeserialize_details
         {
+            //! If not nullptr, receives the result of gzread_trailer
+            std::string *trailer;
+            explicit gzdeserialize_details(std::string *trailer_ = nullptr)
+                : trailer(trailer_)
+            {
+            }
             template <typename mreader_t, typename dipreader_t,
                       typename... constructor_data>
             inline poptype
@@ -73,6 +132,18 @@ namespace fwdpy
                        sizeof(decltype(temp.generation)));
                 KTfwd::gzdeserialize s;
                 s(temp, f, mreader, dipreader);
+                if (trailer)
+                    {
+                        try
+                            {
+                                *trailer = gzread_trailer(f);
+                            }
+                        catch (...)
+                            {
+                                gzclose(f);
+                                throw;
+                            }
+                    }
                 gzclose(f);
                 return temp;
             };
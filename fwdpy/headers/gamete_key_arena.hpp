@@ -0,0 +1,203 @@
+#ifndef FWDPY_GAMETE_KEY_ARENA_HPP
+#define FWDPY_GAMETE_KEY_ARENA_HPP
+
+/*!
+  \file gamete_key_arena.hpp
+
+  Re-use of the storage of gamete key vectors.
+
+  Each KTfwd::gamete owns two std::vector<KTfwd::uint_t> using the
+  default allocator, so their storage cannot be carved out of a
+  single block without changing fwdpp's gamete type.  Instead, the
+  storage itself is recycled.  Capacities are rounded up to fixed size
+  classes, and buffers that are too small for a gamete are kept in
+  per-class free lists, rather than freed, and handed to later
+  gametes.  Together with the recycling of extinct gamete slots, which
+  keep their buffers, this means that once the distribution of
+  gamete sizes has settled, making a gamete does not allocate.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fwdpp/forward_types.hpp>
+#include <vector>
+
+namespace fwdpy
+{
+    struct key_storage_stats
+    {
+        //! Bytes of key storage owned by extant gametes
+        std::size_t bytes_live;
+        //! Bytes owned by all gametes, including extinct ones, plus
+        //! free buffers
+        std::size_t bytes_reserved;
+        //! Gametes filled with a buffer taken from a free list
+        std::uint64_t recycle_hits;
+        //! Gametes filled in the storage they already owned
+        std::uint64_t in_place;
+        //! Gametes for which a buffer had to be allocated
+        std::uint64_t allocations;
+    };
+
+    class gamete_key_arena
+    /*!
+      Size classes hold 8, 16, 32, ... keys.  At most max_free buffers
+      are kept per class.
+
+      Used by chunked_offspring_generator and
+      multilocus_offspring_generator when filling gametes.  The gametes
+      made by KTfwd::experimental::sample_diploid swap buffers with
+      fwdpp's scratch vectors, and are not counted.
+    */
+    {
+      public:
+        using key_vector = std::vector<KTfwd::uint_t>;
+        static constexpr std::size_t min_capacity = 8;
+        static constexpr std::size_t max_free = 4096;
+
+      private:
+        std::vector<std::vector<key_vector>> free_lists;
+
+        static std::size_t
+        class_capacity(const std::size_t c) noexcept
+        {
+            return min_capacity << c;
+        }
+
+        static std::size_t
+        class_of(const std::size_t n) noexcept
+        //! Smallest class holding n keys
+        {
+            std::size_t c = 0;
+            while (class_capacity(c) < n)
+                ++c;
+            return c;
+        }
+
+        std::vector<key_vector> &
+        free_list(const std::size_t c)
+        {
+            if (c >= free_lists.size())
+                free_lists.resize(c + 1);
+            return free_lists[c];
+        }
+
+      public:
+        //! See key_storage_stats
+        std::uint64_t recycle_hits, in_place, allocations;
+
+        gamete_key_arena()
+            : free_lists{}, recycle_hits(0), in_place(0), allocations(0)
+        {
+        }
+
+        gamete_key_arena(const gamete_key_arena &rhs)
+            : free_lists{}, recycle_hits(rhs.recycle_hits),
+              in_place(rhs.in_place), allocations(rhs.allocations)
+        //! Free buffers are not copied.
+        {
+        }
+
+        gamete_key_arena(gamete_key_arena &&) = default;
+
+        gamete_key_arena &
+        operator=(gamete_key_arena rhs)
+        {
+            recycle_hits = rhs.recycle_hits;
+            in_place = rhs.in_place;
+            allocations = rhs.allocations;
+            return *this;
+        }
+
+        void
+        release(key_vector &v)
+        /*!
+          Keep the storage of v in the free list of the largest class
+          it can hold.  v is left empty, with no storage.
+        */
+        {
+            key_vector storage;
+            storage.swap(v);
+            if (storage.capacity() < min_capacity)
+                return;
+            std::size_t c = class_of(storage.capacity());
+            if (class_capacity(c) > storage.capacity())
+                --c;
+            auto &l = free_list(c);
+            if (l.size() < max_free)
+                {
+                    storage.clear();
+                    l.emplace_back(std::move(storage));
+                }
+        }
+
+        template <typename iterator, typename function>
+        void
+        fill(key_vector &dest, iterator first, const std::size_t n,
+             const function &f)
+        /*!
+          dest = f applied to [first,first+n).  If dest cannot hold n
+          keys, its storage is released and replaced by a free buffer
+          of the right class, or by a newly allocated one.
+        */
+        {
+            if (dest.capacity() >= n)
+                ++in_place;
+            else
+                {
+                    const auto c = class_of(n);
+                    auto &l = free_list(c);
+                    key_vector storage;
+                    if (!l.empty())
+                        {
+                            storage.swap(l.back());
+                            l.pop_back();
+                            ++recycle_hits;
+                        }
+                    else
+                        {
+                            storage.reserve(class_capacity(c));
+                            ++allocations;
+                        }
+                    release(dest);
+                    dest.swap(storage);
+                }
+            dest.resize(n);
+            std::transform(first, first + n, dest.begin(), f);
+        }
+
+        std::size_t
+        free_bytes() const noexcept
+        {
+            std::size_t rv = 0;
+            for (const auto &l : free_lists)
+                for (const auto &v : l)
+                    rv += v.capacity() * sizeof(KTfwd::uint_t);
+            return rv;
+        }
+    };
+
+    template <typename pop_t>
+    key_storage_stats
+    gamete_key_storage(const pop_t &pop)
+    //! pop must have a gamete_key_arena named key_arena
+    {
+        key_storage_stats rv{ 0, pop.key_arena.free_bytes(),
+                              pop.key_arena.recycle_hits,
+                              pop.key_arena.in_place,
+                              pop.key_arena.allocations };
+        for (const auto &g : pop.gametes)
+            {
+                const auto b = (g.mutations.capacity()
+                                + g.smutations.capacity())
+                               * sizeof(KTfwd::uint_t);
+                if (g.n)
+                    rv.bytes_live += b;
+                rv.bytes_reserved += b;
+            }
+        return rv;
+    }
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef FWDPY_MULTILOCUS_GENOTYPES_HPP
+#define FWDPY_MULTILOCUS_GENOTYPES_HPP
+
+/*!
+  \file multilocus_genotypes.hpp
+
+  Contiguous storage of multi-locus genotypes.
+
+  multilocus_t stores each individual as a multilocus_diploid_t,
+  which is one heap allocation per individual.  multilocus_genotypes
+  stores N individuals as one N x nloci matrix, and each row is seen
+  through a multilocus_span.  Spans may also be made from a
+  multilocus_diploid_t, so that functions taking a span accept either
+  layout.
+*/
+
+#include "types.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fwdpy
+{
+    template <typename T> class basic_multilocus_span
+    /*!
+      A non-owning view of the loci of one individual.  T is diploid_t
+      or const diploid_t.
+    */
+    {
+      private:
+        T *first;
+        std::size_t n;
+
+      public:
+        using value_type = typename std::remove_const<T>::type;
+        using iterator = T *;
+        using const_iterator = const T *;
+
+        basic_multilocus_span(T *b, const std::size_t nloci) noexcept
+            : first(b), n(nloci)
+        {
+        }
+
+        template <typename U,
+                  typename = typename std::enable_if<std::is_convertible<
+                      U *, T *>::value>::type>
+        basic_multilocus_span(const basic_multilocus_span<U> &rhs) noexcept
+            : first(rhs.begin()), n(rhs.size())
+        //! A span of diploid_t converts to a span of const diploid_t
+        {
+        }
+
+        template <typename container,
+                  typename = typename std::enable_if<std::is_convertible<
+                      decltype(std::declval<container &>().data()),
+                      T *>::value>::type>
+        basic_multilocus_span(container &dip) noexcept
+            : first(dip.data()), n(dip.size())
+        //! View of a multilocus_diploid_t
+        {
+        }
+
+        iterator
+        begin() const noexcept
+        {
+            return first;
+        }
+        iterator
+        end() const noexcept
+        {
+            return first + n;
+        }
+        std::size_t
+        size() const noexcept
+        {
+            return n;
+        }
+        bool
+        empty() const noexcept
+        {
+            return !n;
+        }
+        T &operator[](const std::size_t i) const noexcept
+        {
+            assert(i < n);
+            return first[i];
+        }
+    };
+
+    using multilocus_span = basic_multilocus_span<diploid_t>;
+    using const_multilocus_span = basic_multilocus_span<const diploid_t>;
+
+    class multilocus_genotypes
+    /*!
+      N individuals x nloci, stored row-major in a single vector.
+      Storage is only allocated when N*nloci exceeds the current
+      capacity, so a matrix re-used across generations stops allocating
+      once the population size has peaked.
+    */
+    {
+      private:
+        std::vector<diploid_t> data;
+        std::size_t N, nloci;
+
+      public:
+        multilocus_genotypes() : data{}, N(0), nloci(0) {}
+
+        std::size_t
+        size() const noexcept
+        //! Number of individuals
+        {
+            return N;
+        }
+        std::size_t
+        loci() const noexcept
+        {
+            return nloci;
+        }
+        multilocus_span operator[](const std::size_t i) noexcept
+        {
+            assert(i < N);
+            return multilocus_span(data.data() + i * nloci, nloci);
+        }
+        const_multilocus_span operator[](const std::size_t i) const noexcept
+        {
+            assert(i < N);
+            return const_multilocus_span(data.data() + i * nloci, nloci);
+        }
+
+        void
+        resize(const std::size_t n, const std::size_t l)
+        //! Contents are unspecified afterwards
+        {
+            data.resize(n * l);
+            N = n;
+            nloci = l;
+        }
+
+        void
+        assign(const std::vector<multilocus_diploid_t> &diploids)
+        /*!
+          Copy the diploids of a multilocus_t, which must all have the
+          same number of loci.
+        */
+        {
+            resize(diploids.size(),
+                   diploids.empty() ? 0 : diploids.front().size());
+            auto out = data.begin();
+            for (const auto &dip : diploids)
+                {
+                    assert(dip.size() == nloci);
+                    out = std::copy(dip.begin(), dip.end(), out);
+                }
+        }
+    };
+}
+
+#endif
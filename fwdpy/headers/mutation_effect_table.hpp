@@ -0,0 +1,628 @@
+#ifndef FWDPY_MUTATION_EFFECT_TABLE_HPP
+#define FWDPY_MUTATION_EFFECT_TABLE_HPP
+
+/*!
+  \file mutation_effect_table.hpp
+
+  Structure-of-arrays copy of the effect sizes, dominance, positions and
+  neutrality flags of a population's mutations, plus kernels that
+  accumulate effects over a gamete's keys.
+
+  On x86 hardware, the kernels use AVX-512 or AVX2 gathers when the CPU
+  supports them.  The instruction set is chosen at run time, and no
+  special compiler flags are needed.  All code paths perform the same
+  floating-point operations in the same order, so that results do not
+  depend on the hardware:
+
+  1. Site kernels, used by the site-dependent models, apply the
+  updaters in the order of the keys, as fwdpp does.  Their results are
+  identical to fwdpp's.
+
+  2. Sum kernels, used by the GBR models, keep eight partial sums,
+  reduced in a fixed order.  These sums may differ in the last bits
+  from those of fwdpy 0.0.4-rc2 and earlier, which added effect sizes
+  in the order of the keys, so GBR trait values may differ by a few
+  ulps.  lane_sum_s() gives the same sums without a table.
+*/
+
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__))                               \
+    && (defined(__GNUC__) || defined(__clang__))
+#define FWDPY_X86_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+/*
+  Fused multiply-adds round differently from a multiplication followed
+  by an addition.  They are disabled in the kernels below so that all
+  code paths give the same results.
+*/
+#if defined(__GNUC__) && !defined(__clang__)
+#define FWDPY_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define FWDPY_NO_FP_CONTRACT
+#endif
+
+namespace fwdpy
+{
+    //! Instruction sets used by mutation_effect_table kernels
+    enum class simd_level
+    {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    inline bool
+    simd_level_supported(const simd_level level)
+    /*!
+      \return Whether this CPU supports the instruction set.
+    */
+    {
+#ifdef FWDPY_X86_SIMD_DISPATCH
+        __builtin_cpu_init();
+        switch (level)
+            {
+            case simd_level::avx512:
+                return __builtin_cpu_supports("avx512f");
+            case simd_level::avx2:
+                return __builtin_cpu_supports("avx2");
+            default:
+                return true;
+            }
+#else
+        return level == simd_level::scalar;
+#endif
+    }
+
+    inline simd_level
+    detect_simd_level()
+    /*!
+      \return The best instruction set supported by this CPU.
+    */
+    {
+        static const simd_level level = []() {
+            if (simd_level_supported(simd_level::avx512))
+                return simd_level::avx512;
+            if (simd_level_supported(simd_level::avx2))
+                return simd_level::avx2;
+            return simd_level::scalar;
+        }();
+        return level;
+    }
+
+    namespace effect_kernels
+    {
+        //! Number of keys processed per step by all kernels
+        constexpr std::size_t nlanes = 8;
+
+        inline double
+        reduce_sum(const double *lanes)
+        {
+            return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]))
+                   + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+
+        template <typename effect_at>
+        FWDPY_NO_FP_CONTRACT inline double
+        lane_sum(const effect_at &s, const KTfwd::uint_t *keys,
+                 const std::size_t n, double *lanes) noexcept
+        /*!
+          The sum of s(keys[i]) over [0,n), given in lanes the partial
+          sums of the first n - n%nlanes keys, as computed by the sum
+          kernels below.
+        */
+        {
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+            double rv = reduce_sum(lanes);
+            for (std::size_t i = n - n % nlanes; i < n; ++i)
+                rv += s(keys[i]);
+            return rv;
+        }
+
+        /*
+          Sum kernels, for the GBR model.  Each processes the first
+          n - n%nlanes keys, keeping one partial sum per lane, so that
+          key i is added to lanes[i%nlanes].
+
+          Site kernels, for the site-dependent models.  Each processes
+          the first n - n%nlanes keys, applying the het. and hom.
+          updaters of the model to het and hom in the order of the
+          keys, as fwdpp does.  Only the gathers and the terms of each
+          key are vectorized, so that the results are the same as
+          those of fwdpp.  If product is true, het is multiplied by
+          1+s*h and hom by 1+scaling*s (the product kernel).
+          Otherwise, s*h and scaling*s are added.
+        */
+
+        inline void
+        sum_lanes_scalar(const double *s, const KTfwd::uint_t *keys,
+                         const std::size_t n, double *lanes) noexcept
+        {
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    for (std::size_t l = 0; l < nlanes; ++l)
+                        lanes[l] += s[keys[i + l]];
+                }
+        }
+
+        inline void
+        fold_terms(const double *het_terms, const double *hom_terms,
+                   const bool product, double &het, double &hom) noexcept
+        {
+            if (product)
+                {
+                    for (std::size_t l = 0; l < nlanes; ++l)
+                        {
+                            het *= het_terms[l];
+                            hom *= hom_terms[l];
+                        }
+                }
+            else
+                {
+                    for (std::size_t l = 0; l < nlanes; ++l)
+                        {
+                            het += het_terms[l];
+                            hom += hom_terms[l];
+                        }
+                }
+        }
+
+        FWDPY_NO_FP_CONTRACT inline void
+        fold_sites_scalar(const double *s, const double *h,
+                          const KTfwd::uint_t *keys, const std::size_t n,
+                          const double scaling, const bool product,
+                          double &het, double &hom) noexcept
+        {
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+            const double offset = product ? 1. : 0.;
+            double het_terms[nlanes], hom_terms[nlanes];
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    for (std::size_t l = 0; l < nlanes; ++l)
+                        {
+                            const auto k = keys[i + l];
+                            het_terms[l] = s[k] * h[k];
+                            hom_terms[l] = scaling * s[k];
+                            if (product)
+                                {
+                                    het_terms[l] += offset;
+                                    hom_terms[l] += offset;
+                                }
+                        }
+                    fold_terms(het_terms, hom_terms, product, het, hom);
+                }
+        }
+
+#ifdef FWDPY_X86_SIMD_DISPATCH
+        __attribute__((target("avx2"))) inline void
+        sum_lanes_avx2(const double *s, const KTfwd::uint_t *keys,
+                       const std::size_t n, double *lanes) noexcept
+        {
+            __m256d lo = _mm256_loadu_pd(lanes),
+                    hi = _mm256_loadu_pd(lanes + 4);
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    const __m128i k_lo = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i *>(keys + i));
+                    const __m128i k_hi = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i *>(keys + i + 4));
+                    lo = _mm256_add_pd(lo, _mm256_i32gather_pd(s, k_lo, 8));
+                    hi = _mm256_add_pd(hi, _mm256_i32gather_pd(s, k_hi, 8));
+                }
+            _mm256_storeu_pd(lanes, lo);
+            _mm256_storeu_pd(lanes + 4, hi);
+        }
+
+        FWDPY_NO_FP_CONTRACT __attribute__((target("avx2"))) inline void
+        fold_sites_avx2(const double *s, const double *h,
+                        const KTfwd::uint_t *keys, const std::size_t n,
+                        const double scaling, const bool product,
+                        double &het, double &hom) noexcept
+        {
+            const __m256d vscaling = _mm256_set1_pd(scaling),
+                          one = _mm256_set1_pd(1.);
+            double het_terms[nlanes], hom_terms[nlanes];
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    for (std::size_t half = 0; half < nlanes; half += 4)
+                        {
+                            const __m128i k = _mm_loadu_si128(
+                                reinterpret_cast<const __m128i *>(keys + i
+                                                                  + half));
+                            const __m256d vs = _mm256_i32gather_pd(s, k, 8);
+                            const __m256d vh = _mm256_i32gather_pd(h, k, 8);
+                            __m256d vhet = _mm256_mul_pd(vs, vh),
+                                    vhom = _mm256_mul_pd(vscaling, vs);
+                            if (product)
+                                {
+                                    vhet = _mm256_add_pd(vhet, one);
+                                    vhom = _mm256_add_pd(vhom, one);
+                                }
+                            _mm256_storeu_pd(het_terms + half, vhet);
+                            _mm256_storeu_pd(hom_terms + half, vhom);
+                        }
+                    fold_terms(het_terms, hom_terms, product, het, hom);
+                }
+        }
+
+        __attribute__((target("avx512f"))) inline void
+        sum_lanes_avx512(const double *s, const KTfwd::uint_t *keys,
+                         const std::size_t n, double *lanes) noexcept
+        {
+            __m512d sum = _mm512_loadu_pd(lanes);
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    const __m256i k = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(keys + i));
+                    sum = _mm512_add_pd(sum, _mm512_i32gather_pd(k, s, 8));
+                }
+            _mm512_storeu_pd(lanes, sum);
+        }
+
+        FWDPY_NO_FP_CONTRACT __attribute__((target("avx512f"))) inline void
+        fold_sites_avx512(const double *s, const double *h,
+                          const KTfwd::uint_t *keys, const std::size_t n,
+                          const double scaling, const bool product,
+                          double &het, double &hom) noexcept
+        {
+            const __m512d vscaling = _mm512_set1_pd(scaling),
+                          one = _mm512_set1_pd(1.);
+            double het_terms[nlanes], hom_terms[nlanes];
+            for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+                {
+                    const __m256i k = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(keys + i));
+                    const __m512d vs = _mm512_i32gather_pd(k, s, 8);
+                    const __m512d vh = _mm512_i32gather_pd(k, h, 8);
+                    __m512d vhet = _mm512_mul_pd(vs, vh),
+                            vhom = _mm512_mul_pd(vscaling, vs);
+                    if (product)
+                        {
+                            vhet = _mm512_add_pd(vhet, one);
+                            vhom = _mm512_add_pd(vhom, one);
+                        }
+                    _mm512_storeu_pd(het_terms, vhet);
+                    _mm512_storeu_pd(hom_terms, vhom);
+                    fold_terms(het_terms, hom_terms, product, het, hom);
+                }
+        }
+#endif
+    }
+
+    class mutation_effect_table
+    /*!
+      Contiguous copies of s, h, pos and neutral for each element of a
+      mutation container, indexed like the container.
+
+      The table must be kept in sync by the owner: sync() copies the
+      whole container, and assign() copies a single mutation that was
+      just added to the container or recycled.
+    */
+    {
+      private:
+        simd_level level;
+        bool
+        can_gather(const std::size_t n) const noexcept
+        //! Gathers use signed 32-bit indexes
+        {
+            return n >= effect_kernels::nlanes && level != simd_level::scalar
+                   && s.size() <= std::size_t(
+                          std::numeric_limits<std::int32_t>::max());
+        }
+
+      public:
+        std::vector<double> s, h, pos;
+        std::vector<char> neutral;
+
+        explicit mutation_effect_table(
+            const simd_level level_ = detect_simd_level())
+            : level(level_), s{}, h{}, pos{}, neutral{}
+        {
+        }
+
+        simd_level
+        instruction_set() const noexcept
+        {
+            return level;
+        }
+
+        std::size_t
+        size() const noexcept
+        {
+            return s.size();
+        }
+
+        void
+        assign(const std::size_t key, const KTfwd::popgenmut &m)
+        {
+            if (key >= s.size())
+                {
+                    s.resize(key + 1);
+                    h.resize(key + 1);
+                    pos.resize(key + 1);
+                    neutral.resize(key + 1);
+                }
+            s[key] = m.s;
+            h[key] = m.h;
+            pos[key] = m.pos;
+            neutral[key] = m.neutral;
+        }
+
+        void
+        sync(const mcont_t &mutations)
+        {
+            s.resize(mutations.size());
+            h.resize(mutations.size());
+            pos.resize(mutations.size());
+            neutral.resize(mutations.size());
+            for (std::size_t i = 0; i < mutations.size(); ++i)
+                {
+                    s[i] = mutations[i].s;
+                    h[i] = mutations[i].h;
+                    pos[i] = mutations[i].pos;
+                    neutral[i] = mutations[i].neutral;
+                }
+        }
+
+        double
+        total_s(const KTfwd::uint_t *keys, const std::size_t n) const
+            noexcept
+        /*!
+          The sum of s over keys[0,n).  The keys are summed in nlanes
+          partial sums, so the result may differ in the last bits from
+          a sum taken in the order of the keys.  See lane_sum_s().
+        */
+        {
+            using namespace effect_kernels;
+            double lanes[nlanes] = { 0. };
+#ifdef FWDPY_X86_SIMD_DISPATCH
+            if (can_gather(n))
+                {
+                    if (level == simd_level::avx512)
+                        sum_lanes_avx512(s.data(), keys, n, lanes);
+                    else
+                        sum_lanes_avx2(s.data(), keys, n, lanes);
+                }
+            else
+#endif
+                sum_lanes_scalar(s.data(), keys, n, lanes);
+            const double *sp = s.data();
+            return lane_sum([sp](const KTfwd::uint_t k) { return sp[k]; },
+                            keys, n, lanes);
+        }
+
+        FWDPY_NO_FP_CONTRACT void
+        fold_sites(const KTfwd::uint_t *keys, const std::size_t n,
+                   const double scaling, const bool product, double &het,
+                   double &hom) const noexcept
+        /*!
+          Apply the het. updater of a site-dependent model to het, and
+          its hom. updater to hom, for each of keys[0,n), in order.
+          The model is multiplicative if product is true, and additive
+          otherwise.  See effect_kernels.
+        */
+        {
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+            using namespace effect_kernels;
+#ifdef FWDPY_X86_SIMD_DISPATCH
+            if (can_gather(n))
+                {
+                    if (level == simd_level::avx512)
+                        fold_sites_avx512(s.data(), h.data(), keys, n,
+                                          scaling, product, het, hom);
+                    else
+                        fold_sites_avx2(s.data(), h.data(), keys, n,
+                                        scaling, product, het, hom);
+                }
+            else
+#endif
+                fold_sites_scalar(s.data(), h.data(), keys, n, scaling,
+                                  product, het, hom);
+            for (std::size_t i = n - n % nlanes; i < n; ++i)
+                {
+                    const auto k = keys[i];
+                    if (product)
+                        {
+                            het *= (1. + s[k] * h[k]);
+                            hom *= (1. + scaling * s[k]);
+                        }
+                    else
+                        {
+                            het += s[k] * h[k];
+                            hom += scaling * s[k];
+                        }
+                }
+        }
+
+        FWDPY_NO_FP_CONTRACT double
+        fold_diploid(const KTfwd::uint_t *k1, const std::size_t n1,
+                     const KTfwd::uint_t *k2, const std::size_t n2,
+                     const double scaling, const bool product,
+                     double w) const noexcept
+        /*!
+          The value of a diploid carrying keys k1[0,n1) and k2[0,n2),
+          starting from w, as obtained by fwdpp's
+          site_dependent_fitness.  The two lists are merged by
+          position, and a site is homozygous if both carry its key or
+          its position.
+        */
+        {
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+            const auto het = [this, product](double &v, const std::size_t k) {
+                if (product)
+                    v *= (1. + s[k] * h[k]);
+                else
+                    v += s[k] * h[k];
+            };
+            const auto e2 = k2 + n2;
+            for (const auto *b1 = k1; b1 < k1 + n1; ++b1)
+                {
+                    const auto k = *b1;
+                    for (; k2 < e2 && *k2 != k && pos[*k2] < pos[k]; ++k2)
+                        het(w, *k2);
+                    if (k2 < e2 && (*k2 == k || pos[*k2] == pos[k]))
+                        {
+                            if (product)
+                                w *= (1. + scaling * s[k]);
+                            else
+                                w += scaling * s[k];
+                            ++k2;
+                        }
+                    else
+                        het(w, k);
+                }
+            for (; k2 < e2; ++k2)
+                het(w, *k2);
+            return w;
+        }
+    };
+
+    template <typename effect_at>
+    inline double
+    lane_sum_s(const effect_at &s, const KTfwd::uint_t *keys,
+               const std::size_t n) noexcept
+    /*!
+      The sum of s(keys[i]) over [0,n), in the same order as
+      mutation_effect_table::total_s(), for use without a table.
+    */
+    {
+        using namespace effect_kernels;
+        double lanes[nlanes] = { 0. };
+        for (std::size_t i = 0; i + nlanes <= n; i += nlanes)
+            {
+                for (std::size_t l = 0; l < nlanes; ++l)
+                    lanes[l] += s(keys[i + l]);
+            }
+        return lane_sum(s, keys, n, lanes);
+    }
+
+    inline std::vector<std::vector<double>>
+    gamete_effect_sums(const singlepop_t &pop)
+    /*!
+      For each instruction set supported by this CPU, in the order of
+      simd_level, values computed by the kernels over the selected
+      mutations of each gamete of pop: total_s(), and then het and hom
+      as given by fold_sites() for the additive and the multiplicative
+      models with scaling 2, starting from 1.  Used to test that all
+      code paths agree.
+    */
+    {
+        std::vector<std::vector<double>> rv;
+        for (const auto level :
+             { simd_level::scalar, simd_level::avx2, simd_level::avx512 })
+            {
+                if (!simd_level_supported(level))
+                    continue;
+                mutation_effect_table table(level);
+                table.sync(pop.mutations);
+                std::vector<double> sums;
+                for (const auto &g : pop.gametes)
+                    {
+                        const auto keys = g.smutations.data();
+                        const auto n = g.smutations.size();
+                        sums.push_back(table.total_s(keys, n));
+                        for (const bool product : { false, true })
+                            {
+                                double het = 1., hom = 1.;
+                                table.fold_sites(keys, n, 2., product, het,
+                                                 hom);
+                                sums.push_back(het);
+                                sums.push_back(hom);
+                            }
+                    }
+                rv.emplace_back(std::move(sums));
+            }
+        return rv;
+    }
+
+    template <typename fitness_t>
+    inline void
+    mutation_added(const fitness_t &, const mcont_t &, const std::size_t)
+    /*!
+      Called by the "evolve" drivers when mutations[key] has been added
+      or recycled during a generation, so that fitness models holding a
+      mutation_effect_table can keep it in sync.  Models that need this
+      provide an overload.  This one does nothing.
+    */
+    {
+    }
+
+    template <typename fitness_t>
+    inline void
+    offspring_gametes_ready(const fitness_t &, const singlepop_t &)
+    /*!
+      Called by chunked_offspring_generator once the offspring gametes
+      are in the population, and before the offspring are evaluated
+      concurrently.  Models that cache per-gamete values provide an
+      overload, to fill their caches serially.  This one does nothing.
+    */
+    {
+    }
+
+    template <typename fitness_t, typename poptype>
+    inline void
+    mutation_effects_changed(const fitness_t &, const poptype &)
+    /*!
+      Called by the multi-locus "evolve" drivers before the first
+      generation, and when the population's mutations were re-indexed
+      by compact_population(), so that fitness models holding a
+      mutation_effect_table can sync it.  Models that need this
+      provide an overload.  This one does nothing.
+    */
+    {
+    }
+
+    template <typename mutation_model, typename fitness_t>
+    struct notify_new_mutations
+    /*!
+      Wraps a mutation model, calling mutation_added() for each new
+      mutation.  If added is not nullptr, new keys are also appended to
+      it.  See mutation_bookkeeper in fwdpp_features.hpp.
+    */
+    {
+        mutation_model mmodel;
+        const fitness_t &ff;
+        std::vector<std::size_t> *added;
+        std::size_t
+        operator()(std::queue<std::size_t> &recycling_bin,
+                   mcont_t &mutations) const
+        {
+            const std::size_t key = mmodel(recycling_bin, mutations);
+            mutation_added(ff, mutations, key);
+            if (added)
+                added->push_back(key);
+            return key;
+        }
+    };
+
+    template <typename mutation_model, typename fitness_t>
+    inline notify_new_mutations<typename std::decay<mutation_model>::type,
+                                fitness_t>
+    track_new_mutations(mutation_model &&mmodel, const fitness_t &ff,
+                        std::vector<std::size_t> *added = nullptr)
+    {
+        return notify_new_mutations<
+            typename std::decay<mutation_model>::type, fitness_t>{
+            std::forward<mutation_model>(mmodel), ff, added
+        };
+    }
+}
+
+#endif
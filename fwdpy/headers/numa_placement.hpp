@@ -0,0 +1,290 @@
+#ifndef FWDPY_NUMA_PLACEMENT_HPP
+#define FWDPY_NUMA_PLACEMENT_HPP
+
+/*!
+  \file numa_placement.hpp
+
+  Placement of replicates on the nodes of a NUMA machine.
+
+  Populations are created by the Python thread, so their containers
+  are first touched, and their pages placed, on whichever node that
+  thread ran.  With evolve_options::numa_placement, the workers of a
+  replicate_scheduler are pinned to the CPUs of one node each,
+  round-robin, and a replicate's containers are copied by the worker
+  about to evolve it.  Under Linux's default, "local", memory policy,
+  the pages of the copies, and of everything allocated while evolving
+  the replicate, are then on the worker's node.
+
+  The topology is read from /sys/devices/system/node, so libnuma is
+  not needed.  On other systems, or if the topology cannot be read,
+  placement does nothing.  On a machine with a single node, workers
+  are pinned to all of the CPUs the process may use.
+
+  With evolve_options::huge_pages, the storage of large containers is
+  advised to use transparent huge pages.
+*/
+
+#include "evolve_options.hpp"
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fwdpy
+{
+    namespace numa_details
+    {
+        //! Containers smaller than this are not advised to use huge pages
+        constexpr std::size_t huge_page_bytes = std::size_t(2) << 20;
+
+        inline std::vector<unsigned>
+        parse_cpulist(const std::string &s)
+        //! "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+        {
+            std::vector<unsigned> rv;
+            std::istringstream in(s);
+            std::string range;
+            while (std::getline(in, range, ','))
+                {
+                    if (range.empty() || !std::isdigit(range[0]))
+                        continue;
+                    const auto dash = range.find('-');
+                    const unsigned first
+                        = unsigned(std::stoul(range.substr(0, dash)));
+                    const unsigned last
+                        = (dash == std::string::npos)
+                              ? first
+                              : unsigned(std::stoul(range.substr(dash + 1)));
+                    for (unsigned c = first; c <= last; ++c)
+                        rv.push_back(c);
+                }
+            return rv;
+        }
+
+        inline std::string
+        read_line(const std::string &path)
+        //! First line of a file, or an empty string
+        {
+            std::ifstream in(path.c_str());
+            std::string line;
+            std::getline(in, line);
+            return line;
+        }
+    }
+
+    inline std::vector<std::vector<unsigned>>
+    numa_nodes()
+    /*!
+      The CPUs of each NUMA node that this process may run on.  Nodes
+      with no such CPU are omitted.  Empty if the topology is unknown.
+    */
+    {
+        std::vector<std::vector<unsigned>> rv;
+#ifdef __linux__
+        using namespace numa_details;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed))
+            return rv;
+        try
+            {
+                const std::string sysfs = "/sys/devices/system/node/";
+                const auto online = parse_cpulist(read_line(sysfs + "online"));
+                for (const auto node : online)
+                    {
+                        std::vector<unsigned> cpus;
+                        for (const auto c : parse_cpulist(read_line(
+                                 sysfs + "node" + std::to_string(node)
+                                 + "/cpulist")))
+                            {
+                                if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                                    cpus.push_back(c);
+                            }
+                        if (!cpus.empty())
+                            rv.emplace_back(std::move(cpus));
+                    }
+            }
+        catch (const std::exception &)
+            {
+                rv.clear();
+            }
+#endif
+        return rv;
+    }
+
+    inline void
+    advise_huge_pages(const void *p, const std::size_t bytes)
+    /*!
+      Advise the kernel to back the whole pages within [p,p+bytes) with
+      transparent huge pages.  Does nothing for less than one huge
+      page, or where not supported.  Failure is ignored, as the advice
+      is only a hint.
+    */
+    {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (bytes < numa_details::huge_page_bytes)
+            return;
+        const auto page = std::uintptr_t(sysconf(_SC_PAGESIZE));
+        const auto b = (std::uintptr_t(p) + page - 1) / page * page,
+                   e = (std::uintptr_t(p) + bytes) / page * page;
+        if (e > b)
+            madvise(reinterpret_cast<void *>(b), e - b, MADV_HUGEPAGE);
+#else
+        (void)p;
+        (void)bytes;
+#endif
+    }
+
+    template <typename T>
+    inline void
+    advise_huge_pages(const std::vector<T> &v)
+    //! Advise the whole capacity of v
+    {
+        advise_huge_pages(v.data(), v.capacity() * sizeof(T));
+    }
+
+    namespace numa_details
+    {
+        template <typename T>
+        inline void
+        rehome(std::vector<T> &v, const bool huge_pages)
+        /*!
+          Copy v into storage allocated, and first touched, by the
+          calling thread.  Elements are copied rather than moved, so
+          that nested vectors are re-allocated, too.
+        */
+        {
+            std::vector<T> local;
+            local.reserve(v.capacity());
+            if (huge_pages)
+                advise_huge_pages(local);
+            local.insert(local.end(), v.begin(), v.end());
+            v.swap(local);
+        }
+    }
+
+    template <typename pop_t>
+    void
+    rehome_population(pop_t *pop, const bool huge_pages)
+    /*!
+      Re-allocate the mutations, mutation counts, gametes (with their
+      keys) and diploids of pop in the calling thread.  Indexes do not
+      change.
+    */
+    {
+        numa_details::rehome(pop->mutations, huge_pages);
+        numa_details::rehome(pop->mcounts, huge_pages);
+        numa_details::rehome(pop->gametes, huge_pages);
+        numa_details::rehome(pop->diploids, huge_pages);
+    }
+
+    class numa_placement
+    /*!
+      Placement of the replicates run by a replicate_scheduler.  Pass
+      pin() to replicate_scheduler::run(), and call place() from a
+      task before evolving its replicate.
+
+      Worker 0 is the calling thread, whose CPU affinity is restored
+      on destruction.
+    */
+    {
+      private:
+        const std::vector<std::vector<unsigned>> nodes;
+#ifdef __linux__
+        cpu_set_t caller;
+        bool caller_saved;
+#endif
+
+      public:
+        const bool huge_pages;
+
+        explicit numa_placement(const evolve_options &options)
+            : nodes(options.numa_placement
+                        ? numa_nodes()
+                        : std::vector<std::vector<unsigned>>()),
+#ifdef __linux__
+              caller(), caller_saved(false),
+#endif
+              huge_pages(options.huge_pages)
+        {
+#ifdef __linux__
+            if (!nodes.empty())
+                {
+                    CPU_ZERO(&caller);
+                    caller_saved
+                        = !sched_getaffinity(0, sizeof(caller), &caller);
+                }
+#endif
+        }
+
+        numa_placement(const numa_placement &) = delete;
+        numa_placement &operator=(const numa_placement &) = delete;
+
+        ~numa_placement()
+        {
+#ifdef __linux__
+            if (caller_saved)
+                sched_setaffinity(0, sizeof(caller), &caller);
+#endif
+        }
+
+        bool
+        enabled() const noexcept
+        //! false if placement was not asked for, or is not possible
+        {
+            return !nodes.empty();
+        }
+
+        void
+        pin(const unsigned worker) const
+        /*!
+          Restrict the calling thread, which runs the given worker, to
+          the CPUs of node worker % number of nodes.  Threads it
+          creates, such as those filling offspring chunks, inherit its
+          affinity.
+        */
+        {
+#ifdef __linux__
+            if (nodes.empty())
+                return;
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (const auto c : nodes[worker % nodes.size()])
+                CPU_SET(c, &cpus);
+            sched_setaffinity(0, sizeof(cpus), &cpus);
+#else
+            (void)worker;
+#endif
+        }
+
+        template <typename pop_t>
+        void
+        place(pop_t *pop) const
+        /*!
+          Re-allocate pop in the calling worker, if enabled.
+          Otherwise, with huge_pages, advise its existing containers.
+        */
+        {
+            if (enabled())
+                rehome_population(pop, huge_pages);
+            else if (huge_pages)
+                {
+                    advise_huge_pages(pop->mutations);
+                    advise_huge_pages(pop->mcounts);
+                    advise_huge_pages(pop->gametes);
+                    advise_huge_pages(pop->diploids);
+                }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,413 @@
+#ifndef FWDPY_POPULATION_SNAPSHOT_HPP
+#define FWDPY_POPULATION_SNAPSHOT_HPP
+
+/*!
+  \file population_snapshot.hpp
+
+  Immutable snapshots of a population, sharing storage between
+  generations.
+
+  A population_snapshot stores the containers of a population as
+  fixed-size chunks held by reference-counted pointers to const.
+  Copies of a snapshot share all of its storage.  A snapshot_source
+  keeps the latest snapshot of one population, and brings it up to
+  date by replacing the chunks that may have changed since.  Chunks
+  held by earlier snapshots are never modified.
+
+  The cost of snapshot_source::take() is as follows:
+
+  1. diploids and mcounts: the code writing them records the chunks
+  it writes (see dirty_chunks.hpp), and only those are copied, without
+  comparing them.  The trait_arrays of a FWDPY_COMPACT_DIPLOID build
+  are treated as part of the diploids.  Each generation writes every offspring and
+  recounts every mutation, so both are copied whole after a
+  generation.
+  2. ancestry: shared while its revision is unchanged, and otherwise
+  copied whole.  Samplers see simplified tables, and simplification
+  rewrites them, so the tables are copied whole by each sampling
+  generation that records ancestry.
+  3. mutations, gametes, fixations and fixation times: these are
+  also written by fwdpp, so writes to them are not recorded.  Each
+  chunk is compared with the live container, element by element, and
+  copied if it differs.  The comparisons cost O(size of the
+  containers).  Most chunks of mutations are usually shared.  Gamete
+  counts change every generation, so most chunks of gametes are
+  copied.
+
+  Copying a snapshot, as sampler_pipeline does, costs O(number of
+  chunks).
+
+  Samplers take a const singlepop_t * or const multilocus_t *.  A
+  snapshot_view fills a population object, re-used across snapshots,
+  from a snapshot, so that existing samplers may be applied to it
+  unchanged.  Only the chunks that differ from those of the previous
+  snapshot are copied into the view.  Views hold no position lookup
+  table.
+*/
+
+#include "dirty_chunks.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace fwdpy
+{
+    namespace snapshot_details
+    {
+        template <typename T>
+        inline typename std::enable_if<std::is_trivially_copyable<T>::value,
+                                       bool>::type
+        same(const T *a, const T *b, const std::size_t n)
+        /*!
+          Bitwise comparison.  Padding bytes may make equal elements
+          compare unequal, which only costs a chunk copy.
+        */
+        {
+            return !std::memcmp(a, b, n * sizeof(T));
+        }
+
+        template <typename T>
+        inline typename std::enable_if<!std::is_trivially_copyable<T>::value,
+                                       bool>::type
+        same(const T *a, const T *b, const std::size_t n)
+        {
+            return std::equal(a, a + n, b);
+        }
+
+        inline bool
+        same(const gamete_t *a, const gamete_t *b, const std::size_t n)
+        //! KTfwd::gamete's operator== ignores counts
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (a[i].n != b[i].n || a[i].mutations != b[i].mutations
+                        || a[i].smutations != b[i].smutations)
+                        return false;
+                }
+            return true;
+        }
+
+        inline std::unique_ptr<singlepop_t>
+        make_view(const singlepop_t *)
+        {
+            return std::unique_ptr<singlepop_t>(new singlepop_t(0u));
+        }
+
+        inline std::unique_ptr<multilocus_t>
+        make_view(const multilocus_t *)
+        {
+            return std::unique_ptr<multilocus_t>(new multilocus_t(0u, 0u));
+        }
+    }
+
+    template <typename T> class cow_vector
+    /*!
+      A sequence stored as chunks of chunk_size elements, each held by
+      a std::shared_ptr<const std::vector<T>>.  Copies share chunks.
+    */
+    {
+      public:
+        using chunk_t = std::vector<T>;
+        using chunk_list = std::vector<std::shared_ptr<const chunk_t>>;
+        static constexpr std::size_t chunk_size = dirty_chunks::chunk_size;
+
+      private:
+        chunk_list chunks;
+        //! Revision of each chunk when it was copied, for assign() with
+        //! recorded writes
+        std::vector<std::uint64_t> revisions;
+        std::size_t n;
+
+        template <typename keep_chunk>
+        std::size_t
+        assign_chunks(const std::vector<T> &v, const keep_chunk &keep)
+        {
+            const std::size_t nc = (v.size() + chunk_size - 1) / chunk_size;
+            chunks.resize(nc);
+            revisions.resize(nc, 0);
+            std::size_t replaced = 0;
+            for (std::size_t c = 0; c < nc; ++c)
+                {
+                    const auto b = v.begin() + c * chunk_size,
+                               e = v.begin()
+                                   + std::min(v.size(), (c + 1) * chunk_size);
+                    const std::size_t len = std::size_t(e - b);
+                    auto &current = chunks[c];
+                    if (current && current->size() == len
+                        && keep(c, *current, &*b))
+                        continue;
+                    current = std::make_shared<const chunk_t>(b, e);
+                    ++replaced;
+                }
+            n = v.size();
+            return replaced;
+        }
+
+      public:
+        cow_vector() : chunks{}, revisions{}, n(0) {}
+
+        std::size_t
+        size() const noexcept
+        {
+            return n;
+        }
+
+        std::size_t
+        nchunks() const noexcept
+        {
+            return chunks.size();
+        }
+
+        const chunk_t &
+        chunk(const std::size_t i) const
+        {
+            return *chunks[i];
+        }
+
+        std::size_t
+        assign(const std::vector<T> &v)
+        /*!
+          Make *this a copy of v.  Chunks equal to the corresponding
+          elements of v are kept.  Others are replaced by new chunks.
+
+          \return The number of chunks replaced.
+        */
+        {
+            return assign_chunks(
+                v, [](const std::size_t, const chunk_t &current,
+                      const T *elements) {
+                    return snapshot_details::same(current.data(), elements,
+                                                  current.size());
+                });
+        }
+
+        std::size_t
+        assign(const std::vector<T> &v, const dirty_chunks &writes)
+        /*!
+          Make *this a copy of v, whose writes are recorded by writes.
+          Chunks not written since they were copied are kept, without
+          comparing them with v.
+
+          \return The number of chunks replaced.
+        */
+        {
+            const auto replaced = assign_chunks(
+                v, [this, &writes](const std::size_t c, const chunk_t &,
+                                   const T *) {
+                    return revisions[c] == writes.revision(c);
+                });
+            for (std::size_t c = 0; c < revisions.size(); ++c)
+                revisions[c] = writes.revision(c);
+            return replaced;
+        }
+
+        void
+        copy_to(std::vector<T> &v, chunk_list &copied) const
+        /*!
+          Make v a copy of *this.  copied lists the chunks copied into
+          v by the last call, which are not copied again.  It is then
+          replaced by the chunks of *this.
+        */
+        {
+            copied.resize(chunks.size());
+            for (std::size_t c = 0; c < chunks.size(); ++c)
+                {
+                    const auto &src = *chunks[c];
+                    const std::size_t first = c * chunk_size;
+                    if (copied[c] == chunks[c]
+                        && v.size() >= first + src.size())
+                        continue;
+                    const std::size_t overlap = std::min(
+                        src.size(), v.size() > first ? v.size() - first : 0);
+                    std::copy(src.begin(), src.begin() + overlap,
+                              v.begin() + first);
+                    v.insert(v.end(), src.begin() + overlap, src.end());
+                    copied[c] = chunks[c];
+                }
+            if (v.size() > n)
+                v.erase(v.begin() + n, v.end());
+        }
+    };
+
+    template <typename pop_t> struct population_snapshot
+    /*!
+      The state of a population at one generation: its mutations and
+      their counts, gametes, diploids, fixations and fixation times,
+      size and generation, and its recorded ancestry.
+    */
+    {
+        using diploid_t =
+            typename std::decay<decltype(pop_t::diploids)>::type::value_type;
+        using mutation_vector = cow_vector<typename pop_t::mutation_t>;
+        using count_vector = cow_vector<KTfwd::uint_t>;
+        using gamete_vector = cow_vector<typename pop_t::gamete_t>;
+        using diploid_vector = cow_vector<diploid_t>;
+#ifdef FWDPY_COMPACT_DIPLOID
+        using trait_vector = cow_vector<double>;
+        using label_vector = cow_vector<std::size_t>;
+#endif
+
+        struct copied_chunks
+        //! What copy_to() last copied into a view
+        {
+            typename mutation_vector::chunk_list mutations, fixations;
+            typename count_vector::chunk_list mcounts, fixation_times;
+            typename gamete_vector::chunk_list gametes;
+            typename diploid_vector::chunk_list diploids;
+#ifdef FWDPY_COMPACT_DIPLOID
+            typename trait_vector::chunk_list g, e, w;
+            typename label_vector::chunk_list label;
+#endif
+            std::shared_ptr<const ancestry_tables> ancestry;
+        };
+
+        unsigned generation, N;
+        mutation_vector mutations, fixations;
+        count_vector mcounts, fixation_times;
+        gamete_vector gametes;
+        diploid_vector diploids;
+#ifdef FWDPY_COMPACT_DIPLOID
+        //! pop->trait_data
+        trait_vector g, e, w;
+        label_vector label;
+#endif
+        //! Copied whole, if not empty
+        std::shared_ptr<const ancestry_tables> ancestry;
+        //! Revision of the tables in ancestry
+        std::uint64_t ancestry_revision;
+
+        population_snapshot()
+            : generation(0), N(0), mutations{}, fixations{}, mcounts{},
+              fixation_times{}, gametes{}, diploids{},
+#ifdef FWDPY_COMPACT_DIPLOID
+              g{}, e{}, w{}, label{},
+#endif
+              ancestry{}, ancestry_revision(0)
+        {
+        }
+
+        std::size_t
+        assign(const pop_t *pop)
+        /*!
+          Bring the snapshot up to date with pop.
+
+          \return The number of chunks replaced.
+        */
+        {
+            generation = pop->generation;
+            N = pop->N;
+            if (pop->ancestry.empty())
+                ancestry = nullptr;
+            else if (!ancestry
+                     || ancestry_revision != pop->ancestry.revision)
+                {
+                    ancestry = std::make_shared<const ancestry_tables>(
+                        pop->ancestry);
+                    ancestry_revision = pop->ancestry.revision;
+                }
+            std::size_t rv = 0;
+#ifdef FWDPY_COMPACT_DIPLOID
+            const auto &traits = pop->trait_data;
+            rv += g.assign(traits.g, pop->diploid_writes)
+                  + e.assign(traits.e, pop->diploid_writes)
+                  + w.assign(traits.w, pop->diploid_writes)
+                  + label.assign(traits.label, pop->diploid_writes);
+#endif
+            return rv + mutations.assign(pop->mutations)
+                   + fixations.assign(pop->fixations)
+                   + mcounts.assign(pop->mcounts, pop->mcount_writes)
+                   + fixation_times.assign(pop->fixation_times)
+                   + gametes.assign(pop->gametes)
+                   + diploids.assign(pop->diploids, pop->diploid_writes);
+        }
+
+        void
+        copy_to(pop_t *view, copied_chunks &copied) const
+        /*!
+          Make view a copy of the snapshot.  copied must be the same
+          object at every call for the same view.  The position lookup
+          table of view is cleared.
+        */
+        {
+            view->generation = generation;
+            view->N = N;
+            mutations.copy_to(view->mutations, copied.mutations);
+            fixations.copy_to(view->fixations, copied.fixations);
+            mcounts.copy_to(view->mcounts, copied.mcounts);
+            fixation_times.copy_to(view->fixation_times,
+                                   copied.fixation_times);
+            gametes.copy_to(view->gametes, copied.gametes);
+            diploids.copy_to(view->diploids, copied.diploids);
+#ifdef FWDPY_COMPACT_DIPLOID
+            g.copy_to(view->trait_data.g, copied.g);
+            e.copy_to(view->trait_data.e, copied.e);
+            w.copy_to(view->trait_data.w, copied.w);
+            label.copy_to(view->trait_data.label, copied.label);
+#endif
+            view->mut_lookup.clear();
+            if (copied.ancestry != ancestry)
+                {
+                    view->ancestry = ancestry ? *ancestry : ancestry_tables();
+                    copied.ancestry = ancestry;
+                }
+        }
+    };
+
+    template <typename pop_t> class snapshot_source
+    /*!
+      Takes successive snapshots of one population.  Not thread-safe:
+      take() must be called by the thread evolving the population, but
+      the snapshots it returns may be read by any thread.
+    */
+    {
+      private:
+        population_snapshot<pop_t> latest;
+
+      public:
+        //! Chunks replaced by the last call to take()
+        std::size_t replaced;
+
+        snapshot_source() : latest{}, replaced(0) {}
+
+        std::shared_ptr<const population_snapshot<pop_t>>
+        take(const pop_t *pop)
+        {
+            replaced = latest.assign(pop);
+            return std::make_shared<const population_snapshot<pop_t>>(
+                latest);
+        }
+    };
+
+    template <typename pop_t> class snapshot_view
+    /*!
+      A population object filled from snapshots, for passing to
+      samplers.  Its storage is re-used from one snapshot to the next.
+    */
+    {
+      private:
+        std::unique_ptr<pop_t> view;
+        typename population_snapshot<pop_t>::copied_chunks copied;
+
+      public:
+        snapshot_view()
+            : view(snapshot_details::make_view(static_cast<pop_t *>(nullptr))),
+              copied{}
+        {
+        }
+
+        const pop_t *
+        get(const population_snapshot<pop_t> &snapshot)
+        //! Valid until the next call
+        {
+            snapshot.copy_to(view.get(), copied);
+            return view.get();
+        }
+    };
+}
+
+#endif
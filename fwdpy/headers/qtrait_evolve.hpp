@@ -2,11 +2,19 @@
 #ifndef FWDP_QTRAIT_EVOLVE_QTRAIT_SAMPLER_HPP
 #define FWDP_QTRAIT_EVOLVE_QTRAIT_SAMPLER_HPP
 
+#include "ancestry_tables.hpp"
+#include "compaction.hpp"
+#include "counter_rng.hpp"
+#include "evolve_options.hpp"
+#include "fitness_dispatch.hpp"
 #include "fwdpp_features.hpp"
 #include "fwdpy_fitness.hpp"
 #include "internal_region_manager.hpp"
+#include "mutation_effect_table.hpp"
 #include "reserve.hpp"
+#include "sample_diploid_chunked.hpp"
 #include "sampler_base.hpp"
+#include "sampler_pipeline.hpp"
 #include "types.hpp"
 #include <algorithm>
 #include <future>
@@ -20,66 +28,157 @@ namespace fwdpy
 {
     namespace qtrait
     {
-        template <typename rules_t>
+        struct fold_into_fitness
+        /*!
+          Folder for mutation_bookkeeper, used when
+          evolve_options::fold_fixations is set.
+        */
+        {
+            singlepop_fitness *fitness;
+            inline void
+            operator()(const KTfwd::popgenmut &m) const
+            {
+                fitness->fold_fixation(m);
+            }
+        };
+
+        template <typename rules_t, typename fitness_t,
+                  typename removal_policy, typename folder_t>
         void
         evolve_regions_qtrait_sampler_cpp_details(
-            singlepop_t *pop, const unsigned long seed,
+            singlepop_t *pop, const rng_stream_key &stream,
             const unsigned *Nvector, const size_t Nvector_len,
             const double neutral, const double selected, const double recrate,
             const double f, const double sigmaE, const double optimum,
             const double VS, std::unique_ptr<singlepop_fitness> &fitness,
-            const int interval, KTfwd::extensions::discrete_mut_model &&__m,
-            KTfwd::extensions::discrete_rec_model &&__recmap, sampler_base &s,
-            rules_t &&rules)
+            const fitness_t &ff, const int interval, KTfwd::extensions::discrete_mut_model &&__m,
+            KTfwd::extensions::discrete_rec_model &&__recmap,
+            const ancestry_neutral_model &neutral_model, sampler_base &s,
+            rules_t &&rules, const evolve_options &options,
+            const removal_policy &remove_fixed, const folder_t &folder)
         /*
           \note the gist of this implementation is from
           fwdpy/fwdpy/evolve_regions_sampler.cc
+
+          remove_fixed and folder are KTfwd::remove_neutral() and
+          retain_selected_fixations(), or std::true_type() and
+          fold_into_fitness when fixations are folded.
         */
         {
-            gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
-            gsl_rng_set(rng, seed);
+            const counter_rng replicate_rng(stream);
+            gsl_rng *rng = replicate_rng.get();
             const unsigned simlen = unsigned(Nvector_len);
-            const double mu_tot = neutral + selected;
-            auto x = std::max_element(Nvector, Nvector + Nvector_len);
-            assert(x != Nvector + Nvector_len);
-            reserve_space(pop->gametes, pop->mutations, *x, mu_tot);
+            // When recording ancestry, neutral mutations are not simulated
+            // forward in time.  They are added to the tables by mutate().
+            const bool record = options.record_ancestry;
+            const double forward_neutral = record ? 0. : neutral;
+            const double mu_tot = forward_neutral + selected;
+            sampler_pipeline<singlepop_t> sample(s, options);
+            adaptive_reservation reservation(options);
+            reservation.start(pop, Nvector, Nvector_len, mu_tot);
             KTfwd::extensions::discrete_mut_model m(std::move(__m));
             KTfwd::extensions::discrete_rec_model recmap(std::move(__recmap));
             rules_t model_rules(std::forward<rules_t>(rules));
             const auto recpos = KTfwd::extensions::bind_drm(
                 recmap, pop->gametes, pop->mutations, rng, recrate);
-            // fitness->update(pop);
+            std::unique_ptr<chunked_offspring_generator> chunked(
+                (options.offspring_chunks > 1 || record
+                 || chunked_generator_required)
+                    ? new chunked_offspring_generator(
+                          *pop, options.offspring_chunks,
+                          options.offspring_threads)
+                    : nullptr);
+            std::vector<offspring_chunk::recombination_policy> chunk_recpols;
+            std::vector<offspring_chunk::mutation_model> chunk_mmodels;
+            mutation_bookkeeper<singlepop_t::mutation_t> bookkeeper;
+            bookkeeper.reset(pop);
+            bookkeeper.fold_removed_fixations(pop, folder);
+            if (chunked)
+                {
+                    chunk_recpols = bind_chunk_recombination(*chunked, recmap,
+                                                             pop, recrate);
+                    chunked->log_new_mutations(&bookkeeper.added);
+                    chunked->log_fixations(&bookkeeper.fixed);
+                }
+            if (record)
+                {
+                    if (pop->ancestry.empty())
+                        pop->ancestry.reset(2 * pop->diploids.size(),
+                                            pop->generation);
+                    chunked->record_ancestry(&pop->ancestry);
+                }
+            update_model_data(ff, *fitness, pop);
             for (unsigned g = 0; g < simlen; ++g, ++pop->generation)
                 {
                     const unsigned nextN = *(Nvector + g);
                     if (interval && pop->generation
                         && pop->generation % interval == 0.)
                         {
-                            s(pop, pop->generation);
+                            bookkeeper.flush(pop);
+                            pop->ancestry.simplify_and_mutate(rng,
+                                                              neutral_model);
+                            sample(pop, pop->generation);
                         }
-                    KTfwd::experimental::sample_diploid(
-                        rng, pop->gametes, pop->diploids, pop->mutations,
-                        pop->mcounts, pop->N, nextN, mu_tot,
-                        KTfwd::extensions::bind_dmm(
-                            m, pop->mutations, pop->mut_lookup, rng, neutral,
-                            selected, pop->generation),
-                        recpos, fitness->fitness_function, pop->neutral,
-                        pop->selected, f, model_rules,
-                        KTfwd::remove_neutral());
-                    fwdpy::update_mutations_n(pop->mutations, pop->fixations,
-                                              pop->fixation_times,
-                                              pop->mut_lookup, pop->mcounts,
-                                              pop->generation, 2 * nextN);
+                    if (chunked)
+                        {
+                            chunked->seed(stream, pop->generation);
+                            bind_chunk_mutation(*chunked, m, pop,
+                                                forward_neutral, selected,
+                                                chunk_mmodels);
+                            (*chunked)(pop, nextN, mu_tot, chunk_mmodels,
+                                       chunk_recpols, ff, f, model_rules,
+                                       remove_fixed);
+                        }
+#ifndef FWDPY_COMPACT_DIPLOID
+                    else
+                        {
+                            KTfwd::experimental::sample_diploid(
+                                rng, pop->gametes, pop->diploids,
+                                pop->mutations, pop->mcounts, pop->N, nextN,
+                                mu_tot,
+                                track_new_mutations(
+                                    KTfwd::extensions::bind_dmm(
+                                        m, pop->mutations, pop->mut_lookup,
+                                        rng, neutral, selected,
+                                        pop->generation),
+                                    ff, &bookkeeper.added),
+                                recpos, ff, pop->neutral, pop->selected, f,
+                                model_rules,
+                                fixation_logging_policy<removal_policy>{
+                                    pop, 2 * nextN, remove_fixed,
+                                    &bookkeeper.fixed });
+                            diploids_written(pop);
+                            mcounts_written(pop);
+                        }
+#endif
+                    bookkeeper.update(pop, pop->generation, 2 * nextN,
+                                      folder);
                     assert(KTfwd::check_sum(pop->gametes, 2 * nextN));
                     pop->N = nextN;
-                    // fitness->update(pop);
+                    if (record
+                        && (g + 1) % options.simplification_interval == 0)
+                        {
+                            pop->ancestry.simplify_and_mutate(rng,
+                                                              neutral_model);
+                        }
+                    const bool compacted = compact_if_due(pop, options, g + 1);
+                    if (reservation.update(pop, compacted))
+                        {
+                            bookkeeper.indexes_changed(pop);
+                            fitness->indexes_changed();
+                        }
+                    update_model_data(ff, *fitness, pop);
                 }
+            bookkeeper.flush(pop);
+            // Samplers and the caller see simplified, fully mutated
+            // tables.
+            pop->ancestry.simplify_and_mutate(rng, neutral_model);
             if (interval && pop->generation
                 && pop->generation % interval == 0.)
                 {
-                    s(pop, pop->generation);
+                    sample(pop, pop->generation);
                 }
-            gsl_rng_free(rng);
+            sample.finish();
             // Allow a sampler to clean up after itself
             s.cleanup();
         }
@@ -92,7 +191,7 @@ namespace fwdpy
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
             const internal::region_manager *rm,
-            const singlepop_fitness &fitness);
+            const singlepop_fitness &fitness, const evolve_options &options);
     }
 }
 
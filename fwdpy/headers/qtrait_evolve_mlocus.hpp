@@ -1,23 +1,31 @@
 #ifndef FWDPY_QTRAIT_EVOLVE_MLOCUS_HPP
 #define FWDPY_QTRAIT_EVOLVE_MLOCUS_HPP
 
+#include "ancestry_tables.hpp"
+#include "compaction.hpp"
+#include "counter_rng.hpp"
+#include "evolve_options.hpp"
+#include "fitness_dispatch.hpp"
 #include "fwdpp_features.hpp"
 #include "fwdpy_fitness.hpp"
 #include "internal_region_manager.hpp"
+#include "mutation_effect_table.hpp"
 #include "reserve.hpp"
+#include "sample_diploid_multilocus.hpp"
 #include "sampler_base.hpp"
-#include "sampler_base.hpp"
+#include "sampler_pipeline.hpp"
 #include "types.hpp"
 #include <algorithm>
 #include <exception>
 #include <functional>
 #include <future>
 #include <fwdpp/diploid.hh>
-#include <fwdpp/experimental/sample_diploid_mloc.hpp>
 #include <fwdpp/extensions/callbacks.hpp>
 #include <fwdpp/extensions/regions.hpp>
 #include <fwdpp/sugar/sampling.hpp>
+#include <numeric>
 #include <set>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
@@ -25,57 +33,231 @@ namespace fwdpy
 {
     namespace qtrait
     {
+        struct fold_additive_trait_effect
+        /*!
+          Folder for mutation_bookkeeper, used with
+          mloc_folded_additive_trait_kernel.
+        */
+        {
+            double scaling;
+            double *fixed;
+            inline void
+            operator()(const KTfwd::popgenmut &m) const
+            {
+                *fixed += scaling * m.s;
+            }
+        };
+
+        inline std::vector<double>
+        locus_starts(const internal::region_manager *rm)
+        /*!
+          The leftmost position of each locus but the first, where each
+          locus spans its neutral, selected and recombination regions.
+          See multilocus_offspring_generator::record_ancestry.
+
+          Throws std::runtime_error unless the loci occupy disjoint,
+          increasing position ranges.
+        */
+        {
+            std::vector<double> rv;
+            for (std::size_t i = 1; i < rm->nb.size(); ++i)
+                {
+                    const double end = std::max(
+                        { rm->ne[i - 1], rm->se[i - 1], rm->re[i - 1] });
+                    const double beg
+                        = std::min({ rm->nb[i], rm->sb[i], rm->rb[i] });
+                    if (beg < end)
+                        {
+                            throw std::runtime_error(
+                                "with record_ancestry, loci must occupy "
+                                "disjoint, increasing position ranges");
+                        }
+                    rv.push_back(beg);
+                }
+            return rv;
+        }
+
         template <typename mutation_policies, typename recombination_policies,
-                  typename rules_type>
+                  typename rules_type, typename fitness_t,
+                  typename removal_policy, typename folder_t>
         inline void
-        evolve_qtrait_mloc_details_common(
+        evolve_qtrait_mloc_generations(
             multilocus_t *pop, gsl_rng const *rng,
             const KTfwd::uint_t *Nvector, const std::size_t Nvector_len,
             const mutation_policies &mmodels,
             const recombination_policies &recpols,
             const std::vector<double> &tmu,
             const std::vector<double> &between_region_rec_rates,
-            std::unique_ptr<multilocus_fitness> &fitness, sampler_base &s,
-            const unsigned interval, const double f, rules_type &&rules)
+            const fitness_t &ff, sampler_base &s, const unsigned interval,
+            const double f, rules_type &rules_local,
+            const evolve_options &options,
+            const std::vector<double> &locus_starts,
+            const ancestry_neutral_model &neutral_model,
+            const removal_policy &remove_fixed, const folder_t &folder)
         /*!
-         * Common loop shared by the two functions defined
-         * below
+         * The generation loop, instantiated for each type of fitness
+         * model.  See evolve_qtrait_mloc_details_common.
          */
         {
-            auto rules_local(std::forward<rules_type>(rules));
             // evolve...
             const unsigned simlen = unsigned(Nvector_len);
-            // fitness->update(pop);
+            mutation_bookkeeper<multilocus_t::mutation_t> bookkeeper;
+            bookkeeper.reset(pop);
+            bookkeeper.fold_removed_fixations(pop, folder);
+            multilocus_offspring_generator generate_offspring;
+            generate_offspring.log_fixations(&bookkeeper.fixed);
+            sampler_pipeline<multilocus_t> sample(s, options);
+            adaptive_reservation reservation(options);
+            reservation.start(pop, Nvector, Nvector_len,
+                              std::accumulate(tmu.begin(), tmu.end(), 0.));
+            mutation_policies logged_mmodels;
+            for (const auto &mm : mmodels)
+                {
+                    logged_mmodels.emplace_back(
+                        track_new_mutations(mm, ff, &bookkeeper.added));
+                }
+            if (options.record_ancestry)
+                {
+                    if (pop->ancestry.empty())
+                        pop->ancestry.reset(2 * pop->diploids.size(),
+                                            pop->generation);
+                    generate_offspring.record_ancestry(&pop->ancestry,
+                                                       locus_starts);
+                }
+            mutation_effects_changed(ff, *pop);
             for (unsigned g = 0; g < simlen; ++g, ++pop->generation)
                 {
                     const unsigned nextN = *(Nvector + g);
                     if (interval && pop->generation
                         && pop->generation % interval == 0.)
                         {
-                            s(pop, pop->generation);
+                            bookkeeper.flush(pop);
+                            pop->ancestry.simplify_and_mutate(rng,
+                                                              neutral_model);
+                            sample(pop, pop->generation);
                         }
-                    KTfwd::experimental::sample_diploid(
-                        rng, pop->gametes, pop->diploids, pop->mutations,
-                        pop->mcounts, pop->N, nextN, tmu.data(), mmodels,
-                        recpols, between_region_rec_rates.data(),
-                        // rec b/w loci is interpreted as cM!!!!!
-                        [](const gsl_rng *__r, const double __d) {
-                            return gsl_ran_bernoulli(__r, __d);
-                        },
-                        fitness->fitness_function, pop->neutral, pop->selected,
-                        f, rules_local, KTfwd::remove_neutral());
-                    fwdpy::update_mutations_n(pop->mutations, pop->fixations,
-                                              pop->fixation_times,
-                                              pop->mut_lookup, pop->mcounts,
-                                              pop->generation, 2 * nextN);
+                    // rec b/w loci is interpreted as cM!!!!!
+                    generate_offspring(rng, pop, nextN, tmu.data(),
+                                       logged_mmodels, recpols,
+                                       between_region_rec_rates.data(), ff,
+                                       f, rules_local, remove_fixed);
+                    bookkeeper.update(pop, pop->generation, 2 * nextN,
+                                      folder);
                     pop->N = nextN;
-                    // fitness->update(pop);
+                    if (options.record_ancestry
+                        && (g + 1) % options.simplification_interval == 0)
+                        {
+                            pop->ancestry.simplify_and_mutate(rng,
+                                                              neutral_model);
+                        }
+                    const bool compacted = compact_if_due(pop, options, g + 1);
+                    if (reservation.update(pop, compacted))
+                        {
+                            bookkeeper.indexes_changed(pop);
+                            mutation_effects_changed(ff, *pop);
+                        }
                 }
+            bookkeeper.flush(pop);
+            // Samplers and the caller see simplified, fully mutated
+            // tables.
+            pop->ancestry.simplify_and_mutate(rng, neutral_model);
             if (interval && pop->generation
                 && pop->generation % interval == 0.)
                 {
-                    s(pop, pop->generation);
+                    sample(pop, pop->generation);
                 }
+            sample.finish();
+        }
+
+        template <typename mutation_policies, typename recombination_policies,
+                  typename rules_type>
+        struct evolve_qtrait_mloc_visitor
+        /*!
+         * Calls evolve_qtrait_mloc_generations with the fitness model's
+         * concrete type.  See fitness_dispatch.hpp.
+         */
+        {
+            multilocus_t *pop;
+            gsl_rng const *rng;
+            const KTfwd::uint_t *Nvector;
+            const std::size_t Nvector_len;
+            const mutation_policies &mmodels;
+            const recombination_policies &recpols;
+            const std::vector<double> &tmu;
+            const std::vector<double> &between_region_rec_rates;
+            sampler_base &s;
+            const unsigned interval;
+            const double f;
+            rules_type &rules;
+            const evolve_options &options;
+            const std::vector<double> &locus_starts;
+            const ancestry_neutral_model &neutral_model;
+
+            template <typename fitness_t>
+            void
+            operator()(const fitness_t &ff) const
+            {
+                evolve_qtrait_mloc_generations(
+                    pop, rng, Nvector, Nvector_len, mmodels, recpols, tmu,
+                    between_region_rec_rates, ff, s, interval, f, rules,
+                    options, locus_starts, neutral_model,
+                    KTfwd::remove_neutral(), retain_selected_fixations());
+            }
+        };
+
+        template <typename mutation_policies, typename recombination_policies,
+                  typename rules_type>
+        inline void
+        evolve_qtrait_mloc_details_common(
+            multilocus_t *pop, gsl_rng const *rng,
+            const KTfwd::uint_t *Nvector, const std::size_t Nvector_len,
+            const mutation_policies &mmodels,
+            const recombination_policies &recpols,
+            const std::vector<double> &tmu,
+            const std::vector<double> &between_region_rec_rates,
+            std::unique_ptr<multilocus_fitness> &fitness, sampler_base &s,
+            const unsigned interval, const double f,
+            const evolve_options &options,
+            const std::vector<double> &locus_starts,
+            const ancestry_neutral_model &neutral_model, rules_type &&rules)
+        /*!
+         * Common loop shared by the two functions defined
+         * below.
+         *
+         * If options.fold_fixations is true, fixed selected mutations are
+         * removed from gametes.  Only the additive trait model is
+         * supported, which the callers check.
+         *
+         * If options.record_ancestry is true, mmodels and tmu must not
+         * include neutral mutations, which are placed on the recorded
+         * genealogy according to neutral_model instead.
+         */
+        {
+            auto rules_local(std::forward<rules_type>(rules));
+            using rules_local_t = decltype(rules_local);
+            if (options.fold_fixations)
+                {
+                    double fixed = 0.;
+                    evolve_qtrait_mloc_generations(
+                        pop, rng, Nvector, Nvector_len, mmodels, recpols, tmu,
+                        between_region_rec_rates,
+                        mloc_folded_additive_trait_kernel{
+                            mloc_additive_trait_kernel{ fitness->scaling },
+                            &fixed },
+                        s, interval, f, rules_local, options, locus_starts,
+                        neutral_model, std::true_type(),
+                        fold_additive_trait_effect{ fitness->scaling,
+                                                    &fixed });
+                    return;
+                }
+            visit_multilocus_fitness(
+                *fitness,
+                evolve_qtrait_mloc_visitor<mutation_policies,
+                                           recombination_policies,
+                                           rules_local_t>{
+                    pop, rng, Nvector, Nvector_len, mmodels, recpols, tmu,
+                    between_region_rec_rates, s, interval, f, rules_local,
+                    options, locus_starts, neutral_model });
         }
 
         template <typename rules_type>
@@ -83,10 +265,11 @@ namespace fwdpy
         evolve_qtrait_mloc_regions_cpp_details(
             fwdpy::multilocus_t *pop,
             std::unique_ptr<multilocus_fitness> &fitness, sampler_base &s,
-            const unsigned long seed, const unsigned *Nvector,
+            const rng_stream_key &stream, const unsigned *Nvector,
             const size_t Nvector_len, const internal::region_manager *rm,
             const std::vector<double> &between_region_rec_rates,
-            const double f, const int interval, rules_type &&rules)
+            const double f, const int interval,
+            const evolve_options &options, rules_type &&rules)
         /*!
          * Evolve a multilocus model with support for "regions".
          * Current region support is limited: 1 neutral, 1 selected,
@@ -96,8 +279,8 @@ namespace fwdpy
             // We need to set up mutation and recombination
             // models
             // Get local rng 4 this thread
-            gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
-            gsl_rng_set(rng, seed);
+            const counter_rng replicate_rng(stream);
+            gsl_rng *rng = replicate_rng.get();
             std::vector<double> tmu;
             std::vector<std::function<std::vector<double>(
                 const multilocus_t::gamete_t &, const multilocus_t::gamete_t &,
@@ -107,14 +290,18 @@ namespace fwdpy
                                                   multilocus_t::mcont_t &)>>
                 mmodels;
 
+            // When recording ancestry, neutral mutations are not
+            // simulated forward in time.
+            const bool record = options.record_ancestry;
             for (std::size_t i = 0; i < rm->nb.size(); ++i)
                 {
-                    tmu.push_back(rm->nw[i] + rm->sw[i]);
+                    const double neutral = record ? 0. : rm->nw[i];
+                    tmu.push_back(neutral + rm->sw[i]);
                     mmodels.emplace_back(std::bind(
                         KTfwd::infsites(), std::placeholders::_1,
                         std::placeholders::_2, rng, std::ref(pop->mut_lookup),
                         &pop->generation,
-                        rm->nw[i], // mutation rate, neutral
+                        neutral,   // mutation rate, neutral
                         rm->sw[i], // mutation rate, selected
                         [&rng, &rm, i]() {
                             return gsl_ran_flat(rng, rm->nb[i], rm->ne[i]);
@@ -129,14 +316,15 @@ namespace fwdpy
                         rm->re[i], std::placeholders::_1,
                         std::placeholders::_2, std::placeholders::_3));
                 }
-            auto x = std::max_element(Nvector, Nvector + Nvector_len);
-            reserve_space(pop->gametes, pop->mutations, *x,
-                          std::accumulate(tmu.begin(), tmu.end(), 0.));
             evolve_qtrait_mloc_details_common(
                 pop, rng, Nvector, Nvector_len, mmodels, recpols, tmu,
-                between_region_rec_rates, fitness, s, interval, f, rules);
+                between_region_rec_rates, fitness, s, interval, f, options,
+                record ? locus_starts(rm) : std::vector<double>(),
+                ancestry_neutral_model{
+                    std::accumulate(rm->nw.begin(), rm->nw.end(), 0.), rm->nb,
+                    rm->ne, rm->nw },
+                rules);
             s.cleanup();
-            gsl_rng_free(rng);
         }
 
         template <typename rules_type>
@@ -144,14 +332,15 @@ namespace fwdpy
         evolve_qtrait_mloc_cpp_details(
             fwdpy::multilocus_t *pop,
             std::unique_ptr<multilocus_fitness> &fitness, sampler_base &s,
-            const unsigned long seed, const unsigned *Nvector,
+            const rng_stream_key &stream, const unsigned *Nvector,
             const size_t Nvector_len,
             const std::vector<double> &neutral_mutation_rates,
             const std::vector<double> &selected_mutation_rates,
             const std::vector<KTfwd::extensions::shmodel> &effects_dominance,
             const std::vector<double> &within_region_rec_rates,
             const std::vector<double> &between_region_rec_rates,
-            const double f, const int interval, rules_type &&rules)
+            const double f, const int interval,
+            const evolve_options &options, rules_type &&rules)
         /*!
          * \deprecated
          * Simplistic evolution of multi-locus quant-trait model.
@@ -161,19 +350,9 @@ namespace fwdpy
             // be done b4 this point, else we
             // have threads throwing exceptions...
 
-            // Reserve space
-            auto x = std::max_element(Nvector, Nvector + Nvector_len);
-            assert(x != Nvector + Nvector_len);
-            reserve_space(
-                pop->gametes, pop->mutations, *x,
-                std::accumulate(neutral_mutation_rates.begin(),
-                                neutral_mutation_rates.end(), 0.)
-                    + std::accumulate(selected_mutation_rates.begin(),
-                                      selected_mutation_rates.end(), 0.));
-
             // Get local rng 4 this thread
-            gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
-            gsl_rng_set(rng, seed);
+            const counter_rng replicate_rng(stream);
+            gsl_rng *rng = replicate_rng.get();
 
             // Establish recombination maps--uniform w/in each locus
             std::vector<std::function<std::vector<double>(
@@ -192,7 +371,9 @@ namespace fwdpy
 
             // Establish mutation models--uniform process w/in each locus,
             // w/mutations affecting trait value having DFE N(0,sigma_mus[i])
-            // at the i-th locus
+            // at the i-th locus.  When recording ancestry, neutral
+            // mutations are not simulated forward in time.
+            const bool record = options.record_ancestry;
             i = 0;
             std::vector<std::function<std::size_t(std::queue<std::size_t> &,
                                                   multilocus_t::mcont_t &)>>
@@ -203,7 +384,7 @@ namespace fwdpy
                         KTfwd::infsites(), std::placeholders::_1,
                         std::placeholders::_2, rng, std::ref(pop->mut_lookup),
                         &pop->generation,
-                        mi,                         // mutation rate
+                        record ? 0. : mi,           // mutation rate
                         selected_mutation_rates[i], // mutation rate
                         [&rng, i]() {
                             return gsl_ran_flat(rng, double(i), double(i + 1));
@@ -221,11 +402,27 @@ namespace fwdpy
             auto tmu(neutral_mutation_rates);
             std::transform(tmu.begin(), tmu.end(),
                            selected_mutation_rates.begin(), tmu.begin(),
-                           [](double a, double b) { return a + b; });
+                           [record](double a, double b) {
+                               return (record ? 0. : a) + b;
+                           });
 
+            // Locus i occupies [i,i+1)
+            ancestry_neutral_model neutral_model{
+                std::accumulate(neutral_mutation_rates.begin(),
+                                neutral_mutation_rates.end(), 0.),
+                {}, {}, neutral_mutation_rates };
+            std::vector<double> starts;
+            for (i = 0; i < neutral_mutation_rates.size(); ++i)
+                {
+                    neutral_model.beg.push_back(double(i));
+                    neutral_model.end.push_back(double(i + 1));
+                    if (i)
+                        starts.push_back(double(i));
+                }
             evolve_qtrait_mloc_details_common(
                 pop, rng, Nvector, Nvector_len, mmodels, recpols, tmu,
-                between_region_rec_rates, fitness, s, interval, f, rules);
+                between_region_rec_rates, fitness, s, interval, f, options,
+                starts, neutral_model, rules);
             // auto rules_local(std::forward<rules_type>(rules));
             // evolve...
             // const unsigned simlen = unsigned(Nvector_len);
@@ -263,7 +460,6 @@ namespace fwdpy
                     s(pop, pop->generation);
                 }
                                 */
-            gsl_rng_free(rng);
             // Allow a sampler to clean up after itself
             s.cleanup();
         }
@@ -280,7 +476,7 @@ namespace fwdpy
             const std::vector<double> &between_region_rec_rates,
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
-            const multilocus_fitness &fitness);
+            const multilocus_fitness &fitness, const evolve_options &options);
 
 		//! Evolve a multi-locus quant-trait system w/"regions"
         void evolve_qtrait_mloc_regions_cpp(
@@ -291,7 +487,7 @@ namespace fwdpy
             const std::vector<double> &between_region_rec_rates,
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
-            const multilocus_fitness &fitness);
+            const multilocus_fitness &fitness, const evolve_options &options);
     }
 }
 #endif
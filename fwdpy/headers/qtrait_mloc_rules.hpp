@@ -1,9 +1,10 @@
 #ifndef FWDPY_QTRAIT_MLOC_RULES_HPP
 #define FWDPY_QTRAIT_MLOC_RULES_HPP
 
+#include "alias_sampler.hpp"
 #include "fwdpy_fitness.hpp"
 #include <cmath>
-#include <fwdpp/internal/gsl_discrete.hpp>
+#include <gsl/gsl_randist.h>
 
 namespace fwdpy
 {
@@ -14,16 +15,15 @@ namespace fwdpy
             mutable double wbar;
             const double sigE, optimum, VS;
             mutable std::vector<double> fitnesses;
-
-            mutable KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr lookup;
+            //! Samples parents proportionally to fitnesses.  Rebuilt by w().
+            mutable alias_sampler lookup;
             //! \brief Constructor
             qtrait_mloc_rules(const double &__sigE, const double &__optimum,
                               const double &__VS,
                               const unsigned __maxN = 100000)
                 : wbar(0.), sigE(__sigE), optimum(__optimum), VS(__VS),
                   fitnesses(std::vector<double>(__maxN)),
-                  lookup(
-                      KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(nullptr))
+                  lookup(alias_sampler())
             {
             }
 
@@ -31,21 +31,18 @@ namespace fwdpy
 
             qtrait_mloc_rules(const qtrait_mloc_rules &rhs)
                 : wbar(rhs.wbar), sigE(rhs.sigE), optimum(rhs.optimum),
-                  VS(rhs.VS), fitnesses(rhs.fitnesses),
-                  lookup(
-                      KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(nullptr))
+                  VS(rhs.VS), fitnesses(rhs.fitnesses), lookup(rhs.lookup)
             {
-                if (!fitnesses.empty())
-                    lookup = KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(
-                        gsl_ran_discrete_preproc(fitnesses.size(),
-                                                 &fitnesses[0]));
             }
 
-            //! \brief The "fitness manager"
-            template <typename dipcont_t, typename gcont_t, typename mcont_t>
+            //! \brief The "fitness manager".  diploids may be a
+            //! multilocus_genotypes.  The fitnesses are read from traits.
+            //! See multilocus_t::traits().
+            template <typename dipcont_t, typename traits_t,
+                      typename gcont_t, typename mcont_t>
             void
-            w(const dipcont_t &diploids, gcont_t &gametes,
-              const mcont_t &mutations) const
+            w(const dipcont_t &diploids, const traits_t &traits,
+              gcont_t &gametes, const mcont_t &) const
             {
                 unsigned N_curr = diploids.size();
                 if (fitnesses.size() < N_curr)
@@ -61,34 +58,20 @@ namespace fwdpy
                             }
 
                         // the g/e/w fields will be populated via update()
-                        fitnesses[i] = diploids[i][0].w;
+                        fitnesses[i] = trait_w(traits, i);
                         wbar += fitnesses[i];
                     }
 
                 wbar /= double(diploids.size());
 
-                /*!
-                  Black magic alert:
-                  fwdpp_internal::gsl_ran_discrete_t_ptr contains a
-                  std::unique_ptr wrapping the GSL pointer.
-                  This type has its own deleter, which is convenient, because
-                  operator= for unique_ptrs automagically calls the deleter
-                  before assignment!
-                  Details:
-                  http://www.cplusplus.com/reference/memory/unique_ptr/operator=
-
-                  This only works b/c the rhs of the expression below may be
-                  treated as an rvalue reference.
-                */
-                lookup = KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(
-                    gsl_ran_discrete_preproc(N_curr, &fitnesses[0]));
+                lookup.rebuild(fitnesses.data(), N_curr);
             }
 
             //! \brief Pick parent one
             inline size_t
             pick1(const gsl_rng *r) const
             {
-                return gsl_ran_discrete(r, lookup.get());
+                return lookup(r);
             }
 
             //! \brief Pick parent 2.  Parent 1's data are passed along for
@@ -100,24 +83,33 @@ namespace fwdpy
             {
                 return ((f == 1.) || (f > 0. && gsl_rng_uniform(r) < f))
                            ? p1
-                           : gsl_ran_discrete(r, lookup.get());
+                           : lookup(r);
             }
 
             //! \brief Update some property of the offspring based on
-            //! properties of the parents
-            template <typename diploid_t, typename gcont_t, typename mcont_t>
+            //! properties of the parents.  fitness_t is a
+            //! multi_locus_fitness_fxn or one of the policy types in
+            //! fitness_kernels.hpp.  The parents may be
+            //! multilocus_span objects.  The offspring's traits are
+            //! written to index i of traits.
+            template <typename traits_t, typename diploid_t,
+                      typename parent_t, typename gcont_t, typename mcont_t,
+                      typename fitness_t>
             void
-            update(const gsl_rng *r, diploid_t &offspring, const diploid_t &,
-                   const diploid_t &, const gcont_t &gametes,
+            update(const gsl_rng *r, const std::size_t i, traits_t &traits,
+                   const diploid_t &offspring, const parent_t &,
+                   const parent_t &, const gcont_t &gametes,
                    const mcont_t &mutations,
-                   const multi_locus_fitness_fxn &genetic_value_fxn) const
+                   const fitness_t &genetic_value_fxn) const
             {
-                offspring[0].g
+                const double g
                     = genetic_value_fxn(offspring, gametes, mutations);
-                offspring[0].e = gsl_ran_gaussian_ziggurat(r, sigE);
-                double dev = (offspring[0].g + offspring[0].e - optimum);
-                offspring[0].w = std::exp(-(dev * dev) / (2. * VS));
-                assert(std::isfinite(offspring[0].w));
+                const double e = gsl_ran_gaussian_ziggurat(r, sigE);
+                const double dev = (g + e - optimum);
+                trait_g(traits, i) = g;
+                trait_e(traits, i) = e;
+                trait_w(traits, i) = std::exp(-(dev * dev) / (2. * VS));
+                assert(std::isfinite(trait_w(traits, i)));
             }
         };
     }
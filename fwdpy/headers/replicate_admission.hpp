@@ -0,0 +1,154 @@
+#ifndef FWDPY_REPLICATE_ADMISSION_HPP
+#define FWDPY_REPLICATE_ADMISSION_HPP
+
+/*!
+  \file replicate_admission.hpp
+
+  Running replicates within a memory budget.
+
+  Without a budget, the workers of a replicate_scheduler start as many
+  replicates at once as there are workers, whatever their size.  With
+  one, a replicate is only started while the estimated footprints of
+  the running replicates, plus its own, fit within the budget.
+  Replicates that are not running are kept "parked": compacted, with no
+  spare capacity.
+
+  run_admitted() also places replicates on NUMA nodes, if asked to.
+  See numa_placement.hpp.
+*/
+
+#include "compaction.hpp"
+#include "evolve_options.hpp"
+#include "numa_placement.hpp"
+#include "replicate_scheduler.hpp"
+#include "reserve.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fwdpy
+{
+    class replicate_admission
+    /*!
+      Counts the bytes admitted by running replicates.  A replicate
+      is always admitted when no other is running, so that one whose
+      estimate exceeds the budget still runs, on its own.
+    */
+    {
+      private:
+        std::mutex lock;
+        std::condition_variable done;
+        const std::size_t budget;
+        std::size_t admitted;
+        unsigned running;
+
+      public:
+        //! 0 means no budget
+        explicit replicate_admission(const std::size_t budget_)
+            : lock{}, done{}, budget(budget_), admitted(0), running(0)
+        {
+        }
+
+        void
+        acquire(const std::size_t bytes)
+        //! Blocks until bytes fit within the budget
+        {
+            std::unique_lock<std::mutex> l(lock);
+            done.wait(l, [this, bytes]() {
+                return !budget || !running || admitted + bytes <= budget;
+            });
+            admitted += bytes;
+            ++running;
+        }
+
+        void
+        release(const std::size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> l(lock);
+                admitted -= bytes;
+                --running;
+            }
+            done.notify_all();
+        }
+    };
+
+    template <typename pop_t>
+    void
+    park_population(pop_t *pop)
+    /*!
+      Release the memory a population does not need between
+      simulations: extinct mutations and gametes, and spare capacity.
+      See compact_population().
+    */
+    {
+        compact_population(pop);
+        pop->diploids.shrink_to_fit();
+#ifdef FWDPY_COMPACT_DIPLOID
+        pop->trait_data.shrink_to_fit();
+#endif
+        pop->mut_lookup.rehash(0);
+    }
+
+    template <typename pop_t, typename task_t>
+    void
+    run_admitted(replicate_scheduler &scheduler,
+                 const std::vector<std::shared_ptr<pop_t>> &pops,
+                 const unsigned *Nvector, const std::size_t Nvector_len,
+                 const double ttl_mutrate, const evolve_options &options,
+                 task_t &&task)
+    /*!
+      scheduler.run(pops.size(), task), admitting replicates within
+      options.memory_budget.  Footprints are estimated once, after
+      parking every replicate, by estimate_replicate_bytes().  A
+      replicate is parked again when its task returns.
+
+      Workers are pinned, and each replicate is placed by the worker
+      running it, as set by options.numa_placement and
+      options.huge_pages.
+    */
+    {
+        numa_placement placement(options);
+        const auto pin
+            = [&placement](const unsigned worker) { placement.pin(worker); };
+        if (!options.memory_budget)
+            {
+                scheduler.run(pops.size(),
+                              [&](const std::size_t i) {
+                                  placement.place(pops[i].get());
+                                  task(i);
+                              },
+                              pin);
+                return;
+            }
+        std::vector<std::size_t> footprints;
+        footprints.reserve(pops.size());
+        for (const auto &pop : pops)
+            {
+                park_population(pop.get());
+                footprints.push_back(estimate_replicate_bytes(
+                    pop.get(), Nvector, Nvector_len, ttl_mutrate));
+            }
+        replicate_admission admission(options.memory_budget);
+        scheduler.run(pops.size(), [&](const std::size_t i) {
+            admission.acquire(footprints[i]);
+            try
+                {
+                    placement.place(pops[i].get());
+                    task(i);
+                    park_population(pops[i].get());
+                }
+            catch (...)
+                {
+                    admission.release(footprints[i]);
+                    throw;
+                }
+            admission.release(footprints[i]);
+        }, pin);
+    }
+}
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef FWDPY_REPLICATE_SCHEDULER_HPP
+#define FWDPY_REPLICATE_SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fwdpy
+{
+    inline unsigned
+    replicate_worker_count(const unsigned requested, const std::size_t ntasks)
+    /*!
+      Number of worker threads to use for ntasks replicates.
+
+      \param requested The number of threads asked for.  0 means
+      use std::thread::hardware_concurrency().
+      \param ntasks The number of replicates.
+
+      \return A value in [1,ntasks], or 1 if ntasks==0.
+    */
+    {
+        unsigned n = requested;
+        if (!n)
+            {
+                n = std::thread::hardware_concurrency();
+            }
+        if (!n)
+            n = 1;
+        if (ntasks && std::size_t(n) > ntasks)
+            n = unsigned(ntasks);
+        return n;
+    }
+
+    class replicate_scheduler
+    /*!
+      A bounded, work-stealing scheduler for independent replicates.
+
+      A fixed number of worker threads is created.  Task indexes
+      [0,ntasks) are dealt out to per-worker queues in contiguous
+      blocks.  A worker takes work from the front of its own queue and,
+      when that runs dry, steals from the back of another worker's
+      queue.  Replicates of very different run times (due to different
+      N, or to samplers doing different amounts of work) therefore
+      still keep every worker busy.
+
+      If any task throws, no new tasks are started and the first
+      exception is re-thrown from run() after all workers have joined.
+
+      When only one worker is needed, tasks are run in the calling
+      thread.
+    */
+    {
+      private:
+        struct work_queue
+        {
+            std::mutex lock;
+            std::deque<std::size_t> tasks;
+        };
+
+        template <typename task_t, typename start_t>
+        void
+        worker(const unsigned id, task_t &task, start_t &start)
+        {
+            start(id);
+            std::size_t t;
+            while (!abort.load() && next_task(id, t))
+                {
+                    try
+                        {
+                            task(t);
+                        }
+                    catch (...)
+                        {
+                            std::lock_guard<std::mutex> g(error_lock);
+                            if (!error)
+                                error = std::current_exception();
+                            abort.store(true);
+                        }
+                }
+        }
+
+        bool
+        next_task(const unsigned id, std::size_t &t)
+        {
+            {
+                std::lock_guard<std::mutex> g(queues[id]->lock);
+                if (!queues[id]->tasks.empty())
+                    {
+                        t = queues[id]->tasks.front();
+                        queues[id]->tasks.pop_front();
+                        return true;
+                    }
+            }
+            // Our queue is empty, so steal from the others
+            for (unsigned i = 1; i < queues.size(); ++i)
+                {
+                    auto &victim = *queues[(id + i) % queues.size()];
+                    std::lock_guard<std::mutex> g(victim.lock);
+                    if (!victim.tasks.empty())
+                        {
+                            t = victim.tasks.back();
+                            victim.tasks.pop_back();
+                            return true;
+                        }
+                }
+            return false;
+        }
+
+        std::vector<std::unique_ptr<work_queue>> queues;
+        std::atomic<bool> abort;
+        std::mutex error_lock;
+        std::exception_ptr error;
+
+      public:
+        const unsigned nworkers;
+
+        explicit replicate_scheduler(const unsigned nworkers_)
+            : queues{}, abort(false), error_lock{}, error(nullptr),
+              nworkers(std::max(nworkers_, 1u))
+        {
+        }
+
+        template <typename task_t>
+        void
+        run(const std::size_t ntasks, task_t &&task)
+        /*!
+          Call task(i) for i in [0,ntasks).  Blocks until all tasks are
+          done.  The order in which tasks run is unspecified.
+        */
+        {
+            run(ntasks, std::forward<task_t>(task), [](const unsigned) {});
+        }
+
+        template <typename task_t, typename start_t>
+        void
+        run(const std::size_t ntasks, task_t &&task, start_t &&start)
+        /*!
+          As above, and each worker calls start(id), in its own thread,
+          before running any task.  Worker ids are in [0,nworkers).
+        */
+        {
+            if (!ntasks)
+                return;
+            const unsigned nw
+                = unsigned(std::min(std::size_t(nworkers), ntasks));
+            if (nw == 1) // don't spawn threads all willy-nilly!
+                {
+                    start(0u);
+                    for (std::size_t i = 0; i < ntasks; ++i)
+                        task(i);
+                    return;
+                }
+            queues.clear();
+            abort.store(false);
+            error = nullptr;
+            for (unsigned w = 0; w < nw; ++w)
+                {
+                    queues.emplace_back(new work_queue());
+                    const std::size_t b = (ntasks * w) / nw,
+                                      e = (ntasks * (w + 1)) / nw;
+                    for (std::size_t i = b; i < e; ++i)
+                        queues.back()->tasks.push_back(i);
+                }
+            std::vector<std::thread> threads;
+            for (unsigned w = 1; w < nw; ++w)
+                {
+                    threads.emplace_back(
+                        &replicate_scheduler::worker<task_t, start_t>, this,
+                        w, std::ref(task), std::ref(start));
+                }
+            // The calling thread is worker 0
+            worker(0, task, start);
+            for (auto &t : threads)
+                t.join();
+            queues.clear();
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+}
+
+#endif
@@ -1,16 +1,40 @@
 /*!
   \file reserve.hpp
   \brief Reserve memory for mutations and gametes in a population object
+
+  reserve_space() makes a one-off estimate from the largest population
+  size of a simulation.  For growing populations, that over-reserves
+  in early epochs, and any error is corrected by repeated doubling of
+  the containers during a generation.  adaptive_reservation instead
+  follows the sizes actually observed, generation by generation.
 */
 #ifndef FWDPY_RESERVE_HPP
 #define FWDPY_RESERVE_HPP
 
+#include "compaction.hpp"
+#include "evolve_options.hpp"
+#include "numa_placement.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <fwdpp/type_traits.hpp>
+#include <limits>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 namespace fwdpy
 {
+    inline double
+    expected_segregating_sites(const unsigned N, const double ttl_mutrate)
+    {
+        double theta = 4. * double(N) * ttl_mutrate;
+        // Expected number of variants in a W-F population
+        // under "standard" modeling assumptions.
+        // The expression for ES is from Watterson 1975.
+        return std::log(2 * N) * theta + (2. / 3.) * theta;
+    }
+
     template <typename gcont_t, typename mcont_t>
     void
     reserve_space(gcont_t &gametes, mcont_t &mutations, const unsigned N,
@@ -26,16 +50,310 @@ namespace fwdpy
             {
                 gametes.reserve(std::size_t(4 * N));
             }
-        double theta = 4. * double(N) * ttl_mutrate;
-        // Expected number of variants in a W-F population
-        // under "standard" modeling assumptions.
-        // The expression for ES is from Watterson 1975.
-        double ES = std::log(2 * N) * theta + (2. / 3.) * theta;
+        const double ES = expected_segregating_sites(N, ttl_mutrate);
         if (mutations.capacity() < std::size_t(ES))
             {
                 mutations.reserve(std::size_t(ES));
             }
     }
+
+    struct reservation_stats
+    /*!
+      High-water marks of a population's containers, recorded by
+      adaptive_reservation after each generation.
+    */
+    {
+        //! Largest sizes reached
+        std::size_t mutations, gametes, diploids;
+        //! Largest number of bytes reserved by the three containers and
+        //! any trait_arrays, not counting the keys stored by gametes
+        std::size_t bytes;
+        //! Number of times capacity was grown ahead of need, or shrunk
+        unsigned grown, shrunk;
+        //! Number of times growth was limited by
+        //! evolve_options::reservation_cap
+        unsigned capped;
+    };
+
+    namespace reservation_details
+    {
+        template <typename T>
+        inline std::size_t
+        reserved_bytes(const std::vector<T> &v)
+        {
+            return v.capacity() * sizeof(T);
+        }
+
+        template <typename T>
+        inline std::size_t
+        reserved_bytes(const std::vector<std::vector<T>> &v)
+        //! Demes of a metapop_t, or loci of a multilocus_t
+        {
+            std::size_t rv = v.capacity() * sizeof(std::vector<T>);
+            for (const auto &i : v)
+                rv += reserved_bytes(i);
+            return rv;
+        }
+
+        inline std::size_t
+        trait_bytes(const void *)
+        //! For population types whose diploids hold their own traits
+        {
+            return 0;
+        }
+
+        template <typename pop_t>
+        inline auto
+        trait_bytes(const pop_t *pop)
+            -> decltype(pop->trait_data.reserved_bytes())
+        //! The trait_arrays of a FWDPY_COMPACT_DIPLOID build
+        {
+            return pop->trait_data.reserved_bytes();
+        }
+
+        template <typename pop_t>
+        inline std::size_t
+        reserved_bytes(const pop_t *pop)
+        {
+            return reserved_bytes(pop->mutations)
+                   + reserved_bytes(pop->gametes)
+                   + reserved_bytes(pop->diploids) + trait_bytes(pop);
+        }
+    }
+
+    template <typename pop_t>
+    std::size_t
+    estimate_replicate_bytes(const pop_t *pop, const unsigned *Nvector,
+                             const std::size_t Nvector_len,
+                             const double ttl_mutrate)
+    /*!
+      A rough upper estimate of the memory needed to evolve pop
+      through Nvector, for deciding how many replicates may run at
+      once.  N is the largest of Nvector and the current size.
+
+      1. Diploids: two generations of N, at the current number of bytes
+      per diploid, and one generation of traits if these are stored
+      apart from the diploids.
+      2. Mutations: the larger of the current number and the expected
+      number of segregating sites, each with its count and an entry in
+      the position lookup table.
+      3. Gametes: the larger of the current number and 4N, each with
+      the larger of the current mean number of keys and theta = 4N*mu.
+    */
+    {
+        using namespace reservation_details;
+        const unsigned N = std::max(
+            *std::max_element(Nvector, Nvector + Nvector_len),
+            unsigned(pop->diploids.size()));
+        const double bytes_per_diploid
+            = pop->diploids.empty()
+                  ? double(sizeof(typename std::decay<decltype(
+                        pop->diploids)>::type::value_type))
+                  : double(reserved_bytes(pop->diploids))
+                        / double(pop->diploids.size());
+        const double trait_bytes_per_diploid
+            = pop->diploids.empty() ? 0.
+                                    : double(trait_bytes(pop))
+                                          / double(pop->diploids.size());
+        // Elements of the position lookup table, which is a hash set
+        const double lookup_entry = 4. * sizeof(double);
+        const double mutations = std::max(
+            double(pop->mutations.size()),
+            expected_segregating_sites(N, ttl_mutrate));
+        double keys = 0.;
+        for (const auto &g : pop->gametes)
+            keys += double(g.mutations.size() + g.smutations.size());
+        const double keys_per_gamete = std::max(
+            pop->gametes.empty() ? 0. : keys / double(pop->gametes.size()),
+            4. * double(N) * ttl_mutrate);
+        const double gametes
+            = std::max(double(pop->gametes.size()), 4. * double(N));
+        return std::size_t(
+            2. * double(N) * bytes_per_diploid
+            + double(N) * trait_bytes_per_diploid
+            + mutations * (sizeof(typename pop_t::mutation_t)
+                           + sizeof(KTfwd::uint_t) + lookup_entry)
+            + gametes * (sizeof(typename pop_t::gamete_t)
+                         + keys_per_gamete * sizeof(KTfwd::uint_t)));
+    }
+
+    inline void
+    check_reservation_options(const evolve_options &options)
+    //! Throws std::runtime_error if the policy is invalid
+    {
+        if (options.reservation_growth != 0.
+            && !(options.reservation_growth > 1.))
+            {
+                throw std::runtime_error(
+                    "reservation_growth must be 0 or > 1.");
+            }
+    }
+
+    class adaptive_reservation
+    /*!
+      Keeps the capacity of a population's mutation and gamete
+      containers between growth and growth^3 times what is needed.
+
+      1. start() reserves for the first generation only, using
+      reserve_space()'s estimate.
+      2. update(), after each generation, records high-water marks in
+      pop->reservation.  A container whose size exceeds capacity/growth
+      is grown to growth^2 times its size, so that the next generation
+      is unlikely to reallocate it.
+      3. While the population is below its largest size, as after a
+      contraction, update() also counts live mutations and gametes.  If
+      either container reserves more than growth^3 times its live
+      elements, the population is compacted (see compaction.hpp) and
+      reserves growth^2 times the live elements.  This happens at most
+      once per contraction: the largest size is then reset to the
+      current one.
+      4. If cap is not 0, growth is limited so that the three
+      containers reserve at most cap bytes.  Containers still grow as
+      needed by a generation.
+
+      With growth == 0, start() behaves as reserve_space() given the
+      largest population size, and update() only records high-water
+      marks.
+
+      With evolve_options::huge_pages, storage reserved here is advised
+      to use transparent huge pages.
+    */
+    {
+      private:
+        const double growth;
+        const std::size_t cap;
+        const bool huge_pages;
+        unsigned peakN;
+
+        template <typename container, typename pop_t>
+        std::size_t
+        limit(const container &c, const pop_t *pop,
+              const std::size_t target) const
+        //! Largest capacity <= target allowed by cap
+        {
+            if (!cap)
+                return target;
+            const std::size_t others = reservation_details::reserved_bytes(pop)
+                                       - reservation_details::reserved_bytes(c);
+            const std::size_t allowed
+                = (cap > others)
+                      ? (cap - others) / sizeof(typename container::value_type)
+                      : 0;
+            return std::min(target, std::max(allowed, c.size()));
+        }
+
+        template <typename container, typename pop_t>
+        void
+        reserve(container &c, pop_t *pop, const std::size_t target)
+        {
+            const std::size_t n = limit(c, pop, target);
+            if (n < target)
+                ++pop->reservation.capped;
+            if (n > c.capacity())
+                {
+                    c.reserve(n);
+                    if (huge_pages)
+                        advise_huge_pages(c);
+                    ++pop->reservation.grown;
+                }
+        }
+
+        template <typename container, typename pop_t>
+        void
+        grow(container &c, pop_t *pop)
+        {
+            if (double(c.size()) * growth > double(c.capacity()))
+                reserve(c, pop, std::size_t(double(c.size()) * growth * growth));
+        }
+
+        template <typename pop_t>
+        bool
+        oversized(const pop_t *pop) const
+        {
+            const double g3 = growth * growth * growth;
+            return double(pop->mutations.capacity())
+                       > g3 * double(std::max(live_mutations(pop),
+                                              std::size_t(1)))
+                   || double(pop->gametes.capacity())
+                          > g3 * double(std::max(live_gametes(pop),
+                                                 std::size_t(1)));
+        }
+
+      public:
+        explicit adaptive_reservation(const evolve_options &options)
+            : growth(options.reservation_growth),
+              cap(options.reservation_cap),
+              huge_pages(options.huge_pages), peakN(0)
+        {
+        }
+
+        template <typename pop_t>
+        void
+        start(pop_t *pop, const unsigned *Nvector, const std::size_t Nvector_len,
+              const double ttl_mutrate)
+        {
+            peakN = unsigned(pop->diploids.size());
+            const unsigned N
+                = (growth != 0.)
+                      ? std::max(peakN, Nvector[0])
+                         : *std::max_element(Nvector, Nvector + Nvector_len);
+            typename pop_t::gcont_t g;
+            typename pop_t::mcont_t m;
+            reserve_space(g, m, N, ttl_mutrate);
+            reserve(pop->gametes, pop, g.capacity());
+            reserve(pop->mutations, pop, m.capacity());
+            record(pop);
+        }
+
+        template <typename pop_t>
+        void
+        record(pop_t *pop) const
+        //! Update the high-water marks in pop->reservation
+        {
+            auto &r = pop->reservation;
+            r.mutations = std::max(r.mutations, pop->mutations.size());
+            r.gametes = std::max(r.gametes, pop->gametes.size());
+            r.diploids = std::max(r.diploids, pop->diploids.size());
+            r.bytes = std::max(r.bytes,
+                               reservation_details::reserved_bytes(pop));
+        }
+
+        template <typename pop_t>
+        bool
+        update(pop_t *pop, const bool compacted)
+        /*!
+          Call after each generation, and after compact_if_due().
+
+          \param compacted Whether pop was compacted by the caller.
+
+          \return true if pop was compacted, either by the caller or by
+          this call.  The caller must then refresh any state holding
+          mutation or gamete indexes.
+        */
+        {
+            record(pop);
+            if (growth == 0.)
+                return compacted;
+            const unsigned N = unsigned(pop->diploids.size());
+            bool shrunk = false;
+            if (N < peakN && oversized(pop))
+                {
+                    if (!compacted)
+                        {
+                            compact_population(pop);
+                            shrunk = true;
+                        }
+                    ++pop->reservation.shrunk;
+                    // Shrink again only after a further contraction
+                    peakN = N;
+                }
+            peakN = std::max(peakN, N);
+            grow(pop->mutations, pop);
+            grow(pop->gametes, pop);
+            record(pop);
+            return compacted || shrunk;
+        }
+    };
 }
 
 #endif
@@ -1,9 +1,10 @@
 #ifndef FWDPY_RULES_BASE_HPP
 #define FWDPY_RULES_BASE_HPP
 
+#include "alias_sampler.hpp"
 #include "fwdpy_fitness.hpp"
 #include "types.hpp"
-#include <fwdpp/internal/gsl_discrete.hpp>
+#include <gsl/gsl_randist.h>
 #include <stdexcept>
 #include <vector>
 
@@ -12,12 +13,12 @@ namespace fwdpy
     struct single_region_rules_base
     {
         std::vector<double> fitnesses;
-        KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr lookup;
+        //! Samples parents proportionally to fitnesses.  Rebuilt by w().
+        alias_sampler lookup;
         double wbar;
         std::size_t index;
         single_region_rules_base()
-            : fitnesses(std::vector<double>()),
-              lookup(KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(nullptr)),
+            : fitnesses(std::vector<double>()), lookup(alias_sampler()),
               wbar(0.0), index(0)
         {
         }
@@ -25,24 +26,34 @@ namespace fwdpy
         single_region_rules_base(single_region_rules_base &&) = default;
 
         single_region_rules_base(const single_region_rules_base &rhs)
-            : fitnesses(rhs.fitnesses),
-              lookup(KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(nullptr)),
-              wbar(rhs.wbar), index(rhs.index)
+            : fitnesses(rhs.fitnesses), lookup(rhs.lookup), wbar(rhs.wbar),
+              index(rhs.index)
         {
-            if (!fitnesses.empty())
-                lookup = KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(
-                    gsl_ran_discrete_preproc(fitnesses.size(), &fitnesses[0]));
         }
 
         virtual ~single_region_rules_base() {}
 
-        virtual void w(const dipvector_t &, gcont_t &, const mcont_t &) = 0;
+        //! \brief The "fitness manager".  Reads the parents' fitnesses
+        //! from traits.  See diploid_t.
+        virtual void w(const dipvector_t &, const diploid_traits_t &,
+                       gcont_t &, const mcont_t &)
+            = 0;
+
+#ifndef FWDPY_COMPACT_DIPLOID
+        //! \brief As above, for KTfwd::experimental::sample_diploid
+        void
+        w(const dipvector_t &diploids, gcont_t &gametes,
+          const mcont_t &mutations)
+        {
+            w(diploids, diploids, gametes, mutations);
+        }
+#endif
 
         //! \brief Pick parent one
         virtual size_t
         pick1(const gsl_rng *r) const
         {
-            return gsl_ran_discrete(r, lookup.get());
+            return lookup(r);
         }
 
         //! \brief Pick parent 2.  Parent 1's data are passed along for models
@@ -53,16 +64,33 @@ namespace fwdpy
         {
             return (f == 1. || (f > 0. && gsl_rng_uniform(r) < f))
                        ? p1
-                       : gsl_ran_discrete(r, lookup.get());
+                       : lookup(r);
         }
 
+#ifndef FWDPY_COMPACT_DIPLOID
         //! \brief Update some property of the offspring based on properties of
-        //! the parents
+        //! the parents.  Called by KTfwd::experimental::sample_diploid.
         virtual void update(const gsl_rng *r, diploid_t &offspring,
                             const diploid_t &, const diploid_t &,
                             const gcont_t &gametes, const mcont_t &mutations,
                             const single_region_fitness_fxn &ff)
             = 0;
+#endif
+
+        //! \brief Same as update, but for offspring generated in parallel
+        //! chunks.  Must not modify the rules object.  The offspring's
+        //! index in the offspring generation is passed along, and its
+        //! traits are written to that index of traits.
+        virtual void
+        update_concurrent(const gsl_rng *, const std::size_t,
+                          diploid_traits_t &, const diploid_t &,
+                          const diploid_t &, const diploid_t &,
+                          const gcont_t &, const mcont_t &,
+                          const single_region_fitness_fxn &) const
+        {
+            throw std::runtime_error("these rules do not support "
+                                     "parallel offspring generation");
+        }
     };
 }
 
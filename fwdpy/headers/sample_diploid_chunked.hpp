@@ -0,0 +1,839 @@
+/*!
+  \file sample_diploid_chunked.hpp
+
+  \brief Generate the offspring of a single deme in parallel chunks.
+
+  The offspring generation is split into a fixed number of contiguous
+  chunks.  Each chunk has its own staging buffers for new mutations
+  and new gametes.  Chunks only read the parental generation, so they
+  can be filled concurrently.  The staged data are then merged into
+  the population in chunk order, which is offspring order.
+
+  The random numbers for each offspring come from counter-based
+  streams keyed by the offspring's index.  See counter_rng.hpp.
+  Results depend on the random seed, but neither on the number of
+  chunks nor on the number of threads used to fill them.
+*/
+
+#ifndef FWDPY_SAMPLE_DIPLOID_CHUNKED_HPP
+#define FWDPY_SAMPLE_DIPLOID_CHUNKED_HPP
+
+#include "ancestry_tables.hpp"
+#include "counter_rng.hpp"
+#include "mutation_effect_table.hpp"
+#include "replicate_scheduler.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fwdpp/diploid.hh>
+#include <fwdpp/extensions/regions.hpp>
+#include <gsl/gsl_randist.h>
+
+namespace fwdpy
+{
+    template <typename lookup_table_t> struct chunk_mutation_lookup
+    /*!
+      Mutation position lookup used by the mutation model within a chunk.
+
+      The population's lookup table is only read.  Positions of
+      mutations arising in this chunk are stored locally until the
+      merge.
+    */
+    {
+        //! Result of find().  Only comparison against end() is supported.
+        struct result
+        {
+            bool found;
+            bool
+            operator==(const result &rhs) const
+            {
+                return found == rhs.found;
+            }
+            bool
+            operator!=(const result &rhs) const
+            {
+                return found != rhs.found;
+            }
+        };
+        const lookup_table_t *population;
+        std::unordered_set<double> local;
+
+        explicit chunk_mutation_lookup(const lookup_table_t &l)
+            : population(&l), local{}
+        {
+        }
+
+        result
+        find(const double pos) const
+        {
+            return result{ population->count(pos) > 0
+                           || local.count(pos) > 0 };
+        }
+        result
+        end() const
+        {
+            return result{ false };
+        }
+        std::size_t
+        count(const double pos) const
+        {
+            return std::size_t(find(pos).found);
+        }
+        void
+        insert(const double pos)
+        {
+            local.insert(pos);
+        }
+        void
+        emplace(const double pos)
+        {
+            local.insert(pos);
+        }
+        void
+        clear()
+        {
+            local.clear();
+        }
+    };
+
+    using singlepop_lookup_t = decltype(singlepop_t::mut_lookup);
+
+    //! Mutation keys of staged mutations have this bit set.
+    constexpr KTfwd::uint_t staged_mutation_flag = KTfwd::uint_t(1)
+                                                   << 31;
+    //! Offspring gamete references to staged gametes have this bit set.
+    constexpr std::size_t staged_gamete_flag
+        = std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 1);
+
+    inline void
+    recombine_keys(const std::vector<KTfwd::uint_t> &a,
+                   const std::vector<KTfwd::uint_t> &b,
+                   const std::vector<double> &breakpoints,
+                   const mcont_t &mutations, std::vector<KTfwd::uint_t> &out)
+    /*!
+      Keys at positions < a breakpoint come from the "current"
+      gamete, which starts out as a and swaps at each breakpoint.
+    */
+    {
+        out.clear();
+        auto i = a.cbegin(), ie = a.cend(), j = b.cbegin(), je = b.cend();
+        const auto lt = [&mutations](const KTfwd::uint_t k, const double p) {
+            return mutations[k].pos < p;
+        };
+        for (const auto bp : breakpoints)
+            {
+                auto ii = std::lower_bound(i, ie, bp, lt);
+                out.insert(out.end(), i, ii);
+                j = std::lower_bound(j, je, bp, lt);
+                i = ii;
+                std::swap(i, j);
+                std::swap(ie, je);
+            }
+        out.insert(out.end(), i, ie);
+    }
+
+    struct offspring_chunk
+    /*!
+      Per-chunk random number stream and staging buffers.
+      All buffers are re-used from generation to generation.
+    */
+    {
+        using mutation_model
+            = std::function<std::size_t(std::queue<std::size_t> &, mcont_t &)>;
+        using recombination_policy = std::function<std::vector<double>(
+            const gamete_t &, const gamete_t &, const mcont_t &)>;
+        struct staged_gamete
+        {
+            std::size_t first;
+            KTfwd::uint_t nneutral, nselected;
+        };
+        //! Streams of the current offspring.  See set_streams().
+        counter_rng rng, recombination_rng, mutation_rng;
+        chunk_mutation_lookup<singlepop_lookup_t> lookup;
+        //! New mutations.  Always empty.
+        std::queue<std::size_t> recycling_bin;
+        //! New mutations arising in this chunk
+        mcont_t mutations;
+        //! Keys of all staged gametes, stored contiguously
+        std::vector<KTfwd::uint_t> keys;
+        std::vector<staged_gamete> gametes;
+        //! Scratch space for building one gamete
+        std::vector<KTfwd::uint_t> neutral, selected;
+        //! Two gamete references and two parent indexes per offspring
+        std::vector<std::size_t> offspring_gametes, parents;
+        //! Where staged mutations and gametes ended up after the merge
+        std::vector<std::size_t> mutation_remap, gamete_remap;
+        //! Ancestry edges of the offspring, when recording ancestry
+        std::vector<ancestry_edge> edges;
+        std::size_t first_offspring, last_offspring;
+
+        explicit offspring_chunk(const singlepop_lookup_t &l)
+            : rng(), recombination_rng(), mutation_rng(), lookup(l),
+              recycling_bin{}, mutations{}, keys{}, gametes{}, neutral{},
+              selected{}, offspring_gametes{}, parents{}, mutation_remap{},
+              gamete_remap{}, edges{}, first_offspring(0), last_offspring(0)
+        {
+        }
+
+        void
+        set_streams(rng_stream_key key, const std::size_t individual)
+        /*!
+          Select the streams of one offspring.  rng is used for
+          choosing parents, recombination_rng by the recombination
+          policy and mutation_rng for mutations.
+        */
+        {
+            key.individual = std::uint32_t(individual);
+            key.purpose = rng_purpose::parents;
+            rng.set(key);
+            key.purpose = rng_purpose::recombination;
+            recombination_rng.set(key);
+            key.purpose = rng_purpose::mutation;
+            mutation_rng.set(key);
+        }
+
+        void
+        reset(const std::size_t b, const std::size_t e)
+        {
+            lookup.clear();
+            mutations.clear();
+            keys.clear();
+            gametes.clear();
+            offspring_gametes.clear();
+            parents.clear();
+            edges.clear();
+            first_offspring = b;
+            last_offspring = e;
+        }
+
+        inline double
+        key_position(const KTfwd::uint_t key, const mcont_t &pmutations) const
+        {
+            return (key & staged_mutation_flag)
+                       ? mutations[key & ~staged_mutation_flag].pos
+                       : pmutations[key].pos;
+        }
+
+        inline void
+        record_edges(const std::int32_t *nodes,
+                     const std::vector<double> &breakpoints)
+        //! Edges from nodes[0] and nodes[1] to nodes[2]
+        {
+            double left = ancestry_tables::lower();
+            std::size_t current = 0;
+            for (const auto bp : breakpoints)
+                {
+                    if (bp == std::numeric_limits<double>::max())
+                        break;
+                    if (left < bp)
+                        {
+                            edges.push_back(ancestry_edge{
+                                left, bp, nodes[current], nodes[2] });
+                            left = bp;
+                        }
+                    current ^= 1;
+                }
+            edges.push_back(ancestry_edge{ left, ancestry_tables::upper(),
+                                           nodes[current], nodes[2] });
+        }
+
+        std::size_t
+        make_gamete(const std::size_t g1, const std::size_t g2,
+                    const double mu, const gcont_t &pgametes,
+                    const mcont_t &pmutations, const mutation_model &mmodel,
+                    const recombination_policy &recpol,
+                    const std::int32_t *nodes = nullptr)
+        /*!
+          Make one offspring gamete from parental gametes g1 and g2.
+
+          If nodes is not nullptr, it contains the ancestry nodes of g1,
+          g2 and the offspring gamete, and edges are recorded.
+          Breakpoints are then needed even if g1 == g2.
+
+          \return Either the index of a parental gamete, if the offspring
+          gamete is an unchanged copy of it, or the index of a staged
+          gamete with staged_gamete_flag set.
+        */
+        {
+            bool recombined = false;
+            if (g1 != g2 || nodes)
+                {
+                    auto breakpoints
+                        = recpol(pgametes[g1], pgametes[g2], pmutations);
+                    if (nodes)
+                        record_edges(nodes, breakpoints);
+                    if (g1 != g2 && !breakpoints.empty()
+                        && !(breakpoints.size() == 1
+                             && breakpoints[0]
+                                    == std::numeric_limits<double>::max()))
+                        {
+                            recombine_keys(pgametes[g1].mutations,
+                                           pgametes[g2].mutations,
+                                           breakpoints, pmutations, neutral);
+                            recombine_keys(pgametes[g1].smutations,
+                                           pgametes[g2].smutations,
+                                           breakpoints, pmutations, selected);
+                            recombined = true;
+                        }
+                }
+            const unsigned nm
+                = (mu > 0.) ? gsl_ran_poisson(mutation_rng.get(), mu) : 0u;
+            if (!nm && !recombined)
+                return g1;
+            if (!recombined)
+                {
+                    neutral.assign(pgametes[g1].mutations.begin(),
+                                   pgametes[g1].mutations.end());
+                    selected.assign(pgametes[g1].smutations.begin(),
+                                    pgametes[g1].smutations.end());
+                }
+            for (unsigned i = 0; i < nm; ++i)
+                {
+                    const auto local = mmodel(recycling_bin, mutations);
+                    const KTfwd::uint_t key
+                        = KTfwd::uint_t(local) | staged_mutation_flag;
+                    const double pos = mutations[local].pos;
+                    auto &dest = mutations[local].neutral ? neutral : selected;
+                    dest.insert(
+                        std::upper_bound(dest.begin(), dest.end(), pos,
+                                         [this, &pmutations](
+                                             const double p,
+                                             const KTfwd::uint_t k) {
+                                             return p < this->key_position(
+                                                            k, pmutations);
+                                         }),
+                        key);
+                }
+            gametes.push_back(staged_gamete{ keys.size(),
+                                             KTfwd::uint_t(neutral.size()),
+                                             KTfwd::uint_t(selected.size()) });
+            keys.insert(keys.end(), neutral.begin(), neutral.end());
+            keys.insert(keys.end(), selected.begin(), selected.end());
+            return (gametes.size() - 1) | staged_gamete_flag;
+        }
+    };
+
+    inline bool
+    fixed_mutation_removable(const KTfwd::popgenmut &, std::true_type)
+    {
+        return true;
+    }
+
+    inline bool
+    fixed_mutation_removable(const KTfwd::popgenmut &m,
+                             KTfwd::remove_neutral)
+    {
+        return m.neutral;
+    }
+
+    template <typename function>
+    inline void
+    for_each_first_gamete(const diploid_t &dip, const function &f)
+    {
+        f(dip.first);
+    }
+
+    template <typename function>
+    inline void
+    for_each_first_gamete(const multilocus_diploid_t &dip,
+                          const function &f)
+    {
+        for (const auto &locus : dip)
+            f(locus.first);
+    }
+
+    template <typename removal_policy> struct fixation_logging_policy
+    /*!
+      Mutation removal policy for KTfwd::experimental::sample_diploid,
+      which calls it for fixed mutations carried by the offspring
+      gametes.  Behaves as the wrapped policy, and appends the key of
+      each fixed mutation to *fixed once.
+    */
+    {
+        const singlepop_t *pop;
+        KTfwd::uint_t twoN;
+        removal_policy rp;
+        std::vector<std::size_t> *fixed;
+
+        bool
+        operator()(const KTfwd::popgenmut &m) const
+        {
+            const auto k = std::size_t(&m - pop->mutations.data());
+            assert(k < pop->mutations.size());
+            if (pop->mcounts[k] == twoN
+                && std::find(fixed->begin(), fixed->end(), k) == fixed->end())
+                fixed->push_back(k);
+            return fixed_mutation_removable(m, rp);
+        }
+    };
+
+    template <typename pop_t, typename removal_policy>
+    void
+    process_offspring_gametes(pop_t *pop, const KTfwd::uint_t twoN,
+                              const removal_policy &rp,
+                              std::vector<std::size_t> *fixed)
+    /*!
+      Recount mutations and remove fixed variants from gametes, as
+      KTfwd::experimental::sample_diploid does.  Gamete counts must be
+      those of the offspring generation.
+
+      A fixed mutation is carried by every gamete, so fixations are
+      found among the mutations of the first offspring.  Their keys
+      are appended to *fixed, unless fixed is nullptr.
+    */
+    {
+        pop->mcounts.resize(pop->mutations.size(), 0u);
+        std::fill(pop->mcounts.begin(), pop->mcounts.end(), 0u);
+        pop->mcount_writes.touch_all();
+        for (const auto &g : pop->gametes)
+            {
+                if (g.n)
+                    {
+                        for (const auto k : g.mutations)
+                            pop->mcounts[k] += g.n;
+                        for (const auto k : g.smutations)
+                            pop->mcounts[k] += g.n;
+                    }
+            }
+        if (pop->diploids.empty())
+            return;
+        std::vector<std::size_t> found;
+        auto &keys = fixed ? *fixed : found;
+        bool removable = false;
+        const auto is_fixed = [pop, twoN, &rp](const KTfwd::uint_t k) {
+            return pop->mcounts[k] == twoN
+                   && fixed_mutation_removable(pop->mutations[k], rp);
+        };
+        const auto find_fixed = [&](const KTfwd::uint_t k) {
+            if (pop->mcounts[k] == twoN)
+                {
+                    keys.push_back(k);
+                    removable = removable || is_fixed(k);
+                }
+        };
+        for_each_first_gamete(
+            pop->diploids.front(), [&](const std::size_t gam) {
+                const auto &g = pop->gametes[gam];
+                std::for_each(g.mutations.begin(), g.mutations.end(),
+                              find_fixed);
+                std::for_each(g.smutations.begin(), g.smutations.end(),
+                              find_fixed);
+            });
+        if (!removable)
+            return;
+        for (auto &g : pop->gametes)
+            {
+                if (g.n)
+                    {
+                        g.mutations.erase(std::remove_if(g.mutations.begin(),
+                                                         g.mutations.end(),
+                                                         is_fixed),
+                                          g.mutations.end());
+                        g.smutations.erase(
+                            std::remove_if(g.smutations.begin(),
+                                           g.smutations.end(), is_fixed),
+                            g.smutations.end());
+                    }
+            }
+    }
+
+    /*!
+      Whether single-deme simulations must use
+      chunked_offspring_generator.  KTfwd::experimental::sample_diploid
+      passes each offspring to the rules without the population's
+      traits, which a FWDPY_COMPACT_DIPLOID build keeps apart from the
+      diploids.  See diploid_t.
+    */
+    constexpr bool chunked_generator_required = compact_diploid_layout;
+
+    class chunked_offspring_generator
+    /*!
+      Replacement for KTfwd::experimental::sample_diploid for single-deme
+      simulations, filling the offspring generation in parallel.
+
+      The rules type must provide w(), pick1(), pick2() and
+      update_concurrent(). See rules_base.hpp.  This is the only
+      generator for single-deme simulations in a FWDPY_COMPACT_DIPLOID
+      build.  See chunked_generator_required.
+    */
+    {
+      private:
+        std::vector<std::unique_ptr<offspring_chunk>> chunks;
+        //! Copy of the parental generation. Swapped with pop->diploids.
+        dipvector_t parents;
+        std::queue<std::size_t> mutation_queue, gamete_queue;
+        replicate_scheduler workers;
+        //! If not nullptr, keys of merged mutations are appended here
+        std::vector<std::size_t> *added_mutations;
+        //! If not nullptr, keys of fixed mutations are appended here
+        std::vector<std::size_t> *fixed_mutations;
+        //! If not nullptr, offspring ancestry is recorded here
+        ancestry_tables *ancestry;
+        //! Streams of the current generation
+        rng_stream_key streams;
+
+        std::size_t
+        resolve(const offspring_chunk &c, const std::size_t ref) const
+        {
+            return (ref & staged_gamete_flag)
+                       ? c.gamete_remap[ref & ~staged_gamete_flag]
+                       : ref;
+        }
+
+        template <typename fitness_fxn>
+        void
+        merge(singlepop_t *pop, const fitness_fxn &ff)
+        /*!
+          Move staged mutations and gametes into the population,
+          recycling extinct slots, in chunk order.  Key storage comes
+          from pop->key_arena.  The fitness model
+          is notified of each new mutation.  See mutation_effect_table.hpp.
+        */
+        {
+            for (auto &cptr : chunks)
+                {
+                    auto &c = *cptr;
+                    c.mutation_remap.resize(c.mutations.size());
+                    for (std::size_t i = 0; i < c.mutations.size(); ++i)
+                        {
+                            auto &m = c.mutations[i];
+                            // Guard against two chunks drawing the same
+                            // position
+                            while (pop->mut_lookup.find(m.pos)
+                                   != pop->mut_lookup.end())
+                                {
+                                    m.pos = std::nextafter(
+                                        m.pos,
+                                        std::numeric_limits<double>::max());
+                                }
+                            pop->mut_lookup.insert(m.pos);
+                            std::size_t idx;
+                            if (!mutation_queue.empty())
+                                {
+                                    idx = mutation_queue.front();
+                                    mutation_queue.pop();
+                                    pop->mutations[idx] = std::move(m);
+                                }
+                            else
+                                {
+                                    idx = pop->mutations.size();
+                                    pop->mutations.emplace_back(std::move(m));
+                                    pop->mcounts.push_back(0);
+                                }
+                            c.mutation_remap[i] = idx;
+                            mutation_added(ff, pop->mutations, idx);
+                            if (added_mutations)
+                                added_mutations->push_back(idx);
+                        }
+                    c.gamete_remap.resize(c.gametes.size());
+                    for (std::size_t i = 0; i < c.gametes.size(); ++i)
+                        {
+                            const auto &sg = c.gametes[i];
+                            std::size_t idx;
+                            if (!gamete_queue.empty())
+                                {
+                                    idx = gamete_queue.front();
+                                    gamete_queue.pop();
+                                }
+                            else
+                                {
+                                    idx = pop->gametes.size();
+                                    pop->gametes.emplace_back(0u);
+                                }
+                            auto &g = pop->gametes[idx];
+                            g.n = 0;
+                            const auto remap = [&c](const KTfwd::uint_t k) {
+                                return (k & staged_mutation_flag)
+                                           ? KTfwd::uint_t(c.mutation_remap
+                                                               [k & ~staged_mutation_flag])
+                                           : k;
+                            };
+                            const auto b = c.keys.cbegin() + sg.first;
+                            pop->key_arena.fill(g.mutations, b, sg.nneutral,
+                                                remap);
+                            pop->key_arena.fill(g.smutations,
+                                                b + sg.nneutral,
+                                                sg.nselected, remap);
+                            c.gamete_remap[i] = idx;
+                        }
+                    for (std::size_t i = c.first_offspring;
+                         i < c.last_offspring; ++i)
+                        {
+                            auto &dip = pop->diploids[i];
+                            const std::size_t o = 2 * (i - c.first_offspring);
+                            dip.first = resolve(c, c.offspring_gametes[o]);
+                            dip.second
+                                = resolve(c, c.offspring_gametes[o + 1]);
+                            pop->gametes[dip.first].n++;
+                            pop->gametes[dip.second].n++;
+                        }
+                    // Phenotypes are assigned to the same range later.
+                    pop->diploid_writes.touch(c.first_offspring,
+                                              c.last_offspring);
+                    if (ancestry)
+                        {
+                            ancestry->edges.insert(ancestry->edges.end(),
+                                                   c.edges.begin(),
+                                                   c.edges.end());
+                        }
+                }
+        }
+
+      public:
+        chunked_offspring_generator(const singlepop_t &pop,
+                                    const unsigned nchunks,
+                                    const unsigned nthreads)
+            : chunks{}, parents{}, mutation_queue{}, gamete_queue{},
+              workers(replicate_worker_count(nthreads, nchunks)),
+              added_mutations(nullptr), fixed_mutations(nullptr),
+              ancestry(nullptr),
+              streams{ 0, 0, 0, 0, rng_purpose::parents }
+        {
+            for (unsigned i = 0; i < std::max(nchunks, 1u); ++i)
+                {
+                    chunks.emplace_back(new offspring_chunk(pop.mut_lookup));
+                }
+        }
+
+        std::size_t
+        size() const
+        {
+            return chunks.size();
+        }
+
+        void
+        log_new_mutations(std::vector<std::size_t> *added)
+        /*!
+          Append the keys of new mutations to added.  See
+          mutation_bookkeeper in fwdpp_features.hpp.
+        */
+        {
+            added_mutations = added;
+        }
+
+        void
+        log_fixations(std::vector<std::size_t> *fixed)
+        /*!
+          Append the keys of mutations fixed in the offspring generation
+          to fixed.  See process_offspring_gametes().
+        */
+        {
+            fixed_mutations = fixed;
+        }
+
+        void
+        record_ancestry(ancestry_tables *tables)
+        /*!
+          Record the ancestry of each offspring gamete in tables, whose
+          current gametes must be those of the parental generation.
+          Breakpoints are drawn for every offspring gamete, so results
+          differ from those obtained without recording.
+        */
+        {
+            ancestry = tables;
+        }
+
+        //! Chunk i. Models are bound to its streams and lookup.
+        offspring_chunk &
+        chunk(const std::size_t i)
+        {
+            return *chunks[i];
+        }
+
+        void
+        seed(const rng_stream_key &replicate, const unsigned generation)
+        /*!
+          Offspring streams are keyed by the replicate's seed and index,
+          generation, and the offspring's index.  Must be called once
+          per generation.
+        */
+        {
+            streams = replicate;
+            streams.generation = generation;
+        }
+
+        template <typename fitness_fxn, typename rules_t,
+                  typename removal_policy>
+        double
+        operator()(singlepop_t *pop, const KTfwd::uint_t nextN,
+                   const double mu,
+                   const std::vector<offspring_chunk::mutation_model> &mmodels,
+                   const std::vector<offspring_chunk::recombination_policy>
+                       &recpols,
+                   const fitness_fxn &ff, const double f, rules_t &rules,
+                   const removal_policy &rp)
+        /*!
+          Generate one generation of offspring.
+
+          \param mmodels One mutation model per chunk, bound to
+          chunk(i).lookup and chunk(i).mutation_rng.
+          \param recpols One recombination policy per chunk, bound to
+          chunk(i).recombination_rng.
+
+          \return Mean fitness of the parental generation.
+        */
+        {
+            // Extinct slots are available for recycling.  This must
+            // happen before rules.w() zeroes parental gamete counts.
+            mutation_queue = std::queue<std::size_t>();
+            gamete_queue = std::queue<std::size_t>();
+            for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+                {
+                    if (!pop->mcounts[i])
+                        mutation_queue.push(i);
+                }
+            for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+                {
+                    if (!pop->gametes[i].n)
+                        gamete_queue.push(i);
+                }
+            rules.w(pop->diploids, pop->traits(), pop->gametes,
+                    pop->mutations);
+            parents.swap(pop->diploids);
+            pop->diploids.resize(nextN);
+#ifdef FWDPY_COMPACT_DIPLOID
+            // The parents' traits are not read after w().
+            pop->trait_data.resize(nextN);
+#endif
+            std::int32_t parent_nodes = 0, offspring_nodes = 0;
+            if (ancestry)
+                {
+                    parent_nodes = std::int32_t(ancestry->first_sample);
+                    offspring_nodes
+                        = std::int32_t(ancestry->add_generation(2 * nextN));
+                }
+
+            const std::size_t nc = chunks.size();
+            for (std::size_t c = 0; c < nc; ++c)
+                {
+                    chunks[c]->reset((nextN * c) / nc,
+                                     (nextN * (c + 1)) / nc);
+                }
+
+            // Fill the chunks.  The parental generation is read-only here.
+            workers.run(nc, [&](const std::size_t ci) {
+                auto &c = *chunks[ci];
+                const gsl_rng *r = c.rng.get();
+                for (std::size_t i = c.first_offspring; i < c.last_offspring;
+                     ++i)
+                    {
+                        c.set_streams(streams, i);
+                        const std::size_t p1 = rules.pick1(r);
+                        const std::size_t p2 = rules.pick2(
+                            r, p1, f, parents[p1], pop->gametes,
+                            pop->mutations);
+                        auto p1g1 = parents[p1].first,
+                             p1g2 = parents[p1].second;
+                        auto p2g1 = parents[p2].first,
+                             p2g2 = parents[p2].second;
+                        const bool swap1 = gsl_rng_uniform(r) < 0.5;
+                        if (swap1)
+                            std::swap(p1g1, p1g2);
+                        const bool swap2 = gsl_rng_uniform(r) < 0.5;
+                        if (swap2)
+                            std::swap(p2g1, p2g2);
+                        c.parents.push_back(p1);
+                        c.parents.push_back(p2);
+                        // Node 2p is parents[p].first, and 2p+1 is
+                        // parents[p].second.
+                        const std::int32_t n1 = parent_nodes
+                                                + std::int32_t(2 * p1),
+                                           n2 = parent_nodes
+                                                + std::int32_t(2 * p2),
+                                           o = offspring_nodes
+                                               + std::int32_t(2 * i);
+                        const std::int32_t nodes1[3]
+                            = { n1 + swap1, n1 + !swap1, o },
+                            nodes2[3] = { n2 + swap2, n2 + !swap2, o + 1 };
+                        c.offspring_gametes.push_back(c.make_gamete(
+                            p1g1, p1g2, mu, pop->gametes, pop->mutations,
+                            mmodels[ci], recpols[ci],
+                            ancestry ? nodes1 : nullptr));
+                        c.offspring_gametes.push_back(c.make_gamete(
+                            p2g1, p2g2, mu, pop->gametes, pop->mutations,
+                            mmodels[ci], recpols[ci],
+                            ancestry ? nodes2 : nullptr));
+                    }
+            });
+
+            merge(pop, ff);
+            offspring_gametes_ready(ff, *pop);
+
+            // Assign phenotypes/fitnesses.  Containers are read-only here.
+            workers.run(nc, [&](const std::size_t ci) {
+                auto &c = *chunks[ci];
+                const gsl_rng *r = c.rng.get();
+                for (std::size_t i = c.first_offspring; i < c.last_offspring;
+                     ++i)
+                    {
+                        const std::size_t o = 2 * (i - c.first_offspring);
+                        auto key = streams;
+                        key.individual = std::uint32_t(i);
+                        key.purpose = rng_purpose::phenotype;
+                        c.rng.set(key);
+                        rules.update_concurrent(
+                            r, i, pop->traits(), pop->diploids[i],
+                            parents[c.parents[o]],
+                            parents[c.parents[o + 1]], pop->gametes,
+                            pop->mutations, ff);
+                    }
+            });
+
+            process_offspring_gametes(pop, 2 * nextN, rp,
+                                      fixed_mutations);
+            return rules.wbar;
+        }
+    };
+
+    inline std::vector<offspring_chunk::recombination_policy>
+    bind_chunk_recombination(chunked_offspring_generator &gen,
+                             const KTfwd::extensions::discrete_rec_model &recmap,
+                             singlepop_t *pop, const double recrate)
+    /*!
+      One recombination policy per chunk.  These only need to be bound
+      once per simulation.
+    */
+    {
+        std::vector<offspring_chunk::recombination_policy> rv;
+        for (std::size_t i = 0; i < gen.size(); ++i)
+            {
+                rv.emplace_back(KTfwd::extensions::bind_drm(
+                    recmap, pop->gametes, pop->mutations,
+                    gen.chunk(i).recombination_rng.get(), recrate));
+            }
+        return rv;
+    }
+
+    inline void
+    bind_chunk_mutation(chunked_offspring_generator &gen,
+                        const KTfwd::extensions::discrete_mut_model &m,
+                        singlepop_t *pop, const double neutral,
+                        const double selected,
+                        std::vector<offspring_chunk::mutation_model> &mmodels)
+    /*!
+      One mutation model per chunk.  Must be re-bound each generation,
+      as the generation is bound by value.
+    */
+    {
+        mmodels.clear();
+        for (std::size_t i = 0; i < gen.size(); ++i)
+            {
+                mmodels.emplace_back(KTfwd::extensions::bind_dmm(
+                    m, pop->mutations, gen.chunk(i).lookup,
+                    gen.chunk(i).mutation_rng.get(), neutral, selected,
+                    pop->generation));
+            }
+    }
+}
+
+#endif
@@ -0,0 +1,372 @@
+/*!
+  \file sample_diploid_multilocus.hpp
+
+  \brief Generate the offspring of a multi-locus population.
+
+  The multi-locus KTfwd::experimental::sample_diploid copies the
+  parental generation as a vector of multilocus_diploid_t, and builds
+  each offspring as a new multilocus_diploid_t, so that every
+  generation makes several heap allocations per individual.  Here,
+  the parental generation is copied into a multilocus_genotypes
+  matrix that is re-used across generations, and offspring are written
+  in place into pop->diploids.
+*/
+
+#ifndef FWDPY_SAMPLE_DIPLOID_MULTILOCUS_HPP
+#define FWDPY_SAMPLE_DIPLOID_MULTILOCUS_HPP
+
+#include "ancestry_tables.hpp"
+#include "multilocus_genotypes.hpp"
+#include "sample_diploid_chunked.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <gsl/gsl_randist.h>
+
+namespace fwdpy
+{
+    class multilocus_offspring_generator
+    /*!
+      Replacement for the multi-locus KTfwd::experimental::sample_diploid.
+
+      Each offspring gamete starts on a random strand of its parent.
+      The strand switches between loci i-1 and i with probability
+      r_between[i-1], and after any locus with an odd number of
+      crossovers.  Mutations are added after recombination.
+
+      The rules type must provide w(), pick1(), pick2() and update().
+      w() and pick2() are passed a multilocus_genotypes and a
+      const_multilocus_span, respectively, for the parents.  w() reads
+      the parents' fitnesses from multilocus_t::traits().  update() is
+      passed the offspring's index, multilocus_t::traits(), the
+      offspring's multilocus_diploid_t, and spans for the parents.
+
+      See record_ancestry() for recording the ancestry of the
+      offspring.
+    */
+    {
+      private:
+        //! Copy of the parental generation
+        multilocus_genotypes parents;
+        std::queue<std::size_t> mutation_queue, gamete_queue;
+        //! Scratch space for building one gamete
+        std::vector<KTfwd::uint_t> neutral, selected;
+        //! Scratch space for the gametes of one offspring
+        std::vector<std::size_t> haplotype1, haplotype2;
+        //! If not nullptr, offspring ancestry is recorded here
+        ancestry_tables *ancestry;
+        //! If not nullptr, keys of fixed mutations are appended here
+        std::vector<std::size_t> *fixed_mutations;
+        //! Leftmost position of each locus but the first
+        std::vector<double> locus_starts;
+
+        void
+        add_edge(const double left, const double right,
+                 const std::int32_t parent, const std::int32_t child)
+        //! Extends the last edge if it continues on the same parent
+        {
+            auto &edges = ancestry->edges;
+            if (!edges.empty() && edges.back().child == child
+                && edges.back().parent == parent && edges.back().right == left)
+                {
+                    edges.back().right = right;
+                }
+            else
+                edges.push_back(ancestry_edge{ left, right, parent, child });
+        }
+
+        void
+        record_edges(const std::size_t l, const std::int32_t *nodes,
+                     const bool swapped,
+                     const std::vector<double> &breakpoints)
+        /*!
+          Edges for locus l, from nodes[0] and nodes[1], the parent's
+          first and second sides, to nodes[2].  Locus l covers the
+          positions from its start up to the start of locus l+1.
+        */
+        {
+            double left = l ? locus_starts[l - 1] : ancestry_tables::lower();
+            const double right = (l < locus_starts.size())
+                                     ? locus_starts[l]
+                                     : ancestry_tables::upper();
+            std::size_t current = swapped;
+            for (const auto bp : breakpoints)
+                {
+                    if (bp == std::numeric_limits<double>::max())
+                        break;
+                    if (left < bp)
+                        {
+                            add_edge(left, bp, nodes[current], nodes[2]);
+                            left = bp;
+                        }
+                    current ^= 1;
+                }
+            add_edge(left, right, nodes[current], nodes[2]);
+        }
+
+        template <typename mutation_model>
+        void
+        add_mutations(const unsigned nm, multilocus_t *pop,
+                      const mutation_model &mmodel)
+        //! Add nm new mutations to the gamete being built
+        {
+            for (unsigned i = 0; i < nm; ++i)
+                {
+                    const auto key = mmodel(mutation_queue, pop->mutations);
+                    const double pos = pop->mutations[key].pos;
+                    auto &dest
+                        = pop->mutations[key].neutral ? neutral : selected;
+                    dest.insert(
+                        std::upper_bound(dest.begin(), dest.end(), pos,
+                                         [pop](const double p,
+                                               const KTfwd::uint_t k) {
+                                             return p < pop->mutations[k].pos;
+                                         }),
+                        KTfwd::uint_t(key));
+                }
+        }
+
+        std::size_t
+        add_gamete(multilocus_t *pop)
+        /*!
+          Store the gamete being built, recycling an extinct slot.  Key
+          storage comes from pop->key_arena.
+        */
+        {
+            std::size_t idx;
+            if (!gamete_queue.empty())
+                {
+                    idx = gamete_queue.front();
+                    gamete_queue.pop();
+                }
+            else
+                {
+                    idx = pop->gametes.size();
+                    pop->gametes.emplace_back(0u);
+                }
+            auto &g = pop->gametes[idx];
+            g.n = 0;
+            const auto same_key = [](const KTfwd::uint_t k) { return k; };
+            pop->key_arena.fill(g.mutations, neutral.cbegin(), neutral.size(),
+                                same_key);
+            pop->key_arena.fill(g.smutations, selected.cbegin(),
+                                selected.size(), same_key);
+            return idx;
+        }
+
+        template <typename mutation_models, typename recombination_policies>
+        void
+        make_haplotype(const gsl_rng *r, multilocus_t *pop,
+                       const const_multilocus_span parent, const double *mu,
+                       const mutation_models &mmodels,
+                       const recombination_policies &recpols,
+                       const double *r_between,
+                       std::vector<std::size_t> &haplotype,
+                       const std::int32_t *nodes)
+        /*!
+          Fill haplotype with the offspring gamete inherited from
+          parent at each locus.
+
+          If nodes is not nullptr, it contains the ancestry nodes of
+          the parent's two sides and of the offspring, and edges are
+          recorded.
+        */
+        {
+            haplotype.resize(parent.size());
+            bool swapped = gsl_rng_uniform(r) < 0.5;
+            for (std::size_t l = 0; l < parent.size(); ++l)
+                {
+                    if (l && r_between[l - 1] > 0.
+                        && gsl_ran_bernoulli(r, r_between[l - 1]))
+                        {
+                            swapped = !swapped;
+                        }
+                    std::size_t g1 = parent[l].first, g2 = parent[l].second;
+                    if (swapped)
+                        std::swap(g1, g2);
+                    // Crossovers must be drawn even if g1 == g2, as they
+                    // determine the strand inherited at the next locus.
+                    const auto breakpoints = recpols[l](
+                        pop->gametes[g1], pop->gametes[g2], pop->mutations);
+                    if (nodes)
+                        record_edges(l, nodes, swapped, breakpoints);
+                    std::size_t nbreaks = breakpoints.size();
+                    if (nbreaks
+                        && breakpoints.back()
+                               == std::numeric_limits<double>::max())
+                        {
+                            --nbreaks;
+                        }
+                    const bool recombined = nbreaks && g1 != g2;
+                    if (recombined)
+                        {
+                            recombine_keys(pop->gametes[g1].mutations,
+                                           pop->gametes[g2].mutations,
+                                           breakpoints, pop->mutations,
+                                           neutral);
+                            recombine_keys(pop->gametes[g1].smutations,
+                                           pop->gametes[g2].smutations,
+                                           breakpoints, pop->mutations,
+                                           selected);
+                        }
+                    if (nbreaks % 2)
+                        swapped = !swapped;
+                    const unsigned nm
+                        = (mu[l] > 0.) ? gsl_ran_poisson(r, mu[l]) : 0u;
+                    if (!nm && !recombined)
+                        {
+                            haplotype[l] = g1;
+                            continue;
+                        }
+                    if (!recombined)
+                        {
+                            neutral.assign(pop->gametes[g1].mutations.begin(),
+                                           pop->gametes[g1].mutations.end());
+                            selected.assign(
+                                pop->gametes[g1].smutations.begin(),
+                                pop->gametes[g1].smutations.end());
+                        }
+                    add_mutations(nm, pop, mmodels[l]);
+                    haplotype[l] = add_gamete(pop);
+                }
+        }
+
+      public:
+        multilocus_offspring_generator()
+            : parents{}, mutation_queue{}, gamete_queue{}, neutral{},
+              selected{}, haplotype1{}, haplotype2{}, ancestry(nullptr),
+              fixed_mutations(nullptr), locus_starts{}
+        {
+        }
+
+        void
+        record_ancestry(ancestry_tables *tables,
+                        std::vector<double> starts)
+        /*!
+          Record the ancestry of each offspring in tables, whose
+          current gametes must be those of the population.
+
+          \param starts The leftmost position of each locus but the
+          first.  Loci must occupy disjoint, increasing position
+          ranges, and crossovers within a locus must fall in its range.
+        */
+        {
+            ancestry = tables;
+            locus_starts = std::move(starts);
+        }
+
+        void
+        log_fixations(std::vector<std::size_t> *fixed)
+        /*!
+          Append the keys of mutations fixed in the offspring generation
+          to fixed.  See process_offspring_gametes().
+        */
+        {
+            fixed_mutations = fixed;
+        }
+
+        template <typename mutation_models, typename recombination_policies,
+                  typename fitness_fxn, typename rules_t,
+                  typename removal_policy>
+        double
+        operator()(const gsl_rng *r, multilocus_t *pop,
+                   const KTfwd::uint_t nextN, const double *mu,
+                   const mutation_models &mmodels,
+                   const recombination_policies &recpols,
+                   const double *r_between, const fitness_fxn &ff,
+                   const double f, rules_t &rules, const removal_policy &rp)
+        /*!
+          Generate one generation of offspring.
+
+          \param mu Total mutation rate at each locus
+          \param mmodels One mutation model per locus
+          \param recpols One recombination policy per locus
+          \param r_between Probability of crossing over between
+          adjacent loci
+
+          \return Mean fitness of the parental generation.
+        */
+        {
+            // Extinct slots are available for recycling.  This must
+            // happen before rules.w() zeroes parental gamete counts.
+            mutation_queue = std::queue<std::size_t>();
+            gamete_queue = std::queue<std::size_t>();
+            for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+                {
+                    if (!pop->mcounts[i])
+                        mutation_queue.push(i);
+                }
+            for (std::size_t i = 0; i < pop->gametes.size(); ++i)
+                {
+                    if (!pop->gametes[i].n)
+                        gamete_queue.push(i);
+                }
+            parents.assign(pop->diploids);
+            rules.w(parents, pop->traits(), pop->gametes, pop->mutations);
+            std::int32_t parent_nodes = 0, offspring_nodes = 0;
+            if (ancestry)
+                {
+                    parent_nodes = std::int32_t(ancestry->first_sample);
+                    offspring_nodes
+                        = std::int32_t(ancestry->add_generation(2 * nextN));
+                }
+            // Only allocates if the population grows
+            if (pop->diploids.size() < nextN)
+                {
+                    pop->diploids.resize(
+                        nextN, multilocus_diploid_t(parents.loci()));
+                }
+            else
+                pop->diploids.resize(nextN);
+#ifdef FWDPY_COMPACT_DIPLOID
+            // The parents' traits are not read after w().
+            pop->trait_data.resize(nextN);
+#endif
+
+            for (std::size_t i = 0; i < nextN; ++i)
+                {
+                    const std::size_t p1 = rules.pick1(r);
+                    const std::size_t p2 = rules.pick2(
+                        r, p1, f, parents[p1], pop->gametes, pop->mutations);
+                    const std::int32_t nodes1[3]
+                        = { parent_nodes + 2 * std::int32_t(p1),
+                            parent_nodes + 2 * std::int32_t(p1) + 1,
+                            offspring_nodes + 2 * std::int32_t(i) },
+                        nodes2[3] = { parent_nodes + 2 * std::int32_t(p2),
+                                      parent_nodes + 2 * std::int32_t(p2) + 1,
+                                      offspring_nodes + 2 * std::int32_t(i)
+                                          + 1 };
+                    make_haplotype(r, pop, parents[p1], mu, mmodels, recpols,
+                                   r_between, haplotype1,
+                                   ancestry ? nodes1 : nullptr);
+                    make_haplotype(r, pop, parents[p2], mu, mmodels, recpols,
+                                   r_between, haplotype2,
+                                   ancestry ? nodes2 : nullptr);
+                    auto &offspring = pop->diploids[i];
+                    for (std::size_t l = 0; l < offspring.size(); ++l)
+                        {
+                            offspring[l] = diploid_t(
+                                diploid_t::first_type(haplotype1[l]),
+                                diploid_t::second_type(haplotype2[l]));
+                            pop->gametes[haplotype1[l]].n++;
+                            pop->gametes[haplotype2[l]].n++;
+                        }
+                    rules.update(r, i, pop->traits(), offspring,
+                                 parents[p1], parents[p2],
+                                 pop->gametes, pop->mutations, ff);
+                }
+            pop->diploid_writes.touch(0, nextN);
+
+            process_offspring_gametes(pop, 2 * nextN, rp,
+                                      fixed_mutations);
+            return rules.wbar;
+        }
+    };
+}
+
+#endif
@@ -362,32 +362,20 @@ namespace fwdpy
 
         template <typename pop_t>
         void fillG(const pop_t *pop, std::vector<double> &Gbuffer,
-                   double *VG) // single-pop...
+                   double *VG)
         /*!
           Returns vector of genetic values of each diploid.
         */
         {
             Gbuffer.clear();
-            for (const auto &dip : pop->diploids)
+            const auto &traits = pop->traits();
+            for (std::size_t i = 0; i < pop->diploids.size(); ++i)
                 {
-                    Gbuffer.push_back(dip.g);
+                    Gbuffer.push_back(trait_g(traits, i));
                 }
         }
     };
 
-    template <>
-    inline void
-    additive_variance::fillG<multilocus_t>(const multilocus_t *pop,
-                                           std::vector<double> &Gbuffer,
-                                           double *VG)
-    {
-        Gbuffer.clear();
-        for (const auto &dip : pop->diploids)
-            {
-                Gbuffer.push_back(dip[0].g);
-            }
-    }
-
 }
 
 #endif
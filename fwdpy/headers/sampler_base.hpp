@@ -2,6 +2,8 @@
 #define FWDPY_SAMPLER_BASE_HPP
 
 #include "types.hpp"
+#include <cstddef>
+#include <memory>
 #include <stdexcept>
 #include <thread>
 #include <vector>
@@ -335,6 +337,195 @@ namespace fwdpy
             return f;
         }
     };
+
+    struct pass_sampler : public sampler_base
+    /*!
+      Base class for a sampler that may share a single traversal of a
+      population with other samplers.  See composite_sampler.
+
+      Rather than reading the population in operator(), a pass_sampler
+      subscribes, via subscriptions(), to callbacks made for each
+      mutation with a nonzero count and/or for each diploid.  A pass
+      over the population calls begin_pass(), then the subscribed
+      callbacks, in index order, then end_pass().  Applied on its own,
+      a pass_sampler makes a pass for itself.
+    */
+    {
+        enum : unsigned
+        {
+            visits_mutations = 1,
+            visits_diploids = 2
+        };
+
+        virtual unsigned
+        subscriptions() const = 0;
+
+        virtual void
+        begin_pass(const singlepop_t *, const unsigned)
+        {
+        }
+        virtual void
+        visit_mutation(const singlepop_t *, const std::size_t)
+        {
+        }
+        virtual void
+        visit_diploid(const singlepop_t *, const std::size_t)
+        {
+        }
+        virtual void
+        end_pass(const singlepop_t *, const unsigned)
+        {
+        }
+
+        virtual void
+        begin_pass(const multilocus_t *, const unsigned)
+        {
+        }
+        virtual void
+        visit_mutation(const multilocus_t *, const std::size_t)
+        {
+        }
+        virtual void
+        visit_diploid(const multilocus_t *, const std::size_t)
+        //! Called once per diploid, for all of its loci
+        {
+        }
+        virtual void
+        end_pass(const multilocus_t *, const unsigned)
+        {
+        }
+
+        virtual void
+        operator()(const singlepop_t *pop, const unsigned generation);
+        virtual void
+        operator()(const multilocus_t *pop, const unsigned generation);
+    };
+
+    template <typename pop_t>
+    inline void
+    run_pass(const std::vector<pass_sampler *> &samplers, const pop_t *pop,
+             const unsigned generation)
+    /*!
+      A single traversal of pop: one pass over its mutations and one
+      over its diploids, each skipped if no sampler subscribes to it.
+    */
+    {
+        std::vector<pass_sampler *> mvisitors, dvisitors;
+        for (auto s : samplers)
+            {
+                if (s->subscriptions() & pass_sampler::visits_mutations)
+                    mvisitors.push_back(s);
+                if (s->subscriptions() & pass_sampler::visits_diploids)
+                    dvisitors.push_back(s);
+                s->begin_pass(pop, generation);
+            }
+        if (!mvisitors.empty())
+            {
+                for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+                    {
+                        if (!pop->mcounts[i])
+                            continue;
+                        for (auto s : mvisitors)
+                            s->visit_mutation(pop, i);
+                    }
+            }
+        if (!dvisitors.empty())
+            {
+                for (std::size_t i = 0; i < pop->diploids.size(); ++i)
+                    {
+                        for (auto s : dvisitors)
+                            s->visit_diploid(pop, i);
+                    }
+            }
+        for (auto s : samplers)
+            s->end_pass(pop, generation);
+    }
+
+    inline void
+    pass_sampler::operator()(const singlepop_t *pop, const unsigned generation)
+    {
+        run_pass(std::vector<pass_sampler *>(1, this), pop, generation);
+    }
+
+    inline void
+    pass_sampler::operator()(const multilocus_t *pop,
+                             const unsigned generation)
+    {
+        run_pass(std::vector<pass_sampler *>(1, this), pop, generation);
+    }
+
+    class composite_sampler : public sampler_base
+    /*!
+      Applies several samplers to the same population.  Children that
+      are pass_samplers share a single traversal of the population.
+      Others are applied in turn, before the traversal.
+
+      Children are not owned, and must outlive *this.
+    */
+    {
+      private:
+        std::vector<sampler_base *> children;
+        std::vector<pass_sampler *> fused;
+        std::vector<sampler_base *> others;
+
+        template <typename pop_t>
+        void
+        apply(const pop_t *pop, const unsigned generation)
+        {
+            for (auto s : others)
+                s->operator()(pop, generation);
+            if (!fused.empty())
+                run_pass(fused, pop, generation);
+        }
+
+      public:
+        composite_sampler() : children{}, fused{}, others{} {}
+
+        void
+        add(sampler_base *s)
+        {
+            if (s == nullptr)
+                throw std::runtime_error("composite_sampler: null sampler");
+            children.push_back(s);
+            if (auto p = dynamic_cast<pass_sampler *>(s))
+                fused.push_back(p);
+            else
+                others.push_back(s);
+        }
+
+        std::size_t
+        size() const noexcept
+        {
+            return children.size();
+        }
+
+        virtual void
+        operator()(const singlepop_t *pop, const unsigned generation)
+        {
+            apply(pop, generation);
+        }
+
+        virtual void
+        operator()(const multilocus_t *pop, const unsigned generation)
+        {
+            apply(pop, generation);
+        }
+
+        virtual void
+        operator()(const metapop_t *pop, const unsigned generation)
+        //! No traversal is shared for metapopulations
+        {
+            for (auto s : children)
+                s->operator()(pop, generation);
+        }
+
+        virtual void
+        cleanup()
+        {
+            for (auto s : children)
+                s->cleanup();
+        }
+    };
 }
 
 #endif
@@ -0,0 +1,172 @@
+#ifndef FWDPY_SAMPLER_PIPELINE_HPP
+#define FWDPY_SAMPLER_PIPELINE_HPP
+
+/*!
+  \file sampler_pipeline.hpp
+
+  Applying a temporal sampler without stalling evolution.
+
+  Samplers such as PopSampler, writing to files, or VASampler, doing a
+  QR decomposition, may take longer than a generation.  With
+  evolve_options::sampler_queue set, each sampling generation hands a
+  snapshot of the population (see population_snapshot.hpp) to a queue,
+  and evolution continues at once.  A background thread applies the
+  sampler to the snapshots, in the order they were taken.  When the
+  queue is full, evolution waits for the sampler.
+*/
+
+#include "evolve_options.hpp"
+#include "population_snapshot.hpp"
+#include "sampler_base.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace fwdpy
+{
+    template <typename pop_t> class sampler_pipeline
+    /*!
+      Stands in for a sampler in the generation loop of an "evolve"
+      driver.  With a queue capacity of 0, calls are passed straight to
+      the sampler.
+
+      The background thread is started by the first call.  finish()
+      must be called after the last one, and before the sampler's
+      cleanup().  Each sampler sees the same calls, in the same order,
+      as without a queue.  An exception thrown by the sampler is
+      re-thrown by the next call, or by finish().
+    */
+    {
+      private:
+        using snapshot_ptr = std::shared_ptr<const population_snapshot<pop_t>>;
+        sampler_base &sampler;
+        const std::size_t capacity;
+        snapshot_source<pop_t> source;
+        std::deque<std::pair<snapshot_ptr, unsigned>> queue;
+        std::mutex lock;
+        std::condition_variable changed;
+        bool closed, abandoned;
+        std::exception_ptr error;
+        std::thread consumer;
+
+        void
+        serve()
+        {
+            snapshot_view<pop_t> view;
+            std::unique_lock<std::mutex> l(lock);
+            while (true)
+                {
+                    changed.wait(l, [this]() {
+                        return abandoned || closed || !queue.empty();
+                    });
+                    if (abandoned || queue.empty())
+                        return;
+                    auto next = std::move(queue.front());
+                    l.unlock();
+                    try
+                        {
+                            sampler(view.get(*next.first), next.second);
+                        }
+                    catch (...)
+                        {
+                            l.lock();
+                            error = std::current_exception();
+                            abandoned = true;
+                            queue.clear();
+                            changed.notify_all();
+                            return;
+                        }
+                    l.lock();
+                    // Popped only now, so that a full queue counts the
+                    // snapshot being sampled.
+                    queue.pop_front();
+                    changed.notify_all();
+                }
+        }
+
+        void
+        rethrow()
+        //! Must hold lock
+        {
+            if (error)
+                {
+                    auto e = error;
+                    error = nullptr;
+                    std::rethrow_exception(e);
+                }
+        }
+
+      public:
+        sampler_pipeline(sampler_base &s, const evolve_options &options)
+            : sampler(s), capacity(options.sampler_queue), source{},
+              queue{}, lock{}, changed{}, closed(false), abandoned(false),
+              error(nullptr), consumer{}
+        {
+        }
+
+        sampler_pipeline(const sampler_pipeline &) = delete;
+        sampler_pipeline &operator=(const sampler_pipeline &) = delete;
+
+        ~sampler_pipeline()
+        //! Without finish(), as when evolution throws, queued samples
+        //! are dropped.
+        {
+            if (consumer.joinable())
+                {
+                    {
+                        std::lock_guard<std::mutex> l(lock);
+                        abandoned = true;
+                    }
+                    changed.notify_all();
+                    consumer.join();
+                }
+        }
+
+        void
+        operator()(const pop_t *pop, const unsigned generation)
+        /*!
+          Sample pop, or queue a snapshot of it, waiting while the
+          queue is full.
+        */
+        {
+            if (!capacity)
+                {
+                    sampler(pop, generation);
+                    return;
+                }
+            auto snapshot = source.take(pop);
+            std::unique_lock<std::mutex> l(lock);
+            if (!consumer.joinable())
+                consumer = std::thread(&sampler_pipeline::serve, this);
+            changed.wait(l, [this]() {
+                return abandoned || queue.size() < capacity;
+            });
+            rethrow();
+            queue.emplace_back(std::move(snapshot), generation);
+            changed.notify_all();
+        }
+
+        void
+        finish()
+        //! Wait for all queued samples to be taken
+        {
+            if (!consumer.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> l(lock);
+                closed = true;
+            }
+            changed.notify_all();
+            consumer.join();
+            std::lock_guard<std::mutex> l(lock);
+            rethrow();
+        }
+    };
+}
+
+#endif
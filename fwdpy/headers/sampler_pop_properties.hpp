@@ -1,6 +1,7 @@
 #ifndef FWDPY_POP_PROPERTIES_HPP
 #define FWDPY_POP_PROPERTIES_HPP
 
+#include "mutation_effect_table.hpp"
 #include "types.hpp"
 #include <array>
 #include <sampler_base.hpp>
@@ -28,7 +29,7 @@ namespace fwdpy
     */
     using qtrait_stats_t = std::vector<std::array<double, 13>>;
 
-    class pop_properties : public sampler_base
+    class pop_properties : public pass_sampler
     /*!
       \brief A "sampler" that records "quantitative genetics" kinda stuff.
       \ingroup samplers
@@ -37,16 +38,97 @@ namespace fwdpy
       public:
         using final_t = std::vector<qtrait_stats_cython>;
 
+        virtual unsigned
+        subscriptions() const
+        {
+            return visits_mutations | visits_diploids;
+        }
+
+        virtual void
+        begin_pass(const singlepop_t *pop, const unsigned)
+        {
+            begin_details(pop);
+        }
+
+        virtual void
+        visit_mutation(const singlepop_t *pop, const std::size_t i)
+        {
+            visit_mutation_details(pop, i);
+        }
+
+        virtual void
+        visit_diploid(const singlepop_t *pop, const std::size_t i)
+        {
+            const auto &dip = pop->diploids[i];
+            const auto &traits = pop->traits();
+            VG.push_back(trait_g(traits, i));
+            VE.push_back(trait_e(traits, i));
+            trait.push_back(trait_g(traits, i) + trait_e(traits, i));
+            wbar.push_back(trait_w(traits, i));
+            // Count up # deleterious mutations per individual
+            unsigned nd = 0;
+            for (auto &&m : pop->gametes[dip.first].smutations)
+                {
+                    if (pop->mcounts[m] < 2 * pop->N)
+                        nd++;
+                }
+            for (auto &&m : pop->gametes[dip.second].smutations)
+                {
+                    if (pop->mcounts[m] < 2 * pop->N)
+                        nd++;
+                }
+            ndel.push_back(double(nd));
+        }
+
+        virtual void
+        end_pass(const singlepop_t *, const unsigned generation)
+        {
+            end_details(generation);
+        }
+
+        virtual void
+        begin_pass(const multilocus_t *pop, const unsigned)
+        {
+            begin_details(pop);
+        }
+
+        virtual void
+        visit_mutation(const multilocus_t *pop, const std::size_t i)
+        {
+            visit_mutation_details(pop, i);
+        }
+
         virtual void
-        operator()(const singlepop_t *pop, const unsigned generation)
+        visit_diploid(const multilocus_t *pop, const std::size_t i)
         {
-            call_operator_details(pop, generation);
+            const auto &dip = pop->diploids[i];
+            const auto &traits = pop->traits();
+            VG.push_back(trait_g(traits, i));
+            VE.push_back(trait_e(traits, i));
+            trait.push_back(trait_g(traits, i) + trait_e(traits, i));
+            wbar.push_back(trait_w(traits, i));
+            // Count up # deleterious per locus
+            unsigned nd = 0;
+            for (auto &&locus : dip)
+                {
+                    for (auto &&m : pop->gametes[locus.first].smutations)
+                        {
+                            if (pop->mcounts[m] <= 2 * pop->N)
+                                nd++;
+                        }
+                    for (auto &&m : pop->gametes[locus.second].smutations)
+                        {
+                            if (pop->mcounts[m] <= 2 * pop->N)
+                                nd++;
+                        }
+                    ndel.push_back(double(nd));
+                }
         }
 
         virtual void
-        operator()(const multilocus_t *pop, const unsigned generation)
+        end_pass(const multilocus_t *, const unsigned generation)
         {
-            call_operator_details(pop, generation);
+            end_details(generation);
         }
 
         final_t
@@ -116,78 +198,64 @@ namespace fwdpy
             return rv;
         }
 
-        explicit pop_properties(double optimum_) noexcept : optimum(optimum_)
+        explicit pop_properties(double optimum_) noexcept
+            : VG{}, VE{}, trait{}, wbar{}, ndel{}, effects{}, twoN(0.),
+              mvexpl(0.), leading_e(0.), leading_f(0.), sum_e(0.), nm(0),
+              qstats{}, optimum(optimum_)
         {
         }
 
       private:
+        //! Per-diploid values, filled during a pass
+        std::vector<double> VG, VE, trait, wbar, ndel;
+        //! Effect sizes and neutrality flags, read during a pass
+        mutation_effect_table effects;
+        //! Per-mutation sums, filled during a pass
+        double twoN, mvexpl, leading_e, leading_f, sum_e;
+        unsigned nm;
+
         template <typename pop_t>
-        void
-        fill_vectors(const pop_t *pop, std::vector<double> &VG,
-                     std::vector<double> &VE, std::vector<double> &trait,
-                     std::vector<double> &wbar, std::vector<double> &ndel)
+        inline void
+        begin_details(const pop_t *pop)
         {
-            for (const auto &dip : pop->diploids)
+            for (auto v : { &VG, &VE, &trait, &wbar, &ndel })
                 {
-                    VG.push_back(dip.g);
-                    VE.push_back(dip.e);
-                    trait.push_back(dip.g + dip.e);
-                    wbar.push_back(dip.w);
-                    // Count up # deleterious mutations per individual
-                    unsigned nd = 0;
-                    for (auto &&m : pop->gametes[dip.first].smutations)
-                        {
-                            if (pop->mcounts[m] < 2 * pop->N)
-                                nd++;
-                        }
-                    for (auto &&m : pop->gametes[dip.second].smutations)
-                        {
-                            if (pop->mcounts[m] < 2 * pop->N)
-                                nd++;
-                        }
-                    ndel.push_back(double(nd));
+                    v->clear();
+                    v->reserve(pop->diploids.size());
                 }
+            effects.sync(pop->mutations);
+            twoN = 2. * double(pop->diploids.size());
+            mvexpl = 0.;
+            leading_e = std::numeric_limits<double>::quiet_NaN();
+            leading_f = std::numeric_limits<double>::quiet_NaN();
+            sum_e = 0.;
+            nm = 0;
         }
 
         template <typename pop_t>
         inline void
-        call_operator_details(const pop_t *pop, const unsigned generation)
+        visit_mutation_details(const pop_t *pop, const std::size_t i)
         {
-            std::vector<double> VG, VE, wbar, trait, ndel;
-            VG.reserve(pop->diploids.size());
-            VE.reserve(pop->diploids.size());
-            trait.reserve(pop->diploids.size());
-            wbar.reserve(pop->diploids.size());
-            ndel.reserve(pop->diploids.size());
-
-            fill_vectors(pop, VG, VE, trait, wbar, ndel);
-
-            double twoN = 2. * double(pop->diploids.size());
-            double mvexpl = 0.,
-                   leading_e = std::numeric_limits<double>::quiet_NaN(),
-                   leading_f = std::numeric_limits<double>::quiet_NaN();
-            double sum_e = 0.;
-            unsigned nm = 0;
-            for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
+            if (pop->mcounts[i] < twoN && !effects.neutral[i])
                 {
-                    if (pop->mcounts[i] && pop->mcounts[i] < twoN
-                        && !pop->mutations[i].neutral)
+                    auto n = pop->mcounts[i];
+                    double p = double(n) / twoN, q = 1. - p;
+                    double s = effects.s[i];
+                    double temp = 2. * p * q * std::pow(s, 2.0);
+                    if (temp > mvexpl)
                         {
-                            auto n = pop->mcounts[i];
-                            double p = double(n) / twoN, q = 1. - p;
-                            double s = pop->mutations[i].s;
-                            double temp = 2. * p * q * std::pow(s, 2.0);
-                            if (temp > mvexpl)
-                                {
-                                    mvexpl = temp;
-                                    leading_e = s;
-                                    leading_f = p;
-                                }
-                            sum_e += pop->mutations[i].s;
-                            ++nm;
+                            mvexpl = temp;
+                            leading_e = s;
+                            leading_f = p;
                         }
+                    sum_e += s;
+                    ++nm;
                 }
+        }
 
+        inline void
+        end_details(const unsigned generation)
+        {
             // Calcate V(G) here b/c we're going to mess
             // around with this container below when
             // calculating V_{s,t}
@@ -244,42 +312,5 @@ namespace fwdpy
             UNLOADED
         };
     };
-
-    template <>
-    inline void
-    pop_properties::fill_vectors<multilocus_t>(const multilocus_t *pop,
-                                               std::vector<double> &VG,
-                                               std::vector<double> &VE,
-                                               std::vector<double> &trait,
-                                               std::vector<double> &wbar,
-                                               std::vector<double> &ndel)
-    /*!
-      Specialization for fwdpy::multilocus_t
-    */
-    {
-        for (const auto &dip : pop->diploids)
-            {
-                VG.push_back(dip[0].g);
-                VE.push_back(dip[0].e);
-                trait.push_back(dip[0].g + dip[0].e);
-                wbar.push_back(dip[0].w);
-                // Count up # deleterious per locus
-                unsigned nd = 0;
-                for (auto &&locus : dip)
-                    {
-                        for (auto &&m : pop->gametes[locus.first].smutations)
-                            {
-                                if (pop->mcounts[m] <= 2 * pop->N)
-                                    nd++;
-                            }
-                        for (auto &&m : pop->gametes[locus.second].smutations)
-                            {
-                                if (pop->mcounts[m] <= 2 * pop->N)
-                                    nd++;
-                            }
-                        ndel.push_back(double(nd));
-                    }
-            }
-    }
 }
 #endif
@@ -2,25 +2,38 @@
 #define FWDPY_SAMPLE_N_HPP
 
 #include "sampler_base.hpp"
+#include "sampling_wrappers.hpp"
 #include "types.hpp"
 #include <Sequence/SimData.hpp>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <fwdpp/diploid.hh>
 #include <fwdpp/sugar/poptypes/tags.hpp>
 #include <fwdpp/sugar/sampling.hpp>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 namespace fwdpy
 {
-    class sample_n
-        : public sampler_base // take a sample of size n from a population
-                              /*
-                                \brief A "sampler" that takes a sample of n gametes from a population
-                                \ingroup samplers
-                              */
+    class sample_n : public pass_sampler
+    /*!
+      \brief A "sampler" that takes a sample of n gametes from a population
+      \ingroup samplers
+
+      Gametes are taken in pairs from nsam/2 (rounded up) diploids
+      sampled with replacement.  See sampling_details::draw_nodes.  The
+      sampled diploids are read during the pass over diploids, which
+      may be shared with other samplers.  See composite_sampler.
+
+      For a population whose ancestry is recorded, neutral sites are
+      read from the ancestry tables.  For a multilocus_t, those sites,
+      and fixations when removeFixed is false, are assigned to loci by
+      position, which requires locus boundaries.
+    */
     {
       public:
         using final_t
@@ -33,22 +46,94 @@ namespace fwdpy
         const std::string nfile, sfile;
         const std::vector<std::pair<double, double>> locus_boundaries;
         const bool removeFixed, recordSamples, recordDetails;
+        //! Sampled gametes, as indexes 2 * diploid + (0 or 1)
+        std::vector<std::int32_t> nodes;
+        //! Columns of the sample, in order of diploid
+        std::vector<unsigned> columns;
+        //! The next element of columns to be read
+        std::size_t next_column;
+        //! Sites of the sample at each locus
+        std::vector<sampling_details::site_map> neutral, selected;
+
+        template <typename pop_t>
+        void
+        begin_details(const pop_t *pop, const unsigned generation,
+                      const std::size_t nloci)
+        {
+            if (pop->diploids.empty())
+                throw std::runtime_error("cannot sample an empty population");
+            if (!pop->ancestry.empty())
+                sampling_details::check_ancestry(*pop, generation);
+            sampling_details::draw_nodes(r.get(), pop->diploids.size(), nsam,
+                                         nodes);
+            columns.resize(nsam);
+            for (unsigned i = 0; i < nsam; ++i)
+                columns[i] = i;
+            std::stable_sort(columns.begin(), columns.end(),
+                             [this](const unsigned a, const unsigned b) {
+                                 return nodes[a] < nodes[b];
+                             });
+            next_column = 0;
+            neutral.assign(nloci, sampling_details::site_map());
+            selected.assign(nloci, sampling_details::site_map());
+        }
+
+        void
+        add_gametes(const singlepop_t *pop, const unsigned column)
+        {
+            sampling_details::for_each_gamete(
+                *pop, nodes[column], [&](const gamete_t &g) {
+                    sampling_details::add_sites(pop->mutations, neutral[0],
+                                                g.mutations, column, nsam);
+                    sampling_details::add_sites(pop->mutations, selected[0],
+                                                g.smutations, column, nsam);
+                });
+        }
+
+        void
+        add_gametes(const multilocus_t *pop, const unsigned column)
+        {
+            const auto n = nodes[column];
+            const auto &dip = pop->diploids[std::size_t(n / 2)];
+            for (std::size_t l = 0; l < dip.size(); ++l)
+                {
+                    const auto &g = pop->gametes[(n % 2) ? dip[l].second
+                                                         : dip[l].first];
+                    sampling_details::add_sites(pop->mutations, neutral[l],
+                                                g.mutations, column, nsam);
+                    sampling_details::add_sites(pop->mutations, selected[l],
+                                                g.smutations, column, nsam);
+                }
+        }
 
+        template <typename pop_t>
         void
-        remove_redundant_selected_fixations(KTfwd::sep_sample_t &sample)
-        /* In fwdpy, we have a slight issue:
-         * 1. Quant-trait sims do copy selected fixations
-         *    into fixations/fixation times, while also
-         *    leaving them in the pop
-         * 2. Thus, when removeFixed = false, we can end up w/two
-         *    copies of such mutations.  Essentially, we are using
-         *    fwdpp as it was not intended to be used :).
-         * 3. This function cleans up the mess we've made
-         */
-        {
-            sample.second.erase(
-                std::unique(sample.second.begin(), sample.second.end()),
-                sample.second.end());
+        visit_details(const pop_t *pop, const std::size_t i)
+        //! Read the sampled gametes of diploid i
+        {
+            while (next_column < columns.size()
+                   && std::size_t(nodes[columns[next_column]] / 2) == i)
+                {
+                    add_gametes(pop, columns[next_column]);
+                    ++next_column;
+                }
+        }
+
+        KTfwd::sep_sample_t
+        locus_sample(const std::size_t l)
+        //! The sample at locus l.  Its sites are moved out.
+        {
+            if (removeFixed)
+                {
+                    sampling_details::remove_fixed_sites(neutral[l], nsam);
+                    sampling_details::remove_fixed_sites(selected[l], nsam);
+                }
+            KTfwd::sep_sample_t s(
+                KTfwd::sample_t(neutral[l].begin(), neutral[l].end()),
+                KTfwd::sample_t(selected[l].begin(), selected[l].end()));
+            neutral[l].clear();
+            selected[l].clear();
+            return s;
         }
 
         void
@@ -92,11 +177,33 @@ namespace fwdpy
         }
 
       public:
+        virtual unsigned
+        subscriptions() const
+        {
+            return visits_diploids;
+        }
         virtual void
-        operator()(const singlepop_t *pop, const unsigned generation)
+        begin_pass(const singlepop_t *pop, const unsigned generation)
         {
-            auto s = KTfwd::sample_separate(r.get(), *pop, nsam, removeFixed);
-            remove_redundant_selected_fixations(s);
+            begin_details(pop, generation, 1);
+        }
+        virtual void
+        visit_diploid(const singlepop_t *pop, const std::size_t i)
+        {
+            visit_details(pop, i);
+        }
+        virtual void
+        end_pass(const singlepop_t *pop, const unsigned generation)
+        {
+            if (!pop->ancestry.empty())
+                pop->ancestry.neutral_genotypes(nodes, neutral[0]);
+            if (!removeFixed)
+                {
+                    const std::string fixed(nsam, '1');
+                    for (const auto &m : pop->fixations)
+                        (m.neutral ? neutral[0] : selected[0])[m.pos] = fixed;
+                }
+            auto s = locus_sample(0);
             if (!nfile.empty())
                 {
                     write_sample(nfile, s.first);
@@ -129,14 +236,68 @@ namespace fwdpy
         }
 
         virtual void
-        operator()(const multilocus_t *pop, const unsigned generation)
+        begin_pass(const multilocus_t *pop, const unsigned generation)
+        {
+            const auto nloci = pop->diploids.empty()
+                                   ? std::size_t(0)
+                                   : pop->diploids[0].size();
+            if ((!pop->ancestry.empty() || !removeFixed)
+                && locus_boundaries.size() != nloci)
+                {
+                    throw std::runtime_error(
+                        "locus boundaries are needed to sample a population "
+                        "with recorded ancestry, or to include fixations");
+                }
+            begin_details(pop, generation, nloci);
+        }
+        virtual void
+        visit_diploid(const multilocus_t *pop, const std::size_t i)
         {
-            auto s = KTfwd::sample_separate(r.get(), *pop, nsam, removeFixed,
-                                            locus_boundaries);
-            for (auto &si : s)
+            visit_details(pop, i);
+        }
+        virtual void
+        end_pass(const multilocus_t *pop, const unsigned generation)
+        {
+            const auto nloci = neutral.size();
+            if (!pop->ancestry.empty())
                 {
-                    remove_redundant_selected_fixations(si);
+                    sampling_details::site_map sites;
+                    pop->ancestry.neutral_genotypes(nodes, sites);
+                    for (auto &site : sites)
+                        {
+                            const auto l = sampling_details::locus_of(
+                                locus_boundaries, site.first);
+                            if (l == nloci)
+                                continue;
+                            auto &g = neutral[l][site.first];
+                            if (g.empty())
+                                g = std::move(site.second);
+                            else
+                                {
+                                    for (unsigned c = 0; c < nsam; ++c)
+                                        {
+                                            if (site.second[c] == '1')
+                                                g[c] = '1';
+                                        }
+                                }
+                        }
+                }
+            if (!removeFixed)
+                {
+                    const std::string fixed(nsam, '1');
+                    for (const auto &m : pop->fixations)
+                        {
+                            const auto l = sampling_details::locus_of(
+                                locus_boundaries, m.pos);
+                            if (l < nloci)
+                                (m.neutral ? neutral[l]
+                                           : selected[l])[m.pos]
+                                    = fixed;
+                        }
                 }
+            std::vector<KTfwd::sep_sample_t> s;
+            for (std::size_t l = 0; l < nloci; ++l)
+                s.emplace_back(locus_sample(l));
             if (!nfile.empty())
                 {
                     write_mloc_sample(nfile, s, true);
@@ -174,6 +335,7 @@ namespace fwdpy
                         }
                 }
         }
+
         final_t
         final() const
         {
@@ -189,7 +351,8 @@ namespace fwdpy
             : rv(final_t()), nsam(nsam_), r(GSLrng_t(gsl_rng_get(r_))),
               nfile(neutral_file), sfile(selected_file),
               locus_boundaries(boundaries), removeFixed(rfixed),
-              recordSamples(rec_samples), recordDetails(rec_sh)
+              recordSamples(rec_samples), recordDetails(rec_sh), nodes{},
+              columns{}, next_column(0), neutral{}, selected{}
         /*!
           Note the implementation of this constructor!!
 
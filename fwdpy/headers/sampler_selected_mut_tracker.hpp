@@ -2,131 +2,19 @@
 #define FWDPY_GET_SELECTED_MUT_DATA_HPP
 #include "sampler_base.hpp"
 #include "types.hpp"
-#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 namespace fwdpy
 {
-    class selected_mut_tracker : public sampler_base
-    /*!
-      \brief A "sampler" for recording frequency trajectories of selected
-      mutations.
-      \ingroup samplers
-    */
-    {
-      public:
-        /*!
-          \brief Internal representation of mutation frequencies during a
-          simulation
-
-          \note Used in fwdpy::selected_mut_tracker
-        */
-        using trajVec = std::vector<std::pair<unsigned, double>>;
-        using posEsize = std::pair<double, double>;
-        using innerMap = std::map<posEsize, trajVec>;
-        using final_t = std::unordered_map<KTfwd::uint_t, innerMap>;
-
-        virtual void
-        operator()(const singlepop_t *pop, const unsigned generation)
-        {
-            call_operator_details(pop, generation);
-        }
-        virtual void
-        operator()(const multilocus_t *pop, const unsigned generation)
-        {
-            call_operator_details(pop, generation);
-        }
-
-        final_t
-        final() const
-        {
-            return trajectories;
-        }
-
-        explicit selected_mut_tracker() noexcept : trajectories(final_t())
-        {
-            trajectories.reserve(1000000);
-        }
-
-        final_t::const_iterator
-        begin() const
-        {
-            return this->trajectories.cbegin();
-        }
-        final_t::const_iterator
-        end() const
-        {
-            return this->trajectories.cend();
-        }
-
-      private:
-        final_t trajectories;
-        template <typename pop_t>
-        inline void
-        call_operator_details(const pop_t *pop, const unsigned generation)
-        {
-            for (std::size_t i = 0; i < pop->mcounts.size(); ++i)
-                {
-                    if (pop->mcounts[i])
-                        { // if mutation is not extinct
-                            const auto &__m = pop->mutations[i];
-                            if (!__m.neutral)
-                                {
-                                    const auto freq
-                                        = double(pop->mcounts[i])
-                                          / double(2 * pop->diploids.size());
-                                    auto __itr = trajectories.find(__m.g);
-                                    if (__itr == trajectories.end())
-                                        {
-                                            final_t::mapped_type m;
-                                            trajVec v(1, { generation, freq });
-                                            v.reserve(50);
-                                            m[{ __m.pos, __m.s }]
-                                                = std::move(v);
-                                            trajectories.emplace(__m.g,
-                                                                 std::move(m));
-                                        }
-                                    else
-                                        {
-                                            auto __ps = __itr->second.find(
-                                                { __m.pos, __m.s });
-                                            if (__ps == __itr->second.end())
-                                                {
-                                                    // update the data
-                                                    __itr->second.emplace(
-                                                        std::make_pair(__m.pos,
-                                                                       __m.s),
-                                                        std::
-                                                            vector<std::
-                                                                       pair<unsigned,
-                                                                            double>>(
-                                                                1,
-                                                                std::make_pair(
-                                                                    generation,
-                                                                    freq)));
-                                                }
-                                            else
-                                                {
-                                                    // Don't keep updating for
-                                                    // fixed
-                                                    // variants
-                                                    if (__ps->second.back()
-                                                            .second
-                                                        < 1.)
-                                                        {
-                                                            __ps->second
-                                                                .emplace_back(
-                                                                    generation,
-                                                                    freq);
-                                                        }
-                                                }
-                                        }
-                                }
-                        }
-                }
-        }
-    };
-
     using origin_filter_fxn = bool (*)(const unsigned);
     using pos_esize_filter_fxn = bool (*)(const std::pair<double, double> &);
     using freq_filter_fxn
@@ -229,6 +117,405 @@ namespace fwdpy
             return freq_filter(freqs, data);
         }
     };
+    class selected_mut_tracker : public pass_sampler
+    /*!
+      \brief A "sampler" for recording frequency trajectories of selected
+      mutations.
+      \ingroup samplers
+
+      A trajectory is identified by a mutation's generation of origin,
+      position and effect size.  Each record, one per trajectory per
+      sampled generation, is three 32-bit integers stored in columns:
+      the index of the sampled generation, the mutation's count, and
+      the trajectory's id.  The generation and number of gametes of
+      each sample are stored once, so that frequencies are
+      reconstructed exactly.
+
+      Each mutation slot of the population remembers the trajectory of
+      the mutation last seen in it.  A hash lookup is only needed when a
+      slot holds a new mutation, or when mutations have been moved, as
+      by compaction.
+
+      Filters are applied while sampling, so that rejected trajectories
+      are never kept:
+
+      1. The origin and position/effect size filters of a trajFilter are
+      applied when a mutation is first seen.  Rejected mutations are
+      not recorded.  The frequency filter of a trajFilter needs whole
+      trajectories, and is not applied here.
+
+      2. A trajectory is kept only if its frequency exceeded min_freq
+      at some sampled generation, and its last record is from a
+      generation >= existed_past.  A trajectory is decided when it is
+      last recorded: when it fixes, or at the first sampled generation
+      at which its mutation is absent.  Trajectories that fail are
+      evicted, and the storage of their records is reclaimed once
+      evicted records are half of those stored.
+
+      final() builds the nested maps used by FreqSampler and traj2sql
+      on demand.  It omits trajectories not yet decided that fail the
+      conditions in 2.
+    */
+    {
+      public:
+        /*!
+          \brief Internal representation of mutation frequencies during a
+          simulation
+
+          \note Used in fwdpy::selected_mut_tracker
+        */
+        using trajVec = std::vector<std::pair<unsigned, double>>;
+        using posEsize = std::pair<double, double>;
+        using innerMap = std::map<posEsize, trajVec>;
+        using final_t = std::unordered_map<KTfwd::uint_t, innerMap>;
+
+        virtual unsigned
+        subscriptions() const
+        {
+            return visits_mutations;
+        }
+        virtual void
+        begin_pass(const singlepop_t *pop, const unsigned g)
+        {
+            begin_details(pop, g);
+        }
+        virtual void
+        visit_mutation(const singlepop_t *pop, const std::size_t i)
+        {
+            visit_mutation_details(pop, i);
+        }
+        virtual void
+        end_pass(const singlepop_t *, const unsigned)
+        {
+            end_details();
+        }
+        virtual void
+        begin_pass(const multilocus_t *pop, const unsigned g)
+        {
+            begin_details(pop, g);
+        }
+        virtual void
+        visit_mutation(const multilocus_t *pop, const std::size_t i)
+        {
+            visit_mutation_details(pop, i);
+        }
+        virtual void
+        end_pass(const multilocus_t *, const unsigned)
+        {
+            end_details();
+        }
+
+        final_t
+        final() const
+        //! Trajectories, keyed by origin, then by position and effect size
+        {
+            final_t rv;
+            std::vector<trajVec *> dest(trajectories.size(), nullptr);
+            for (std::size_t t = 0; t < trajectories.size(); ++t)
+                {
+                    const auto &tr = trajectories[t];
+                    if (tr.evicted || !passes(tr))
+                        continue;
+                    auto &v = rv[tr.origin][{ tr.pos, tr.esize }];
+                    v.reserve(v.size() + tr.nrecords);
+                    dest[t] = &v;
+                }
+            for (std::size_t r = 0; r < record_ids.size(); ++r)
+                {
+                    auto d = dest[record_ids[r]];
+                    if (d == nullptr)
+                        continue;
+                    const auto &sample = samples[record_samples[r]];
+                    d->emplace_back(sample.generation,
+                                    double(record_counts[r])
+                                        / double(sample.twoN));
+                }
+            return rv;
+        }
+
+        std::size_t
+        ntrajectories() const noexcept
+        //! Includes evicted trajectories whose storage is not reclaimed
+        {
+            return trajectories.size();
+        }
+
+        std::size_t
+        nrecords() const noexcept
+        //! Includes records of evicted trajectories not yet reclaimed
+        {
+            return record_ids.size();
+        }
+
+        explicit selected_mut_tracker(const trajFilter *tf_ = nullptr,
+                                      const double min_freq_ = 0.,
+                                      const unsigned existed_past_ = 0)
+            /*!
+              \param tf_ Origin and position/effect size filters.  Not
+              owned, and must outlive *this.  If nullptr, all pass.
+              \param min_freq_ Keep trajectories whose frequency
+              exceeded this value.
+              \param existed_past_ Keep trajectories recorded at a
+              generation >= this value.
+            */
+            : tf(tf_),
+              min_freq(min_freq_),
+              existed_past(existed_past_),
+              samples{},
+              trajectories{},
+              record_samples{},
+              record_counts{},
+              record_ids{},
+              evicted_records(0),
+              active{},
+              alive{},
+              index{}
+        {
+        }
+
+        virtual void
+        cleanup()
+        //! The per-slot state is only needed during a simulation
+        {
+            active.clear();
+            active.shrink_to_fit();
+        }
+
+      private:
+        struct sample_t
+        {
+            unsigned generation;
+            std::uint32_t twoN;
+        };
+        struct trajectory_t
+        {
+            KTfwd::uint_t origin;
+            double pos, esize;
+            //! Greatest frequency recorded
+            double max_freq;
+            std::uint32_t nrecords;
+            //! Samples of the last record, and of the last visit
+            std::uint32_t last_record, last_seen;
+            //! fixed: no more records.  gone: mutation no longer present.
+            bool fixed, gone, evicted;
+        };
+        struct slot_t
+        //! The trajectory of the mutation last seen in a slot
+        {
+            KTfwd::uint_t origin;
+            double pos, esize;
+            std::uint32_t id;
+        };
+        //! Slot states other than a trajectory id
+        static constexpr std::uint32_t no_trajectory
+            = std::numeric_limits<std::uint32_t>::max(),
+            rejected = no_trajectory - 1;
+        struct key_hash
+        {
+            std::size_t
+            operator()(const std::tuple<KTfwd::uint_t, double, double> &k)
+                const noexcept
+            {
+                std::size_t h = std::hash<KTfwd::uint_t>()(std::get<0>(k));
+                h ^= std::hash<double>()(std::get<1>(k)) + 0x9e3779b9
+                     + (h << 6) + (h >> 2);
+                h ^= std::hash<double>()(std::get<2>(k)) + 0x9e3779b9
+                     + (h << 6) + (h >> 2);
+                return h;
+            }
+        };
+
+        const trajFilter *tf;
+        const double min_freq;
+        const unsigned existed_past;
+        std::vector<sample_t> samples;
+        std::vector<trajectory_t> trajectories;
+        //! The record columns
+        std::vector<std::uint32_t> record_samples, record_counts, record_ids;
+        std::size_t evicted_records;
+        //! Indexed by mutation slot
+        std::vector<slot_t> active;
+        //! Trajectories whose mutation was present at the last sample
+        std::vector<std::uint32_t> alive;
+        //! Keys of the trajectories in alive
+        std::unordered_map<std::tuple<KTfwd::uint_t, double, double>,
+                           std::uint32_t, key_hash>
+            index;
+
+        bool
+        passes(const trajectory_t &tr) const
+        {
+            return tr.max_freq > min_freq
+                   && samples[tr.last_record].generation >= existed_past;
+        }
+
+        void
+        evict(trajectory_t &tr)
+        {
+            tr.evicted = true;
+            evicted_records += tr.nrecords;
+        }
+
+        template <typename pop_t>
+        inline void
+        begin_details(const pop_t *pop, const unsigned g)
+        {
+            if (samples.size() >= rejected)
+                throw std::runtime_error(
+                    "selected_mut_tracker: too many samples");
+            samples.push_back(
+                sample_t{ g, std::uint32_t(2 * pop->diploids.size()) });
+            if (active.size() < pop->mcounts.size())
+                active.resize(pop->mcounts.size(),
+                              slot_t{ 0, 0., 0., no_trajectory });
+        }
+
+        std::uint32_t
+        admit(const KTfwd::uint_t origin, const double pos,
+              const double esize)
+        /*!
+          The trajectory of a mutation not remembered by its slot:
+          rejected, if filtered out, or an existing trajectory, or a
+          new one.
+        */
+        {
+            if (tf != nullptr
+                && (!tf->apply_origin_filter(origin)
+                    || !tf->apply_pos_esize_filter({ pos, esize })))
+                return rejected;
+            auto itr = index.find(std::make_tuple(origin, pos, esize));
+            if (itr != index.end())
+                return itr->second;
+            if (trajectories.size() >= rejected)
+                throw std::runtime_error(
+                    "selected_mut_tracker: too many trajectories");
+            const auto id = std::uint32_t(trajectories.size());
+            trajectories.push_back(trajectory_t{ origin, pos, esize, 0., 0,
+                                                 0, 0, false, false,
+                                                 false });
+            index.emplace(std::make_tuple(origin, pos, esize), id);
+            alive.push_back(id);
+            return id;
+        }
+
+        template <typename pop_t>
+        inline void
+        visit_mutation_details(const pop_t *pop, const std::size_t i)
+        {
+            const auto &m = pop->mutations[i];
+            if (m.neutral)
+                return;
+            auto &slot = active[i];
+            if (slot.id == no_trajectory || slot.origin != m.g
+                || slot.pos != m.pos || slot.esize != m.s)
+                {
+                    slot = slot_t{ m.g, m.pos, m.s, admit(m.g, m.pos, m.s) };
+                }
+            if (slot.id == rejected)
+                return;
+            auto &tr = trajectories[slot.id];
+            const auto current = std::uint32_t(samples.size() - 1);
+            tr.last_seen = current;
+            // Don't keep updating for fixed variants
+            if (tr.fixed || tr.evicted)
+                return;
+            const auto &sample = samples.back();
+            record_samples.push_back(current);
+            record_counts.push_back(std::uint32_t(pop->mcounts[i]));
+            record_ids.push_back(slot.id);
+            ++tr.nrecords;
+            tr.last_record = current;
+            tr.max_freq = std::max(tr.max_freq, double(pop->mcounts[i])
+                                                    / double(sample.twoN));
+            if (pop->mcounts[i] >= sample.twoN)
+                {
+                    tr.fixed = true;
+                    if (!passes(tr))
+                        evict(tr);
+                }
+        }
+
+        void
+        end_details()
+        /*!
+          Decide the trajectories whose mutations were absent from this
+          sample.
+        */
+        {
+            const auto current = std::uint32_t(samples.size() - 1);
+            std::size_t n = 0;
+            for (const auto id : alive)
+                {
+                    auto &tr = trajectories[id];
+                    if (tr.last_seen == current)
+                        {
+                            alive[n++] = id;
+                            continue;
+                        }
+                    tr.gone = true;
+                    if (!tr.fixed && !tr.evicted && !passes(tr))
+                        evict(tr);
+                    index.erase(std::make_tuple(tr.origin, tr.pos, tr.esize));
+                }
+            alive.resize(n);
+            if (evicted_records && 2 * evicted_records >= record_ids.size())
+                reclaim();
+        }
+
+        void
+        reclaim()
+        /*!
+          Remove the records of evicted trajectories, and the evicted
+          trajectories whose mutations are gone, renumbering the rest.
+        */
+        {
+            std::size_t n = 0;
+            for (std::size_t r = 0; r < record_ids.size(); ++r)
+                {
+                    if (trajectories[record_ids[r]].evicted)
+                        continue;
+                    record_samples[n] = record_samples[r];
+                    record_counts[n] = record_counts[r];
+                    record_ids[n] = record_ids[r];
+                    ++n;
+                }
+            for (auto v : { &record_samples, &record_counts, &record_ids })
+                {
+                    v->resize(n);
+                    v->shrink_to_fit();
+                }
+            evicted_records = 0;
+
+            std::vector<std::uint32_t> renumber(
+                trajectories.size(), std::uint32_t(no_trajectory));
+            n = 0;
+            for (std::size_t t = 0; t < trajectories.size(); ++t)
+                {
+                    auto &tr = trajectories[t];
+                    if (tr.evicted)
+                        {
+                            tr.nrecords = 0;
+                            if (tr.gone)
+                                continue;
+                        }
+                    renumber[t] = std::uint32_t(n);
+                    trajectories[n++] = tr;
+                }
+            trajectories.resize(n);
+            for (auto &id : record_ids)
+                id = renumber[id];
+            for (auto &id : alive)
+                id = renumber[id];
+            for (auto &i : index)
+                i.second = renumber[i.second];
+            for (auto &slot : active)
+                {
+                    if (slot.id < rejected)
+                        slot.id = renumber[slot.id];
+                }
+        }
+    };
+
     void
     traj2sql(const std::vector<std::unique_ptr<fwdpy::sampler_base>> &samplers,
              const std::shared_ptr<std::mutex> &dblock, const trajFilter *tf,
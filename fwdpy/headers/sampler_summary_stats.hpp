@@ -0,0 +1,285 @@
+/*!
+  \file sampler_summary_stats.hpp
+
+  Summary statistics of samples, computed without building the
+  samples.
+
+  Taking a sample with fwdpy::sample_n and summarizing it in Python
+  means building a string of genotypes per site.  Here, the derived
+  allele count of each mutation in a sample is found from the keys of
+  the sampled gametes, or from the ancestry tables, and the statistics
+  are computed from those counts.  Mutations are derived, so the unfolded site frequency
+  spectrum, and hence Fay and Wu's H, are available.
+*/
+#ifndef FWDPY_SAMPLER_SUMMARY_STATS_HPP
+#define FWDPY_SAMPLER_SUMMARY_STATS_HPP
+
+#include "sampler_base.hpp"
+#include "sampling_wrappers.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fwdpy
+{
+    struct summary_stats
+    /*!
+      Statistics of one class of mutations, at one locus, in the
+      sample taken at one generation.
+    */
+    {
+        unsigned generation, locus;
+        //! false for neutral mutations, true for selected ones
+        bool selected;
+        //! Number of segregating sites
+        unsigned S;
+        //! Diversity, Watterson's theta, Tajima's D, Fay and Wu's
+        //! theta_H, and H = pi - thetaH.  D is NaN when S == 0.
+        double pi, thetaw, tajimasd, thetah, faywuh;
+    };
+
+    class sample_summary_stats : public sampler_base
+    /*!
+      \brief A "sampler" that takes a sample of nsam gametes, and records
+      summary_stats for neutral and for selected mutations.
+      \ingroup samplers
+
+      Gametes are taken in pairs from nsam/2 (rounded up) diploids
+      sampled with replacement, as by sample_n.  See
+      sampling_details::draw_nodes.  For a multilocus_t, statistics
+      are recorded for each locus of the same sampled haplotypes.
+      Sites fixed in the sample are not segregating.
+
+      For a population whose ancestry is recorded, neutral sites are
+      read from the ancestry tables.  For a multilocus_t, they are
+      assigned to loci by position, which requires locus boundaries.
+    */
+    {
+      public:
+        using final_t = std::vector<summary_stats>;
+
+        virtual void
+        operator()(const singlepop_t *pop, const unsigned generation)
+        {
+            draw(pop);
+            std::vector<unsigned> neutral_counts;
+            if (!pop->ancestry.empty())
+                neutral_counts = ancestry_counts(pop, generation);
+            add_counts(pop, &gamete_t::mutations, neutral_counts);
+            record(neutral_counts, generation, 0, false);
+            std::vector<unsigned> selected_counts;
+            add_counts(pop, &gamete_t::smutations, selected_counts);
+            record(selected_counts, generation, 0, true);
+        }
+
+        virtual void
+        operator()(const multilocus_t *pop, const unsigned generation)
+        {
+            draw(pop);
+            const auto nloci = pop->diploids.empty()
+                                   ? std::size_t(0)
+                                   : pop->diploids[0].size();
+            std::vector<unsigned> neutral_counts;
+            std::vector<double> positions;
+            if (!pop->ancestry.empty())
+                {
+                    if (locus_boundaries.size() != nloci)
+                        {
+                            throw std::runtime_error(
+                                "locus boundaries are needed to sample a "
+                                "population with recorded ancestry");
+                        }
+                    neutral_counts
+                        = ancestry_counts(pop, generation, &positions);
+                }
+            std::vector<unsigned> counts;
+            for (std::size_t l = 0; l < nloci; ++l)
+                {
+                    counts.clear();
+                    for (std::size_t i = 0; i < positions.size(); ++i)
+                        {
+                            if (positions[i] >= locus_boundaries[l].first
+                                && positions[i] < locus_boundaries[l].second)
+                                counts.push_back(neutral_counts[i]);
+                        }
+                    add_counts(pop, &gamete_t::mutations, counts, l);
+                    record(counts, generation, unsigned(l), false);
+                    counts.clear();
+                    add_counts(pop, &gamete_t::smutations, counts, l);
+                    record(counts, generation, unsigned(l), true);
+                }
+        }
+
+        final_t
+        final() const
+        {
+            return rv;
+        }
+
+        explicit sample_summary_stats(
+            const unsigned nsam_, const gsl_rng *r_,
+            const std::vector<std::pair<double, double>> &boundaries
+            = std::vector<std::pair<double, double>>())
+            : rv{}, nsam(nsam_), r(GSLrng_t(gsl_rng_get(r_))),
+              locus_boundaries(boundaries), a1(0.), a2(0.), e1(0.), e2(0.),
+              nodes{}, dcount{}, touched{}
+        /*!
+          As for sample_n, the sampler's rng is seeded from r_, so
+          that it is reproducibly seeded to the extent that this
+          constructor is called in a reproducible order.
+
+          \param boundaries [first,second) position range of each
+          locus of a multilocus_t.  Only used for populations whose
+          ancestry is recorded.
+        */
+        {
+            if (nsam < 2)
+                throw std::runtime_error("sample size must be at least 2");
+            for (unsigned i = 1; i < nsam; ++i)
+                {
+                    a1 += 1. / double(i);
+                    a2 += 1. / (double(i) * double(i));
+                }
+            const double n = double(nsam);
+            const double b1 = (n + 1.) / (3. * (n - 1.)),
+                         b2 = 2. * (n * n + n + 3.) / (9. * n * (n - 1.));
+            const double c1 = b1 - 1. / a1,
+                         c2 = b2 - (n + 2.) / (a1 * n) + a2 / (a1 * a1);
+            e1 = c1 / a1;
+            e2 = c2 / (a1 * a1 + a2);
+        }
+
+      private:
+        using keys_t = std::vector<KTfwd::uint_t> gamete_t::*;
+
+        final_t rv;
+        const unsigned nsam;
+        GSLrng_t r;
+        const std::vector<std::pair<double, double>> locus_boundaries;
+        //! Constants of Tajima's D
+        double a1, a2, e1, e2;
+        //! Sampled gametes, as indexes 2 * diploid + (0 or 1)
+        std::vector<std::int32_t> nodes;
+        //! Derived allele counts, indexed by mutation key
+        std::vector<unsigned> dcount;
+        std::vector<KTfwd::uint_t> touched;
+
+        template <typename pop_t>
+        void
+        draw(const pop_t *pop)
+        {
+            if (pop->diploids.empty())
+                throw std::runtime_error("cannot sample an empty population");
+            sampling_details::draw_nodes(r.get(), pop->diploids.size(), nsam,
+                                         nodes);
+            if (dcount.size() < pop->mutations.size())
+                dcount.resize(pop->mutations.size(), 0);
+        }
+
+        void
+        count_keys(const std::vector<KTfwd::uint_t> &keys)
+        {
+            for (const auto k : keys)
+                {
+                    if (!dcount[k]++)
+                        touched.push_back(k);
+                }
+        }
+
+        void
+        collect(std::vector<unsigned> &counts)
+        //! Move the counts of segregating sites to counts, and reset
+        {
+            for (const auto k : touched)
+                {
+                    if (dcount[k] < nsam)
+                        counts.push_back(dcount[k]);
+                    dcount[k] = 0;
+                }
+            touched.clear();
+        }
+
+        void
+        add_counts(const singlepop_t *pop, keys_t keys,
+                   std::vector<unsigned> &counts)
+        {
+            for (const auto n : nodes)
+                {
+                    const auto &dip = pop->diploids[std::size_t(n / 2)];
+                    count_keys(
+                        pop->gametes[(n % 2) ? dip.second : dip.first].*keys);
+                }
+            collect(counts);
+        }
+
+        void
+        add_counts(const multilocus_t *pop, keys_t keys,
+                   std::vector<unsigned> &counts, const std::size_t locus)
+        {
+            for (const auto n : nodes)
+                {
+                    const auto &dip = pop->diploids[std::size_t(n / 2)][locus];
+                    count_keys(
+                        pop->gametes[(n % 2) ? dip.second : dip.first].*keys);
+                }
+            collect(counts);
+        }
+
+        template <typename pop_t>
+        std::vector<unsigned>
+        ancestry_counts(const pop_t *pop, const unsigned generation,
+                        std::vector<double> *positions = nullptr)
+        /*!
+          Derived counts of the segregating neutral sites in the tables,
+          and optionally their positions
+        */
+        {
+            sampling_details::check_ancestry(*pop, generation);
+            std::vector<unsigned> counts;
+            pop->ancestry.derived_counts(nodes, counts, positions);
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < counts.size(); ++i)
+                {
+                    if (counts[i] == nsam)
+                        continue;
+                    counts[kept] = counts[i];
+                    if (positions)
+                        (*positions)[kept] = (*positions)[i];
+                    ++kept;
+                }
+            counts.resize(kept);
+            if (positions)
+                positions->resize(kept);
+            return counts;
+        }
+
+        void
+        record(const std::vector<unsigned> &counts, const unsigned generation,
+               const unsigned locus, const bool selected)
+        {
+            const double n = double(nsam), denom = n * (n - 1.);
+            double pi = 0., thetah = 0.;
+            for (const auto c : counts)
+                {
+                    pi += 2. * double(c) * (n - double(c)) / denom;
+                    thetah += 2. * double(c) * double(c) / denom;
+                }
+            const double S = double(counts.size());
+            const double thetaw = S / a1;
+            const double D
+                = counts.empty()
+                      ? std::numeric_limits<double>::quiet_NaN()
+                      : (pi - thetaw) / std::sqrt(e1 * S + e2 * S * (S - 1.));
+            rv.push_back(summary_stats{ generation, locus, selected,
+                                        unsigned(counts.size()), pi, thetaw,
+                                        D, thetah, pi - thetah });
+        }
+    };
+}
+
+#endif
@@ -13,10 +13,219 @@
 #define FWDPY_SAMPLING_WRAPPERS_HPP
 
 #include "types.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <fwdpp/sugar/sampling.hpp>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace fwdpy
 {
+    namespace sampling_details
+    {
+        //! Genotypes of a sample, keyed by position
+        using site_map = std::map<double, std::string>;
+
+        template <typename F>
+        inline void
+        for_each_gamete(const singlepop_t &p, const std::int32_t node,
+                        const F &f)
+        //! Apply f to the gamete of an ancestry node
+        {
+            const auto &dip = p.diploids[std::size_t(node / 2)];
+            f(p.gametes[(node % 2) ? dip.second : dip.first]);
+        }
+
+        template <typename F>
+        inline void
+        for_each_gamete(const multilocus_t &p, const std::int32_t node,
+                        const F &f)
+        //! Apply f to the gamete of an ancestry node at each locus
+        {
+            for (const auto &dip : p.diploids[std::size_t(node / 2)])
+                f(p.gametes[(node % 2) ? dip.second : dip.first]);
+        }
+
+        inline void
+        draw_nodes(const gsl_rng *r, const std::size_t N, const unsigned nsam,
+                   std::vector<std::int32_t> &nodes)
+        /*!
+          Fill nodes with nsam gametes, as indexes 2 * diploid + (0 or
+          1), taken in pairs from nsam/2 (rounded up) of N diploids
+          sampled with replacement.
+        */
+        {
+            nodes.clear();
+            for (unsigned i = 0; i < nsam; ++i)
+                {
+                    if (!(i % 2))
+                        nodes.push_back(
+                            std::int32_t(2 * gsl_rng_uniform_int(r, N)));
+                    else
+                        nodes.push_back(nodes.back() + 1);
+                }
+        }
+
+        template <typename mcont>
+        inline void
+        add_sites(const mcont &mutations, site_map &sites,
+                  const std::vector<KTfwd::uint_t> &keys,
+                  const unsigned column, const unsigned nsam)
+        //! Mark the sites of keys as derived in column of a sample of nsam
+        {
+            for (const auto k : keys)
+                {
+                    auto &g = sites[mutations[k].pos];
+                    if (g.empty())
+                        g.assign(nsam, '0');
+                    g[column] = '1';
+                }
+        }
+
+        template <typename poptype>
+        inline void
+        check_ancestry(const poptype &p, const unsigned generation)
+        /*!
+          Throws std::runtime_error if the tables of p are not
+          simplified and mutated up to generation.
+        */
+        {
+            const auto &tables = p.ancestry;
+            if (!tables.up_to_date() || tables.generation != generation
+                || tables.nsamples != 2 * p.diploids.size())
+                {
+                    throw std::runtime_error(
+                        "recorded ancestry does not match the population");
+                }
+        }
+
+        inline void
+        remove_fixed_sites(site_map &sites, const unsigned nsam)
+        //! Remove the sites where all of a sample of nsam are derived
+        {
+            const std::string fixed(nsam, '1');
+            for (auto i = sites.begin(); i != sites.end();)
+                {
+                    if (i->second == fixed)
+                        i = sites.erase(i);
+                    else
+                        ++i;
+                }
+        }
+
+        inline std::size_t
+        locus_of(const std::vector<std::pair<double, double>> &boundaries,
+                 const double pos)
+        /*!
+          \return The locus whose [first,second) contains pos, or
+          boundaries.size() if there is none.
+        */
+        {
+            std::size_t l = 0;
+            for (; l < boundaries.size(); ++l)
+                {
+                    if (pos >= boundaries[l].first
+                        && pos < boundaries[l].second)
+                        break;
+                }
+            return l;
+        }
+    }
+
+    template <typename poptype>
+    KTfwd::sep_sample_t
+    sample_separate_ancestry(const gsl_rng *r, const poptype &p,
+                             const unsigned nsam, const bool removeFixed,
+                             const unsigned generation)
+    /*!
+      Sample from a population whose ancestry is recorded.  Neutral
+      sites come from the ancestry tables, as well as from any neutral
+      mutations carried by gametes.  For a multilocus_t, sites of all
+      loci are returned together.
+
+      nsam gametes are taken from nsam/2 (rounded up) diploids
+      sampled with replacement.  See sampling_details::draw_nodes.
+
+      \param generation The birth generation of the current diploids.
+
+      Throws std::runtime_error if the tables are not simplified and
+      mutated up to generation.
+    */
+    {
+        sampling_details::check_ancestry(p, generation);
+        sampling_details::site_map neutral, selected;
+        std::vector<std::int32_t> nodes;
+        sampling_details::draw_nodes(r, p.diploids.size(), nsam, nodes);
+        for (unsigned i = 0; i < nsam; ++i)
+            {
+                sampling_details::for_each_gamete(
+                    p, nodes[i], [&](const typename poptype::gamete_t &g) {
+                        sampling_details::add_sites(p.mutations, neutral,
+                                                    g.mutations, i, nsam);
+                        sampling_details::add_sites(p.mutations, selected,
+                                                    g.smutations, i, nsam);
+                    });
+            }
+        p.ancestry.neutral_genotypes(nodes, neutral);
+        if (removeFixed)
+            {
+                sampling_details::remove_fixed_sites(neutral, nsam);
+                sampling_details::remove_fixed_sites(selected, nsam);
+            }
+        else
+            {
+                const std::string fixed(nsam, '1');
+                for (const auto &m : p.fixations)
+                    (m.neutral ? neutral : selected)[m.pos] = fixed;
+            }
+        return KTfwd::sep_sample_t(
+            KTfwd::sample_t(neutral.begin(), neutral.end()),
+            KTfwd::sample_t(selected.begin(), selected.end()));
+    }
+
+    inline std::vector<KTfwd::sep_sample_t>
+    sample_separate_ancestry(
+        const gsl_rng *r, const multilocus_t &p, const unsigned nsam,
+        const bool removeFixed,
+        const std::vector<std::pair<double, double>> &locus_boundaries,
+        const unsigned generation)
+    /*!
+      As above, with the sites of each locus returned separately.  A
+      site belongs to the locus whose [first,second) contains it.
+
+      Throws std::runtime_error unless there is one boundary per locus.
+    */
+    {
+        if (p.diploids.empty()
+            || locus_boundaries.size() != p.diploids[0].size())
+            {
+                throw std::runtime_error(
+                    "locus boundaries are needed to sample a population "
+                    "with recorded ancestry");
+            }
+        auto s
+            = sample_separate_ancestry(r, p, nsam, removeFixed, generation);
+        std::vector<KTfwd::sep_sample_t> rv(locus_boundaries.size());
+        for (auto &site : s.first)
+            {
+                const auto l
+                    = sampling_details::locus_of(locus_boundaries, site.first);
+                if (l < rv.size())
+                    rv[l].first.push_back(std::move(site));
+            }
+        for (auto &site : s.second)
+            {
+                const auto l
+                    = sampling_details::locus_of(locus_boundaries, site.first);
+                if (l < rv.size())
+                    rv[l].second.push_back(std::move(site));
+            }
+        return rv;
+    }
+
     template <typename poptype>
     KTfwd::sample_t
     sample_single(const gsl_rng *r, const poptype &p, const unsigned nsam,
@@ -26,6 +235,25 @@ namespace fwdpy
         return KTfwd::sample(r, p, nsam, removeFixed);
     }
 
+    template <>
+    inline KTfwd::sample_t
+    sample_single<singlepop_t>(const gsl_rng *r, const singlepop_t &p,
+                               const unsigned nsam, const bool removeFixed)
+    {
+        if (p.ancestry.empty())
+            return KTfwd::sample(r, p, nsam, removeFixed);
+        auto s = sample_separate_ancestry(r, p, nsam, removeFixed,
+                                          p.generation);
+        KTfwd::sample_t rv(std::move(s.first));
+        rv.insert(rv.end(), s.second.begin(), s.second.end());
+        std::sort(rv.begin(), rv.end(),
+                  [](const KTfwd::sample_t::value_type &a,
+                     const KTfwd::sample_t::value_type &b) {
+                      return a.first < b.first;
+                  });
+        return rv;
+    }
+
     template <typename poptype>
     KTfwd::sep_sample_t
     sample_sep_single(const gsl_rng *r, const poptype &p, const unsigned nsam,
@@ -35,6 +263,18 @@ namespace fwdpy
         return KTfwd::sample_separate(r, p, nsam, removeFixed);
     }
 
+    template <>
+    inline KTfwd::sep_sample_t
+    sample_sep_single<singlepop_t>(const gsl_rng *r, const singlepop_t &p,
+                                   const unsigned nsam,
+                                   const bool removeFixed)
+    {
+        if (p.ancestry.empty())
+            return KTfwd::sample_separate(r, p, nsam, removeFixed);
+        return sample_separate_ancestry(r, p, nsam, removeFixed,
+                                        p.generation);
+    }
+
     template <typename poptype>
     std::vector<KTfwd::sample_t>
     sample_single_mloc(
@@ -46,6 +286,32 @@ namespace fwdpy
         return KTfwd::sample(r, p, nsam, removeFixed, locus_boundaries);
     }
 
+    template <>
+    inline std::vector<KTfwd::sample_t>
+    sample_single_mloc<multilocus_t>(
+        const gsl_rng *r, const multilocus_t &p, const unsigned nsam,
+        const bool removeFixed,
+        const std::vector<std::pair<double, double>> &locus_boundaries)
+    {
+        if (p.ancestry.empty())
+            return KTfwd::sample(r, p, nsam, removeFixed, locus_boundaries);
+        auto s = sample_separate_ancestry(r, p, nsam, removeFixed,
+                                          locus_boundaries, p.generation);
+        std::vector<KTfwd::sample_t> rv;
+        for (auto &si : s)
+            {
+                rv.emplace_back(std::move(si.first));
+                rv.back().insert(rv.back().end(), si.second.begin(),
+                                 si.second.end());
+                std::sort(rv.back().begin(), rv.back().end(),
+                          [](const KTfwd::sample_t::value_type &a,
+                             const KTfwd::sample_t::value_type &b) {
+                              return a.first < b.first;
+                          });
+            }
+        return rv;
+    }
+
     template <typename poptype>
     std::vector<KTfwd::sep_sample_t>
     sample_sep_single_mloc(
@@ -58,6 +324,20 @@ namespace fwdpy
         return KTfwd::sample_separate(r, p, nsam, removeFixed,
                                       locus_boundaries);
     }
+
+    template <>
+    inline std::vector<KTfwd::sep_sample_t>
+    sample_sep_single_mloc<multilocus_t>(
+        const gsl_rng *r, const multilocus_t &p, const unsigned nsam,
+        const bool removeFixed,
+        const std::vector<std::pair<double, double>> &locus_boundaries)
+    {
+        if (p.ancestry.empty())
+            return KTfwd::sample_separate(r, p, nsam, removeFixed,
+                                          locus_boundaries);
+        return sample_separate_ancestry(r, p, nsam, removeFixed,
+                                        locus_boundaries, p.generation);
+    }
 }
 
 #endif
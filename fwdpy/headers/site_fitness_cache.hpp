@@ -0,0 +1,319 @@
+#ifndef FWDPY_SITE_FITNESS_CACHE_HPP
+#define FWDPY_SITE_FITNESS_CACHE_HPP
+
+#include "fitness_kernels.hpp"
+#include "fwdpy_fitness.hpp"
+#include "mutation_effect_table.hpp"
+#include "types.hpp"
+#include <cstddef>
+#include <fwdpp/fitness_models.hpp>
+#include <vector>
+
+namespace fwdpy
+{
+    template <typename site_effects>
+    class cached_site_fitness : public singlepop_fitness
+    /*!
+      Site-dependent fitness for a single deme, using per-gamete cached
+      values.  site_effects is additive_site_effects or
+      multiplicative_site_effects.  See fitness_kernels.hpp.
+
+      Results are identical, bit for bit, to those of
+      site_dependent_fitness_wrapper with the equivalent updaters.
+      fwdpp's site_dependent_fitness applies the updaters in order of
+      position, so a cached value may only be used when it was obtained
+      by the same sequence of operations.  For each gamete, we store:
+
+      1. het, the result of applying the het. updater for each of its
+      selected mutations to the starting value.  This is the value of
+      a diploid whose other gamete carries no selected mutations.
+
+      2. hom, the same for the hom. updater.  This is the value of a
+      diploid carrying two copies of the gamete.
+
+      Otherwise, the two key lists are merged, as by fwdpp, and the
+      value recomputed.  Entries and merged values are computed by the
+      site kernels of a mutation_effect_table, which read effect sizes,
+      dominance and positions from contiguous arrays rather than from
+      the mutation objects, and call no updater through a pointer.
+
+      Entry i of the cache corresponds to pop->gametes[i].  Entries are
+      filled/invalidated by update(), which the "evolve" drivers call
+      once before the first generation and after every generation:
+
+      1. Extinct gametes may be recycled into new gametes by mutation
+      or recombination, so their entries are invalidated.
+      2. Entries for gametes that lost fixed mutations are refreshed.
+      This is detected by a change in the number of keys.
+
+      3. After compaction, or when the starting value changes, all
+      entries are discarded.  See indexes_changed() and
+      fold_fixation().
+
+      The fitness function never writes to the cache, so that it may
+      be called concurrently for different offspring.  Gametes without
+      a current entry are evaluated into scratch space instead.  The
+      chunked offspring generator calls offspring_gametes_ready() after
+      making the offspring gametes, and before evaluating the offspring
+      concurrently, which fills the entries of all of those gametes
+      serially.  See fill().
+
+      The table is synced in update(), and mutations added during a
+      generation are copied to it via mutation_added(), which the
+      "evolve" drivers call.
+
+      Folded fixations (see fold_fixation()) are applied, via the hom.
+      updater, to starting_fitness, as if they were the leftmost sites
+      of every diploid.
+    */
+    {
+      private:
+        struct cache_entry
+        {
+            //! Values of the gamete paired with itself or with no
+            //! selected mutations.
+            double het, hom;
+            //! Value of smutations.size() when the entry was filled
+            std::size_t nkeys;
+            bool valid;
+        };
+        mutable std::vector<cache_entry> cache;
+        mutable mutation_effect_table table;
+        //! starting_fitness, plus the effects of folded fixations
+        double start;
+
+        cache_entry
+        make_entry(const gamete_t &g) const noexcept
+        {
+            cache_entry e{ start, start, g.smutations.size(), true };
+            table.fold_sites(g.smutations.data(), g.smutations.size(),
+                             effects.scaling, site_effects::product, e.het,
+                             e.hom);
+            return e;
+        }
+
+        inline bool
+        is_current(const std::size_t i, const gcont_t &gametes) const
+            noexcept
+        {
+            return cache[i].valid
+                   && cache[i].nkeys == gametes[i].smutations.size();
+        }
+
+        const cache_entry &
+        fetch(const std::size_t i, const gcont_t &gametes,
+              cache_entry &scratch) const noexcept
+        {
+            if (i < cache.size() && is_current(i, gametes))
+                return cache[i];
+            scratch = make_entry(gametes[i]);
+            return scratch;
+        }
+
+        double
+        merge(const gamete_t &g1, const gamete_t &g2) const noexcept
+        /*!
+          The value of a diploid, obtained as by fwdpp's
+          site_dependent_fitness.
+        */
+        {
+            return table.fold_diploid(
+                g1.smutations.data(), g1.smutations.size(),
+                g2.smutations.data(), g2.smutations.size(), effects.scaling,
+                site_effects::product, start);
+        }
+
+        double
+        direct(const diploid_t &dip, const gcont_t &gametes,
+               const mcont_t &mutations) const noexcept
+        /*!
+          No table, for the rare cases where it is out of sync.
+        */
+        {
+            return wfinal(KTfwd::site_dependent_fitness()(
+                gametes[dip.first].smutations.cbegin(),
+                gametes[dip.first].smutations.cend(),
+                gametes[dip.second].smutations.cbegin(),
+                gametes[dip.second].smutations.cend(), mutations,
+                [this](double &w, const KTfwd::popgenmut &m) noexcept {
+                    this->effects.hom(w, m.s);
+                },
+                [this](double &w, const KTfwd::popgenmut &m) noexcept {
+                    this->effects.het(w, m.s, m.h);
+                },
+                start));
+        }
+
+        void
+        bind()
+        {
+            this->fitness_function = [this](const diploid_t &dip,
+                                             const gcont_t &gametes,
+                                             const mcont_t &mutations) {
+                return (*this)(dip, gametes, mutations);
+            };
+        }
+
+      public:
+        const site_effects effects;
+        const fitness_function_finalizer wfinal;
+        const double starting_fitness;
+
+        cached_site_fitness(const site_effects &effects_,
+                            fitness_function_finalizer wfinal_,
+                            const double starting_fitness_)
+            : singlepop_fitness(), cache{}, table{},
+              start(starting_fitness_), effects(effects_), wfinal(wfinal_),
+              starting_fitness(starting_fitness_)
+        {
+            bind();
+        }
+
+        cached_site_fitness(const cached_site_fitness &rhs)
+            : singlepop_fitness(), cache{}, table{},
+              start(rhs.starting_fitness), effects(rhs.effects),
+              wfinal(rhs.wfinal), starting_fitness(rhs.starting_fitness)
+        /*!
+          The cache, table and folded fixations are not copied, as they
+          refer to a specific population.
+        */
+        {
+            bind();
+        }
+
+        //! fitness_function refers to this object, and cannot be copied
+        cached_site_fitness &operator=(const cached_site_fitness &) = delete;
+
+        inline double
+        operator()(const diploid_t &dip, const gcont_t &gametes,
+                   const mcont_t &mutations) const noexcept
+        {
+            const auto &g1 = gametes[dip.first], &g2 = gametes[dip.second];
+            if (g1.smutations.empty() && g2.smutations.empty())
+                return wfinal(start);
+            if (table.size() != mutations.size())
+                return direct(dip, gametes, mutations);
+            cache_entry scratch;
+            if (dip.first == dip.second)
+                return wfinal(fetch(dip.first, gametes, scratch).hom);
+            if (g2.smutations.empty())
+                return wfinal(fetch(dip.first, gametes, scratch).het);
+            if (g1.smutations.empty())
+                return wfinal(fetch(dip.second, gametes, scratch).het);
+            return wfinal(merge(g1, g2));
+        }
+
+        virtual singlepop_builtin_t
+        builtin() const
+        {
+            return site_effects::builtin;
+        }
+
+        virtual bool
+        folds_fixations() const
+        {
+            return true;
+        }
+
+        virtual void
+        fold_fixation(const KTfwd::popgenmut &m)
+        {
+            effects.hom(start, m.s);
+            cache.clear();
+        }
+
+        virtual void
+        indexes_changed()
+        {
+            cache.clear();
+        }
+
+        void
+        assign_mutation(const mcont_t &mutations, const std::size_t key) const
+        //! See mutation_added()
+        {
+            table.assign(key, mutations[key]);
+        }
+
+        void
+        fill(const gcont_t &gametes, const mcont_t &mutations) const
+        /*!
+          Invalidate the entries of extinct gametes, and fill those of
+          the other gametes.  Must not be called concurrently with the
+          fitness function.
+        */
+        {
+            if (table.size() != mutations.size())
+                {
+                    cache.clear();
+                    return;
+                }
+            cache.resize(gametes.size(), cache_entry{ 0., 0., 0, false });
+            for (std::size_t i = 0; i < cache.size(); ++i)
+                {
+                    if (!gametes[i].n)
+                        cache[i].valid = false;
+                    else if (!is_current(i, gametes))
+                        cache[i] = make_entry(gametes[i]);
+                }
+        }
+
+        virtual void
+        update(const singlepop_t *pop)
+        {
+            table.sync(pop->mutations);
+            fill(pop->gametes, pop->mutations);
+        }
+
+        virtual singlepop_fitness *
+        clone() const
+        {
+            return new cached_site_fitness(*this);
+        }
+    };
+
+    template <typename site_effects>
+    inline void
+    mutation_added(const cached_site_fitness<site_effects> &fitness,
+                   const mcont_t &mutations, const std::size_t key)
+    {
+        fitness.assign_mutation(mutations, key);
+    }
+
+    template <typename site_effects>
+    inline void
+    offspring_gametes_ready(const cached_site_fitness<site_effects> &fitness,
+                            const singlepop_t &pop)
+    {
+        fitness.fill(pop.gametes, pop.mutations);
+    }
+
+    //! Site-dependent models, as exposed to Cython
+    enum site_dependent_model_t
+    {
+        additive_site_model,
+        multiplicative_site_model
+    };
+
+    inline singlepop_fitness *
+    make_cached_site_fitness(const site_dependent_model_t model,
+                             const double scaling,
+                             fitness_function_finalizer wfinal,
+                             const double starting_fitness)
+    /*!
+      Returns a new cached_site_fitness of the requested model. The
+      homozygous effect of a mutation is scaling*s.
+    */
+    {
+        if (model == multiplicative_site_model)
+            {
+                return new cached_site_fitness<multiplicative_site_effects>(
+                    multiplicative_site_effects{ scaling }, wfinal,
+                    starting_fitness);
+            }
+        return new cached_site_fitness<additive_site_effects>(
+            additive_site_effects{ scaling }, wfinal, starting_fitness);
+    }
+}
+
+#endif
@@ -7,15 +7,25 @@
 #ifndef __FWDPY_TYPES__
 #define __FWDPY_TYPES__
 
+#include "ancestry_tables.hpp"
+#include "dirty_chunks.hpp"
+#include "folded_fixations.hpp"
 #include "fwdpy_serialization.hpp"
+#include "gamete_key_arena.hpp"
+#include "reserve.hpp"
 #include <fwdpp/sugar.hpp>
 #include <fwdpp/sugar/GSLrng_t.hpp>
 #ifdef CUSTOM_DIPLOID_BASE
 #include <fwdpp/tags/diploid_tags.hpp>
 #endif
+#include <cstddef>
+#include <cstdint>
 #include <gsl/gsl_statistics_double.h>
+#include <istream>
 #include <map>
 #include <memory>
+#include <ostream>
+#include <stdexcept>
 #include <vector>
 namespace fwdpy
 {
@@ -35,6 +45,18 @@ namespace fwdpy
     //! Typedef for gamete container
     using gcont_t = std::vector<gamete_t>;
 
+#ifdef FWDPY_COMPACT_DIPLOID
+    //! Type of the indexes to gametes stored by diploids
+    using gamete_index_t = std::uint32_t;
+    //! Whether this is a FWDPY_COMPACT_DIPLOID build.  See diploid_t.
+    constexpr bool compact_diploid_layout = true;
+#else
+    //! Type of the indexes to gametes stored by diploids
+    using gamete_index_t = std::size_t;
+    //! Whether this is a FWDPY_COMPACT_DIPLOID build.  See diploid_t.
+    constexpr bool compact_diploid_layout = false;
+#endif
+
 #ifdef CUSTOM_DIPLOID_BASE
 	struct diploid_t : public KTfwd::tags::custom_diploid_t
 #else
@@ -42,16 +64,28 @@ namespace fwdpy
 #endif
     /*!
       \brief Custom diploid type.
+
+      When built with FWDPY_COMPACT_DIPLOID defined (see setup.py), the
+      gamete indexes are 32 bits, and g, e, w and label are stored
+      apart from the diploids, in the population's trait_arrays.  A
+      diploid is then 8 bytes rather than 48, which is all that
+      picking parents and making gametes read.  The number of gametes
+      must be less than 2^32, and binary output (see serialize())
+      cannot be read by a build using the other layout.
+
+      Code that must work with either layout reads and writes g, e, w
+      and label via trait_g(), trait_e(), trait_w() and trait_label().
     */
     {
-        using first_type = std::size_t;
-        using second_type = std::size_t;
+        using first_type = gamete_index_t;
+        using second_type = gamete_index_t;
         //! First gamete.  A gamete is vector<size_t> where the elements are
         //! indexes to a population's gamete container
         first_type first;
         //! Second gamete. A gamete is vector<size_t> where the elements are
         //! indexes to a population's gamete container
         second_type second;
+#ifndef FWDPY_COMPACT_DIPLOID
         //! 64 bits of data to do stuff with.  Initialized to zero upon
         //! construction
         std::size_t label;
@@ -63,22 +97,19 @@ namespace fwdpy
         double e;
         //! Fitness.  This is not necessarily written to by a simulation.
         double w;
+#endif
         //! Constructor
-        diploid_t() noexcept : first(first_type()),
-                               second(second_type()),
-                               label(0),
-                               g(0.),
-                               e(0.),
-                               w(1.)
-        {
-        }
+        diploid_t() noexcept : diploid_t(first_type(), second_type()) {}
         //! Construct from two indexes to gametes
-        diploid_t(first_type g1, first_type g2) noexcept : first(g1),
-                                                           second(g2),
-                                                           label(0),
-                                                           g(0.),
-                                                           e(0.),
-                                                           w(1.)
+        diploid_t(first_type g1, second_type g2) noexcept : first(g1),
+                                                            second(g2)
+#ifndef FWDPY_COMPACT_DIPLOID
+                                                            ,
+                                                            label(0),
+                                                            g(0.),
+                                                            e(0.),
+                                                            w(1.)
+#endif
         {
         }
     };
@@ -86,6 +117,245 @@ namespace fwdpy
     //! Typedef for container of diploids
     using dipvector_t = std::vector<diploid_t>;
 
+    // Types for multi-"locus" (multi-region) simulations
+    using multilocus_diploid_t = std::vector<diploid_t>;
+
+#ifdef FWDPY_COMPACT_DIPLOID
+    struct trait_arrays
+    /*!
+      g, e, w and label of each diploid of a population, when built
+      with FWDPY_COMPACT_DIPLOID.  Element i of each array belongs to
+      diploid i.  See diploid_t.
+    */
+    {
+        std::vector<double> g, e, w;
+        std::vector<std::size_t> label;
+
+        trait_arrays() : g{}, e{}, w{}, label{} {}
+        explicit trait_arrays(const std::size_t n)
+            : g(n, 0.), e(n, 0.), w(n, 1.), label(n, 0)
+        {
+        }
+
+        std::size_t
+        size() const noexcept
+        {
+            return w.size();
+        }
+
+        void
+        resize(const std::size_t n)
+        //! New elements take the values of a default-constructed diploid
+        {
+            g.resize(n, 0.);
+            e.resize(n, 0.);
+            w.resize(n, 1.);
+            label.resize(n, 0);
+        }
+
+        void
+        shrink_to_fit()
+        {
+            g.shrink_to_fit();
+            e.shrink_to_fit();
+            w.shrink_to_fit();
+            label.shrink_to_fit();
+        }
+
+        std::size_t
+        reserved_bytes() const noexcept
+        {
+            return (g.capacity() + e.capacity() + w.capacity())
+                       * sizeof(double)
+                   + label.capacity() * sizeof(std::size_t);
+        }
+
+        static bool
+        next_in(std::istream &i)
+        /*!
+          \return Whether the next data in i were written by write().
+          Nothing is extracted.
+        */
+        {
+            const auto start = i.tellg();
+            std::uint32_t tag = 0;
+            i.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+            const bool rv = bool(i) && tag == format_tag;
+            i.clear();
+            i.seekg(start);
+            return rv;
+        }
+
+        void
+        write(std::ostream &o) const
+        {
+            const std::uint32_t tag = format_tag;
+            const std::uint64_t n = size();
+            o.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+            o.write(reinterpret_cast<const char *>(&n), sizeof(n));
+            if (!n)
+                return;
+            o.write(reinterpret_cast<const char *>(g.data()),
+                    std::streamsize(n * sizeof(double)));
+            o.write(reinterpret_cast<const char *>(e.data()),
+                    std::streamsize(n * sizeof(double)));
+            o.write(reinterpret_cast<const char *>(w.data()),
+                    std::streamsize(n * sizeof(double)));
+            o.write(reinterpret_cast<const char *>(label.data()),
+                    std::streamsize(n * sizeof(std::size_t)));
+        }
+
+        void
+        read(std::istream &i)
+        //! Throws std::runtime_error if i does not contain the data
+        {
+            std::uint32_t tag = 0;
+            std::uint64_t n = 0;
+            i.read(reinterpret_cast<char *>(&tag), sizeof(tag));
+            if (!i || tag != format_tag)
+                throw std::runtime_error("invalid diploid trait data");
+            i.read(reinterpret_cast<char *>(&n), sizeof(n));
+            resize(std::size_t(n));
+            if (n)
+                {
+                    i.read(reinterpret_cast<char *>(g.data()),
+                           std::streamsize(n * sizeof(double)));
+                    i.read(reinterpret_cast<char *>(e.data()),
+                           std::streamsize(n * sizeof(double)));
+                    i.read(reinterpret_cast<char *>(w.data()),
+                           std::streamsize(n * sizeof(double)));
+                    i.read(reinterpret_cast<char *>(label.data()),
+                           std::streamsize(n * sizeof(std::size_t)));
+                }
+            if (!i)
+                throw std::runtime_error("invalid diploid trait data");
+        }
+
+      private:
+        static constexpr std::uint32_t format_tag = 0x44445746; // "FWDD"
+    };
+
+    //! Where a single deme's g, e, w and label are stored
+    using diploid_traits_t = trait_arrays;
+    //! Where a multilocus_t's g, e, w and label are stored
+    using mloc_traits_t = trait_arrays;
+
+    template <typename T>
+    inline auto
+    trait_g(T &traits, const std::size_t i) -> decltype((traits.g[i]))
+    //! Genetic component of trait value of diploid i
+    {
+        return traits.g[i];
+    }
+
+    template <typename T>
+    inline auto
+    trait_e(T &traits, const std::size_t i) -> decltype((traits.e[i]))
+    //! Random component of trait value of diploid i
+    {
+        return traits.e[i];
+    }
+
+    template <typename T>
+    inline auto
+    trait_w(T &traits, const std::size_t i) -> decltype((traits.w[i]))
+    //! Fitness of diploid i
+    {
+        return traits.w[i];
+    }
+
+    template <typename T>
+    inline auto
+    trait_label(T &traits, const std::size_t i)
+        -> decltype((traits.label[i]))
+    //! Label of diploid i
+    {
+        return traits.label[i];
+    }
+#else
+    //! Where a single deme's g, e, w and label are stored
+    using diploid_traits_t = dipvector_t;
+    //! Where a multilocus_t's g, e, w and label are stored.  They are
+    //! those of each diploid's first locus.
+    using mloc_traits_t = std::vector<multilocus_diploid_t>;
+
+    namespace traits_details
+    {
+        inline diploid_t &
+        holder(diploid_t &dip, const std::size_t)
+        //! A diploid holds its own traits.  The index is not used.
+        {
+            return dip;
+        }
+
+        inline const diploid_t &
+        holder(const diploid_t &dip, const std::size_t)
+        {
+            return dip;
+        }
+
+        inline diploid_t &
+        holder(dipvector_t &diploids, const std::size_t i)
+        {
+            return diploids[i];
+        }
+
+        inline const diploid_t &
+        holder(const dipvector_t &diploids, const std::size_t i)
+        {
+            return diploids[i];
+        }
+
+        inline diploid_t &
+        holder(mloc_traits_t &diploids, const std::size_t i)
+        {
+            return diploids[i][0];
+        }
+
+        inline const diploid_t &
+        holder(const mloc_traits_t &diploids, const std::size_t i)
+        {
+            return diploids[i][0];
+        }
+    }
+
+    template <typename T>
+    inline auto
+    trait_g(T &traits, const std::size_t i)
+        -> decltype((traits_details::holder(traits, i).g))
+    //! Genetic component of trait value of diploid i
+    {
+        return traits_details::holder(traits, i).g;
+    }
+
+    template <typename T>
+    inline auto
+    trait_e(T &traits, const std::size_t i)
+        -> decltype((traits_details::holder(traits, i).e))
+    //! Random component of trait value of diploid i
+    {
+        return traits_details::holder(traits, i).e;
+    }
+
+    template <typename T>
+    inline auto
+    trait_w(T &traits, const std::size_t i)
+        -> decltype((traits_details::holder(traits, i).w))
+    //! Fitness of diploid i
+    {
+        return traits_details::holder(traits, i).w;
+    }
+
+    template <typename T>
+    inline auto
+    trait_label(T &traits, const std::size_t i)
+        -> decltype((traits_details::holder(traits, i).label))
+    //! Label of diploid i
+    {
+        return traits_details::holder(traits, i).label;
+    }
+#endif
+
     //! Allows serialization of diploids.
     struct diploid_writer
     {
@@ -94,9 +364,15 @@ namespace fwdpy
         inline result_type
         operator()(const diploid_t &dip, streamtype &o) const
         {
+#ifdef FWDPY_COMPACT_DIPLOID
+            // Traits are written with a population's optional data
+            (void)dip;
+            (void)o;
+#else
             KTfwd::fwdpp_internal::scalar_writer()(o, &dip.g);
             KTfwd::fwdpp_internal::scalar_writer()(o, &dip.e);
             KTfwd::fwdpp_internal::scalar_writer()(o, &dip.w);
+#endif
         }
     };
 
@@ -108,9 +384,14 @@ namespace fwdpy
         inline result_type
         operator()(diploid_t &dip, streamtype &i) const
         {
+#ifdef FWDPY_COMPACT_DIPLOID
+            (void)dip;
+            (void)i;
+#else
             KTfwd::fwdpp_internal::scalar_reader()(i, &dip.g);
             KTfwd::fwdpp_internal::scalar_reader()(i, &dip.e);
             KTfwd::fwdpp_internal::scalar_reader()(i, &dip.w);
+#endif
         }
     };
 
@@ -157,8 +438,60 @@ namespace fwdpy
         using base = KTfwd::singlepop<KTfwd::popgenmut, diploid_t>;
         //! The current generation.  Start counting from zero
         unsigned generation;
+        //! Ancestry of the current gametes.  Empty unless the population
+        //! was evolved with evolve_options::record_ancestry set.
+        ancestry_tables ancestry;
+        //! Fixations removed from gametes by
+        //! evolve_options::fold_fixations
+        folded_fixations folded;
+        //! Re-usable storage for the keys of new gametes.  Not
+        //! serialized.
+        gamete_key_arena key_arena;
+        //! High-water marks of the containers.  Not serialized.
+        reservation_stats reservation;
+        //! Writes to diploids and mcounts, read by population_snapshot.
+        //! Writes to trait_data are recorded as writes to diploids.  Not
+        //! serialized.
+        dirty_chunks diploid_writes, mcount_writes;
+#ifdef FWDPY_COMPACT_DIPLOID
+        //! g, e, w and label of each diploid.  See traits().
+        trait_arrays trait_data;
+#endif
         //! Constructor takes number of diploids as argument
-	    explicit singlepop_t(const unsigned &N) : base(N), generation(0) {}
+        explicit singlepop_t(const unsigned &N)
+            : base(N), generation(0), ancestry{}, folded{}, key_arena{},
+              reservation{}, diploid_writes{}, mcount_writes{}
+#ifdef FWDPY_COMPACT_DIPLOID
+              ,
+              trait_data(N)
+#endif
+        {
+        }
+
+        diploid_traits_t &
+        traits()
+        /*!
+          g, e, w and label of each diploid, to be read and written via
+          trait_g() and friends.  These are the diploids themselves,
+          unless built with FWDPY_COMPACT_DIPLOID.
+        */
+        {
+#ifdef FWDPY_COMPACT_DIPLOID
+            return trait_data;
+#else
+            return diploids;
+#endif
+        }
+
+        const diploid_traits_t &
+        traits() const
+        {
+#ifdef FWDPY_COMPACT_DIPLOID
+            return trait_data;
+#else
+            return diploids;
+#endif
+        }
 
         unsigned
         gen() const
@@ -192,35 +525,90 @@ namespace fwdpy
             return int(N == diploids.size());
         }
 
+        std::string
+        optional_data() const
+        /*!
+          Ancestry tables and folded fixations, if any, and the
+          trait_data of a FWDPY_COMPACT_DIPLOID build, in the format read
+          by read_optional_data().
+        */
+        {
+            std::ostringstream buffer;
+            if (!ancestry.empty())
+                ancestry.write(buffer);
+            if (!folded.empty())
+                folded.write(buffer);
+#ifdef FWDPY_COMPACT_DIPLOID
+            trait_data.write(buffer);
+#endif
+            return buffer.str();
+        }
+
+        void
+        read_optional_data(std::istream &buffer)
+        //! Read the output of optional_data(), up to the end of buffer
+        {
+            while (buffer.peek() != std::istream::traits_type::eof())
+                {
+                    if (folded_fixations::next_in(buffer))
+                        folded.read(buffer);
+#ifdef FWDPY_COMPACT_DIPLOID
+                    else if (trait_arrays::next_in(buffer))
+                        trait_data.read(buffer);
+#endif
+                    else
+                        ancestry.read(buffer);
+                }
+        }
+
         std::string
         serialize() const
+        //! optional_data() is appended to the output.
         {
             return serialization::serialize_details(
-                this, KTfwd::mutation_writer(), fwdpy::diploid_writer());
+                       this, KTfwd::mutation_writer(),
+                       fwdpy::diploid_writer())
+                   + optional_data();
         }
 
         void
         deserialize(const std::string &s)
         {
-            *this = serialize_objects::deserialize_details<singlepop_t>()(
-                s, KTfwd::mutation_reader<singlepop_t::mutation_t>(),
-                fwdpy::diploid_reader(), 0u);
+            std::istringstream buffer(s);
+            singlepop_t pop(0u);
+            buffer.read(reinterpret_cast<char *>(&pop.generation),
+                        sizeof(unsigned));
+            KTfwd::deserialize()(
+                pop, buffer, KTfwd::mutation_reader<singlepop_t::mutation_t>(),
+                fwdpy::diploid_reader());
+            pop.read_optional_data(buffer);
+            *this = std::move(pop);
         }
 
         int
         tofile(const char *filename, bool append = false) const
+        /*!
+          optional_data() is written after the population.  See
+          serialize_objects::gzwrite_trailer.
+        */
         {
             return fwdpy::serialize_objects::gzserialize_details(
                 *this, KTfwd::mutation_writer(), fwdpy::diploid_writer(),
-                filename, append);
+                filename, append, optional_data());
         }
 
         void
         fromfile(const char *filename, std::size_t offset)
         {
-            *this = serialize_objects::gzdeserialize_details<singlepop_t>()(
-                KTfwd::mutation_reader<singlepop_t::mutation_t>(),
-                fwdpy::diploid_reader(), filename, offset, 0u);
+            std::string trailer;
+            singlepop_t pop
+                = serialize_objects::gzdeserialize_details<singlepop_t>(
+                    &trailer)(
+                    KTfwd::mutation_reader<singlepop_t::mutation_t>(),
+                    fwdpy::diploid_reader(), filename, offset, 0u);
+            std::istringstream buffer(trailer);
+            pop.read_optional_data(buffer);
+            *this = std::move(pop);
         }
     };
 
@@ -267,6 +655,11 @@ namespace fwdpy
         using base = KTfwd::metapop<KTfwd::popgenmut, diploid_t>;
         //! Current generation.  Start counting from 0
         unsigned generation;
+#ifdef FWDPY_COMPACT_DIPLOID
+        //! g, e, w and label of each deme's diploids.  Not serialized.
+        //! See traits().
+        mutable std::vector<trait_arrays> trait_data;
+#endif
         //! Constructor takes list of deme sizes are aregument
         explicit metapop_t(const std::vector<unsigned> &Ns)
             : base(&Ns[0], Ns.size()), generation(0)
@@ -280,7 +673,37 @@ namespace fwdpy
         }
 
         //! Construct from a fwdpy::singlepop_t
-        explicit metapop_t(const singlepop_t &p) : base(p), generation(p.generation) {}
+        explicit metapop_t(const singlepop_t &p)
+            : base(p), generation(p.generation)
+#ifdef FWDPY_COMPACT_DIPLOID
+              ,
+              trait_data(1, p.trait_data)
+#endif
+        {
+        }
+
+        const diploid_traits_t &
+        traits(const std::size_t deme) const
+        /*!
+          g, e, w and label of the diploids of a deme.  See
+          singlepop_t::traits().  Metapopulation simulations do not
+          assign these, so diploids keep the values of the diploid
+          that last occupied the same index of the deme.  In a
+          FWDPY_COMPACT_DIPLOID build, the values are not moved by the
+          demographic operations of metapop.hpp either.
+        */
+        {
+#ifdef FWDPY_COMPACT_DIPLOID
+            // Demes change size and number without this object being
+            // told.
+            if (trait_data.size() < diploids.size())
+                trait_data.resize(diploids.size());
+            trait_data[deme].resize(diploids[deme].size());
+            return trait_data[deme];
+#else
+            return diploids[deme];
+#endif
+        }
 
         unsigned
         gen() const
@@ -424,9 +847,6 @@ namespace fwdpy
         }
     };
 
-    // Types for multi-"locus" (multi-region) simulations
-    using multilocus_diploid_t = std::vector<diploid_t>;
-
     // Have to use fwdpy::diploid_t below, as GCC seems to get confused
     // otherwise...
     struct multilocus_t
@@ -434,10 +854,60 @@ namespace fwdpy
     {
         using base = KTfwd::multiloc<KTfwd::popgenmut, fwdpy::diploid_t>;
         unsigned generation;
+        //! Ancestry of the current gametes.  Empty unless the population
+        //! was evolved with evolve_options::record_ancestry set.  A node
+        //! is one side of a diploid: its first, or its second, gamete
+        //! at every locus.
+        ancestry_tables ancestry;
+        //! Fixations removed from gametes by
+        //! evolve_options::fold_fixations
+        folded_fixations folded;
+        //! Re-usable storage for the keys of new gametes.  Not
+        //! serialized.
+        gamete_key_arena key_arena;
+        //! High-water marks of the containers.  Not serialized.
+        reservation_stats reservation;
+        //! Writes to diploids and mcounts, read by population_snapshot.
+        //! Not serialized.
+        dirty_chunks diploid_writes, mcount_writes;
+#ifdef FWDPY_COMPACT_DIPLOID
+        //! g, e, w and label of each diploid.  See traits().
+        trait_arrays trait_data;
+#endif
         explicit multilocus_t(const unsigned N, const unsigned nloci)
-            : base(N, nloci), generation(0)
+            : base(N, nloci), generation(0), ancestry{}, folded{},
+              key_arena{}, reservation{}, diploid_writes{}, mcount_writes{}
+#ifdef FWDPY_COMPACT_DIPLOID
+              ,
+              trait_data(N)
+#endif
         {
         }
+
+        mloc_traits_t &
+        traits()
+        /*!
+          g, e, w and label of each diploid, to be read and written via
+          trait_g() and friends.  These are the diploids' first loci,
+          unless built with FWDPY_COMPACT_DIPLOID.
+        */
+        {
+#ifdef FWDPY_COMPACT_DIPLOID
+            return trait_data;
+#else
+            return diploids;
+#endif
+        }
+
+        const mloc_traits_t &
+        traits() const
+        {
+#ifdef FWDPY_COMPACT_DIPLOID
+            return trait_data;
+#else
+            return diploids;
+#endif
+        }
         unsigned
         gen() const
         {
@@ -453,35 +923,91 @@ namespace fwdpy
         {
             return int(N == diploids.size());
         }
+        std::string
+        optional_data() const
+        /*!
+          Ancestry tables and folded fixations, if any, and the
+          trait_data of a FWDPY_COMPACT_DIPLOID build, in the format read
+          by read_optional_data().
+        */
+        {
+            std::ostringstream buffer;
+            if (!ancestry.empty())
+                ancestry.write(buffer);
+            if (!folded.empty())
+                folded.write(buffer);
+#ifdef FWDPY_COMPACT_DIPLOID
+            trait_data.write(buffer);
+#endif
+            return buffer.str();
+        }
+
+        void
+        read_optional_data(std::istream &buffer)
+        //! Read the output of optional_data(), up to the end of buffer
+        {
+            while (buffer.peek() != std::istream::traits_type::eof())
+                {
+                    if (folded_fixations::next_in(buffer))
+                        folded.read(buffer);
+#ifdef FWDPY_COMPACT_DIPLOID
+                    else if (trait_arrays::next_in(buffer))
+                        trait_data.read(buffer);
+#endif
+                    else
+                        ancestry.read(buffer);
+                }
+        }
+
         std::string
         serialize() const
+        //! optional_data() is appended to the output.
         {
             return serialization::serialize_details(
-                this, KTfwd::mutation_writer(), fwdpy::diploid_writer());
+                       this, KTfwd::mutation_writer(),
+                       fwdpy::diploid_writer())
+                   + optional_data();
         }
 
         void
         deserialize(const std::string &s)
         {
-            *this = serialize_objects::deserialize_details<multilocus_t>()(
-                s, KTfwd::mutation_reader<multilocus_t::mutation_t>(),
-                fwdpy::diploid_reader(), 0u, 0u);
+            std::istringstream buffer(s);
+            multilocus_t pop(0u, 0u);
+            buffer.read(reinterpret_cast<char *>(&pop.generation),
+                        sizeof(unsigned));
+            KTfwd::deserialize()(
+                pop, buffer,
+                KTfwd::mutation_reader<multilocus_t::mutation_t>(),
+                fwdpy::diploid_reader());
+            pop.read_optional_data(buffer);
+            *this = std::move(pop);
         }
 
         int
         tofile(const char *filename, bool append = false) const
+        /*!
+          optional_data() is written after the population.  See
+          serialize_objects::gzwrite_trailer.
+        */
         {
             return fwdpy::serialize_objects::gzserialize_details(
                 *this, KTfwd::mutation_writer(), fwdpy::diploid_writer(),
-                filename, append);
+                filename, append, optional_data());
         }
 
         void
         fromfile(const char *filename, std::size_t offset)
         {
-            *this = serialize_objects::gzdeserialize_details<multilocus_t>()(
-                KTfwd::mutation_reader<multilocus_t::mutation_t>(),
-                fwdpy::diploid_reader(), filename, offset, 0u, 0u);
+            std::string trailer;
+            multilocus_t pop
+                = serialize_objects::gzdeserialize_details<multilocus_t>(
+                    &trailer)(
+                    KTfwd::mutation_reader<multilocus_t::mutation_t>(),
+                    fwdpy::diploid_reader(), filename, offset, 0u, 0u);
+            std::istringstream buffer(trailer);
+            pop.read_optional_data(buffer);
+            *this = std::move(pop);
         }
     };
 }
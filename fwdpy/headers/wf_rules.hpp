@@ -28,9 +28,11 @@ namespace fwdpy
         {
         }
 
+        using base_t::w;
+
         virtual void
-        w(const dipvector_t &diploids, gcont_t &gametes,
-          const mcont_t &mutations)
+        w(const dipvector_t &diploids, const diploid_traits_t &traits,
+          gcont_t &gametes, const mcont_t &)
         {
             index = 0; // reset this variable
             auto N_curr = diploids.size();
@@ -41,28 +43,69 @@ namespace fwdpy
                 {
                     gametes[diploids[i].first].n
                         = gametes[diploids[i].second].n = 0;
-                    fitnesses[i] = diploids[i].w;
-                    wbar += diploids[i].w;
+                    fitnesses[i] = trait_w(traits, i);
+                    wbar += fitnesses[i];
                 }
             wbar /= double(N_curr);
-            lookup = KTfwd::fwdpp_internal::gsl_ran_discrete_t_ptr(
-                gsl_ran_discrete_preproc(N_curr, &fitnesses[0]));
+            lookup.rebuild(fitnesses.data(), N_curr);
         }
 
+#ifndef FWDPY_COMPACT_DIPLOID
         //! \brief Update some property of the offspring based on properties of
         //! the parents
         virtual void
-        update(const gsl_rng *r, diploid_t &offspring, const diploid_t &,
-               const diploid_t &, const gcont_t &gametes,
+        update(const gsl_rng *r, diploid_t &offspring, const diploid_t &p1,
+               const diploid_t &p2, const gcont_t &gametes,
                const mcont_t &mutations,
                const single_region_fitness_fxn &ff) noexcept
         {
-            offspring.w = ff(offspring, gametes, mutations);
-            offspring.e = 0.0;
-            offspring.g = 0.0;
-            offspring.label = index++;
-            assert(std::isfinite(offspring.w));
-            return;
+            update_concurrent(r, index++, offspring, offspring, p1, p2,
+                              gametes, mutations, ff);
+        }
+
+        //! \brief Same as above, for the policy types defined in
+        //! fitness_kernels.hpp
+        template <typename fitness_t>
+        void
+        update(const gsl_rng *r, diploid_t &offspring, const diploid_t &p1,
+               const diploid_t &p2, const gcont_t &gametes,
+               const mcont_t &mutations, const fitness_t &ff) noexcept
+        {
+            update_concurrent(r, index++, offspring, offspring, p1, p2,
+                              gametes, mutations, ff);
+        }
+#endif
+
+        virtual void
+        update_concurrent(const gsl_rng *r, const std::size_t offspring_index,
+                          diploid_traits_t &traits,
+                          const diploid_t &offspring, const diploid_t &p1,
+                          const diploid_t &p2, const gcont_t &gametes,
+                          const mcont_t &mutations,
+                          const single_region_fitness_fxn &ff) const noexcept
+        {
+            update_concurrent<single_region_fitness_fxn>(
+                r, offspring_index, traits, offspring, p1, p2, gametes,
+                mutations, ff);
+        }
+
+        //! \brief Same as above, for the policy types defined in
+        //! fitness_kernels.hpp.  traits may also be the offspring
+        //! itself, unless built with FWDPY_COMPACT_DIPLOID.
+        template <typename fitness_t, typename traits_t>
+        void
+        update_concurrent(const gsl_rng *, const std::size_t offspring_index,
+                          traits_t &traits, const diploid_t &offspring,
+                          const diploid_t &, const diploid_t &,
+                          const gcont_t &gametes, const mcont_t &mutations,
+                          const fitness_t &ff) const noexcept
+        {
+            const std::size_t i = offspring_index;
+            trait_w(traits, i) = ff(offspring, gametes, mutations);
+            trait_e(traits, i) = 0.0;
+            trait_g(traits, i) = 0.0;
+            trait_label(traits, i) = offspring_index;
+            assert(std::isfinite(trait_w(traits, i)));
         }
     };
 }
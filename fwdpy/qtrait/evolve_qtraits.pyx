@@ -37,12 +37,13 @@ def evolve_regions_qtrait(GSLrng rng,
                           double sigmaE,
                           double optimum = 0.,
                           double f = 0.,
-                          double VS=1,):
+                          double VS=1,
+                          EvolveOptions options = None):
     """
     Evolve a quantitative trait with variable mutation, fitness effects, and recombination rates.
 
     :param rng: a :class:`GSLrng`
-    :param npops: The number of populations to simulate.  This is equal to the number of threads that will be used!
+    :param npops: The number of populations to simulate.  See :class:`fwdpy.fwdpy.EvolveOptions` for how many are run at once.
     :param N: The diploid population size to simulate
     :param nlist: An array view of a NumPy array.  This represents the population sizes over time.  The length of this view is the length of the simulation in generations. The view must be of an array of 32 bit, unsigned integers (see example).
     :param mu_neutral: The mutation rate to variants not affecting fitness ("neutral" mutations).  The unit is per gamete, per generation.
@@ -55,6 +56,7 @@ def evolve_regions_qtrait(GSLrng rng,
     :param optimum: The optimum trait value. **Default = 0.0**
     :param f: The selfing probabilty. **Default = 0.0**
     :param VS: The total variance in selection intensity. **Default = 1.0**
+    :param options: (None) A :class:`fwdpy.fwdpy.EvolveOptions`.
 
     :raises: RuntimeError if parameters do not pass checks
     """
@@ -64,7 +66,7 @@ def evolve_regions_qtrait(GSLrng rng,
     evolve_regions_qtrait_sampler_fitness(rng,pops,donothing,fitness,nlist,
                                           mu_neutral,mu_selected,recrate,
                                           nregions,sregions,recregions,
-                                          len(nlist),sigmaE,optimum,f,VS)
+                                          len(nlist),sigmaE,optimum,f,VS,options)
                                           
     return pops
 
@@ -80,18 +82,19 @@ def evolve_regions_qtrait_more(GSLrng rng,
                                double sigmaE,
                                double optimum = 0.,
                                double f = 0.,
-                               double VS=1,):
+                               double VS=1,
+                               EvolveOptions options = None):
     donothing = NothingSampler(len(pops))
     fitness = SpopAdditiveTrait()
     evolve_regions_qtrait_sampler_fitness(rng,pops,donothing,fitness,nlist,
                                           mu_neutral,mu_selected,recrate,
                                           nregions,sregions,recregions,
-                                          len(nlist),sigmaE,optimum,f,VS)
+                                          len(nlist),sigmaE,optimum,f,VS,options)
 
 @cython.boundscheck(False)
 def evolve_regions_qtrait_sampler(GSLrng rng,
                                   SpopVec pops,
-                                  TemporalSampler slist,
+                                  slist,
                                   unsigned[:] nlist,
                                   double mu_neutral,
                                   double mu_selected,
@@ -103,17 +106,18 @@ def evolve_regions_qtrait_sampler(GSLrng rng,
                                   double sigmaE,
                                   double optimum = 0.0,
                                   double f = 0,
-                                  double VS = 1.0):
+                                  double VS = 1.0,
+                                  EvolveOptions options = None):
     fitness = SpopAdditiveTrait()
     evolve_regions_qtrait_sampler_fitness(rng,pops,slist,fitness,nlist,
                                           mu_neutral,mu_selected,recrate,
                                           nregions,sregions,recregions,
-                                          sample,sigmaE,optimum,f,VS)
+                                          sample,sigmaE,optimum,f,VS,options)
     
 @cython.boundscheck(False)
 def evolve_regions_qtrait_sampler_fitness(GSLrng rng,
                                           SpopVec pops,
-                                          TemporalSampler slist,
+                                          slist,
                                           SpopFitness fitness_function,
                                           unsigned[:] nlist,
                                           double mu_neutral,
@@ -126,7 +130,8 @@ def evolve_regions_qtrait_sampler_fitness(GSLrng rng,
                                           double sigmaE,
                                           double optimum = 0.0,
                                           double f = 0,
-                                          double VS = 1.0):
+                                          double VS = 1.0,
+                                          EvolveOptions options = None):
     fwdpy.check_input_params(mu_neutral,mu_selected,recrate,nregions,sregions,recregions)
     if isinstance(fitness_function,SpopGBRTrait):
         check_gbr_sdist(sregions)
@@ -137,6 +142,9 @@ def evolve_regions_qtrait_sampler_fitness(GSLrng rng,
         f=0
     rmgr = region_manager_wrapper()
     internal.make_region_manager(rmgr,nregions,sregions,recregions)
+    if options is None:
+        options = EvolveOptions()
     cdef size_t listlen = len(nlist)
+    cdef TemporalSampler sampler = slist if isinstance(slist,TemporalSampler) else CompositeSampler(slist)
     evolve_regions_qtrait_cpp(rng.thisptr,pops.pops,
-                              slist.vec,&nlist[0],listlen,mu_neutral,mu_selected,recrate,f,sigmaE,optimum,VS,sample,rmgr.thisptr,deref(fitness_function.wfxn.get()))
+                              sampler.vec,&nlist[0],listlen,mu_neutral,mu_selected,recrate,f,sigmaE,optimum,VS,sample,rmgr.thisptr,deref(fitness_function.wfxn.get()),options.opts)
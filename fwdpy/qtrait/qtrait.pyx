@@ -22,22 +22,33 @@ cdef class SpopGBRTrait(SpopFitness):
     .. note:: Be really careful with this one!  Fitnesses are undefined if the sum of effect sizes on a haplotype is :math:`< 0:`.  The intended use case is to calculate a trait value under models with effect sizes :math:`>0`.
     """ 
     def __cinit__(self):
-        self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(sum_haplotype_effects,
-                                                                      	geomean))
+        self.wfxn = unique_ptr[singlepop_fitness](<singlepop_fitness*>new singlepop_gbr_trait())
 
 cdef class SpopAdditiveTrait(SpopFitness):
-    def __cinit__(self,int scaling = 2):
-        self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_additive_update,
-                                                                        choose_additive_hom_updater(scaling),
-                                                                        return_trait_value,
-                                                                        0.0))
+    def __cinit__(self,int scaling = 2,bint cache = True):
+        if not cache:
+            self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_additive_update,
+                                                                            choose_additive_hom_updater(scaling),
+                                                                            return_trait_value,
+                                                                            0.0))
+            return
+        self.wfxn = unique_ptr[singlepop_fitness](make_cached_site_fitness(additive_site_model,
+                                                                          choose_hom_scaling(scaling),
+                                                                          return_trait_value,
+                                                                          0.0))
 
 cdef class SpopMultTrait(SpopFitness):
-    def __cinit__(self,int scaling = 2):
-        self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_mult_update,
-                                                                        choose_mult_hom_updater(scaling),
-                                                                        return_trait_value_minus1,
-                                                                        1.0))
+    def __cinit__(self,int scaling = 2,bint cache = True):
+        if not cache:
+            self.wfxn = unique_ptr[singlepop_fitness](new singlepop_fitness(het_mult_update,
+                                                                            choose_mult_hom_updater(scaling),
+                                                                            return_trait_value_minus1,
+                                                                            1.0))
+            return
+        self.wfxn = unique_ptr[singlepop_fitness](make_cached_site_fitness(multiplicative_site_model,
+                                                                          choose_hom_scaling(scaling),
+                                                                          return_trait_value_minus1,
+                                                                          1.0))
 
 cdef extern from "qtrait_evolve_rules.hpp" namespace "fwdpy::qtrait" nogil:
     cdef cppclass qtrait_model_rules:
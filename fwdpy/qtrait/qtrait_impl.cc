@@ -16,14 +16,17 @@
 #include <gsl/gsl_statistics_double.h>
 #include <limits>
 #include <memory>
-#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "fitness_dispatch.hpp"
 #include "internal_region_manager.hpp"
 #include "qtrait_details.hpp"
 #include "qtrait_evolve.hpp"
 #include "qtrait_evolve_rules.hpp"
+#include "replicate_admission.hpp"
+#include "replicate_scheduler.hpp"
 #include "sampler_additive_variance.hpp"
 #include "sampler_no_sampling.hpp"
 #include "types.hpp"
@@ -36,6 +39,57 @@ namespace fwdpy
 {
     namespace qtrait
     {
+        struct evolve_regions_qtrait_visitor
+        /*!
+          Calls evolve_regions_qtrait_sampler_cpp_details for one
+          replicate, with the fitness model's concrete type.  See
+          fitness_dispatch.hpp.
+        */
+        {
+            singlepop_t *pop;
+            const rng_stream_key stream;
+            const unsigned *Nvector;
+            const size_t Nvector_len;
+            const double neutral, selected, recrate, f, sigmaE, optimum, VS;
+            std::unique_ptr<singlepop_fitness> &fitness;
+            const int interval;
+            const internal::region_manager *rm;
+            sampler_base &s;
+            const qtrait_model_rules &rules;
+            const evolve_options &options;
+
+            template <typename fitness_t>
+            void
+            operator()(const fitness_t &ff) const
+            {
+                if (options.fold_fixations)
+                    run(ff, std::true_type(),
+                        fold_into_fitness{ fitness.get() });
+                else
+                    run(ff, KTfwd::remove_neutral(),
+                        retain_selected_fixations());
+            }
+
+            template <typename fitness_t, typename removal_policy,
+                      typename folder_t>
+            void
+            run(const fitness_t &ff, const removal_policy &remove_fixed,
+                const folder_t &folder) const
+            {
+                evolve_regions_qtrait_sampler_cpp_details(
+                    pop, stream, Nvector, Nvector_len, neutral, selected,
+                    recrate, f, sigmaE, optimum, VS, fitness, ff, interval,
+                    KTfwd::extensions::discrete_mut_model(
+                        rm->nb, rm->ne, rm->nw, rm->sb, rm->se, rm->sw,
+                        rm->callbacks),
+                    KTfwd::extensions::discrete_rec_model(rm->rb, rm->rw,
+                                                          rm->rw),
+                    ancestry_neutral_model{ neutral, rm->nb, rm->ne, rm->nw },
+                    s, qtrait_model_rules(rules), options, remove_fixed,
+                    folder);
+            }
+        };
+
         void
         evolve_regions_qtrait_cpp(
             GSLrng_t *rng, std::vector<std::shared_ptr<singlepop_t>> &pops,
@@ -45,7 +99,7 @@ namespace fwdpy
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
             const internal::region_manager *rm,
-            const singlepop_fitness &fitness)
+            const singlepop_fitness &fitness, const evolve_options &options)
         {
             if (neutral < 0. || selected < 0. || recrate < 0.)
                 {
@@ -64,52 +118,37 @@ namespace fwdpy
             if (interval < 0)
                 throw std::runtime_error(
                     "sampling interval must be non-negative");
+            if (options.fold_fixations && !fitness.folds_fixations())
+                throw std::runtime_error(
+                    "fold_fixations is not supported by this trait model");
+            check_compaction_options(options);
+            check_reservation_options(options);
+            check_ancestry_options(options, pops);
             qtrait_model_rules rules(
                 sigmaE, optimum, VS,
                 *std::max_element(Nvector, Nvector + Nvector_length));
-            if (pops.size() > 1)
-                {
-                    std::vector<std::thread> threads;
-                    std::vector<std::unique_ptr<singlepop_fitness>> fitnesses;
-                    for (std::size_t i = 0; i < pops.size(); ++i)
-                        {
-                            fitnesses.emplace_back(
-                                std::unique_ptr<singlepop_fitness>(
-                                    fitness.clone()));
-                        }
-                    for (std::size_t i = 0; i < pops.size(); ++i)
-                        {
-                            threads.emplace_back(std::thread(
-                                evolve_regions_qtrait_sampler_cpp_details<qtrait_model_rules>,
-                                pops[i].get(), gsl_rng_get(rng->get()),
-                                Nvector, Nvector_length, neutral, selected,
-                                recrate, f, sigmaE, optimum, VS,
-                                std::ref(fitnesses[i]), interval,
-                                KTfwd::extensions::discrete_mut_model(
-                                    rm->nb, rm->ne, rm->nw, rm->sb, rm->se,
-                                    rm->sw, rm->callbacks),
-                                KTfwd::extensions::discrete_rec_model(
-                                    rm->rb, rm->rw, rm->rw),
-                                std::ref(*samplers[i]), rules));
-                        }
-                    for (auto &t : threads)
-                        t.join();
-                }
-            else
+            std::vector<std::unique_ptr<singlepop_fitness>> fitnesses;
+            for (std::size_t i = 0; i < pops.size(); ++i)
                 {
-                    auto fitness_ptr
-                        = std::unique_ptr<singlepop_fitness>(fitness.clone());
-                    evolve_regions_qtrait_sampler_cpp_details<qtrait_model_rules>(
-                        pops[0].get(), gsl_rng_get(rng->get()), Nvector,
-                        Nvector_length, neutral, selected, recrate, f, sigmaE,
-                        optimum, VS, std::ref(fitness_ptr), interval,
-                        KTfwd::extensions::discrete_mut_model(
-                            rm->nb, rm->ne, rm->nw, rm->sb, rm->se, rm->sw,
-                            rm->callbacks),
-                        KTfwd::extensions::discrete_rec_model(rm->rb, rm->rw,
-                                                              rm->rw),
-                        std::ref(*samplers[0]), std::move(rules));
+                    fitnesses.emplace_back(
+                        std::unique_ptr<singlepop_fitness>(fitness.clone()));
                 }
+            const auto streams
+                = draw_replicate_streams(rng->get(), pops.size());
+            replicate_scheduler scheduler(
+                replicate_worker_count(options.nthreads, pops.size()));
+            run_admitted(scheduler, pops, Nvector, Nvector_length,
+                         (options.record_ancestry ? 0. : neutral) + selected,
+                         options,
+                         [&](const std::size_t i) {
+                visit_singlepop_fitness(
+                    *fitnesses[i],
+                    evolve_regions_qtrait_visitor{
+                        pops[i].get(), streams[i], Nvector, Nvector_length,
+                        neutral, selected, recrate, f, sigmaE, optimum, VS,
+                        fitnesses[i], interval, rm, *samplers[i], rules,
+                        options });
+            });
         }
     } // ns qtrait
 } // ns fwdpy
@@ -57,7 +57,8 @@ cdef extern from "qtrait_evolve_mlocus.hpp" namespace "fwdpy::qtrait" nogil:
 			         const double optimum,
 			         const double VS,
                                  const int sample,
-			         const multilocus_fitness & fitness ) except +
+			         const multilocus_fitness & fitness,
+			         const evolve_options & options) except +
 
     void evolve_qtrait_mloc_regions_cpp(GSLrng_t *rng,
             vector[shared_ptr[multilocus_t]] *pops,
@@ -67,6 +68,7 @@ cdef extern from "qtrait_evolve_mlocus.hpp" namespace "fwdpy::qtrait" nogil:
             const vector[double] &between_region_rec_rates,
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
-            const multilocus_fitness &fitness) except +
+            const multilocus_fitness &fitness,
+            const evolve_options & options) except +
     
 include "evolve_qtraits_mloc.pyx"
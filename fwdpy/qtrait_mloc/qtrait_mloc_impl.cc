@@ -7,13 +7,15 @@
 #include <gsl/gsl_statistics_double.h>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <set>
-#include <thread>
 #include <utility>
 #include <vector>
 
 #include "qtrait_evolve_mlocus.hpp"
 #include "qtrait_mloc_rules.hpp"
+#include "replicate_admission.hpp"
+#include "replicate_scheduler.hpp"
 #include "types.hpp"
 
 using namespace std;
@@ -34,7 +36,7 @@ namespace fwdpy
             const std::vector<double> &between_region_rec_rates,
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
-            const multilocus_fitness &fitness)
+            const multilocus_fitness &fitness, const evolve_options &options)
         {
             std::set<std::size_t> vec_sizes{ neutral_mutation_rates.size(),
                                              selected_mutation_rates.size(),
@@ -67,48 +69,45 @@ namespace fwdpy
                     throw std::runtime_error(
                         "sampling interval must be non-negative");
                 }
+            if (options.fold_fixations
+                && fitness.builtin != mloc_builtin_t::additive_trait)
+                {
+                    throw std::runtime_error("fold_fixations is only "
+                                             "supported by the additive "
+                                             "trait model");
+                }
+            check_compaction_options(options);
+            check_reservation_options(options);
+            check_ancestry_options(options, *pops);
             qtrait_mloc_rules rules(
                 sigmaE, optimum, VS,
                 *std::max_element(Nvector, Nvector + Nvector_length));
-            if (pops->size() > 1)
-                {
-                    std::vector<std::thread> threads;
-                    std::vector<std::unique_ptr<multilocus_fitness>> fitnesses;
-                    for (std::size_t i = 0; i < pops->size(); ++i)
-                        {
-                            fitnesses.emplace_back(
-                                std::unique_ptr<multilocus_fitness>(
-                                    fitness.clone()));
-                        }
-                    for (std::size_t i = 0; i < pops->size(); ++i)
-                        {
-                            threads.emplace_back(std::thread(
-                                evolve_qtrait_mloc_cpp_details<qtrait_mloc_rules>,
-                                pops->operator[](i).get(),
-                                std::ref(fitnesses[i]), std::ref(*samplers[i]),
-                                gsl_rng_get(rng->get()), Nvector,
-                                Nvector_length, neutral_mutation_rates,
-                                selected_mutation_rates, shmodels,
-                                within_region_rec_rates,
-                                between_region_rec_rates, f, interval, rules));
-                        }
-                    for (auto &t : threads)
-                        {
-                            t.join();
-                        }
-                }
-            else
+            std::vector<std::unique_ptr<multilocus_fitness>> fitnesses;
+            for (std::size_t i = 0; i < pops->size(); ++i)
                 {
-                    auto fitness_clone
-                        = std::unique_ptr<multilocus_fitness>(fitness.clone());
-                    evolve_qtrait_mloc_cpp_details<qtrait_mloc_rules>(
-                        pops->operator[](0).get(), fitness_clone, *samplers[0],
-                        gsl_rng_get(rng->get()), Nvector, Nvector_length,
-                        neutral_mutation_rates, selected_mutation_rates,
-                        shmodels, within_region_rec_rates,
-                        between_region_rec_rates, f, interval,
-                        std::move(rules));
+                    fitnesses.emplace_back(
+                        std::unique_ptr<multilocus_fitness>(fitness.clone()));
                 }
+            const auto streams
+                = draw_replicate_streams(rng->get(), pops->size());
+            replicate_scheduler scheduler(
+                replicate_worker_count(options.nthreads, pops->size()));
+            const double mu_tot
+                = (options.record_ancestry
+                       ? 0.
+                       : std::accumulate(neutral_mutation_rates.begin(),
+                                         neutral_mutation_rates.end(), 0.))
+                  + std::accumulate(selected_mutation_rates.begin(),
+                                    selected_mutation_rates.end(), 0.);
+            run_admitted(scheduler, *pops, Nvector, Nvector_length, mu_tot,
+                         options, [&](const std::size_t i) {
+                evolve_qtrait_mloc_cpp_details(
+                    pops->operator[](i).get(), fitnesses[i], *samplers[i],
+                    streams[i], Nvector, Nvector_length, neutral_mutation_rates,
+                    selected_mutation_rates, shmodels, within_region_rec_rates,
+                    between_region_rec_rates, f, interval, options,
+                    qtrait_mloc_rules(rules));
+            });
         }
 
         void
@@ -120,7 +119,7 @@ namespace fwdpy
             const std::vector<double> &between_region_rec_rates,
             const double f, const double sigmaE, const double optimum,
             const double VS, const int interval,
-            const multilocus_fitness &fitness)
+            const multilocus_fitness &fitness, const evolve_options &options)
         {
             if (samplers.size() != pops->size())
                 {
@@ -137,44 +136,44 @@ namespace fwdpy
                     throw std::runtime_error(
                         "sampling interval must be non-negative");
                 }
+            if (options.fold_fixations
+                && fitness.builtin != mloc_builtin_t::additive_trait)
+                {
+                    throw std::runtime_error("fold_fixations is only "
+                                             "supported by the additive "
+                                             "trait model");
+                }
+            check_compaction_options(options);
+            check_reservation_options(options);
+            check_ancestry_options(options, *pops);
+            if (options.record_ancestry)
+                locus_starts(rm); // Throws if loci overlap
             qtrait_mloc_rules rules(
                 sigmaE, optimum, VS,
                 *std::max_element(Nvector, Nvector + Nvector_length));
-            if (pops->size() > 1)
-                {
-                    std::vector<std::thread> threads;
-                    std::vector<std::unique_ptr<multilocus_fitness>> fitnesses;
-                    for (std::size_t i = 0; i < pops->size(); ++i)
-                        {
-                            fitnesses.emplace_back(
-                                std::unique_ptr<multilocus_fitness>(
-                                    fitness.clone()));
-                        }
-                    for (std::size_t i = 0; i < pops->size(); ++i)
-                        {
-                            threads.emplace_back(std::thread(
-                                evolve_qtrait_mloc_regions_cpp_details<qtrait_mloc_rules>,
-                                pops->operator[](i).get(),
-                                std::ref(fitnesses[i]), std::ref(*samplers[i]),
-                                gsl_rng_get(rng->get()), Nvector,
-                                Nvector_length, rm, between_region_rec_rates,
-                                f, interval, rules));
-                        }
-                    for (auto &t : threads)
-                        {
-                            t.join();
-                        }
-                }
-            else
+            std::vector<std::unique_ptr<multilocus_fitness>> fitnesses;
+            for (std::size_t i = 0; i < pops->size(); ++i)
                 {
-                    auto fitness_clone
-                        = std::unique_ptr<multilocus_fitness>(fitness.clone());
-                    evolve_qtrait_mloc_regions_cpp_details<qtrait_mloc_rules>(
-                        pops->operator[](0).get(), fitness_clone, *samplers[0],
-                        gsl_rng_get(rng->get()), Nvector, Nvector_length, rm,
-                        between_region_rec_rates, f, interval,
-                        std::move(rules));
+                    fitnesses.emplace_back(
+                        std::unique_ptr<multilocus_fitness>(fitness.clone()));
                 }
+            const auto streams
+                = draw_replicate_streams(rng->get(), pops->size());
+            replicate_scheduler scheduler(
+                replicate_worker_count(options.nthreads, pops->size()));
+            const double mu_tot
+                = (options.record_ancestry
+                       ? 0.
+                       : std::accumulate(rm->nw.begin(), rm->nw.end(), 0.))
+                  + std::accumulate(rm->sw.begin(), rm->sw.end(), 0.);
+            run_admitted(scheduler, *pops, Nvector, Nvector_length, mu_tot,
+                         options, [&](const std::size_t i) {
+                evolve_qtrait_mloc_regions_cpp_details(
+                    pops->operator[](i).get(), fitnesses[i], *samplers[i],
+                    streams[i], Nvector, Nvector_length, rm,
+                    between_region_rec_rates, f, interval, options,
+                    qtrait_mloc_rules(rules));
+            });
         }
     }
 }
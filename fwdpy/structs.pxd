@@ -22,6 +22,13 @@ cdef extern from "sampler_pop_properties.hpp" namespace "fwdpy" nogil:
         double value
         unsigned generation
 
+cdef extern from "sampler_summary_stats.hpp" namespace "fwdpy" nogil:
+    cdef struct summary_stats:
+        unsigned generation, locus
+        bint selected
+        unsigned S
+        double pi, thetaw, tajimasd, thetah, faywuh
+
 cdef extern from "sampler_additive_variance.hpp" namespace "fwdpy" nogil:
     cdef struct VAcum:
         double freq
@@ -133,6 +133,49 @@ cdef class PopSampler(TemporalSampler):
     def __len__(self):
         return self.vec.size()
 
+cdef class SummaryStatsSampler(TemporalSampler):
+    """
+    A :class:`fwdpy.fwdpy.TemporalSampler` that takes a sample of size :math:`n \leq N` from the population
+    and records summary statistics of it.
+
+    The statistics are computed in C++ from the derived allele counts in the sample,
+    so no genotype strings are built.  For each generation, one row is recorded for
+    neutral and one for selected mutations, for each locus of a multi-locus population.
+    The columns are generation, locus, selected, S (the number of segregating sites),
+    pi, thetaw, tajimasd, thetah, and faywuh (:math:`\pi - \theta_H`).  Tajima's D
+    is NaN when S is 0.
+
+    This type is a model of an iterable container.  Return values are pandas.DataFrame
+    objects, and may be either yielded or accessed via [i].
+    """
+    def __cinit__(self, unsigned n, unsigned nsam, GSLrng rng, boundaries=None):
+        """
+        Constructor
+
+        :param n: A length.  Must correspond to number of simulations that will be run simultaneously.
+        :param nsam: The sample size to take.  Must be at least 2.
+        :param rng: A :class:`fwdpy.fwdpy.GSLrng`
+        :param boundaries: (None) For a multi-locus simulation recording ancestry, a list of
+            tuples specifying the positional boundaries of each locus.
+        """
+        cdef vector[pair[double,double]] locus_boundaries
+        if boundaries is not None:
+            locus_boundaries=boundaries
+        for i in range(n):
+            self.vec.push_back(<unique_ptr[sampler_base]>unique_ptr[sample_summary_stats](new
+                sample_summary_stats(nsam,rng.thisptr.get(),locus_boundaries)))
+    def __iter__(self):
+        for i in range(self.vec.size()):
+            yield pandas.DataFrame((<sample_summary_stats*>self.vec[i].get()).final())
+    def __next__(self):
+        return next(self)
+    def __getitem__(self, int i):
+        if i>= self.vec.size():
+            raise IndexError("index out of range")
+        return pandas.DataFrame((<sample_summary_stats*>self.vec[i].get()).final())
+    def __len__(self):
+        return self.vec.size()
+
 cdef class VASampler(TemporalSampler):
     """
     A :class:`fwdpy.fwdpy.TemporalSampler` that estimates the relationship between mutation frequency and total additive
@@ -210,15 +253,31 @@ cdef class FreqSampler(TemporalSampler):
 
     This type is a model of an iterable container.  Return values may be either yielded
     or accessed via [i].
+
+    Filters given to the constructor are applied during the simulation, so that
+    trajectories that are filtered out are not kept in memory.
+
+    .. note:: Only the origin and position/effect size filters of traj_filter are applied
+        during the simulation.  Filters on whole trajectories, such as
+        :class:`fwdpy.fwdpy.TrajExistedPast`, are applied by passing them to
+        :py:meth:`~fwdpy.fwdpy.FreqSampler.to_sql`.  Use existed_past instead
+        to apply that filter during the simulation.
     """
-    def __cinit__(self,unsigned n):
+    def __cinit__(self,unsigned n,TrajFilter traj_filter=None,double min_freq=0.,unsigned existed_past=0):
         """
         Constructor
         
         :param n: A length.  Must correspond to number of simulations that will be run simultaneously.
+        :param traj_filter: (None) A :class:`fwdpy.fwdpy.TrajFilter`.  Mutations whose origin or position/effect size are rejected by it are not tracked.
+        :param min_freq: (0) Only keep trajectories whose frequency exceeded this value at some sampled generation.
+        :param existed_past: (0) Only keep trajectories that were recorded at a generation >= this value.
         """
+        self.traj_filter = traj_filter
+        cdef const trajFilter * tf = NULL
+        if traj_filter is not None:
+            tf = traj_filter.tf.get()
         for i in range(n):
-            self.vec.push_back(<unique_ptr[sampler_base]>unique_ptr[selected_mut_tracker](new selected_mut_tracker()))
+            self.vec.push_back(<unique_ptr[sampler_base]>unique_ptr[selected_mut_tracker](new selected_mut_tracker(tf,min_freq,existed_past)))
     def __convert_data__(self,dict raw,origin_filter=None,pos_esize_filter=None,freq_filter=None):
         temp=[] #list of dicts with named stuff for pands
         for origin in raw:
@@ -291,45 +350,94 @@ cdef class FreqSampler(TemporalSampler):
                 dbname,threshold,label,onedb,append)
 
 
-def apply_sampler(PopVec pops,TemporalSampler sampler):
+cdef class CompositeSampler(TemporalSampler):
+    """
+    A :class:`fwdpy.fwdpy.TemporalSampler` that applies several samplers at once.
+
+    The samplers are applied to the same population, at the same generations.
+    :class:`fwdpy.fwdpy.FreqSampler` and :class:`fwdpy.fwdpy.QtraitStatsSampler`
+    share a single pass over a population's mutations and diploids, rather than
+    each making their own.  Others are applied in turn.
+
+    Data are retrieved from the samplers passed to the constructor, which are kept
+    in the samplers attribute.  Do not call force_clear on them while they are in use.
+
+    .. note:: The "evolve" functions taking a sampler also accept a list of samplers,
+        which is converted to a CompositeSampler.
+
+    Example:
+
+    >>> import fwdpy
+    >>> freqs = fwdpy.FreqSampler(4)
+    >>> stats = fwdpy.QtraitStatsSampler(4,0.0)
+    >>> sampler = fwdpy.CompositeSampler([freqs,stats])
+    """
+    def __cinit__(self, list samplers):
+        """
+        Constructor
+
+        :param samplers: A list of :class:`fwdpy.fwdpy.TemporalSampler`.  All must have the same length.
+        """
+        cdef size_t j
+        if len(samplers) == 0:
+            raise ValueError("CompositeSampler: empty list of samplers")
+        for i in samplers:
+            if not isinstance(i,TemporalSampler):
+                raise TypeError("CompositeSampler: expecting a list of TemporalSampler")
+            if (<TemporalSampler>i).vec.size() != (<TemporalSampler>samplers[0]).vec.size():
+                raise ValueError("CompositeSampler: samplers must be equal in length")
+        self.samplers = list(samplers)
+        for j in range((<TemporalSampler>samplers[0]).vec.size()):
+            self.vec.push_back(<unique_ptr[sampler_base]>unique_ptr[composite_sampler](new composite_sampler()))
+            for i in samplers:
+                (<composite_sampler*>(self.vec.back().get())).add((<TemporalSampler>i).vec[j].get())
+    def __len__(self):
+        return self.vec.size()
+    def __dealloc__(self):
+        #Clear the composites before the samplers they refer to
+        clear_samplers(self.vec)
+
+def apply_sampler(PopVec pops,sampler):
     """
     Apply a temporal sampler to a container of populations.
 
     :param pops: A :class:`fwdpy.fwdpy.PopVec`
-    :param sampler: A :class:`fwdpy.fwdpy.TemporalSampler`
+    :param sampler: A :class:`fwdpy.fwdpy.TemporalSampler`, or a list of them (see :class:`fwdpy.fwdpy.CompositeSampler`)
 
     :return: Nothing
     """
 
     if not isinstance(pops,PopVec):
         raise TypeError("Expecting PopVec.")
+    cdef TemporalSampler s = sampler if isinstance(sampler,TemporalSampler) else CompositeSampler(sampler)
 
     if isinstance(pops,SpopVec):
-        apply_sampler_cpp[singlepop_t]((<SpopVec>pops).pops,sampler.vec)
+        apply_sampler_cpp[singlepop_t]((<SpopVec>pops).pops,s.vec)
     elif isinstance(pops,MetaPopVec):
-        apply_sampler_cpp[metapop_t]((<MetaPopVec>pops).mpops,sampler.vec)
+        apply_sampler_cpp[metapop_t]((<MetaPopVec>pops).mpops,s.vec)
     elif isinstance(pops,MlocusPopVec):
-        apply_sampler_cpp[multilocus_t]((<MlocusPopVec>pops).pops,sampler.vec)
+        apply_sampler_cpp[multilocus_t]((<MlocusPopVec>pops).pops,s.vec)
     else:
         raise RuntimeError("PopVec/PopType type not supported")
 
-def apply_sampler_single(PopType pop,TemporalSampler sampler):
+def apply_sampler_single(PopType pop,sampler):
     """
     Apply a temporal sampler to an indivudal :class:`fwdpy.fwdpy.PopType`
 
     :param pop: A :class:`fwdpy.fwdpy.PopType`
-    :param sampler: A :class:`fwdpy.fwdpy.TemporalSampler`
+    :param sampler: A :class:`fwdpy.fwdpy.TemporalSampler`, or a list of them (see :class:`fwdpy.fwdpy.CompositeSampler`)
 
     The use case for this function is applying very expensive temporal samplers
     at the end of a simulation.  It is assumed that len(sampler)==1.
     """
     if not isinstance(pop,PopType):
         raise TypeError("Expecting PopType.")
+    cdef TemporalSampler s = sampler if isinstance(sampler,TemporalSampler) else CompositeSampler(sampler)
     if isinstance(pop,Spop):
-        apply_sampler_single_cpp[singlepop_t]((<Spop>pop).pop.get(),sampler.vec)
+        apply_sampler_single_cpp[singlepop_t]((<Spop>pop).pop.get(),s.vec)
     elif isinstance(pop,MlocusPop):
-        apply_sampler_single_cpp[multilocus_t]((<MlocusPop>pop).pop.get(),sampler.vec)
+        apply_sampler_single_cpp[multilocus_t]((<MlocusPop>pop).pop.get(),s.vec)
     elif isinstance(pop,MetaPop):
-        apply_sampler_single_cpp[metapop_t]((<MetaPop>pop).mpop.get(),sampler.vec)
+        apply_sampler_single_cpp[metapop_t]((<MetaPop>pop).mpop.get(),s.vec)
     else:
         raise NotImplementedError("Not implemented for this type")
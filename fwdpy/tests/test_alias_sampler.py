@@ -0,0 +1,62 @@
+import unittest
+import math
+import fwdpy as fp
+
+def chisq_critical(df,z=3.09):
+    """
+    Wilson-Hilferty approximation to the upper 0.001 quantile
+    of a chi-squared distribution with df degrees of freedom.
+    """
+    a = 2./(9.*df)
+    return df*(1.-a+z*math.sqrt(a))**3
+
+class testAliasSamplerDistribution(unittest.TestCase):
+    """
+    Indexes are drawn proportionally to their weights.
+    """
+    def check(self,weights,ndraws=200000,seed=101):
+        counts = fp.alias_sampler_counts(fp.GSLrng(seed),weights,ndraws)
+        self.assertEqual(len(counts),len(weights))
+        self.assertEqual(sum(counts),ndraws)
+        total = float(sum(weights))
+        chisq = 0.
+        df = -1
+        for w,c in zip(weights,counts):
+            if w == 0.:
+                self.assertEqual(c,0)
+                continue
+            expected = ndraws*w/total
+            chisq += (c-expected)**2/expected
+            df += 1
+        if df > 0:
+            self.assertTrue(chisq < chisq_critical(df))
+    def testIncreasing(self):
+        self.check([1.,2.,3.,4.])
+    def testZeroWeights(self):
+        self.check([0.,5.,0.,1.,0.25,3.,0.])
+    def testUniform(self):
+        self.check([1.]*50)
+    def testSkewed(self):
+        self.check([1000.]+[1.]*20)
+    def testOneWeight(self):
+        self.assertEqual(fp.alias_sampler_counts(fp.GSLrng(101),[3.],100),[100])
+    def testInvalidWeights(self):
+        for weights in [[],[0.,0.],[1.,-1.],[1.,float('inf')],[float('nan')]]:
+            with self.assertRaises(RuntimeError):
+                fp.alias_sampler_counts(fp.GSLrng(101),weights,1)
+
+class testAliasSamplerStorage(unittest.TestCase):
+    """
+    Rebuilding the table does not allocate unless the number of
+    weights exceeds every previous number.
+    """
+    def testRebuild(self):
+        b = fp.alias_sampler_reserved_bytes([1000,1000,10,1000,2000])
+        self.assertTrue(b[0] > 0)
+        self.assertEqual(b[1],b[0])
+        self.assertEqual(b[2],b[0])
+        self.assertEqual(b[3],b[0])
+        self.assertTrue(b[4] > b[0])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -32,5 +32,329 @@ class EvolveRegions(unittest.TestCase):
         with self.assertRaises(RuntimeError):
             pops = fwdpy.evolve_regions(rng,1,1000,popsizes[0:],0.001,0.001,np.inf,nregions,sregions,rregions)
 
+#Long enough, and with a bottleneck, so that containers are compacted
+#and reservations shrink
+bottleneck = np.array([1000]*100 + [200]*110,dtype=np.uint32)
+NREPS = 4
+
+def evolve_replicates(options,sampler=None,nlist=bottleneck):
+    """
+    Evolve NREPS replicates from the same seed.  If sampler is not None,
+    it is applied every generation.
+    """
+    r = fwdpy.GSLrng(42)
+    if sampler is None:
+        return fwdpy.evolve_regions(r,NREPS,nlist[0],nlist,0.001,0.0001,0.001,nregions,sregions,rregions,
+                                    options=options)
+    pops = fwdpy.SpopVec(NREPS,nlist[0])
+    fwdpy.evolve_regions_sampler(r,pops,sampler,nlist,0.001,0.0001,0.001,
+                                 nregions,sregions,rregions,1,options=options)
+    return pops
+
+def take_samples(pops,sampler):
+    return [fwdpy.get_samples(fwdpy.GSLrng(1),i,20) for i in pops]
+
+def serialize_pops(pops,sampler):
+    import fwdpy.fwdpyio as fpio
+    return [fpio.serialize(i) for i in pops]
+
+def sampler_data(pops,sampler):
+    #Data frames cannot be compared with ==
+    if isinstance(sampler,list):
+        sampler = sampler[0]
+    return [sampler[i].to_dict('records') for i in range(len(sampler))]
+
+class EvolveRegionsThreads(unittest.TestCase):
+    """
+    Results must not depend on the number of worker threads, or on
+    other options that only affect performance
+    """
+    def assertSameResults(self,options,samplers=None,collect=take_samples):
+        """
+        Evolve replicates with each element of options, and require the
+        same results from each.
+
+        :param samplers: None, or one function per element of options,
+            returning the sampler(s) to apply every generation.
+        :param collect: Function of the populations and sampler(s)
+            returning the results to compare.
+        """
+        results = []
+        for i,opts in enumerate(options):
+            sampler = samplers[i]() if samplers is not None else None
+            results.append(collect(evolve_replicates(opts,sampler),sampler))
+        for i in results[1:]:
+            self.assertEqual(results[0],i)
+    def test_resultsIndependentOfNthreads(self):
+        self.assertSameResults([fwdpy.EvolveOptions(nthreads=1),fwdpy.EvolveOptions(nthreads=4)],
+                               collect=serialize_pops)
+    def test_resultsIndependentOfNchunks(self):
+        self.assertSameResults([fwdpy.EvolveOptions(offspring_chunks=2),fwdpy.EvolveOptions(offspring_chunks=5)],
+                               collect=serialize_pops)
+    def test_resultsIndependentOfCompaction(self):
+        self.assertSameResults([fwdpy.EvolveOptions(),
+                                fwdpy.EvolveOptions(compaction_interval=7,compaction_threshold=0.5)])
+    def test_resultsIndependentOfMemoryBudget(self):
+        self.assertSameResults([fwdpy.EvolveOptions(nthreads=NREPS,memory_budget=0),
+                                fwdpy.EvolveOptions(nthreads=NREPS,memory_budget=1)])
+    def test_resultsIndependentOfNumaPlacement(self):
+        self.assertSameResults([fwdpy.EvolveOptions(nthreads=NREPS,numa_placement=placed,huge_pages=placed)
+                                for placed in [False,True]])
+    def test_gameteMerging(self):
+        pops = evolve_replicates(fwdpy.EvolveOptions(gamete_merge_interval=1))
+        for i in fwdpy.check_popdata(pops):
+            self.assertTrue(i['check_sum'])
+            self.assertTrue(i['popdata_sane'])
+        #Gametes are merged at the end of every generation
+        for p in pops:
+            gametes = [tuple(m['pos'] for m in g['neutral']+g['selected']) for g in fwdpy.view_gametes(p)]
+            self.assertEqual(len(gametes),len(set(gametes)))
+    def test_samplerQueue(self):
+        self.assertSameResults([fwdpy.EvolveOptions(sampler_queue=queue) for queue in [0,2]],
+                               [lambda: fwdpy.FreqSampler(NREPS)]*2,sampler_data)
+    def test_samplerList(self):
+        self.assertSameResults([None,None],
+                               [lambda: fwdpy.FreqSampler(NREPS),
+                                lambda: [fwdpy.FreqSampler(NREPS),fwdpy.QtraitStatsSampler(NREPS,0.)]],
+                               sampler_data)
+    def test_freqSamplerFilters(self):
+        results = []
+        for filtered in [False,True]:
+            if filtered:
+                sampler = fwdpy.FreqSampler(NREPS,min_freq=0.01,existed_past=3)
+            else:
+                sampler = fwdpy.FreqSampler(NREPS)
+            evolve_replicates(None,sampler)
+            if filtered:
+                results.append([sampler[i] for i in range(len(sampler))])
+            else:
+                keep = lambda t: max(i[1] for i in t) > 0.01 and t[-1][0] >= 3
+                results.append([sampler.fetch(i,freq_filter=keep) for i in range(len(sampler))])
+        for i,j in zip(results[0],results[1]):
+            self.assertEqual(len(i),len(j))
+            if len(i):
+                cols = ['origin','pos','esize','generation']
+                i = i.sort_values(by=cols).reset_index(drop=True)
+                j = j.sort_values(by=cols).reset_index(drop=True)
+                self.assertTrue(i.equals(j[i.columns]))
+    def test_summaryStatsSampler(self):
+        r = fwdpy.GSLrng(42)
+        pops = fwdpy.SpopVec(2,1000)
+        sampler = fwdpy.SummaryStatsSampler(len(pops),20,r)
+        fwdpy.evolve_regions_sampler(r,pops,sampler,popsizes[0:],0.001,0.001,0.001,
+                                     nregions,sregions,rregions,1)
+        for i in sampler:
+            self.assertEqual(len(i),2*len(popsizes))
+            self.assertTrue((i.locus == 0).all())
+            self.assertEqual(i.selected.sum(),len(popsizes))
+            self.assertTrue((i.S >= 0).all())
+            self.assertTrue((i.pi >= 0).all())
+            self.assertTrue((i.thetaw >= 0).all())
+    def test_compactingCopy(self):
+        r = fwdpy.GSLrng(42)
+        pops = fwdpy.evolve_regions(r,4,1000,popsizes[0:],0.001,0.0001,0.001,nregions,sregions,rregions)
+        for compact in [False,True]:
+            c = fwdpy.copypops(pops,compact=compact)
+            self.assertEqual(len(c),len(pops))
+            for i,j in zip(pops,c):
+                self.assertEqual(fwdpy.get_samples(fwdpy.GSLrng(1),i,20),
+                                 fwdpy.get_samples(fwdpy.GSLrng(1),j,20))
+    def test_gameteKeyStorage(self):
+        r = fwdpy.GSLrng(42)
+        pops = fwdpy.evolve_regions(r,1,1000,popsizes[0:],0.001,0.0001,0.001,nregions,sregions,rregions,
+                                    options=fwdpy.EvolveOptions(offspring_chunks=2))
+        s = fwdpy.gamete_key_storage_stats(pops[0])
+        self.assertTrue(s['recycle_hits'] + s['in_place'] > s['allocations'])
+        self.assertTrue(s['bytes_live'] <= s['bytes_reserved'])
+
+    def test_reservationHighWater(self):
+        bottleneck = np.array([1000]*50 + [100]*50,dtype=np.uint32)
+        results = []
+        for growth in [0.,1.5]:
+            r = fwdpy.GSLrng(42)
+            pops = fwdpy.evolve_regions(r,1,1000,bottleneck,0.001,0.0001,0.001,nregions,sregions,rregions,
+                                        options=fwdpy.EvolveOptions(reservation_growth=growth))
+            results.append(fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],20))
+        self.assertEqual(results[0],results[1])
+        s = fwdpy.reservation_high_water(pops[0])
+        self.assertEqual(s['diploids'],1000)
+        self.assertTrue(s['shrunk'] > 0)
+        self.assertTrue(s['mutations'] >= len(fwdpy.view_mutations(pops[0])))
+
+class CachedSiteFitness(unittest.TestCase):
+    """
+    Cached site-dependent models must give the same results, bit for bit,
+    as the uncached models
+    """
+    def evolve(self,fitness,options=None):
+        import fwdpy.fwdpyio as fpio
+        r = fwdpy.GSLrng(42)
+        pops = fwdpy.SpopVec(2,500)
+        fwdpy.evolve_regions_sampler_fitness(r,pops,fwdpy.NothingSampler(len(pops)),fitness,
+                                             np.array([500]*1000,dtype=np.uint32),
+                                             0.001,0.01,0.001,nregions,sregions,rregions,0,
+                                             options=options)
+        return [fpio.serialize(i) for i in pops]
+    def test_additive(self):
+        import fwdpy.fitness
+        for scaling in [1,2]:
+            self.assertEqual(self.evolve(fwdpy.fitness.SpopAdditive(scaling)),
+                             self.evolve(fwdpy.fitness.SpopAdditive(scaling,cache=False)))
+    def test_multiplicative(self):
+        import fwdpy.fitness
+        for scaling in [1,2]:
+            self.assertEqual(self.evolve(fwdpy.fitness.SpopMult(scaling)),
+                             self.evolve(fwdpy.fitness.SpopMult(scaling,cache=False)))
+    def test_offspringThreads(self):
+        """
+        Offspring are evaluated concurrently when generated in chunks by
+        several threads, and the cache must not be written to then.
+        """
+        import fwdpy.fitness
+        opts = fwdpy.EvolveOptions(offspring_chunks=16,offspring_threads=8)
+        for cached,uncached in [(fwdpy.fitness.SpopAdditive(2),fwdpy.fitness.SpopAdditive(2,cache=False)),
+                                (fwdpy.fitness.SpopMult(2),fwdpy.fitness.SpopMult(2,cache=False))]:
+            self.assertEqual(self.evolve(cached,opts),self.evolve(uncached,opts))
+
+class MultiplicativeFitness(unittest.TestCase):
+    """
+    SpopMult multiplies fitness by 1+h*s for each heterozygous site, and
+    by 1+scaling*s for each homozygous site, with or without its cache
+    """
+    @classmethod
+    def setUpClass(self):
+        import fwdpy.fitness
+        r = fwdpy.GSLrng(303)
+        self.pops = fwdpy.SpopVec(1,500)
+        #Beneficial mutations, so that some sites are homozygous
+        fwdpy.evolve_regions_sampler_fitness(r,self.pops,fwdpy.NothingSampler(len(self.pops)),
+                                             fwdpy.fitness.SpopAdditive(2),
+                                             np.array([500]*200,dtype=np.uint32),
+                                             0.,0.01,0.01,nregions,[fwdpy.ExpS(0,1,1,0.05)],
+                                             [fwdpy.Region(0,1,1)],0)
+        self.diploids = fwdpy.view_diploids(self.pops[0],list(range(500)))
+    def expected(self,scaling):
+        rv = []
+        for d in self.diploids:
+            m0 = dict((m['pos'],m) for m in d['chrom0']['selected'])
+            m1 = dict((m['pos'],m) for m in d['chrom1']['selected'])
+            w = 1.0
+            for pos in set(m0.keys()) | set(m1.keys()):
+                if pos in m0 and pos in m1:
+                    w *= 1.0+scaling*m0[pos]['s']
+                else:
+                    m = m0[pos] if pos in m0 else m1[pos]
+                    w *= 1.0+m['s']*m['h']
+            rv.append(max(0.0,w))
+        return rv
+    def test_homozygousSites(self):
+        self.assertTrue(any(set(m['pos'] for m in d['chrom0']['selected']) &
+                            set(m['pos'] for m in d['chrom1']['selected'])
+                            for d in self.diploids))
+    def test_fitness(self):
+        import fwdpy.fitness
+        for scaling in [1,2]:
+            expected = self.expected(scaling)
+            for cache in [True,False]:
+                w = fwdpy.fitness_values(self.pops[0],fwdpy.fitness.SpopMult(scaling,cache=cache),
+                                         dispatch=cache)
+                self.assertEqual(len(w),len(expected))
+                for i,j in zip(w,expected):
+                    self.assertAlmostEqual(i,j)
+
+class EvolveRegionsRecordAncestry(unittest.TestCase):
+    """
+    Neutral mutations are placed on the recorded ancestry
+    """
+    @classmethod
+    def setUpClass(self):
+        self.pops = fwdpy.evolve_regions(fwdpy.GSLrng(42),1,1000,np.array([1000]*2000,dtype=np.uint32),
+                                         0.01,0.0001,0.001,nregions,sregions,rregions,
+                                         options=fwdpy.EvolveOptions(record_ancestry=True))
+    def test_neutralSitesSampled(self):
+        s = fwdpy.get_samples(fwdpy.GSLrng(1),self.pops[0],20)
+        self.assertTrue(len(s[0]) > 0)
+        for pos,genotypes in s[0]:
+            self.assertTrue((pos >= 0 and pos < 1) or (pos >= 2 and pos < 3))
+            self.assertEqual(len(genotypes),20)
+            self.assertTrue(0 < genotypes.count('1') < 20)
+        self.assertEqual(len([m for m in fwdpy.view_mutations(self.pops[0]) if m['neutral']]),0)
+    def test_mutationsAboveRoots(self):
+        """
+        After one generation, each gamete carries the mutations on its
+        branch to its founder parent, including gametes whose parent
+        left no other offspring.
+        """
+        mu,nsam = 2.,200
+        pops = fwdpy.evolve_regions(fwdpy.GSLrng(42),1,1000,np.array([1000],dtype=np.uint32),
+                                    mu,0.,0.001,nregions,sregions,rregions,
+                                    options=fwdpy.EvolveOptions(record_ancestry=True))
+        S = len(fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],nsam)[0])
+        #A third of the gametes have unary parents, so S would be about
+        #two thirds of this if their branches were dropped
+        self.assertTrue(abs(S-mu*nsam) < 4.*np.sqrt(mu*nsam))
+    def test_copyKeepsAncestry(self):
+        c = fwdpy.copypop(self.pops[0])
+        self.assertEqual(fwdpy.get_samples(fwdpy.GSLrng(1),self.pops[0],20),
+                         fwdpy.get_samples(fwdpy.GSLrng(1),c,20))
+    def test_gzSerializerKeepsAncestry(self):
+        import os,shutil,tempfile
+        import fwdpy.fwdpyio as fpio
+        tdir = tempfile.mkdtemp()
+        try:
+            base = os.path.join(tdir,'ancestry')
+            nlist = np.array([1000]*1000,dtype=np.uint32)
+            pops = fwdpy.SpopVec(1,1000)
+            sampler = fpio.gzSerializer(len(pops),base)
+            fwdpy.evolve_regions_sampler(fwdpy.GSLrng(42),pops,sampler,nlist,0.01,0.0001,0.001,
+                                         nregions,sregions,rregions,len(nlist),
+                                         options=fwdpy.EvolveOptions(record_ancestry=True))
+            offsets = sampler.get()[0]
+            self.assertEqual(offsets[-1][0],len(nlist))
+            read = fpio.read_singlepops(base+'.0.gz',[i[1] for i in offsets])
+            #Neutral sites only exist in the ancestry tables
+            s = fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],20)[0]
+            self.assertTrue(len(s) > 0)
+            self.assertEqual(fwdpy.get_samples(fwdpy.GSLrng(1),read[-1],20)[0],s)
+        finally:
+            shutil.rmtree(tdir)
+    def test_summaryStatsMatchSamples(self):
+        """
+        SummaryStatsSampler and PopSampler draw the same diploids
+        when seeded alike, so the statistics must match those of
+        the samples, whether or not ancestry is recorded.  Both
+        samplers share one pass over the population.
+        """
+        for record in [True,False]:
+            self.checkSummaryStatsMatchSamples(record)
+    def checkSummaryStatsMatchSamples(self,record):
+        nsam = 20
+        samples = fwdpy.PopSampler(2,nsam,fwdpy.GSLrng(7))
+        stats = fwdpy.SummaryStatsSampler(2,nsam,fwdpy.GSLrng(7))
+        pops = fwdpy.SpopVec(2,1000)
+        fwdpy.evolve_regions_sampler(fwdpy.GSLrng(42),pops,[samples,stats],np.array([1000]*100,dtype=np.uint32),
+                                     0.01,0.001,0.001,nregions,sregions,rregions,10,
+                                     options=fwdpy.EvolveOptions(record_ancestry=record))
+        n = float(nsam)
+        a1 = sum(1./i for i in range(1,nsam))
+        S = 0
+        for s,st in zip(samples,stats):
+            self.assertEqual(len(st),2*len(s))
+            for i,(sample,details) in enumerate(s):
+                for selected,sites in enumerate(sample):
+                    counts = [c for c in [g.count('1') for pos,g in sites] if 0 < c < nsam]
+                    row = st.iloc[2*i+selected]
+                    self.assertEqual(bool(row.selected),bool(selected))
+                    self.assertEqual(row.S,len(counts))
+                    self.assertAlmostEqual(row.pi,sum(2.*c*(n-c) for c in counts)/(n*(n-1.)))
+                    self.assertAlmostEqual(row.thetaw,len(counts)/a1)
+                    self.assertAlmostEqual(row.faywuh,row.pi-sum(2.*c*c for c in counts)/(n*(n-1.)))
+                    S += len(counts)
+        self.assertTrue(S > 0)
+    def test_evolveWithoutRecordingRaises(self):
+        with self.assertRaises(RuntimeError):
+            fwdpy.evolve_regions_more(fwdpy.GSLrng(1),self.pops,popsizes[0:],0.01,0.0001,0.001,
+                                      nregions,sregions,rregions)
+
 if __name__ == '__main__':
     unittest.main()
@@ -10,6 +10,37 @@ try:
     pops=fwdpy.SpopVec(10,1000)
     n = fwdpy.NothingSampler(len(pops))
 
+    def selected_genotypes(d):
+        """
+        For each selected site of a diploid, as returned by
+        fwdpy.view_diploids, the mutation and the number of copies
+        of it carried by the diploid.
+        """
+        m0 = dict((m['pos'],m) for m in d['chrom0']['selected'])
+        m1 = dict((m['pos'],m) for m in d['chrom1']['selected'])
+        rv = []
+        for pos in set(m0.keys()) | set(m1.keys()):
+            if pos in m0 and pos in m1:
+                rv.append((m0[pos],2))
+            else:
+                rv.append((m0[pos] if pos in m0 else m1[pos],1))
+        return rv
+
+    def additive_value(d):
+        """
+        Genetic value of a diploid under SpopAdditiveTrait
+        """
+        return sum(2.0*m['s'] if n == 2 else m['s']*m['h'] for m,n in selected_genotypes(d))
+
+    def multiplicative_value(d):
+        """
+        Genetic value of a diploid under SpopMultTrait
+        """
+        g = 1.0
+        for m,n in selected_genotypes(d):
+            g *= 1.0+2.0*m['s'] if n == 2 else 1.0+m['s']*m['h']
+        return g-1.0
+
     class SregionErrors(unittest.TestCase):
         """
         The gene-based region functions cannot allow effect size < 0.
@@ -32,7 +63,217 @@ try:
         def testUniformHi(self):
             with self.assertRaises(RuntimeError):
                 fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(rng,pops,n,f,nlist[0:],0,0.001,0.,[],[fwdpy.UniformS(0,1,1,-0.2,-0.1)],[],1,0.025)
-                
+
+    class CachedAdditiveTrait(unittest.TestCase):
+        """
+        Genetic values obtained via per-gamete cached values must match
+        a direct calculation over each diploid's mutations.
+        """
+        def testGeneticValues(self):
+            import numpy as np
+            r = fwdpy.GSLrng(202)
+            p = fwdpy.SpopVec(1,500)
+            s = fwdpy.NothingSampler(len(p))
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*200,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],[fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.)
+            for d in fwdpy.view_diploids(p[0],list(range(500))):
+                self.assertAlmostEqual(d['g'],additive_value(d))
+
+    class MultiplicativeTrait(unittest.TestCase):
+        """
+        Homozygous mutations must multiply genetic values by 1+2s.
+        """
+        def testGeneticValues(self):
+            import numpy as np
+            r = fwdpy.GSLrng(202)
+            p = fwdpy.SpopVec(1,500)
+            s = fwdpy.NothingSampler(len(p))
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopMultTrait(),
+                                                               np.array([500]*200,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],[fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.)
+            for d in fwdpy.view_diploids(p[0],list(range(500))):
+                self.assertAlmostEqual(d['g'],multiplicative_value(d))
+
+    class FoldFixations(unittest.TestCase):
+        """
+        When fixations are folded, genetic values must match a direct
+        calculation over each diploid's mutations plus the homozygous
+        effects of the selected fixations.
+        """
+        def testGeneticValues(self):
+            import numpy as np
+            r = fwdpy.GSLrng(303)
+            p = fwdpy.SpopVec(1,500)
+            s = fwdpy.NothingSampler(len(p))
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*2000,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],[fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.,
+                                                               options=fwdpy.EvolveOptions(fold_fixations=True))
+            offset = sum(2.0*m['s'] for m in fwdpy.view_fixations(p[0]) if not m['neutral'])
+            for d in fwdpy.view_diploids(p[0],list(range(500))):
+                self.assertAlmostEqual(d['g'],offset+additive_value(d))
+        def testPopgenFixations(self):
+            """
+            Selected fixations removed by a population-genetic simulation
+            must not contribute to trait values.
+            """
+            import numpy as np
+            r = fwdpy.GSLrng(707)
+            p = fwdpy.evolve_regions(r,1,500,np.array([500]*2000,dtype=np.uint32),
+                                     0.,0.01,0.01,[],[fwdpy.ExpS(0,1,1,0.01)],[fwdpy.Region(0,1,1)])
+            g0 = p[0].gen()
+            self.assertTrue(any(not m['neutral'] for m in fwdpy.view_fixations(p[0])))
+            s = fwdpy.NothingSampler(len(p))
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*500,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],[fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.,
+                                                               options=fwdpy.EvolveOptions(fold_fixations=True))
+            offset = sum(2.0*m['s'] for m in fwdpy.view_fixations(p[0]) if not m['neutral'] and m['ftime'] >= g0)
+            for d in fwdpy.view_diploids(p[0],list(range(500))):
+                self.assertAlmostEqual(d['g'],offset+additive_value(d))
+
+    class FitnessDispatch(unittest.TestCase):
+        """
+        Built-in models must give the same values when evaluated as
+        the "evolve" functions do and when evaluated through their
+        std::function, as for custom fitness functions.  Cached site
+        models must also match their uncached versions.
+        """
+        @classmethod
+        def setUpClass(cls):
+            import numpy as np
+            r = fwdpy.GSLrng(404)
+            cls.pops = fwdpy.SpopVec(1,500)
+            s = fwdpy.NothingSampler(len(cls.pops))
+            #Positive effect sizes, so that the GBR model is defined
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,cls.pops,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*200,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],[fwdpy.ExpS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.)
+        def testDispatch(self):
+            for f in [fwdpy.fitness.SpopAdditive(1),fwdpy.fitness.SpopAdditive(2),
+                      fwdpy.fitness.SpopMult(1),fwdpy.fitness.SpopMult(2),
+                      fwdpy.qtrait.SpopAdditiveTrait(),fwdpy.qtrait.SpopMultTrait(),
+                      fwdpy.qtrait.SpopGBRTrait()]:
+                self.assertEqual(fwdpy.fitness_values(self.pops[0],f),
+                                 fwdpy.fitness_values(self.pops[0],f,dispatch=False))
+        def testCache(self):
+            for f,u in [(fwdpy.fitness.SpopAdditive(1),fwdpy.fitness.SpopAdditive(1,cache=False)),
+                        (fwdpy.fitness.SpopAdditive(2),fwdpy.fitness.SpopAdditive(2,cache=False)),
+                        (fwdpy.fitness.SpopMult(1),fwdpy.fitness.SpopMult(1,cache=False)),
+                        (fwdpy.fitness.SpopMult(2),fwdpy.fitness.SpopMult(2,cache=False)),
+                        (fwdpy.qtrait.SpopAdditiveTrait(),fwdpy.qtrait.SpopAdditiveTrait(cache=False)),
+                        (fwdpy.qtrait.SpopMultTrait(),fwdpy.qtrait.SpopMultTrait(cache=False))]:
+                self.assertEqual(fwdpy.fitness_values(self.pops[0],f),
+                                 fwdpy.fitness_values(self.pops[0],u,dispatch=False))
+
+    class SimdEffectSums(unittest.TestCase):
+        """
+        Values computed by the effect kernels must not depend on the
+        instruction set used to compute them.
+        """
+        def testSums(self):
+            import numpy as np
+            r = fwdpy.GSLrng(505)
+            p = fwdpy.SpopVec(1,500)
+            s = fwdpy.NothingSampler(len(p))
+            #Many mutations of small effect, so that gametes carry
+            #enough of them to use the SIMD code paths.
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*500,dtype=np.uint32),
+                                                               0.,0.1,0.01,[],[fwdpy.GaussianS(0,1,1,0.01,0.5)],[fwdpy.Region(0,1,1)],0,0.)
+            self.assertTrue(max(len(d['chrom0']['selected']) for d in fwdpy.view_diploids(p[0],list(range(500)))) >= 16)
+            sums = fwdpy.effect_sums_by_simd_level(p[0])
+            for i in sums[1:]:
+                self.assertEqual(i,sums[0])
+
+    class MutationBookkeeping(unittest.TestCase):
+        """
+        After evolving, stopping, and evolving again, mutation counts
+        must match a full recount, fixations must be recorded once, and
+        the lookup table must only hold the positions of mutations
+        that are still carried by the population.
+        """
+        def check(self,p):
+            b = fwdpy.mutation_bookkeeping(p)
+            self.assertEqual(b['mcounts'],b['recount'])
+            self.assertEqual(len(b['fixations']),len(set(b['fixations'])))
+            self.assertEqual(b['fixations'],sorted(b['fixations']))
+            live = set(pos for pos,n in zip(b['positions'],b['mcounts']) if n > 0)
+            self.assertEqual(len(b['lookup']),len(live))
+            self.assertEqual(set(b['lookup']),live)
+        def testEvolveTwice(self):
+            import numpy as np
+            for opts in [fwdpy.EvolveOptions(),
+                         fwdpy.EvolveOptions(offspring_chunks=4,compaction_interval=100)]:
+                r = fwdpy.GSLrng(606)
+                p = fwdpy.SpopVec(1,500)
+                s = fwdpy.NothingSampler(len(p))
+                for i in range(2):
+                    fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(r,p,s,fwdpy.qtrait.SpopAdditiveTrait(),
+                                                                       np.array([500]*2000,dtype=np.uint32),
+                                                                       0.01,0.01,0.01,[fwdpy.Region(0,1,1)],
+                                                                       [fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.,
+                                                                       options=opts)
+                    self.check(p[0])
+                self.assertTrue(len(fwdpy.view_fixations(p[0])) > 0)
+
+    class RecordAncestry(unittest.TestCase):
+        """
+        Neutral mutations of quantitative trait simulations may be
+        placed on the recorded ancestry.
+        """
+        def testNeutralSitesSampled(self):
+            import numpy as np
+            p = fwdpy.SpopVec(1,500)
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(fwdpy.GSLrng(707),p,fwdpy.NothingSampler(1),
+                                                               fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*500,dtype=np.uint32),
+                                                               0.01,0.01,0.01,[fwdpy.Region(0,1,1)],
+                                                               [fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0,0.,
+                                                               options=fwdpy.EvolveOptions(record_ancestry=True))
+            s = fwdpy.get_samples(fwdpy.GSLrng(1),p[0],20)
+            self.assertTrue(len(s[0]) > 0)
+            for pos,genotypes in s[0]:
+                self.assertTrue(0 < genotypes.count('1') < 20)
+            self.assertTrue(fwdpy.check_popdata(p[0])['popdata_sane'])
+
+    class DiploidLayout(unittest.TestCase):
+        """
+        Diploids of a build with --compact-diploid store only their
+        gametes, and their traits are kept apart.  The traits must be
+        the same as when stored by the diploids.
+        """
+        @classmethod
+        def setUpClass(self):
+            import numpy as np
+            self.p = fwdpy.SpopVec(1,500)
+            fwdpy.qtrait.evolve_regions_qtrait_sampler_fitness(fwdpy.GSLrng(808),self.p,fwdpy.NothingSampler(1),
+                                                               fwdpy.qtrait.SpopAdditiveTrait(),
+                                                               np.array([500]*200,dtype=np.uint32),
+                                                               0.,0.01,0.01,[],
+                                                               [fwdpy.GaussianS(0,1,1,0.1)],[fwdpy.Region(0,1,1)],0.5,0.25)
+        def testDiploidSize(self):
+            l = fwdpy.diploid_layout()
+            if l['compact'] is True:
+                self.assertEqual(l['diploid_bytes'],8)
+            else:
+                self.assertEqual(l['diploid_bytes'],48)
+        def testTraits(self):
+            import math
+            t = fwdpy.diploid_traits(self.p[0])
+            self.assertEqual(len(t),500)
+            self.assertTrue(len(set([i['e'] for i in t])) > 1)
+            for i in t:
+                self.assertAlmostEqual(i['w'],math.exp(-((i['g']+i['e']-0.25)**2)/2.))
+            d = fwdpy.view_diploids(self.p[0],[0,499])
+            self.assertEqual(d[0]['g'],t[0]['g'])
+            self.assertEqual(d[1]['w'],t[499]['w'])
+        def testSerialization(self):
+            import fwdpy.fwdpyio as fpio
+            p2 = fpio.deserialize_singlepops([fpio.serialize(self.p[0])])
+            self.assertEqual(fwdpy.diploid_traits(p2[0]),fwdpy.diploid_traits(self.p[0]))
+
 except ImportError:
     pass
 
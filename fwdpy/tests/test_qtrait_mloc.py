@@ -0,0 +1,126 @@
+try:
+    import fwdpy
+    import fwdpy.fitness
+    import fwdpy.qtrait_mloc as qtm
+    import unittest
+    import numpy as np
+
+    NLOCI=3
+    N=500
+
+    def evolve_mloc(seed,fitness,ngens,r_between,npops=1,mu=0.01,rec=0.01,pops=None,options=None):
+        """
+        Evolve multi-locus populations with positive effect sizes.
+        If pops is None, npops new populations are evolved.
+        Locus i occupies positions [i,i+1).
+        """
+        r = fwdpy.GSLrng(seed)
+        if pops is None:
+            pops = fwdpy.MlocusPopVec(npops,N,NLOCI)
+        qtm.evolve_qtraits_mloc_sample_fitness(r,pops,fwdpy.NothingSampler(len(pops)),fitness,
+                                               np.array([N]*ngens,dtype=np.uint32),
+                                               [mu]*NLOCI,[mu]*NLOCI,
+                                               [fwdpy.ExpS(0,1,1,0.1)]*NLOCI,
+                                               [rec]*NLOCI,[r_between]*(NLOCI-1),
+                                               sample=0,VS=2.,optimum=0.,options=options)
+        return pops
+
+    class FitnessDispatch(unittest.TestCase):
+        """
+        Built-in models must give the same values when evaluated as
+        the "evolve" functions do and when evaluated through their
+        std::function, as for custom fitness functions.
+        """
+        def testDispatch(self):
+            pops = evolve_mloc(505,qtm.MlocusAdditiveTrait(),200,0.5)
+            for f in [fwdpy.fitness.MlocusAdditive(1.),fwdpy.fitness.MlocusAdditive(2.),
+                      fwdpy.fitness.MlocusMult(1.),fwdpy.fitness.MlocusMult(2.),
+                      qtm.MlocusAdditiveTrait(),qtm.MlocusMultTrait(),qtm.MlocusGBRTrait(),
+                      qtm.MlocusPowerMeanTrait(1.,1.,[0.5,0.5],[1./NLOCI]*NLOCI)]:
+                self.assertEqual(fwdpy.fitness_values(pops[0],f),
+                                 fwdpy.fitness_values(pops[0],f,dispatch=False))
+
+    class OffspringGenerator(unittest.TestCase):
+        """
+        Tests of the offspring generated by multilocus_offspring_generator
+        """
+        def testPopdata(self):
+            for r_between in [0.,0.5]:
+                pops = evolve_mloc(101,qtm.MlocusAdditiveTrait(),500,r_between,npops=4)
+                for i in fwdpy.check_popdata(pops):
+                    self.assertTrue(i['check_sum'])
+                    self.assertTrue(i['popdata_sane'])
+        def testStrandsBetweenLoci(self):
+            """
+            Without mutation or recombination within loci, gametes are
+            copied from parents, and offspring strands switch between
+            every pair of adjacent loci with probability r_between.
+            """
+            for r_between in [0.,1.]:
+                pops = evolve_mloc(202,qtm.MlocusAdditiveTrait(),200,0.5)
+                parents = fwdpy.multilocus_gametes(pops[0])
+                evolve_mloc(303,qtm.MlocusAdditiveTrait(),1,r_between,mu=0.,rec=0.,pops=pops)
+                strands = set()
+                for g1,g2 in parents:
+                    if r_between == 0.:
+                        strands.update([g1,g2])
+                    else:
+                        strands.update([tuple((g1,g2)[(j+k)%2][j] for j in range(NLOCI)) for k in [0,1]])
+                for g1,g2 in fwdpy.multilocus_gametes(pops[0]):
+                    self.assertTrue(g1 in strands)
+                    self.assertTrue(g2 in strands)
+                self.assertTrue(fwdpy.check_popdata(pops[0])['popdata_sane'])
+        def testGameteKeyStorage(self):
+            """
+            New gametes take their key storage from the population's arena.
+            """
+            pops = evolve_mloc(404,qtm.MlocusAdditiveTrait(),200,0.5)
+            s = fwdpy.gamete_key_storage_stats(pops[0])
+            self.assertTrue(s['allocations'] > 0)
+            self.assertTrue(s['recycle_hits'] + s['in_place'] > s['allocations'])
+            self.assertTrue(s['bytes_live'] <= s['bytes_reserved'])
+            self.assertTrue(fwdpy.check_popdata(pops[0])['popdata_sane'])
+
+    class RecordAncestry(unittest.TestCase):
+        """
+        Neutral mutations are placed on the ancestry recorded for all
+        loci, and assigned to loci by position when sampling.
+        """
+        boundaries = [(i,i+1) for i in range(NLOCI)]
+        def testNeutralSitesSampled(self):
+            pops = evolve_mloc(404,qtm.MlocusAdditiveTrait(),500,0.5,
+                               options=fwdpy.EvolveOptions(record_ancestry=True,simplification_interval=50))
+            self.assertTrue(fwdpy.check_popdata(pops[0])['popdata_sane'])
+            s = fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],20,locusBoundaries=self.boundaries)
+            self.assertEqual(len(s),NLOCI)
+            for i in range(NLOCI):
+                self.assertTrue(len(s[i][0]) > 0)
+                for pos,genotypes in s[i][0]:
+                    self.assertTrue(pos >= i and pos < i+1)
+                    self.assertTrue(0 < genotypes.count('1') < 20)
+            with self.assertRaises(RuntimeError):
+                fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],20,locusBoundaries=[])
+        def testMutationsPerLocus(self):
+            """
+            After one generation, each gamete carries Poisson(mu) new
+            neutral mutations at each locus.
+            """
+            mu,nsam = 1.,100
+            pops = evolve_mloc(505,qtm.MlocusAdditiveTrait(),1,0.5,mu=mu,
+                               options=fwdpy.EvolveOptions(record_ancestry=True))
+            s = fwdpy.get_samples(fwdpy.GSLrng(1),pops[0],nsam,locusBoundaries=self.boundaries)
+            for i in range(NLOCI):
+                self.assertTrue(abs(len(s[i][0])-mu*nsam) < 4.*np.sqrt(mu*nsam))
+        def testEvolveAgain(self):
+            opts = fwdpy.EvolveOptions(record_ancestry=True)
+            pops = evolve_mloc(606,qtm.MlocusAdditiveTrait(),100,0.5,options=opts)
+            with self.assertRaises(RuntimeError):
+                evolve_mloc(707,qtm.MlocusAdditiveTrait(),100,0.5,pops=pops)
+            evolve_mloc(707,qtm.MlocusAdditiveTrait(),100,0.5,pops=pops,options=opts)
+            self.assertTrue(fwdpy.check_popdata(pops[0])['popdata_sane'])
+
+except ImportError:
+    pass
+
+if __name__ == '__main__':
+    unittest.main()
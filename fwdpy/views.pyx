@@ -46,14 +46,17 @@ cdef gamete_data get_gamete(const gamete_t & g,
     rv.n=g.n
     return rv
 
-cdef diploid_data get_diploid(const diploid_t & dip,
+cdef diploid_data get_diploid(const dipvector_t & diploids,
+                              const diploid_traits_t & traits,
+                              size_t ind,
                               const gcont_t & gametes,
                               const mcont_t & mutations,
                               const mcounts_cont_t & mcounts) nogil:
    cdef diploid_data rv
-   rv.g=dip.g
-   rv.e=dip.e
-   rv.w=dip.w
+   cdef const diploid_t * dip = &diploids[ind]
+   rv.g=trait_g(traits,ind)
+   rv.e=trait_e(traits,ind)
+   rv.w=trait_w(traits,ind)
    rv.chrom0=get_gamete(gametes[dip.first],mutations,mcounts)
    rv.chrom1=get_gamete(gametes[dip.second],mutations,mcounts)
    rv.n0 = <unsigned>rv.chrom0.selected.size()
@@ -70,19 +73,22 @@ cdef diploid_data get_diploid(const diploid_t & dip,
        i+=1
    return rv
 
-cdef diploid_mloc_data get_diploid_mloc (const dipvector_t & dip,
+cdef diploid_mloc_data get_diploid_mloc (const vector[dipvector_t] & diploids,
+                                         const mloc_traits_t & traits,
+                                         size_t ind,
                                          const gcont_t & gametes,
                                          const mcont_t & mutations,
                                          const mcounts_cont_t & mcounts) nogil:
     cdef diploid_mloc_data rv
     cdef gamete_data gd
-    rv.g=dip[0].g
-    rv.e=dip[0].e
-    rv.w=dip[0].w
+    cdef const dipvector_t * dip = &diploids[ind]
+    rv.g=trait_g(traits,ind)
+    rv.e=trait_e(traits,ind)
+    rv.w=trait_w(traits,ind)
     cdef size_t i = 0
     for j in range(dip.size()):
-        rv.chrom0.push_back(get_gamete(gametes[dip[j].first],mutations,mcounts))
-        rv.chrom1.push_back(get_gamete(gametes[dip[j].second],mutations,mcounts))
+        rv.chrom0.push_back(get_gamete(gametes[deref(dip)[j].first],mutations,mcounts))
+        rv.chrom1.push_back(get_gamete(gametes[deref(dip)[j].second],mutations,mcounts))
         rv.n1.push_back(<unsigned>rv.chrom0[j].selected.size())
         rv.n0.push_back(<unsigned>rv.chrom1[j].selected.size())
         rv.sh0.push_back(0.)
@@ -129,24 +135,26 @@ cdef vector[gamete_data] view_gametes_details_mloc(const multilocus_t * pop) nog
     return rv
 
 cdef vector[diploid_data] view_diploids_details(const dipvector_t & diploids,
+                                                const diploid_traits_t & traits,
                                                 const gcont_t & gametes,
                                                 const mcont_t & mutations,
                                                 const mcounts_cont_t & mcounts,
                                                 const vector[unsigned] & indlist) nogil:
     cdef vector[diploid_data] rv
     for i in range(indlist.size()):
-        rv.push_back(get_diploid(diploids[indlist[i]],gametes,mutations,mcounts))
+        rv.push_back(get_diploid(diploids,traits,indlist[i],gametes,mutations,mcounts))
     return rv
 
 
 cdef vector[diploid_mloc_data] view_diploids_details_mloc(const vector[dipvector_t] & diploids,
+                                                          const mloc_traits_t & traits,
                                                           const gcont_t & gametes,
                                                           const mcont_t & mutations,
                                                           const mcounts_cont_t & mcounts,
                                                           const vector[unsigned] & indlist) nogil:
     cdef vector[diploid_mloc_data] rv
     for i in range(indlist.size()):
-        rv.push_back(get_diploid_mloc(diploids[indlist[i]],gametes,mutations,mcounts))
+        rv.push_back(get_diploid_mloc(diploids,traits,indlist[i],gametes,mutations,mcounts))
     return rv
 
 def view_mutations_singlepop(Spop p):
@@ -348,13 +356,13 @@ def view_diploids_singlepop(Spop p, list indlist):
     for i in indlist:
         if i >= p.popsize():
             raise IndexError("index greater than population size")
-    return view_diploids_details(p.pop.get().diploids,p.pop.get().gametes,p.pop.get().mutations,p.pop.get().mcounts,indlist)
+    return view_diploids_details(p.pop.get().diploids,p.pop.get().traits(),p.pop.get().gametes,p.pop.get().mutations,p.pop.get().mcounts,indlist)
 
 def view_diploids_singlepop_mloc(MlocusPop p, list indlist):
     for i in indlist:
         if i >= p.popsize():
             raise IndexError("index greater than population size")
-    return view_diploids_details_mloc(p.pop.get().diploids,p.pop.get().gametes,p.pop.get().mutations,p.pop.get().mcounts,indlist)
+    return view_diploids_details_mloc(p.pop.get().diploids,p.pop.get().traits(),p.pop.get().gametes,p.pop.get().mutations,p.pop.get().mcounts,indlist)
 
 
 def view_diploids_popvec(SpopVec p, list indlist):
@@ -366,6 +374,7 @@ def view_diploids_popvec(SpopVec p, list indlist):
         il.push_back(<unsigned>(i))
     for i in prange(npops,schedule='static',nogil=True,chunksize=1):
         rv[i] = view_diploids_details(p.pops[i].get().diploids,
+                                      p.pops[i].get().traits(),
                                       p.pops[i].get().gametes,
                                       p.pops[i].get().mutations,
                                       p.pops[i].get().mcounts,il)
@@ -380,6 +389,7 @@ def view_diploids_popvec_mloc(MlocusPopVec p, list indlist):
         il.push_back(<unsigned>(i))
     for i in prange(npops,schedule='static',nogil=True,chunksize=1):
         rv[i] = view_diploids_details_mloc(p.pops[i].get().diploids,
+                                           p.pops[i].get().traits(),
                                            p.pops[i].get().gametes,
                                            p.pops[i].get().mutations,
                                            p.pops[i].get().mcounts,il)
@@ -393,7 +403,7 @@ def view_diploids_metapop(MetaPop p, list indlist, unsigned deme):
                 raise IndexError("index greater than deme size")
     if deme >= len(p.popsizes()):
         raise IndexError("view_diploids: deme index out of range")
-    return view_diploids_details(p.mpop.get().diploids[deme],p.mpop.get().gametes,p.mpop.get().mutations,p.mpop.get().mcounts,indlist)
+    return view_diploids_details(p.mpop.get().diploids[deme],p.mpop.get().traits(deme),p.mpop.get().gametes,p.mpop.get().mutations,p.mpop.get().mcounts,indlist)
     
 def view_diploids(object p, list indlist, deme = None):
     """
@@ -645,6 +655,7 @@ cdef diploid_view_data view_diploids_pd_details(const singlepop_t * pop,
                                                 const vector[unsigned] & indlist,
                                                 bint selectedOnly) nogil:
     cdef vector[diploid_data] v = view_diploids_details(pop.diploids,
+                                                        pop.traits(),
                                                         pop.gametes,
                                                         pop.mutations,
                                                         pop.mcounts,
@@ -719,9 +730,9 @@ def view_diploids_pd(object p,
 cdef diploid_traits_singlepop(Spop p):
     rv=[]
     for i in range(p.pop.get().diploids.size()):
-        rv.append({'g':p.pop.get().diploids[i].g,
-                   'e':p.pop.get().diploids[i].e,
-                   'w':p.pop.get().diploids[i].w})
+        rv.append({'g':trait_g(p.pop.get().traits(),i),
+                   'e':trait_e(p.pop.get().traits(),i),
+                   'w':trait_w(p.pop.get().traits(),i)})
         
     return rv
 
@@ -731,9 +742,9 @@ cdef diploid_traits_popvec(SpopVec p):
 cdef diploid_traits_singlepop_mloc(MlocusPop p):
     rv=[]
     for i in range(p.pop.get().diploids.size()):
-        rv.append({'g':p.pop.get().diploids[i][0].g,
-                   'e':p.pop.get().diploids[i][0].e,
-                   'w':p.pop.get().diploids[i][0].w})
+        rv.append({'g':trait_g(p.pop.get().traits(),i),
+                   'e':trait_e(p.pop.get().traits(),i),
+                   'w':trait_w(p.pop.get().traits(),i)})
         
     return rv
 
@@ -742,13 +753,14 @@ cdef diploid_traits_popvec_mloc(MlocusPopVec p):
 
 
 cdef diploid_traits_mpop(MetaPop m, deme):
-    if deme > m.mpop.get().diploids.size():
+    if deme >= m.mpop.get().diploids.size():
         raise RuntimeError("deme value out of range")
     rv=[]
     for i in range(m.mpop.get().diploids[deme].size()):
-        rv.append({'g':m.mpop.get().diploids[deme][i].g,
-                   'e':m.mpop.get().diploids[deme][i].e,
-                   'w':m.mpop.get().diploids[deme][i].w})
+        rv.append({'g':trait_g(m.mpop.get().traits(deme),i),
+                   'e':trait_e(m.mpop.get().traits(deme),i),
+                   'w':trait_w(m.mpop.get().traits(deme),i)})
+    return rv
 
 cdef diploid_traits_mpopvec(MetaPopVec p,deme):
     return [diploid_traits_mpop(i,deme) for i in p]
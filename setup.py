@@ -68,6 +68,14 @@ if '--qtrait' in sys.argv:
 else:
     QTRAIT=False
 
+#32-bit gamete indexes and no label in fwdpy::diploid_t.
+#See fwdpy/headers/types.hpp.
+if '--compact-diploid' in sys.argv:
+    COMPACT_DIPLOID=True
+    sys.argv.remove('--compact-diploid')
+else:
+    COMPACT_DIPLOID=False
+
 ##Set up our dependent libraries
 GSLLIBS=["gsl","gslcblas"]
 #MEMLIBS=None
@@ -122,6 +130,8 @@ GLOBAL_COMPILE_ARGS=['-std=c++11','-fopenmp',
 ]
 if CUSTOM_DIPLOID_BASE != 0:
     GLOBAL_COMPILE_ARGS.append('-DCUSTOM_DIPLOID_BASE')
+if COMPACT_DIPLOID is True:
+    GLOBAL_COMPILE_ARGS.append('-DFWDPY_COMPACT_DIPLOID')
 
 LINK_ARGS=["-std=c++11",'-fopenmp']
 GLOBAL_INCLUDES=['.','..','fwdpy/headers','fwdpy/headers/fwdpp']
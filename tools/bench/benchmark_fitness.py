@@ -0,0 +1,80 @@
+#Time the evaluation of fitness for every diploid, as done once per
+#generation by the "evolve" functions, for each built-in model
+#evaluated as a policy type (dispatch) versus through its std::function.
+#
+#Both timings of a row use the same model object, so a cached site model
+#is compared against itself.  Each evaluation includes the model's
+#per-generation update (building the cache, for cached models), which is
+#the same for both.
+#
+#Usage: python3 tools/bench/benchmark_fitness.py [-N 1000] [--reps 100]
+#
+#The output starts with the fwdpy version and build layout, to be quoted
+#along with any timings.
+import argparse
+import platform
+import timeit
+import numpy as np
+import fwdpy as fp
+import fwdpy.fitness as fpw
+import fwdpy.qtrait as qt
+import fwdpy.qtrait_mloc as qtm
+
+parser = argparse.ArgumentParser(description="Time fitness dispatch against std::function")
+parser.add_argument('-N',type=int,default=1000,help="Population size")
+parser.add_argument('--reps',type=int,default=100,help="Evaluations timed per model")
+parser.add_argument('--seed',type=int,default=101,help="Random number seed")
+args = parser.parse_args()
+
+N=args.N
+NLOCI=3
+nlist=np.array([N]*10*N,dtype=np.uint32)
+
+def mean_load(p):
+    return np.mean([len(d['chrom0']['selected']) for d in fp.view_diploids(p,list(range(N)))])
+
+#A typical load of weakly-deleterious mutations, for the fitness models
+wpop=fp.evolve_regions(fp.GSLrng(args.seed),1,N,nlist,0.,0.05,0.01,
+                       [],[fp.ExpS(0,1,1,-0.01,0.25)],[fp.Region(0,1,1)])[0]
+#Positive effect sizes under stabilizing selection, for the trait models.
+#The GBR model requires non-negative sums of effect sizes.
+tpops=fp.SpopVec(1,N)
+qt.evolve_regions_qtrait_sampler_fitness(fp.GSLrng(args.seed),tpops,fp.NothingSampler(1),
+                                         qt.SpopAdditiveTrait(),nlist,
+                                         0.,0.05,0.01,[],[fp.ExpS(0,1,1,0.01)],[fp.Region(0,1,1)],
+                                         0.,0.)
+mpops=fp.MlocusPopVec(1,N,NLOCI)
+qtm.evolve_qtraits_mloc_sample_fitness(fp.GSLrng(args.seed),mpops,fp.NothingSampler(1),
+                                       qtm.MlocusAdditiveTrait(),nlist,
+                                       [0.]*NLOCI,[0.05/NLOCI]*NLOCI,[fp.ExpS(0,1,1,0.01)]*NLOCI,
+                                       [0.01/NLOCI]*NLOCI,[0.5]*(NLOCI-1),sample=0)
+
+print("fwdpy",fp.__version__,"python",platform.python_version(),platform.machine())
+print("Diploid layout:",fp.diploid_layout())
+print("N:",N,"reps:",args.reps,"seed:",args.seed)
+print("Mean number of selected mutations per gamete:",mean_load(wpop),"(fitness models),",
+      mean_load(tpops[0]),"(trait models)")
+print()
+
+models = [("SpopAdditive",wpop,fpw.SpopAdditive(2)),
+          ("SpopAdditive, no cache",wpop,fpw.SpopAdditive(2,cache=False)),
+          ("SpopMult",wpop,fpw.SpopMult(2)),
+          ("SpopMult, no cache",wpop,fpw.SpopMult(2,cache=False)),
+          ("SpopAdditiveTrait",tpops[0],qt.SpopAdditiveTrait()),
+          ("SpopAdditiveTrait, no cache",tpops[0],qt.SpopAdditiveTrait(cache=False)),
+          ("SpopMultTrait",tpops[0],qt.SpopMultTrait()),
+          ("SpopMultTrait, no cache",tpops[0],qt.SpopMultTrait(cache=False)),
+          ("SpopGBRTrait",tpops[0],qt.SpopGBRTrait()),
+          ("MlocusAdditive",mpops[0],fpw.MlocusAdditive(2.)),
+          ("MlocusMult",mpops[0],fpw.MlocusMult(2.)),
+          ("MlocusAdditiveTrait",mpops[0],qtm.MlocusAdditiveTrait()),
+          ("MlocusMultTrait",mpops[0],qtm.MlocusMultTrait()),
+          ("MlocusGBRTrait",mpops[0],qtm.MlocusGBRTrait())]
+
+print("{:<30}{:>14}{:>14}{:>9}".format("model","policy (s)","std::function","ratio"))
+for name,p,f in models:
+    if fp.fitness_values(p,f) != fp.fitness_values(p,f,dispatch=False):
+        raise RuntimeError(name+": policy and std::function values differ")
+    tp = timeit.timeit(lambda: fp.fitness_values(p,f),number=args.reps)/args.reps
+    tf = timeit.timeit(lambda: fp.fitness_values(p,f,dispatch=False),number=args.reps)/args.reps
+    print("{:<30}{:>14.3e}{:>14.3e}{:>9.2f}".format(name,tp,tf,tf/tp))